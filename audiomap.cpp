@@ -16,8 +16,26 @@
 #include <vector>
 #include <string>
 #include <thread>
-#include <mutex>
 #include <atomic>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#include "core/cluster.h"
+#include "core/decoder.h"
+#include "core/features.h"
+#include "core/fingerprint.h"
+#include "core/layout.h"
+#include "core/metadata.h"
+#include "core/parallel.h"
+#include "core/pcmfile.h"
+#include "core/project.h"
+#include "core/raster.h"
+#include "core/selection.h"
+#include "core/similarity.h"
+#include "core/thumbs.h"
+#include "core/trace.h"
+#include "core/watch.h"
 
 #pragma comment(lib, "Gdiplus.lib")
 #pragma comment(lib, "ole32.lib")
@@ -26,8 +44,7 @@
 #pragma comment(lib, "mfreadwrite.lib")
 #pragma comment(lib, "mfuuid.lib")
 
-std::mutex g_appMutex;
-std::atomic<int> g_processedCount(0);
+std::atomic<int> g_processedCount(0), g_totalCount(0);
 
 #ifndef MF_SOURCE_READER_ENABLE_ADVANCED_PROCESSING
 DEFINE_GUID(MF_SOURCE_READER_ENABLE_ADVANCED_PROCESSING, 
@@ -44,8 +61,8 @@ bool IsRunningOnWine() {
 }
 
 #define MAX_FILES 5000
+#define MAX_ROOTS 32
 #define MAX_FILE_SIZE_MB 100
-#define WAVEFORM_RES 64 
 #define WIN_WIDTH 800
 #define WIN_HEIGHT 600
 
@@ -108,16 +125,24 @@ class DataObject : public IDataObject {
     FORMATETC fmtEtc;
     STGMEDIUM stgMed;
 public:
-    DataObject(const wchar_t* path) : refCount(1) {
+    // One CF_HDROP for all paths: a double-NUL-terminated list after the header, sized
+    // in one pass and copied in the next, so a drag of thousands of files is one allocation
+    DataObject(const std::vector<const wchar_t*>& paths) : refCount(1) {
         fmtEtc = { CF_HDROP, NULL, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
-        
-        int size = sizeof(DROPFILES) + (wcslen(path) + 2) * sizeof(wchar_t);
-        HGLOBAL hMem = GlobalAlloc(GHND, size);
+
+        std::vector<size_t> lens(paths.size());
+        size_t chars = 1;
+        for (size_t i = 0; i < paths.size(); i++) { lens[i] = wcslen(paths[i]) + 1; chars += lens[i]; }
+        HGLOBAL hMem = GlobalAlloc(GHND, sizeof(DROPFILES) + chars * sizeof(wchar_t));
         char* pMem = (char*)GlobalLock(hMem);
         DROPFILES* df = (DROPFILES*)pMem;
         df->pFiles = sizeof(DROPFILES);
         df->fWide = TRUE;
-        wcscpy((wchar_t*)(pMem + sizeof(DROPFILES)), path);
+        wchar_t* dst = (wchar_t*)(pMem + sizeof(DROPFILES));
+        for (size_t i = 0; i < paths.size(); i++) {
+            memcpy(dst, paths[i], lens[i] * sizeof(wchar_t));
+            dst += lens[i];
+        }
         GlobalUnlock(hMem);
 
         stgMed.tymed = TYMED_HGLOBAL;
@@ -237,21 +262,149 @@ public:
 typedef struct {
     wchar_t filename[MAX_PATH];
     wchar_t fullpath[MAX_PATH];
-    float* visualData;
     float zcr, rms;
-    int bitsPerSample, numSamples, sampleRate, channels;
+    float features[FEATURE_DIM];
+    Loudness loudness; // EBU R128 integrated, short-term max and true peak
+    Rhythm rhythm; // Onsets, tempo (0: no pulse) and loop score
+    float x, y; // World position from the active layout
+    unsigned long long sourceBytes, sourceTime; // File size/write time at analysis
+    unsigned int fingerprint[FP_FRAMES];
+    int fingerprintLen;
+    int dupOf;     // Kept copy of this file's duplicate group (itself if kept), -1 if unique
+    int dupCopies; // Other files in the duplicate group
+    int bitsPerSample, numSamples, sampleRate, channels; // Source bit depth (0 for lossy codecs)
+    bool isFloat;
     float duration;
     long fileSize;
-    int screenX, screenY;
-    COLORREF color;
+    COLORREF color; // Gradient over zcr
+    int cluster;    // From the active cluster method, CLUSTER_NOISE if in none
     UIAnim listHoverAnim, textAnim;
     float rippleAnim;
+    int root;      // Library root the file was found under
 } AudioSample;
 
+// GDI/GDI+ objects kept across frames. Solid pens and brushes come from small rings and
+// are recoloured per use, so a returned object stays valid for the next RING - 1 calls;
+// glows share one unit-circle gradient mapped onto each shape by its transform. Created()
+// counts every object made, which stays flat once the first frames have run.
+class RenderCache {
+public:
+    enum { RING = 8 };
+    ~RenderCache() { Release(); }
+
+    // Graphics on the back buffer, with clip and transform reset for the new frame
+    Gdiplus::Graphics& Surface(HDC hdc) {
+        if (!graphics) { graphics = new Gdiplus::Graphics(hdc); created++; }
+        graphics->ResetClip();
+        graphics->ResetTransform();
+        return *graphics;
+    }
+    void DropSurface() { delete graphics; graphics = NULL; }   // Back buffer replaced
+
+    Gdiplus::SolidBrush& Fill(const Gdiplus::Color& c) {
+        Gdiplus::SolidBrush*& b = brushes[nextBrush++ % RING];
+        if (!b) { b = new Gdiplus::SolidBrush(c); created++; }
+        else b->SetColor(c);
+        return *b;
+    }
+
+    Gdiplus::Pen& Stroke(const Gdiplus::Color& c, float width) {
+        Gdiplus::Pen*& p = pens[nextPen++ % RING];
+        if (!p) { p = new Gdiplus::Pen(c, width); created++; }
+        else { p->SetColor(c); p->SetWidth(width); }
+        return *p;
+    }
+
+    // Fills area with a glow centred in ellipse, fading from center to transparent at
+    // the ellipse's edge (nothing is painted outside it)
+    void Glow(Gdiplus::Graphics& g, const Gdiplus::RectF& ellipse, const Gdiplus::RectF& area, const Gdiplus::Color& center) {
+        if (ellipse.Width <= 0 || ellipse.Height <= 0) return;
+        if (!radial) {
+            Gdiplus::GraphicsPath unit;
+            unit.AddEllipse(0.0f, 0.0f, 1.0f, 1.0f);
+            radial = new Gdiplus::PathGradientBrush(&unit);
+            created += 2;
+        }
+        Gdiplus::Color edge(0, center.GetRed(), center.GetGreen(), center.GetBlue());
+        int count = 1;
+        radial->SetCenterColor(center);
+        radial->SetSurroundColors(&edge, &count);
+        radial->ResetTransform();
+        radial->TranslateTransform(ellipse.X, ellipse.Y);
+        radial->ScaleTransform(ellipse.Width, ellipse.Height);
+        g.FillRectangle(radial, area);
+    }
+
+    // Pen whose colour fades in over the first and out over the last 15% of [left, right].
+    // A pen copies its brush, so this one is rebuilt whenever the span or alpha changes.
+    Gdiplus::Pen& FadePen(int left, int right, int alpha, float width) {
+        if (!fadePen || fadeLeft != left || fadeRight != right || fadeAlpha != alpha) {
+            delete fadePen;
+            Gdiplus::Color clear(0, 237, 237, 237), solid(alpha, 237, 237, 237);
+            Gdiplus::LinearGradientBrush brush(Gdiplus::Point(left, 0), Gdiplus::Point(right, 0), clear, clear);
+            brush.SetWrapMode(Gdiplus::WrapModeTileFlipX);
+            Gdiplus::Color colors[] = { clear, solid, solid, clear };
+            REAL positions[] = { 0.0f, 0.15f, 0.85f, 1.0f };
+            brush.SetInterpolationColors(colors, positions, 4);
+            fadePen = new Gdiplus::Pen(&brush, width);
+            created += 2;
+            fadeLeft = left; fadeRight = right; fadeAlpha = alpha;
+        }
+        return *fadePen;
+    }
+
+    HFONT UiFont() {
+        if (!font) {
+            font = CreateFontA(-11, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+                               DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                               CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
+            created++;
+        }
+        return font;
+    }
+
+    HRGN ClipRegion(int left, int top, int right, int bottom) {
+        if (!region) { region = CreateRectRgn(left, top, right, bottom); created++; }
+        else SetRectRgn(region, left, top, right, bottom);
+        return region;
+    }
+
+    long long Created() const { return created; }
+
+    // Must run before GdiplusShutdown
+    void Release() {
+        DropSurface();
+        for (int i = 0; i < RING; i++) {
+            delete brushes[i]; brushes[i] = NULL;
+            delete pens[i]; pens[i] = NULL;
+        }
+        delete radial; radial = NULL;
+        delete fadePen; fadePen = NULL;
+        if (font) DeleteObject(font);
+        if (region) DeleteObject(region);
+        font = NULL;
+        region = NULL;
+    }
+
+private:
+    Gdiplus::Graphics* graphics = NULL;
+    Gdiplus::SolidBrush* brushes[RING] = {};
+    Gdiplus::Pen* pens[RING] = {};
+    unsigned nextBrush = 0, nextPen = 0;
+    Gdiplus::PathGradientBrush* radial = NULL;
+    Gdiplus::Pen* fadePen = NULL;
+    int fadeLeft = 0, fadeRight = 0, fadeAlpha = -1;
+    HFONT font = NULL;
+    HRGN region = NULL;
+    long long created = 0;
+};
+
+RenderCache g_render;
+
 // Wiggly line
 class Oscilloscope {
 public:
-    void Draw(HDC hdc, RECT r, char* audioMem, DWORD startTime, int byteRate, int alpha, int maxBytes) {
+    void Draw(HDC hdc, Gdiplus::Graphics& g, RECT r, char* audioMem, DWORD startTime, int byteRate, int alpha, int maxBytes) {
         int w = r.right - r.left;
         int h = r.bottom - r.top;
         int cy = r.top + h / 2;
@@ -263,28 +416,18 @@ public:
         SetTextColor(hdc, RGB(Blend(237), Blend(237), Blend(237)));
         TextOutA(hdc, r.left + (w - sz.cx) / 2, r.top - sz.cy - 5, hint, 3);
 
-        Gdiplus::Graphics g(hdc);
         g.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias);
 
         // Background
         {
             int centerX = r.left + w / 2;
             int centerY = r.top + h / 2;
-            Gdiplus::GraphicsPath path;
-            path.AddEllipse(centerX - w/2, centerY - h, w, h*2);
-            
-            Gdiplus::PathGradientBrush brush(&path);
-            Gdiplus::Color centerColor(Blend(40), 10, 10, 15);
-            Gdiplus::Color edgeColor(0, 10, 10, 15);
-            brush.SetCenterColor(centerColor);
-            int count = 1;
-            brush.SetSurroundColors(&edgeColor, &count);
-            g.FillRectangle(&brush, r.left, r.top, w, h);
+            g_render.Glow(g, Gdiplus::RectF((REAL)(centerX - w/2), (REAL)(centerY - h), (REAL)w, (REAL)(h*2)),
+                          Gdiplus::RectF((REAL)r.left, (REAL)r.top, (REAL)w, (REAL)h), Gdiplus::Color(Blend(40), 10, 10, 15));
         }
 
         if (!audioMem || byteRate == 0 || maxBytes <= 44) {
-            Gdiplus::Pen penIdle(Gdiplus::Color(alpha / 2, 60, 60, 70), 1.0f);
-            g.DrawLine(&penIdle, r.left, cy, r.right, cy);
+            g.DrawLine(&g_render.Stroke(Gdiplus::Color(alpha / 2, 60, 60, 70), 1.0f), r.left, cy, r.right, cy);
             return;
         }
 
@@ -308,20 +451,11 @@ public:
         int samplesPerPixel = samplesInView / w;
         if (samplesPerPixel < 1) samplesPerPixel = 1;
 
-        Gdiplus::Point ptStart(r.left, cy);
-        Gdiplus::Point ptEnd(r.right, cy);
-        Gdiplus::Color colTrans(0, 237, 237, 237);
-        Gdiplus::Color colSolid(alpha, 237, 237, 237);
-        
-        Gdiplus::LinearGradientBrush penBrush(ptStart, ptEnd, colTrans, colTrans);
-        penBrush.SetWrapMode(Gdiplus::WrapModeTileFlipX);
-        Gdiplus::Color colors[] = { colTrans, colSolid, colSolid, colTrans };
-        REAL positions[] = { 0.0f, 0.15f, 0.85f, 1.0f };
-        penBrush.SetInterpolationColors(colors, positions, 4);
-        Gdiplus::Pen penWave(&penBrush, 1.5f);
+        // Edges fade out; the pen is reused while the rect and alpha hold
+        Gdiplus::Pen& penWave = g_render.FadePen(r.left, r.right, alpha, 1.5f);
 
-        std::vector<Gdiplus::PointF> points;
-        points.reserve(w);
+        // Buffers keep their capacity across frames
+        points.clear();
 
         for(int i = 0; i < w; i++) {
             long long p = startByte + (long long)i * samplesPerPixel * 2;
@@ -353,7 +487,7 @@ public:
 
         // Apply a [1, 2, 1] kernel to smooth jagged edges before drawing
         if (points.size() > 2) {
-            std::vector<Gdiplus::PointF> smoothPts = points;
+            smoothPts = points;
             for (size_t i = 1; i < points.size() - 1; i++) {
                 // Average: 25% Left, 50% Center, 25% Right
                 float ny = (points[i-1].Y + points[i].Y * 2.0f + points[i+1].Y) / 4.0f;
@@ -363,6 +497,9 @@ public:
             g.DrawCurve(&penWave, smoothPts.data(), (INT)smoothPts.size(), 0.5f); 
         }
     }
+
+private:
+    std::vector<Gdiplus::PointF> points, smoothPts;
 };
 
 // Global app state
@@ -387,6 +524,27 @@ typedef struct {
     
     // Data bounds
     float minX, maxX, minY, maxY;
+
+    // Layout
+    int layoutMethod;
+    int axisY;                          // Height on the axes layout (MapAxis)
+    float layoutSpread;
+    int clusterMethod;                  // Colours and list groups; -1 = off (zcr gradient)
+
+    // Similar panel
+    bool isSimilarOpen;
+    int simPanelN;
+    int simPanelIds[MAX_SIMILAR], simPanelCount;
+    RECT simPanelRect;
+
+    // Metadata filters
+    bool isFilterOpen, hideFiltered;
+    int filterDragColumn, filterDragX;  // Histogram being dragged (-1 if none) and where it started
+    RECT filterPanelRect;
+
+    // Duplicates
+    bool collapseDuplicates;
+    int dupGroups;
     
     // UI state
     int hoverIndex, menuIndex, menuVisible;
@@ -427,32 +585,269 @@ typedef struct {
 } AppState;
 
 AppState app = {0};
+LayoutEngine g_layout;
+ClusterEngine g_cluster;
+int g_clusterFitCount;                  // Samples in the last full cluster fit
+SimilarityIndex g_simIndex;
+DuplicateIndex g_dupIndex;
+
+// A folder in the library; its samples carry its index in AudioSample::root
+struct LibraryRoot {
+    wchar_t path[MAX_PATH];
+    int files, duplicates;              // Per-root stats (UpdateRootStats)
+    double duration;                    // Seconds of audio
+    unsigned long long bytes;
+    double scanMs;                      // Collect + analyse time of the scan that added it
+    FolderWatcher watcher;
+    bool overflow;                      // Change events were dropped: re-list the root
+    bool cacheDirty;                    // Samples changed since its feature cache was written
+};
+
+// Library session: one or more roots merged into one map. In watch-folder mode files
+// changed under a root are re-analysed in place.
+struct Library {
+    std::vector<std::unique_ptr<LibraryRoot>> roots;
+    ThumbnailStore thumbs;              // Hover waveforms, slot i for sample i
+    bool pinThumbBins = false;          // Keep the resolution instead of taking the first cache's
+    bool watchEnabled = true;
+    std::vector<std::string> pending;   // Changed paths waiting for the burst to settle
+    DWORD lastEvent, lastPoll;
+} g_library;
+
+// Frame profiler: DrawMap sections timed while the 'P' overlay is shown
+enum { PROF_LINES, PROF_DOTS, PROF_TILES, PROF_LABELS, PROF_MENU, PROF_PANELS, PROF_OSC, PROF_MINIMAP,
+       PROF_HUD, PROF_LIST, PROF_BLIT, PROF_SECTIONS };
+static const char* const g_profNames[PROF_SECTIONS] = { "lines", "dots", "tiles", "labels", "menu", "panels",
+                                                        "oscilloscope", "minimap", "hud", "list", "blit" };
+FrameProfiler g_frameProf(g_profNames, PROF_SECTIONS);
+bool g_showProfiler = false;
+
+// Heap allocations through operator new (the profiler reports them per frame)
+static std::atomic<long long> g_newCount(0);
+void* operator new(size_t size) {
+    g_newCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
 
 // Backbuffer
 HDC g_hdcBack = NULL;
 HBITMAP g_hbmBack = NULL;
+unsigned int* g_backBits = NULL;    // Top-down 32-bit DIB section pixels
 int g_bbWidth = 0, g_bbHeight = 0;
 
-// Sort by color
-int CompareSamplesColor(const void* a, const void* b) {
-    int idxA = *(const int*)a;
-    int idxB = *(const int*)b;
-    if (app.samples[idxA].color < app.samples[idxB].color) return -1;
-    if (app.samples[idxA].color > app.samples[idxB].color) return 1;
-    return 0;
+// Map layer (background, grid, neighbour lines, dots) rasterised in parallel screen
+// tiles straight into the back buffer; text and panels are drawn over it with GDI
+TileRasterizer g_tiles;
+
+// World positions mirrored into flat arrays for the per-frame projection pass, which
+// fills screenX/screenY for every sample and lists the ones on screen. Rebuilt only
+// after something moves, adds, removes or hides samples (MarkMapDirty)
+struct MapView {
+    float x[MAX_FILES], y[MAX_FILES];
+    unsigned char hidden[MAX_FILES];    // Collapsed duplicate copies, filtered-out samples in hide mode
+    int screenX[MAX_FILES], screenY[MAX_FILES];
+    int visible[MAX_FILES];             // On-screen samples, in index (paint) order
+    float radius[MAX_FILES];            // Drawn radius, parallel to visible
+    int visibleCount;
+    int count;                          // Samples mirrored (-1 forces a rebuild)
+    MapTransform proj;                  // Of the last frame, to map the mouse back to world positions
+} g_mapView = { {0}, {0}, {0}, {0}, {0}, {0}, {0}, 0, -1 };
+
+// World positions bucketed for selection queries, rebuilt with the map view
+PointGrid g_mapGrid;
+
+// Map selection: flags by sample index (RemoveSamples moves them with their samples).
+// Gestures re-query g_mapGrid on every mouse move instead of scanning the samples.
+enum { SELECT_NONE, SELECT_RECT, SELECT_LASSO };
+struct Selection {
+    unsigned char flag[MAX_FILES];
+    std::vector<int> ids;               // Selected samples in index order
+    int gesture;                        // SELECT_* while the mouse button is down
+    std::vector<Gdiplus::PointF> outline;   // Gesture in screen pixels (rectangle: two corners)
+} g_selection;
+
+void SetSelection(const std::vector<int>& ids) {
+    for (int id : g_selection.ids) g_selection.flag[id] = 0;
+    g_selection.ids.clear();
+    for (int id : ids) {
+        if (g_mapView.hidden[id]) continue;
+        g_selection.flag[id] = 1;
+        g_selection.ids.push_back(id);
+    }
+}
+
+void ClearSelection() { SetSelection(std::vector<int>()); }
+
+// Drop flags of samples past the count or no longer shown, and relist the rest
+void RefreshSelection() {
+    g_selection.ids.clear();
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!g_selection.flag[i]) continue;
+        if (i >= app.count || g_mapView.hidden[i]) g_selection.flag[i] = 0;
+        else g_selection.ids.push_back(i);
+    }
+}
+
+// Filterable per-sample properties: source metadata, then the feature vector.
+// Duration and size are kept as log10 so their histograms spread over the range.
+enum MetaColumn { META_DURATION, META_RATE, META_CHANNELS, META_SIZE, META_LUFS, META_SHORT_TERM, META_TRUE_PEAK,
+                  META_TEMPO, META_FEATURES, META_COLUMNS = META_FEATURES + FEATURE_DIM };
+
+MetadataIndex g_meta;
+bool g_metaStale = true;                // Samples changed since the index was built
+
+const char* MetaColumnName(int c) {
+    switch (c) {
+        case META_DURATION: return "length";
+        case META_RATE:     return "rate";
+        case META_CHANNELS: return "channels";
+        case META_SIZE:     return "size";
+        case META_LUFS:     return "loudness";
+        case META_SHORT_TERM: return "short-term max";
+        case META_TRUE_PEAK: return "true peak";
+        case META_TEMPO:    return "tempo";
+    }
+    return FeatureName(c - META_FEATURES);
+}
+
+void FormatMetaValue(int c, float v, char* out) {
+    switch (c) {
+        case META_DURATION: sprintf(out, "%.2fs", powf(10.0f, v)); break;
+        case META_SIZE:     sprintf(out, "%.2f MB", powf(10.0f, v) / 1048576.0f); break;
+        case META_RATE:
+        case META_CHANNELS: sprintf(out, "%.0f", v); break;
+        case META_LUFS:
+        case META_SHORT_TERM: sprintf(out, "%.1f LUFS", v); break;
+        case META_TRUE_PEAK: sprintf(out, "%.1f dBTP", v); break;
+        case META_TEMPO:    sprintf(out, "%.1f BPM", v); break;
+        default:            sprintf(out, "%.3f", v); break;
+    }
+}
+
+void SyncMetadata() {
+    if (!g_metaStale) return;
+    std::vector<float> values((size_t)META_COLUMNS * app.count);
+    for (int i = 0; i < app.count; i++) {
+        const AudioSample& s = app.samples[i];
+        float* v = &values[i];
+        v[(size_t)META_DURATION * app.count] = log10f(s.duration > 0.001f ? s.duration : 0.001f);
+        v[(size_t)META_RATE * app.count] = (float)s.sampleRate;
+        v[(size_t)META_CHANNELS * app.count] = (float)s.channels;
+        v[(size_t)META_SIZE * app.count] = log10f(s.fileSize > 0 ? (float)s.fileSize : 1.0f);
+        v[(size_t)META_LUFS * app.count] = s.loudness.integrated;
+        v[(size_t)META_SHORT_TERM * app.count] = s.loudness.shortTermMax;
+        v[(size_t)META_TRUE_PEAK * app.count] = s.loudness.truePeak;
+        v[(size_t)META_TEMPO * app.count] = s.rhythm.tempo;
+        for (int d = 0; d < FEATURE_DIM; d++) v[(size_t)(META_FEATURES + d) * app.count] = s.features[d];
+    }
+    g_meta.Build(values.data(), app.count, META_COLUMNS);
+    g_metaStale = false;
+}
+
+void MarkMapDirty() { g_mapView.count = -1; g_metaStale = true; }
+
+// A filter changed: only hide mode changes which samples are projected
+void MarkFilterChanged() { if (app.hideFiltered) g_mapView.count = -1; }
+
+void SyncMapView() {
+    if (g_mapView.count == app.count) return;
+    SyncMetadata();
+    bool hideFiltered = app.hideFiltered && g_meta.AnyActive();
+    for (int i = 0; i < app.count; i++) {
+        const AudioSample& s = app.samples[i];
+        g_mapView.x[i] = s.x;
+        g_mapView.y[i] = s.y;
+        g_mapView.hidden[i] = ((app.collapseDuplicates && s.dupOf >= 0 && s.dupOf != i) ||
+                               (hideFiltered && !g_meta.Match(i))) ? 1 : 0;
+    }
+    g_mapView.count = app.count;
+    g_mapGrid.Build(g_mapView.x, g_mapView.y, app.count);
+    RefreshSelection();
+}
+
+// Select what the gesture outline covers (screen pixels mapped back to world positions)
+void UpdateSelectionGesture() {
+    SyncMapView();
+    const MapTransform& t = g_mapView.proj;
+    const std::vector<Gdiplus::PointF>& o = g_selection.outline;
+    if (t.scaleX == 0 || t.scaleY == 0) return;
+    std::vector<int> hits;
+    if (g_selection.gesture == SELECT_RECT && o.size() == 2) {
+        g_mapGrid.QueryRect((o[0].X - t.offsetX) / t.scaleX, (o[0].Y - t.offsetY) / t.scaleY,
+                            (o[1].X - t.offsetX) / t.scaleX, (o[1].Y - t.offsetY) / t.scaleY, hits);
+    } else if (g_selection.gesture == SELECT_LASSO && o.size() >= 3) {
+        std::vector<float> px(o.size()), py(o.size());
+        for (size_t k = 0; k < o.size(); k++) {
+            px[k] = (o[k].X - t.offsetX) / t.scaleX;
+            py[k] = (o[k].Y - t.offsetY) / t.scaleY;
+        }
+        g_mapGrid.QueryLasso(px.data(), py.data(), (int)o.size(), hits);
+    }
+    SetSelection(hits);
+}
+
+// Filter panel histogram under (mx, my), -1 if none (layout as drawn in DrawMap)
+int FilterColumnAt(int mx, int my) {
+    const RECT& r = app.filterPanelRect;
+    if (!app.isFilterOpen || mx < r.left + 8 || mx > r.right - 8 || my < r.top + 24) return -1;
+    int c = (my - (r.top + 24)) / 34;
+    if (c >= g_meta.Columns() || my - (r.top + 24) - c * 34 < 14) return -1;
+    return c;
+}
+
+// Column value under screen x of a filter histogram
+float FilterValueAt(int c, int mx) {
+    const RECT& r = app.filterPanelRect;
+    float t = (float)(mx - (r.left + 8)) / (float)(r.right - r.left - 16);
+    if (t <= 0.0f) return g_meta.Min(c);
+    if (t >= 1.0f) return g_meta.Max(c);
+    return g_meta.Min(c) + (g_meta.Max(c) - g_meta.Min(c)) * t;
+}
+
+// Distinct pastel per cluster, stepping the hue by the golden ratio; noise is grey
+COLORREF ClusterColor(int c) {
+    if (c < 0) return RGB(110, 110, 115);
+    float h = fmodf(0.1f + c * 0.618034f, 1.0f) * 6.0f, f = h - (int)h;
+    float hi = 240.0f, lo = 130.0f, rise = lo + (hi - lo) * f, fall = hi - (hi - lo) * f;
+    switch ((int)h) {
+        case 0:  return RGB((int)hi, (int)rise, (int)lo);
+        case 1:  return RGB((int)fall, (int)hi, (int)lo);
+        case 2:  return RGB((int)lo, (int)hi, (int)rise);
+        case 3:  return RGB((int)lo, (int)fall, (int)hi);
+        case 4:  return RGB((int)rise, (int)lo, (int)hi);
+        default: return RGB((int)hi, (int)lo, (int)fall);
+    }
+}
+
+COLORREF SampleColor(const AudioSample& s) {
+    return app.clusterMethod >= 0 ? ClusterColor(s.cluster) : s.color;
+}
+
+// List order: by cluster (noise last) when clustering, then by color
+unsigned int SortKey(const AudioSample& s) {
+    if (app.clusterMethod < 0) return s.color;
+    unsigned int group = s.cluster >= 0 ? (unsigned int)s.cluster : MAX_CLUSTERS;
+    return group << 24 | (s.color & 0xFFFFFF);
 }
 
 void SortSamples() {
-    for(int i=0; i<app.count; i++) app.sortedIndices[i] = i;
-    qsort(app.sortedIndices, app.count, sizeof(int), CompareSamplesColor);
+    std::vector<unsigned int> keys(app.count);
+    for (int i = 0; i < app.count; i++) keys[i] = SortKey(app.samples[i]);
+    SortIndicesByKey(keys.data(), app.count, app.sortedIndices);
 }
 
 // Check if rect overlaps any existing dots
 int CheckOverlap(RECT r) {
     for (int i = 0; i < app.count; i++) {
         if (i == app.hoverIndex) continue;
-        int x = app.samples[i].screenX;
-        int y = app.samples[i].screenY;
+        int x = g_mapView.screenX[i];
+        int y = g_mapView.screenY[i];
         if (x >= r.left && x <= r.right && y >= r.top && y <= r.bottom) return 1;
     }
     return 0;
@@ -467,47 +862,110 @@ bool IsRectOverlap(RECT r, RECT* existing, int count) {
     return false;
 }
 
+// WAV/AIFF/FLAC/MP3 are decoded from a file mapping by the core; false forces Media Foundation (--decoder mf)
+bool g_nativeDecode = true;
+
 // Decode audio to PCM
 class AudioDecoder {
 public:
+    // 16-bit interleaved samples for playback (malloc'd, caller frees)
     static short* Load(const wchar_t* filepath, int* outSamples, int* outRate, int* outChannels) {
         *outSamples = 0; *outRate = 0; *outChannels = 0;
 
+        if (g_nativeDecode) {
+            MappedFile mapped;
+            PcmFormat fmt;
+            if (mapped.Open(filepath) && ParsePcmFile(mapped.Data(), mapped.Size(), &fmt)) {
+                std::vector<short> scratch;
+                const short* pcm = PcmAsInt16(fmt, scratch);
+                size_t count = (size_t)fmt.frames * fmt.channels;
+                short* buffer = (short*)malloc(count * sizeof(short));
+                if (!buffer) return NULL;
+                memcpy(buffer, pcm, count * sizeof(short));
+                *outSamples = (int)count; *outRate = fmt.sampleRate; *outChannels = fmt.channels;
+                return buffer;
+            }
+            // FLAC and MP3 through the built-in decoders
+            std::unique_ptr<AudioStream> stream;
+            if (mapped.Data()) stream = OpenAudioStream(mapped.Data(), mapped.Size());
+            std::vector<short> pcmOut;
+            if (stream && DecodeStream(*stream, pcmOut) && !pcmOut.empty()) {
+                short* buffer = (short*)malloc(pcmOut.size() * sizeof(short));
+                if (!buffer) return NULL;
+                memcpy(buffer, pcmOut.data(), pcmOut.size() * sizeof(short));
+                *outSamples = (int)pcmOut.size(); *outRate = stream->sampleRate; *outChannels = stream->channels;
+                return buffer;
+            }
+        }
+
+        std::vector<short> pcm;
+        int rate, ch, bits;
+        bool isFloat;
+        if (!DecodeMF(filepath, pcm, &rate, &ch, &bits, &isFloat)) return NULL;
+        short* buffer = (short*)malloc(pcm.size() * sizeof(short));
+        if (!buffer) return NULL;
+        memcpy(buffer, pcm.data(), pcm.size() * sizeof(short));
+        *outSamples = (int)pcm.size(); *outRate = rate; *outChannels = ch;
+        return buffer;
+    }
+
+    // Media Foundation decode for the analysis: 32-bit float output, so nothing is
+    // quantised, plus the source's own resolution (0 when the codec has none, e.g. mp3)
+    static bool LoadFloat(const wchar_t* filepath, std::vector<float>& out, int* outRate, int* outChannels,
+                          int* outBits, bool* outFloat) {
+        return DecodeMF(filepath, out, outRate, outChannels, outBits, outFloat);
+    }
+
+private:
+    // T is short (16-bit PCM output) or float (32-bit float output)
+    template <typename T>
+    static bool DecodeMF(const wchar_t* filepath, std::vector<T>& out, int* outRate, int* outChannels,
+                         int* outBits, bool* outFloat) {
+        out.clear();
         WIN32_FILE_ATTRIBUTE_DATA fad;
         if (!GetFileAttributesExW(filepath, GetFileExInfoStandard, &fad) || 
             (fad.nFileSizeHigh == 0 && fad.nFileSizeLow == 0)) {
-            return NULL; 
+            return false; 
         }
 
+        long long openStart = g_tracer.Active() ? g_tracer.NowUs() : -1;
         IMFSourceReader* pReader = NULL;
-        if (FAILED(MFCreateSourceReaderFromURL(filepath, NULL, &pReader))) return NULL;
+        if (FAILED(MFCreateSourceReaderFromURL(filepath, NULL, &pReader))) return false;
+
+        // Source format before conversion
+        UINT32 nativeBits = 0;
+        GUID nativeSubtype = GUID_NULL;
+        IMFMediaType* pNative = NULL;
+        if (SUCCEEDED(pReader->GetNativeMediaType((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, &pNative))) {
+            pNative->GetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, &nativeBits);
+            pNative->GetGUID(MF_MT_SUBTYPE, &nativeSubtype);
+            pNative->Release();
+        }
 
         IMFMediaType* pType = NULL;
         MFCreateMediaType(&pType);
         pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
-        pType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
-        pType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
+        pType->SetGUID(MF_MT_SUBTYPE, sizeof(T) == 4 ? MFAudioFormat_Float : MFAudioFormat_PCM);
+        pType->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, (UINT32)sizeof(T) * 8);
 
         if (FAILED(pReader->SetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, NULL, pType))) {
-            pType->Release(); pReader->Release(); return NULL;
+            pType->Release(); pReader->Release(); return false;
         }
         pType->Release();
 
         IMFMediaType* pCurrentType = NULL;
         if (FAILED(pReader->GetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, &pCurrentType))) {
-            pReader->Release(); return NULL;
+            pReader->Release(); return false;
         }
 
         UINT32 rate = 44100, ch = 2;
         pCurrentType->GetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, &rate);
         pCurrentType->GetUINT32(MF_MT_AUDIO_NUM_CHANNELS, &ch);
         pCurrentType->Release();
+        if (openStart >= 0) g_tracer.Complete("mf open", openStart, g_tracer.NowUs() - openStart);
 
-        size_t capacity = 4096; 
-        size_t count = 0; 
-        short* buffer = (short*)malloc(capacity * sizeof(short));
-        if (!buffer) { pReader->Release(); return NULL; }
-
+        TraceScope decodeScope("mf decode");
+        out.reserve(4096);
         while (true) {
             IMFSample* pSample = NULL; 
             DWORD flags = 0;
@@ -524,90 +982,317 @@ public:
                 BYTE* data = NULL; 
                 DWORD len = 0;
                 if (SUCCEEDED(pMediaBuf->Lock(&data, NULL, &len))) {
-                    len &= ~1; 
-                    int newShorts = len / 2;
-                    if (count + newShorts > capacity) {
-                        size_t newCap = (capacity + newShorts) * 2;
-                        short* temp = (short*)realloc(buffer, newCap * sizeof(short));
-                        if (!temp) { 
-                            free(buffer); buffer = NULL; 
-                            pMediaBuf->Unlock(); pMediaBuf->Release(); pSample->Release(); break; 
-                        }
-                        buffer = temp; capacity = newCap;
-                    }
-                    if (buffer) { memcpy(buffer + count, data, len); count += newShorts; }
+                    size_t newValues = len / sizeof(T);
+                    size_t at = out.size();
+                    out.resize(at + newValues);
+                    memcpy(&out[at], data, newValues * sizeof(T));
                     pMediaBuf->Unlock();
                 }
                 pMediaBuf->Release();
             }
             pSample->Release();
-            if (!buffer || count > 15000000) break;
+            if (out.size() > 15000000) break;
         }
         pReader->Release();
 
-        if (count == 0 || !buffer) { if (buffer) free(buffer); return NULL; }
-        *outSamples = (int)count; *outRate = rate; *outChannels = ch;
-        return buffer;
+        if (out.empty()) return false;
+        *outRate = rate; *outChannels = ch;
+        *outFloat = nativeSubtype == MFAudioFormat_Float;
+        *outBits = (int)nativeBits;
+        return true;
     }
 };
 
-// Process one audio file
-void ProcessFile(const wchar_t* filepath) {
-    int numSamples, rate, ch;
-    short* rawData = AudioDecoder::Load(filepath, &numSamples, &rate, &ch);
-    if (!rawData) return;
-    
-    AudioSample* s = &app.samples[app.count];
-    s->visualData = (float*)calloc(WAVEFORM_RES, sizeof(float));
-    
-    // NULL check
-    if (!s->visualData) {
-        free(rawData);
-        return;
-    }
-
-    double totalSq = 0; 
-    int crossings = 0;
-    int visualStep = numSamples / WAVEFORM_RES; 
-    if (visualStep < 1) visualStep = 1;
-    
-    for (int i = 0; i < numSamples; i++) {
-        float val = rawData[i] / 32768.0f;
-        if (i > 0 && rawData[i] * rawData[i-1] < 0) crossings++;
-        totalSq += val * val;
-        if (i % visualStep == 0 && (i/visualStep) < WAVEFORM_RES) 
-            s->visualData[i/visualStep] = val;
-    }
-    
-    float rawRms = (float)sqrt(sqrt(totalSq / numSamples)); 
-    float rawZcr = (float)sqrt((float)crossings / numSamples);
-    float spreadRms = powf(rawRms, 0.33f); 
-    float spreadZcr = powf(rawZcr, 0.33f);
-    
-    float jitterX = ((float)(rand() % 100) / 100.0f - 0.5f) * 0.05f; 
-    float jitterY = ((float)(rand() % 100) / 100.0f - 0.5f) * 0.05f;
-    s->rms = (spreadRms + jitterY) * 5.0f; 
-    s->zcr = (spreadZcr + jitterX) * 5.0f; 
+// Fill a sample (and its thumbnail envelope) from the portable analysis
+void SetSampleAnalysis(const SampleAnalysis& a, const wchar_t* filepath, AudioSample* s, Envelope* thumb) {
+    *thumb = a.envelope;
+    s->zcr = a.zcr; s->rms = a.rms;
+    memcpy(s->features, a.features, sizeof(s->features));
+    s->loudness = a.loudness;
+    s->rhythm = a.rhythm;
+    memcpy(s->fingerprint, a.fingerprint, sizeof(s->fingerprint));
+    s->fingerprintLen = a.fingerprintLen;
+    s->dupOf = -1; s->dupCopies = 0;
     
     const wchar_t* p = wcsrchr(filepath, L'\\'); 
     wcscpy(s->filename, p ? p + 1 : filepath); 
     wcscpy(s->fullpath, filepath);
     
-    s->bitsPerSample = 16; s->numSamples = numSamples / ch; 
-    s->sampleRate = rate; s->channels = ch;
-    s->duration = (float)s->numSamples / (float)rate; s->fileSize = numSamples * 2; 
-    s->fileSize = numSamples * 2; 
+    s->bitsPerSample = a.bitsPerSample; s->isFloat = a.isFloat;
+    s->numSamples = a.numFrames; 
+    s->sampleRate = a.sampleRate; s->channels = a.channels;
+    s->duration = a.duration;
     s->rippleAnim = 0.0f;
+    s->color = (COLORREF)a.color;
+    s->cluster = CLUSTER_NOISE;
+}
 
-    float t = rawZcr * 3.0f; 
-    if (t > 1.0f) t = 1.0f;
-    int r, g, b;
-    if (t < 0.5f) { float lt = t*2.0f; r=255-(int)(lt*100); g=100+(int)(lt*155); b=100; } 
-    else { float lt = (t-0.5f)*2.0f; r=155-(int)(lt*100); g=255-(int)(lt*100); b=100+(int)(lt*155); }
-    s->color = RGB((r+255)/2, (g+255)/2, (b+255)/2);
-    
-    app.count++; 
-    free(rawData);
+static inline unsigned long long HashPath(const wchar_t* path) {
+    return HashBytes(path, wcslen(path) * sizeof(wchar_t));
+}
+
+// File in the app's data folder: %LOCALAPPDATA%\audiomap\<name>
+bool GetAppDataPath(const wchar_t* name, wchar_t* out) {
+    wchar_t base[MAX_PATH], dir[MAX_PATH];
+    DWORD len = GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH);
+    if (len == 0 || len >= MAX_PATH) return false;
+    swprintf(dir, MAX_PATH, L"%s\\audiomap", base);
+    CreateDirectoryW(dir, NULL);
+    swprintf(out, MAX_PATH, L"%s\\%s", dir, name);
+    return true;
+}
+
+// Cache file for a library root: %LOCALAPPDATA%\audiomap\<hash>.<ext>
+bool GetCachePath(const wchar_t* root, const wchar_t* ext, wchar_t* out) {
+    wchar_t name[64];
+    swprintf(name, 64, L"%016llx.%s", HashPath(root), ext);
+    return GetAppDataPath(name, out);
+}
+
+// Analysed sample as stored on disk
+typedef struct {
+    wchar_t fullpath[MAX_PATH];
+    unsigned long long sourceBytes, sourceTime;
+    float features[FEATURE_DIM];
+    Loudness loudness;
+    Rhythm rhythm;
+    unsigned int fingerprint[FP_FRAMES];
+    int fingerprintLen;
+    float zcr, rms;
+    int bitsPerSample, numSamples, sampleRate, channels;
+    int isFloat;
+    float duration;
+    long fileSize;
+    COLORREF color;
+    Envelope thumb;                     // At the library's thumbnail resolution
+} CacheRecord;
+
+// Per-root feature cache; records are reused while file size and write time match
+class FeatureCache {
+    std::vector<CacheRecord> records;
+    std::vector<std::pair<unsigned long long, int>> lookup; // (path hash, record), sorted
+
+public:
+    bool Load(const wchar_t* path) {
+        records.clear(); lookup.clear();
+        FILE* f = _wfopen(path, L"rb");
+        if (!f) return false;
+        // Version 2: zcr/rms are stored without the old random jitter
+        // Version 3: analysis at the source resolution, true bit depth and float flag
+        // Version 4: per-channel zero crossings, stereo width feature
+        // Version 5: quantised min/max thumbnail envelopes
+        // Version 6: EBU R128 loudness and true peak
+        // Version 7: onsets, tempo and loop score (two more features)
+        int header[4] = {0};
+        bool ok = fread(header, sizeof(header), 1, f) == 1 && header[0] == 0x43464D41 /* AMFC */ && header[1] == 7 &&
+                  header[2] == (int)sizeof(CacheRecord) && header[3] >= 0 && header[3] <= MAX_FILES * 4;
+        if (ok) {
+            records.resize(header[3]);
+            ok = header[3] == 0 || fread(records.data(), sizeof(CacheRecord), header[3], f) == (size_t)header[3];
+        }
+        fclose(f);
+        if (!ok) { records.clear(); return false; }
+
+        lookup.reserve(records.size());
+        for (int i = 0; i < (int)records.size(); i++) {
+            records[i].fullpath[MAX_PATH - 1] = 0;
+            lookup.push_back({ HashPath(records[i].fullpath), i });
+        }
+        std::sort(lookup.begin(), lookup.end());
+        return true;
+    }
+
+    // Writes the samples of one library root (root < 0: all of them)
+    bool Save(const wchar_t* path, const AudioSample* samples, const ThumbnailStore& thumbs, int count, int root = -1) const {
+        FILE* f = _wfopen(path, L"wb");
+        if (!f) return false;
+        int stored = 0;
+        for (int i = 0; i < count; i++) stored += (root < 0 || samples[i].root == root);
+        int header[4] = { 0x43464D41, 7, (int)sizeof(CacheRecord), stored };
+        bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+        for (int i = 0; i < count && ok; i++) {
+            const AudioSample* s = &samples[i];
+            if (root >= 0 && s->root != root) continue;
+            CacheRecord r = {0};
+            wcscpy(r.fullpath, s->fullpath);
+            r.sourceBytes = s->sourceBytes; r.sourceTime = s->sourceTime;
+            memcpy(r.features, s->features, sizeof(r.features));
+            r.loudness = s->loudness;
+            r.rhythm = s->rhythm;
+            memcpy(r.fingerprint, s->fingerprint, sizeof(r.fingerprint));
+            r.fingerprintLen = s->fingerprintLen;
+            r.zcr = s->zcr; r.rms = s->rms;
+            r.bitsPerSample = s->bitsPerSample; r.numSamples = s->numSamples;
+            r.isFloat = s->isFloat;
+            r.sampleRate = s->sampleRate; r.channels = s->channels;
+            r.duration = s->duration; r.fileSize = s->fileSize; r.color = s->color;
+            thumbs.Load(i, &r.thumb);
+            ok = fwrite(&r, sizeof(r), 1, f) == 1;
+        }
+        fclose(f);
+        return ok;
+    }
+
+    // Thumbnail resolution the cache was written with (0: empty)
+    int ThumbBins() const { return records.empty() ? 0 : records[0].thumb.bins; }
+
+    bool Lookup(const wchar_t* fullpath, unsigned long long bytes, unsigned long long time, AudioSample* s, Envelope* thumb) const {
+        unsigned long long key = HashPath(fullpath);
+        auto it = std::lower_bound(lookup.begin(), lookup.end(), std::make_pair(key, -1));
+        for (; it != lookup.end() && it->first == key; ++it) {
+            const CacheRecord& r = records[it->second];
+            if (wcscmp(r.fullpath, fullpath) != 0 || r.sourceBytes != bytes || r.sourceTime != time) continue;
+            Get(it->second, s, thumb);
+            return true;
+        }
+        return false;
+    }
+
+    // Record i as a sample, without checking its file (a restored session does that later)
+    int Size() const { return (int)records.size(); }
+    void Get(int i, AudioSample* s, Envelope* thumb) const {
+        const CacheRecord& r = records[i];
+        *thumb = r.thumb;
+        if (thumb->bins < 1 || thumb->bins > THUMB_MAX_BINS) thumb->bins = 0;
+        const wchar_t* p = wcsrchr(r.fullpath, L'\\');
+        wcscpy(s->filename, p ? p + 1 : r.fullpath);
+        wcscpy(s->fullpath, r.fullpath);
+        memcpy(s->features, r.features, sizeof(r.features));
+        s->loudness = r.loudness;
+        s->rhythm = r.rhythm;
+        memcpy(s->fingerprint, r.fingerprint, sizeof(r.fingerprint));
+        s->fingerprintLen = r.fingerprintLen;
+        s->dupOf = -1; s->dupCopies = 0;
+        s->zcr = r.zcr; s->rms = r.rms;
+        s->bitsPerSample = r.bitsPerSample; s->numSamples = r.numSamples;
+        s->isFloat = r.isFloat != 0;
+        s->sampleRate = r.sampleRate; s->channels = r.channels;
+        s->duration = r.duration; s->fileSize = r.fileSize; s->color = r.color;
+        s->cluster = CLUSTER_NOISE;
+        s->sourceBytes = r.sourceBytes; s->sourceTime = r.sourceTime;
+        s->rippleAnim = 0.0f;
+    }
+};
+
+// Fill a sample and its thumbnail envelope from the cache, or decode and analyse it
+bool LoadSample(const wchar_t* path, const FeatureCache* cache, AudioSample* out, Envelope* thumb) {
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    {
+        TraceScope t("stat");
+        if (!GetFileAttributesExW(path, GetFileExInfoStandard, &fad)) return false;
+    }
+    unsigned long long bytes = ((unsigned long long)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+    unsigned long long time = ((unsigned long long)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+    if (cache) {
+        TraceScope t("cache lookup");
+        if (cache->Lookup(path, bytes, time, out, thumb)) { g_tracer.Add("cache hits", 1); return true; }
+    }
+
+    // WAV/AIFF/FLAC/MP3 are analysed straight from the mapping, the rest decoded to float by MF.
+    // Mapped pages are read on first touch, so their disk time lands in "decode".
+    SampleAnalysis a;
+    MappedFile mapped;
+    bool mappedOk;
+    { TraceScope t("map"); mappedOk = g_nativeDecode && mapped.Open(path); }
+    bool ok = mappedOk && AnalyzeAudioImage(mapped.Data(), mapped.Size(), &a);
+    if (!ok) {
+        std::vector<float> pcm;
+        int rate, ch, bits;
+        bool isFloat;
+        if (!AudioDecoder::LoadFloat(path, pcm, &rate, &ch, &bits, &isFloat)) return false;
+        TraceScope t("analyse");
+        ok = AnalyzePcm(pcm.data(), (int)pcm.size(), rate, ch, &a);
+        a.bitsPerSample = bits; a.isFloat = isFloat;
+        g_tracer.Add("mf files", 1);
+    }
+    if (!ok) return false;
+    SetSampleAnalysis(a, path, out, thumb);
+    g_tracer.Add("bytes read", (long long)bytes);
+    g_tracer.Add("audio ms", (long long)(a.duration * 1000.0f));
+    out->fileSize = (long)bytes;
+    out->sourceBytes = bytes; 
+    out->sourceTime = time;
+    return true;
+}
+
+// Process one audio file
+void ProcessFile(const wchar_t* filepath, const FeatureCache* cache, int root) {
+    Envelope thumb;
+    if (!LoadSample(filepath, cache, &app.samples[app.count], &thumb)) return;
+    g_library.thumbs.Store(app.count, thumb);
+    app.samples[app.count++].root = root;
+}
+
+// Load the persisted similarity index for this root, or rebuild and persist it
+void BuildSimilarityIndex(const wchar_t* root) {
+    std::vector<float> feats((size_t)app.count * FEATURE_DIM);
+    std::vector<unsigned long long> keys(app.count);
+    for (int i = 0; i < app.count; i++) {
+        memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[i].features, sizeof(float) * FEATURE_DIM);
+        keys[i] = HashPath(app.samples[i].fullpath);
+    }
+
+    wchar_t indexPath[MAX_PATH];
+    bool havePath = GetCachePath(root, L"simidx", indexPath);
+    if (havePath) {
+        FILE* f = _wfopen(indexPath, L"rb");
+        if (f) {
+            bool loaded = g_simIndex.Load(f, keys.data(), feats.data(), app.count);
+            fclose(f);
+            if (loaded) return;
+        }
+    }
+
+    g_simIndex.Build(feats.data(), app.count);
+    if (havePath) {
+        // A short write would be rejected on every later load: drop the file instead
+        FILE* f = _wfopen(indexPath, L"wb");
+        if (f) {
+            bool ok = g_simIndex.Save(f, keys.data(), feats.data(), app.count);
+            ok = fclose(f) == 0 && ok;
+            if (!ok) DeleteFileW(indexPath);
+        }
+    }
+}
+
+// Apply the duplicate index's groups; the longest (then largest) copy is kept
+void AssignDuplicateGroups() {
+    std::vector<int> group(app.count);
+    app.dupGroups = g_dupIndex.Groups(app.count, group.data());
+
+    std::vector<int> keep(app.count, -1), size(app.count, 0);
+    for (int i = 0; i < app.count; i++) {
+        app.samples[i].dupOf = -1; app.samples[i].dupCopies = 0;
+        int g = group[i];
+        if (g < 0) continue;
+        size[g]++;
+        int k = keep[g];
+        const AudioSample* a = &app.samples[i];
+        const AudioSample* b = (k >= 0) ? &app.samples[k] : NULL;
+        if (!b || a->duration > b->duration ||
+            (a->duration == b->duration && (a->sourceBytes > b->sourceBytes ||
+            (a->sourceBytes == b->sourceBytes && wcscmp(a->fullpath, b->fullpath) < 0))))
+            keep[g] = i;
+    }
+    for (int i = 0; i < app.count; i++) {
+        if (group[i] < 0) continue;
+        app.samples[i].dupOf = keep[group[i]];
+        app.samples[i].dupCopies = size[group[i]] - 1;
+    }
+    MarkMapDirty();
+}
+
+// Group near-identical files by fingerprint
+void FindDuplicates() {
+    std::vector<unsigned int> fps((size_t)app.count * FP_FRAMES);
+    std::vector<int> lens(app.count);
+    for (int i = 0; i < app.count; i++) {
+        memcpy(&fps[(size_t)i * FP_FRAMES], app.samples[i].fingerprint, sizeof(unsigned int) * FP_FRAMES);
+        lens[i] = app.samples[i].fingerprintLen;
+    }
+    g_dupIndex.numThreads = g_simIndex.numThreads;
+    g_dupIndex.Build(fps.data(), lens.data(), FP_FRAMES, app.count);
+    AssignDuplicateGroups();
 }
 
 // Play audio file
@@ -669,6 +1354,124 @@ void PlayAudio(int index) {
     app.playStartTime = GetTickCount(); // Store start time
 }
 
+// What the axes layout puts on the vertical axis (zcr stays horizontal)
+enum MapAxis { AXIS_RMS, AXIS_LUFS, AXIS_SHORT_TERM, AXIS_TRUE_PEAK, AXIS_COUNT };
+
+const char* AxisName(int a) {
+    static const char* names[] = { "rms", "lufs", "short-term max", "true peak" };
+    return (a >= 0 && a < AXIS_COUNT) ? names[a] : "?";
+}
+
+// Height before spreading: the rms curve, or loudness mapped from -70..0 LUFS (dBTP)
+// onto the same 0..5 range
+float AxisHeight(const AudioSample& s) {
+    float db;
+    switch (app.axisY) {
+        case AXIS_LUFS:       db = s.loudness.integrated; break;
+        case AXIS_SHORT_TERM: db = s.loudness.shortTermMax; break;
+        case AXIS_TRUE_PEAK:  db = s.loudness.truePeak; break;
+        default:              return s.rms;
+    }
+    db = db > LOUDNESS_FLOOR ? db : LOUDNESS_FLOOR;
+    return (db - LOUDNESS_FLOOR) * (5.0f / -LOUDNESS_FLOOR);
+}
+
+// Compute world positions for all samples with the active layout method
+void ApplyLayout() {
+    if (app.count == 0) return;
+
+    // Auto-scale
+    float density = (float)app.count;
+    app.layoutSpread = (density > 50) ? logf(density) * 2.5f : 1.0f;
+
+    // Lay out in path order so the map does not depend on which worker finished first
+    std::vector<std::pair<unsigned long long, int>> byPath(app.count);
+    for (int i = 0; i < app.count; i++) byPath[i] = { HashPath(app.samples[i].fullpath), i };
+    std::sort(byPath.begin(), byPath.end(), [](const std::pair<unsigned long long, int>& a, const std::pair<unsigned long long, int>& b) {
+        if (a.first != b.first) return a.first < b.first;
+        return wcscmp(app.samples[a.second].fullpath, app.samples[b.second].fullpath) < 0;
+    });
+
+    std::vector<float> xy((size_t)app.count * 2);
+    if (app.layoutMethod == LAYOUT_AXES) {
+        for (int i = 0; i < app.count; i++) {
+            const AudioSample* s = &app.samples[byPath[i].second];
+            xy[i * 2] = s->zcr * app.layoutSpread;
+            xy[i * 2 + 1] = AxisHeight(*s) * app.layoutSpread;
+        }
+    } else {
+        std::vector<float> feats((size_t)app.count * FEATURE_DIM);
+        for (int i = 0; i < app.count; i++)
+            memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[byPath[i].second].features, sizeof(float) * FEATURE_DIM);
+
+        g_layout.method = app.layoutMethod;
+        g_layout.Fit(feats.data(), app.count, xy.data());
+        for (int i = 0; i < app.count * 2; i++) xy[i] *= app.layoutSpread;
+    }
+
+    // Spread out dense clusters: minimum spacing is a fraction of the mean spacing
+    // over the central 96% of the map, so a few outliers do not shrink it
+    std::vector<float> xs(app.count), ys(app.count);
+    for (int i = 0; i < app.count; i++) { xs[i] = xy[i * 2]; ys[i] = xy[i * 2 + 1]; }
+    int lo = app.count / 50, hi = app.count - 1 - app.count / 50;
+    std::nth_element(xs.begin(), xs.begin() + lo, xs.end()); float x0 = xs[lo];
+    std::nth_element(xs.begin(), xs.begin() + hi, xs.end()); float x1 = xs[hi];
+    std::nth_element(ys.begin(), ys.begin() + lo, ys.end()); float y0 = ys[lo];
+    std::nth_element(ys.begin(), ys.begin() + hi, ys.end()); float y1 = ys[hi];
+    float area = (x1 - x0) * (y1 - y0);
+    float minDist = (area > 0) ? 0.4f * sqrtf(area / app.count) : app.layoutSpread * 0.01f;
+
+    std::vector<unsigned int> keys(app.count);
+    for (int i = 0; i < app.count; i++) keys[i] = (unsigned int)(byPath[i].first ^ (byPath[i].first >> 32));
+    RelaxOverlaps(xy.data(), keys.data(), app.count, minDist, 16, g_layout.numThreads);
+
+    for (int i = 0; i < app.count; i++) {
+        app.samples[byPath[i].second].x = xy[i * 2];
+        app.samples[byPath[i].second].y = xy[i * 2 + 1];
+    }
+    MarkMapDirty();
+}
+
+// Cluster every sample afresh with the active method
+void FitClusters() {
+    g_clusterFitCount = 0;
+    if (app.clusterMethod < 0 || app.count == 0) return;
+    std::vector<float> feats((size_t)app.count * FEATURE_DIM);
+    std::vector<int> labels(app.count);
+    for (int i = 0; i < app.count; i++)
+        memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[i].features, sizeof(float) * FEATURE_DIM);
+    g_cluster.method = app.clusterMethod;
+    g_cluster.numThreads = g_layout.numThreads;
+    g_cluster.Fit(feats.data(), app.count, labels.data());
+    for (int i = 0; i < app.count; i++) app.samples[i].cluster = labels[i];
+    g_clusterFitCount = app.count;
+}
+
+// Label new or re-analysed samples against the current clusters, leaving the rest as
+// they are. Once the library has doubled since the last fit everything is re-fitted
+// instead (the list order then changes throughout); returns true in that case.
+bool AssignClusters(const int* ids, int n) {
+    if (app.clusterMethod < 0 || n <= 0) return false;
+    if (g_clusterFitCount == 0 || app.count > 2 * g_clusterFitCount) { FitClusters(); return true; }
+    std::vector<float> feats((size_t)n * FEATURE_DIM);
+    std::vector<int> labels(n);
+    for (int i = 0; i < n; i++)
+        memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[ids[i]].features, sizeof(float) * FEATURE_DIM);
+    g_cluster.Assign(feats.data(), n, labels.data());
+    for (int i = 0; i < n; i++) app.samples[ids[i]].cluster = labels[i];
+    return false;
+}
+
+// Expanded file support
+bool IsAudioFile(const wchar_t* name) {
+    const wchar_t* exts[] = { L"wav", L"mp3", L"flac", L"m4a", L"wma", L"aac", L"ogg", L"aiff", L"aif", L"aifc" };
+    const wchar_t* ext = wcsrchr(name, L'.');
+    if (!ext || wcschr(ext, L'\\')) return false;
+    for (auto e : exts)
+        if (_wcsicmp(ext + 1, e) == 0) return true;
+    return false;
+}
+
 // Helper for recursion
 void CollectAudioFiles(const std::wstring& folder, std::vector<std::wstring>& outPaths) {
     WIN32_FIND_DATAW fd;
@@ -678,110 +1481,252 @@ void CollectAudioFiles(const std::wstring& folder, std::vector<std::wstring>& ou
     HANDLE hFind = FindFirstFileW(searchPath, &fd);
     if (hFind == INVALID_HANDLE_VALUE) return;
     
-    // Expanded file support
-    const wchar_t* exts[] = { L"wav", L"mp3", L"flac", L"m4a", L"wma", L"aac", L"ogg", L"aiff" };
-    
     do {
         if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0) continue;
         
         std::wstring fullPath = folder + L"\\" + fd.cFileName;
         if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
             CollectAudioFiles(fullPath, outPaths);
-        } else {
-            const wchar_t* ext = wcsrchr(fd.cFileName, L'.');
-            if (ext) {
-                for (auto e : exts) {
-                    if (_wcsicmp(ext + 1, e) == 0) {
-                        outPaths.push_back(fullPath);
-                        break;
-                    }
-                }
-            }
+        } else if (IsAudioFile(fd.cFileName)) {
+            outPaths.push_back(fullPath);
         }
     } while (FindNextFileW(hFind, &fd));
     FindClose(hFind);
 }
 
-// Multithreaded import
-void ScanDirectory(const char* folderChar) {
-    wchar_t folder[MAX_PATH];
-    MultiByteToWideChar(CP_UTF8, 0, folderChar, -1, folder, MAX_PATH);
+bool g_traceScans = false;             // Record the next GUI scans with g_tracer
 
-    std::vector<std::wstring> allFiles;
-    CollectAudioFiles(folder, allFiles);
+// Times one file's import as a "file" stage named by its path (converted only while tracing)
+class TraceFile {
+public:
+    explicit TraceFile(const wchar_t* path) : start(-1) {
+        if (!g_tracer.Active()) return;
+        WideCharToMultiByte(CP_UTF8, 0, path, -1, utf8, sizeof(utf8), NULL, NULL);
+        start = g_tracer.NowUs();
+    }
+    ~TraceFile() { if (start >= 0) g_tracer.Complete("file", start, g_tracer.NowUs() - start, utf8); }
+
+private:
+    char utf8[MAX_PATH * 4];
+    long long start;
+};
+
+// Trace summary plus throughput derived from the import counters
+void WriteImportSummary(FILE* f) {
+    g_tracer.WriteSummary(f);
+    double decodeMs = 0, analyseMs = 0, fileMs = 0;
+    for (const Tracer::StageStats& s : g_tracer.Summarize()) {
+        if (!strcmp(s.name, "decode") || !strcmp(s.name, "mf open") || !strcmp(s.name, "mf decode")) decodeMs += s.totalMs;
+        else if (!strcmp(s.name, "analyse")) analyseMs += s.totalMs;
+        else if (!strcmp(s.name, "file")) fileMs += s.totalMs;
+    }
+    double audioSec = g_tracer.Total("audio ms") / 1000.0, wall = g_tracer.WallMs();
+    if (audioSec > 0)
+        fprintf(f, "decode %.0f us and analysis %.0f us per audio second (%.0f s of audio)\n",
+                decodeMs * 1000.0 / audioSec, analyseMs * 1000.0 / audioSec, audioSec);
+    if (wall > 0)
+        fprintf(f, "%.1f MB/s read, %.0f files/s, workers busy %.0f%% of wall time per thread\n",
+                g_tracer.Total("bytes read") / 1048576.0 / (wall / 1000.0), g_totalCount.load() * 1000.0 / wall,
+                100.0 * fileMs / wall / (g_layout.numThreads > 0 ? g_layout.numThreads : 1));
+}
+
+// Wall-clock time of the last AddRoots phases in ms (reported by --scan --time)
+struct ScanTimings { double collect, analyse, layout, duplicates, index; } g_scanTimings;
+
+// NowMs() at launch, when the last session was restored, when the first frame was shown
+// and when the background file check finished (0 = not yet); shown by the 'P' overlay
+struct StartupTimings { double launch, restored, firstFrame, checked; } g_startup;
+
+static double NowMs() {
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return t.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+
+// Update world bounds
+void UpdateBounds() {
+    std::vector<float> xy((size_t)app.count * 2), rms(app.count);
+    for (int i = 0; i < app.count; i++) {
+        xy[i * 2] = app.samples[i].x; xy[i * 2 + 1] = app.samples[i].y;
+        rms[i] = app.samples[i].rms;
+    }
+    MapBounds b = ComputeMapBounds(xy.data(), rms.data(), app.count);
+    app.minX = b.minX; app.maxX = b.maxX; 
+    app.minY = b.minY; app.maxY = b.maxY;
+}
+
+// Recount files, duplicates, duration and bytes per root
+void UpdateRootStats() {
+    for (auto& root : g_library.roots) {
+        root->files = 0; root->duplicates = 0;
+        root->duration = 0; root->bytes = 0;
+    }
+    for (int i = 0; i < app.count; i++) {
+        const AudioSample* s = &app.samples[i];
+        if (s->root < 0 || s->root >= (int)g_library.roots.size()) continue;
+        LibraryRoot* root = g_library.roots[s->root].get();
+        root->files++;
+        if (s->dupOf >= 0 && s->dupOf != i) root->duplicates++;
+        root->duration += s->duration;
+        root->bytes += s->sourceBytes;
+    }
+}
+
+// Root a path lives under, -1 if none
+int RootOf(const wchar_t* path) {
+    for (int r = 0; r < (int)g_library.roots.size(); r++) {
+        const wchar_t* root = g_library.roots[r]->path;
+        size_t len = wcslen(root);
+        if (_wcsnicmp(path, root, len) == 0 && path[len] == L'\\') return r;
+    }
+    return -1;
+}
+
+// Same folder, or one contains the other
+static bool PathsOverlap(const wchar_t* a, const wchar_t* b) {
+    size_t la = wcslen(a), lb = wcslen(b), n = (la < lb) ? la : lb;
+    if (_wcsnicmp(a, b, n) != 0) return false;
+    return la == lb || (la < lb ? b[la] : a[lb]) == L'\\';
+}
+
+// Key for the session's persisted similarity index: the root paths joined by '|'
+// (a single-root session keeps the plain root path)
+std::wstring SessionKey() {
+    std::wstring key;
+    for (auto& root : g_library.roots) {
+        if (!key.empty()) key += L"|";
+        key += root->path;
+    }
+    return key;
+}
+
+// Write the feature cache of every root watch mode has changed
+void SaveDirtyCaches() {
+    for (int r = 0; r < (int)g_library.roots.size(); r++) {
+        LibraryRoot* root = g_library.roots[r].get();
+        if (!root->cacheDirty) continue;
+        wchar_t cachePath[MAX_PATH];
+        if (GetCachePath(root->path, L"features", cachePath)) FeatureCache().Save(cachePath, app.samples, g_library.thumbs, app.count, r);
+        root->cacheDirty = false;
+    }
+}
+
+// Drop every root and sample
+void ClearLibrary() {
+    SaveDirtyCaches();
+    app.count = 0;
+    app.dupGroups = 0;
+    g_library.thumbs.Reset(0, g_library.thumbs.Bins());
+    MarkMapDirty();
+    g_meta.ClearAll();
+    ClearSelection();
+    g_library.roots.clear();
+    g_library.pending.clear();
+    g_simIndex.Build(NULL, 0);
+    g_dupIndex.Build(NULL, NULL, FP_FRAMES, 0);
+    g_clusterFitCount = 0;
+}
 
-    if (allFiles.empty()) return;
+// Scan new roots together on all cores and merge them into the library
+// (numThreads <= 0: one per core). Folders that overlap a root are skipped and
+// existing roots are not rescanned; the merged map is laid out again.
+// Returns the number of roots added.
+int AddRoots(const std::vector<std::wstring>& folders, int numThreads = 0, bool useCache = true) {
+    g_scanTimings = ScanTimings();
+    double t0 = NowMs();
+    int firstRoot = (int)g_library.roots.size(), oldCount = app.count;
+
+    std::vector<std::wstring> allFiles;
+    std::vector<int> fileRoot;
+    for (const std::wstring& f : folders) {
+        std::wstring folder = f;
+        while (folder.size() > 3 && (folder.back() == L'\\' || folder.back() == L'/')) folder.pop_back();
+        DWORD attr = GetFileAttributesW(folder.c_str());
+        if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) continue;
+        if (folder.size() >= MAX_PATH || g_library.roots.size() >= MAX_ROOTS) continue;
+        bool overlap = false;
+        for (auto& root : g_library.roots) overlap |= PathsOverlap(root->path, folder.c_str());
+        if (overlap) continue;
+
+        std::unique_ptr<LibraryRoot> root(new LibraryRoot());
+        wcscpy(root->path, folder.c_str());
+        { TraceScope t("collect"); CollectAudioFiles(folder, allFiles); }
+        fileRoot.resize(allFiles.size(), (int)g_library.roots.size());
+        g_library.roots.push_back(std::move(root));
+    }
+    int added = (int)g_library.roots.size() - firstRoot;
+    g_processedCount = 0;
+    g_totalCount = (int)allFiles.size();
+    double t1 = NowMs();
+    g_scanTimings.collect = t1 - t0;
+    if (added == 0) return 0;
+
+    std::vector<FeatureCache> caches(added);
+    std::vector<const FeatureCache*> cachePtr(added, NULL);
+    for (int r = 0; r < added; r++) {
+        TraceScope t("cache load");
+        wchar_t cachePath[MAX_PATH];
+        if (useCache && GetCachePath(g_library.roots[firstRoot + r]->path, L"features", cachePath) && caches[r].Load(cachePath))
+            cachePtr[r] = &caches[r];
+    }
+    // A library opened afresh keeps the thumbnail resolution its caches were saved at
+    if (oldCount == 0 && !g_library.pinThumbBins)
+        for (int r = 0; r < added; r++)
+            if (caches[r].ThumbBins() > 0) { g_library.thumbs.SetBins(caches[r].ThumbBins()); break; }
+    g_library.thumbs.Reserve((int)(app.count + allFiles.size() < MAX_FILES ? app.count + allFiles.size() : MAX_FILES));
 
     // Wine compatibility - use single thread
     if (IsRunningOnWine()) {
         OleInitialize(NULL);
         for (size_t i = 0; i < allFiles.size() && app.count < MAX_FILES; i++) {
-            ProcessFile(allFiles[i].c_str());
+            {
+                TraceFile t(allFiles[i].c_str());
+                ProcessFile(allFiles[i].c_str(), cachePtr[fileRoot[i] - firstRoot], fileRoot[i]);
+            }
+            g_processedCount++;
+            g_tracer.Sample("files queued", g_totalCount - g_processedCount);
         }
         CoUninitialize();
     } 
     else {
-        // Multithreaded import for Windows
+        // Multithreaded import for Windows. Workers analyse into a local sample and
+        // publish it without a lock into a slot reserved past the current count; the
+        // new samples are put back in input (path list) order once all have finished
+        SlotReservation slots(MAX_FILES - app.count);
+        int firstSlot = app.count;
+        AudioSample* staged = &app.samples[firstSlot];
         auto Worker = [&](int start, int end) {
             OleInitialize(NULL);
             for (int i = start; i < end; i++) {
-                if (app.count >= MAX_FILES) break;
+                if (slots.Full()) break;
                 
                 const wchar_t* path = allFiles[i].c_str();
-                int numSamples, rate, ch;
-                short* rawData = AudioDecoder::Load(path, &numSamples, &rate, &ch);
-                
-                if (rawData) {
-                    AudioSample temp = {0};
-                    temp.visualData = (float*)calloc(WAVEFORM_RES, sizeof(float));
-                    
-                    double totalSq = 0; int crossings = 0;
-                    int visualStep = (numSamples / WAVEFORM_RES) < 1 ? 1 : (numSamples / WAVEFORM_RES);
-                    for (int k = 0; k < numSamples; k++) {
-                        float val = rawData[k] / 32768.0f;
-                        if (k > 0 && rawData[k] * rawData[k-1] < 0) crossings++;
-                        totalSq += val * val;
-                        if (k % visualStep == 0 && (k/visualStep) < WAVEFORM_RES) temp.visualData[k/visualStep] = val;
-                    }
-                    float rawRms = (float)sqrt(sqrt(totalSq / numSamples));
-                    float rawZcr = (float)sqrt((float)crossings / numSamples);
-                    float spreadRms = powf(rawRms, 0.33f); float spreadZcr = powf(rawZcr, 0.33f);
-                    float jitterX = ((float)(rand() % 100) / 100.0f - 0.5f) * 0.05f;
-                    float jitterY = ((float)(rand() % 100) / 100.0f - 0.5f) * 0.05f;
-                    
-                    temp.rms = (spreadRms + jitterY) * 5.0f;
-                    temp.zcr = (spreadZcr + jitterX) * 5.0f;
-                    
-                    const wchar_t* p = wcsrchr(path, L'\\');
-                    wcscpy(temp.filename, p ? p + 1 : path);
-                    wcscpy(temp.fullpath, path);
-                    temp.bitsPerSample = 16; temp.numSamples = numSamples / ch;
-                    temp.sampleRate = rate; temp.channels = ch;
-                    temp.duration = (float)temp.numSamples / (float)rate;
-                    temp.fileSize = numSamples * 2;
-                    
-                    float t = rawZcr * 3.0f; if (t > 1.0f) t = 1.0f;
-                    int r, g, b;
-                    if (t < 0.5f) { float lt = t*2.0f; r=255-(int)(lt*100); g=100+(int)(lt*155); b=100; } 
-                    else { float lt = (t-0.5f)*2.0f; r=155-(int)(lt*100); g=255-(int)(lt*100); b=100+(int)(lt*155); }
-                    temp.color = RGB((r+255)/2, (g+255)/2, (b+255)/2);
-                    
-                    free(rawData);
-
-                    std::lock_guard<std::mutex> lock(g_appMutex);
-                    if (app.count < MAX_FILES) {
-                        app.samples[app.count++] = temp;
-                    } else {
-                        free(temp.visualData);
+                AudioSample temp = {0};
+                Envelope thumb;
+                bool loaded;
+                {
+                    TraceFile t(path);
+                    loaded = LoadSample(path, cachePtr[fileRoot[i] - firstRoot], &temp, &thumb);
+                }
+                if (loaded) {
+                    temp.root = fileRoot[i];
+                    int slot = slots.Reserve(i);
+                    if (slot >= 0) {
+                        staged[slot] = temp;
+                        g_library.thumbs.Store(firstSlot + slot, thumb);
                     }
                 }
                 g_processedCount++;
+                g_tracer.Sample("files queued", g_totalCount - g_processedCount);
             }
             CoUninitialize();
         };
 
-        int numThreads = std::thread::hardware_concurrency();
-        if (numThreads == 0) numThreads = 2;
+        if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+        if (numThreads <= 0) numThreads = 2;
+        if (numThreads > (int)allFiles.size()) numThreads = (int)allFiles.size();
+        if (numThreads < 1) numThreads = 1;
         int filesPerThread = (int)allFiles.size() / numThreads;
         std::vector<std::thread> threads;
         
@@ -791,66 +1736,545 @@ void ScanDirectory(const char* folderChar) {
             threads.emplace_back(Worker, start, end);
         }
         for(auto& t : threads) t.join();
+
+        TraceScope t("publish");
+        std::vector<int> order = slots.Order();
+        PermuteInPlace(staged, order);
+        g_library.thumbs.Permute(firstSlot, order);
+        app.count += slots.Count();
     }
+    double t2 = NowMs();
+    g_scanTimings.analyse = t2 - t1;
+    for (int r = firstRoot; r < (int)g_library.roots.size(); r++) g_library.roots[r]->scanMs = t2 - t0;
+    if (app.count == oldCount) { UpdateRootStats(); return added; }
+
+    g_layout.numThreads = numThreads;
+    g_simIndex.numThreads = numThreads;
+    { TraceScope t("layout"); ApplyLayout(); }
+    {
+        TraceScope t("cluster");
+        std::vector<int> ids;
+        for (int i = oldCount; i < app.count; i++) ids.push_back(i);
+        AssignClusters(ids.data(), (int)ids.size());
+    }
+    { TraceScope t("sort"); SortSamples(); }
+    double t3 = NowMs();
+    g_scanTimings.layout = t3 - t2;
 
-    // Auto-scale
-    float density = (float)app.count;
-    float spreadFactor = (density > 50) ? logf(density) * 2.5f : 1.0f;
-    for(int i=0; i<app.count; i++) {
-        app.samples[i].zcr *= spreadFactor;
-        app.samples[i].rms *= spreadFactor;
+    // New samples join the existing duplicate index, so copies across roots group too
+    {
+        TraceScope t("duplicates");
+        if (oldCount == 0) {
+            FindDuplicates();
+        } else {
+            for (int i = oldCount; i < app.count; i++)
+                g_dupIndex.Add(i, app.samples[i].fingerprint, app.samples[i].fingerprintLen);
+            AssignDuplicateGroups();
+        }
     }
-    SortSamples();
+    double t4 = NowMs();
+    g_scanTimings.duplicates = t4 - t3;
+
+    for (int r = firstRoot; r < (int)g_library.roots.size(); r++) {
+        TraceScope t("cache save");
+        wchar_t cachePath[MAX_PATH];
+        if (GetCachePath(g_library.roots[r]->path, L"features", cachePath))
+            FeatureCache().Save(cachePath, app.samples, g_library.thumbs, app.count, r);
+    }
+
+    // The quantizer trained on the existing roots is kept unless the new ones outnumber them
+    {
+        TraceScope t("index");
+        if (oldCount == 0) {
+            BuildSimilarityIndex(SessionKey().c_str());
+        } else if (app.count - oldCount <= oldCount) {
+            for (int i = oldCount; i < app.count; i++) g_simIndex.Add(i, app.samples[i].features);
+        } else {
+            std::vector<float> feats((size_t)app.count * FEATURE_DIM);
+            for (int i = 0; i < app.count; i++)
+                memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[i].features, sizeof(float) * FEATURE_DIM);
+            g_simIndex.Build(feats.data(), app.count);
+        }
+    }
+    g_scanTimings.index = NowMs() - t4;
+    UpdateRootStats();
+    return added;
 }
 
-// Update world bounds
-void UpdateBounds() {
-    // Phase 1: Determine noise floor from max volume
-    float maxRms = 0.0f;
-    for (int i = 0; i < app.count; i++) {
-        if (app.samples[i].rms > maxRms) maxRms = app.samples[i].rms;
+// Start a watcher on every root not yet watched (GUI only)
+void StartWatching() {
+    if (!g_library.watchEnabled) return;
+    for (auto& root : g_library.roots) {
+        if (root->watcher.Active()) continue;
+        char path[MAX_PATH * 4];
+        WideCharToMultiByte(CP_UTF8, 0, root->path, -1, path, sizeof(path), NULL, NULL);
+        root->watcher.Start(path);
     }
-    
-    // Ignore samples below 10% of peak volume (silence/outliers)
-    // unless the peak is too low (all files are silent)
-    float threshold = (maxRms > 0.5f) ? maxRms * 0.1f : -1.0f;
+}
 
-    app.minX = FLT_MAX; app.maxX = -FLT_MAX; 
-    app.minY = FLT_MAX; app.maxY = -FLT_MAX;
-    
-    int validCount = 0;
-    for (int i = 0; i < app.count; i++) {
-        // Skip silence to prevent empty space in minimap/viewport
-        if (app.samples[i].rms < threshold) continue;
+// Indices may now name other samples
+void ResetSampleFocus() {
+    app.hoverIndex = -1; app.lastHoverIndex = -1;
+    app.menuIndex = -1; app.menuVisible = 0;
+    app.listClickedIdx = -1;
+}
 
-        if (app.samples[i].zcr < app.minX) app.minX = app.samples[i].zcr; 
-        if (app.samples[i].zcr > app.maxX) app.maxX = app.samples[i].zcr;
-        if (app.samples[i].rms < app.minY) app.minY = app.samples[i].rms; 
-        if (app.samples[i].rms > app.maxY) app.maxY = app.samples[i].rms;
-        validCount++;
+// Position samples against the current layout without moving the rest of the map.
+// Patched points skip the overlap relaxation; shift+M re-fits the whole map with the
+// current method.
+void PlaceSamples(const int* ids, int n) {
+    if (n <= 0) return;
+    MarkMapDirty();
+    if (app.layoutMethod == LAYOUT_AXES) {
+        for (int i = 0; i < n; i++) {
+            AudioSample* s = &app.samples[ids[i]];
+            s->x = s->zcr * app.layoutSpread;
+            s->y = AxisHeight(*s) * app.layoutSpread;
+        }
+        return;
     }
-    
-    // Fallback if filtering removed everything
-    if (validCount == 0 && app.count > 0) {
-        app.minX = 0; app.maxX = 1; app.minY = 0; app.maxY = 1; // Default safety
-        for (int i = 0; i < app.count; i++) {
-             if (app.samples[i].zcr < app.minX) app.minX = app.samples[i].zcr; 
-             if (app.samples[i].zcr > app.maxX) app.maxX = app.samples[i].zcr;
-             if (app.samples[i].rms < app.minY) app.minY = app.samples[i].rms; 
-             if (app.samples[i].rms > app.maxY) app.maxY = app.samples[i].rms;
+    std::vector<float> feats((size_t)n * FEATURE_DIM), xy((size_t)n * 2);
+    for (int i = 0; i < n; i++)
+        memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[ids[i]].features, sizeof(float) * FEATURE_DIM);
+    g_layout.Place(feats.data(), n, xy.data());
+    for (int i = 0; i < n; i++) {
+        app.samples[ids[i]].x = xy[i * 2] * app.layoutSpread;
+        app.samples[ids[i]].y = xy[i * 2 + 1] * app.layoutSpread;
+    }
+}
+
+// Drop samples from the library and both indices. The last sample swaps into each
+// hole, highest index first, so every moved sample comes from past the final count.
+// Refilled slots are flagged in touched; ids listed in placed follow their sample.
+void RemoveSamples(std::vector<int>& ids, std::vector<char>& touched, std::vector<int>& placed) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (int r = (int)ids.size() - 1; r >= 0; r--) {
+        int idx = ids[r], last = app.count - 1;
+        g_simIndex.Remove(idx);
+        g_dupIndex.Remove(idx);
+        g_selection.flag[idx] = 0;
+        if (idx != last) {
+            app.samples[idx] = app.samples[last];
+            g_selection.flag[idx] = g_selection.flag[last];
+            g_selection.flag[last] = 0;
+            g_library.thumbs.Move(last, idx);
+            g_simIndex.Remove(last);
+            g_dupIndex.Remove(last);
+            g_simIndex.Add(idx, app.samples[idx].features);
+            g_dupIndex.Add(idx, app.samples[idx].fingerprint, app.samples[idx].fingerprintLen);
+            std::replace(placed.begin(), placed.end(), last, idx);
+            touched[idx] = 1;
         }
+        app.count--;
     }
-    
-    // 10% padding for comfortable panning
-    float rangeX = app.maxX - app.minX;
-    float rangeY = app.maxY - app.minY;
-    if (rangeX < 0.1f) rangeX = 0.1f;
-    if (rangeY < 0.1f) rangeY = 0.1f;
-    
-    app.minX -= rangeX * 0.1f;
-    app.maxX += rangeX * 0.1f;
-    app.minY -= rangeY * 0.1f;
-    app.maxY += rangeY * 0.1f;
+    MarkMapDirty();
+}
+
+// Drop flagged and removed samples from the sort order (before new samples reuse
+// indices past the count); returns the entries kept
+int DropFromSortOrder(int oldCount, const std::vector<char>& touched) {
+    int kept = 0;
+    for (int i = 0; i < oldCount; i++) {
+        int id = app.sortedIndices[i];
+        if (id < app.count && !touched[id]) app.sortedIndices[kept++] = id;
+    }
+    return kept;
+}
+
+// Insert the flagged samples into the sort order (same order as SortSamples)
+void InsertIntoSortOrder(int kept, const std::vector<char>& touched) {
+    if ((app.count - kept) * 8 > app.count) { SortSamples(); return; }
+    auto Less = [](int a, int b) {
+        unsigned int ca = SortKey(app.samples[a]), cb = SortKey(app.samples[b]);
+        return ca != cb ? ca < cb : a < b;
+    };
+    for (int idx = 0; idx < app.count && kept < app.count; idx++) {
+        if (!touched[idx]) continue;
+        int* pos = std::upper_bound(app.sortedIndices, app.sortedIndices + kept, idx, Less);
+        memmove(pos + 1, pos, (app.sortedIndices + kept - pos) * sizeof(int));
+        *pos = idx;
+        kept++;
+    }
+}
+
+// Remove a root and its samples; the other roots keep their analysis and positions
+void RemoveRoot(int r) {
+    if (r < 0 || r >= (int)g_library.roots.size()) return;
+    SaveDirtyCaches();
+
+    std::vector<int> ids, placed;
+    for (int i = 0; i < app.count; i++)
+        if (app.samples[i].root == r) ids.push_back(i);
+    int oldCount = app.count;
+    std::vector<char> touched(MAX_FILES, 0);
+    RemoveSamples(ids, touched, placed);
+    InsertIntoSortOrder(DropFromSortOrder(oldCount, touched), touched);
+
+    g_library.roots.erase(g_library.roots.begin() + r);
+    for (int i = 0; i < app.count; i++)
+        if (app.samples[i].root > r) app.samples[i].root--;
+    g_library.pending.clear();
+
+    AssignDuplicateGroups();
+    UpdateBounds();
+    UpdateRootStats();
+    ResetSampleFocus();
+}
+
+// Re-analyse only the files behind the changed paths and patch positions, sort order,
+// duplicate groups and the similarity index in place. Roots flagged with overflow are
+// re-listed in full. Returns false if nothing changed.
+bool PatchLibrary(const std::vector<std::string>& changed) {
+    double t0 = NowMs();
+
+    // Path -> sample lookup
+    std::vector<std::pair<unsigned long long, int>> byPath(app.count);
+    for (int i = 0; i < app.count; i++) byPath[i] = { HashPath(app.samples[i].fullpath), i };
+    std::sort(byPath.begin(), byPath.end());
+    auto Find = [&](const std::wstring& path) {
+        unsigned long long key = HashPath(path.c_str());
+        auto it = std::lower_bound(byPath.begin(), byPath.end(), std::make_pair(key, -1));
+        for (; it != byPath.end() && it->first == key; ++it)
+            if (wcscmp(app.samples[it->second].fullpath, path.c_str()) == 0) return it->second;
+        return -1;
+    };
+
+    // Files to check: every file under a changed directory, samples under a vanished
+    // one, or the whole root plus its samples when its events were dropped
+    std::vector<std::wstring> candidates;
+    for (int r = 0; r < (int)g_library.roots.size(); r++) {
+        LibraryRoot* root = g_library.roots[r].get();
+        if (!root->overflow) continue;
+        root->overflow = false;
+        CollectAudioFiles(root->path, candidates);
+        for (int i = 0; i < app.count; i++)
+            if (app.samples[i].root == r) candidates.push_back(app.samples[i].fullpath);
+    }
+    for (size_t c = 0; c < changed.size(); c++) {
+        wchar_t wide[MAX_PATH];
+        if (!MultiByteToWideChar(CP_UTF8, 0, changed[c].c_str(), -1, wide, MAX_PATH)) continue;
+        DWORD attr = GetFileAttributesW(wide);
+        if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY)) {
+            CollectAudioFiles(wide, candidates);
+        } else if (attr == INVALID_FILE_ATTRIBUTES && Find(wide) < 0) {
+            std::wstring prefix = std::wstring(wide) + L"\\";
+            for (int i = 0; i < app.count; i++)
+                if (wcsncmp(app.samples[i].fullpath, prefix.c_str(), prefix.size()) == 0) candidates.push_back(app.samples[i].fullpath);
+        } else {
+            candidates.push_back(wide);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Stat each candidate: gone or no longer audio is a removal, unchanged size and
+    // write time is skipped, anything else is analysed again
+    std::vector<std::wstring> analyse;
+    std::vector<int> target, targetRoot, removed; // Sample each analysed file replaces (-1 = new)
+    for (const std::wstring& path : candidates) {
+        int idx = Find(path), r = (idx >= 0) ? app.samples[idx].root : RootOf(path.c_str());
+        if (r < 0) continue;
+        WIN32_FILE_ATTRIBUTE_DATA fad;
+        bool exists = IsAudioFile(path.c_str()) && GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad) &&
+                      !(fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+        if (!exists) { if (idx >= 0) removed.push_back(idx); continue; }
+        unsigned long long bytes = ((unsigned long long)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+        unsigned long long time = ((unsigned long long)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+        if (idx >= 0 && app.samples[idx].sourceBytes == bytes && app.samples[idx].sourceTime == time) continue;
+        analyse.push_back(path);
+        target.push_back(idx);
+        targetRoot.push_back(r);
+    }
+    if (analyse.empty() && removed.empty()) return false;
+
+    std::vector<AudioSample> fresh(analyse.size());
+    std::vector<Envelope> freshThumbs(analyse.size());
+    g_library.thumbs.Reserve((int)(app.count + analyse.size() < MAX_FILES ? app.count + analyse.size() : MAX_FILES));
+    std::vector<char> ok(analyse.size(), 0);
+    ParallelRanges((int)analyse.size(), IsRunningOnWine() ? 1 : g_simIndex.numThreads, [&](int start, int end) {
+        OleInitialize(NULL);
+        for (int i = start; i < end; i++) {
+            ok[i] = LoadSample(analyse[i].c_str(), NULL, &fresh[i], &freshThumbs[i]);
+            fresh[i].root = targetRoot[i];
+        }
+        CoUninitialize();
+    });
+    for (int r : targetRoot) g_library.roots[r]->cacheDirty = true;
+    for (int idx : removed) g_library.roots[app.samples[idx].root]->cacheDirty = true;
+
+    // A library that was empty has no layout, index or bounds to patch against
+    bool rebuild = (app.count == 0);
+    int oldCount = app.count;
+    std::vector<char> touched(MAX_FILES, 0);    // Samples to re-insert into the sort order
+    std::vector<int> placed;
+    int added = 0, modified = 0;
+
+    // Re-analysed files replace their sample in place; failures count as removals
+    for (size_t i = 0; i < analyse.size(); i++) {
+        int idx = target[i];
+        if (idx < 0) continue;
+        if (!ok[i]) { removed.push_back(idx); continue; }
+        app.samples[idx] = fresh[i];
+        g_library.thumbs.Store(idx, freshThumbs[i]);
+        app.samples[idx].rippleAnim = 1.0f;
+        touched[idx] = 1;
+        placed.push_back(idx);
+        modified++;
+    }
+
+    RemoveSamples(removed, touched, placed);
+    int kept = DropFromSortOrder(oldCount, touched);
+
+    for (size_t i = 0; i < analyse.size(); i++) {
+        if (target[i] >= 0 || !ok[i]) continue;
+        if (app.count >= MAX_FILES) continue;
+        int idx = app.count++;
+        app.samples[idx] = fresh[i];
+        g_library.thumbs.Store(idx, freshThumbs[i]);
+        app.samples[idx].rippleAnim = 1.0f;
+        touched[idx] = 1;
+        placed.push_back(idx);
+        added++;
+    }
+
+    if (rebuild) {
+        ApplyLayout();
+        FitClusters();
+        SortSamples();
+        FindDuplicates();
+        std::vector<float> feats((size_t)app.count * FEATURE_DIM);
+        for (int i = 0; i < app.count; i++)
+            memcpy(&feats[(size_t)i * FEATURE_DIM], app.samples[i].features, sizeof(float) * FEATURE_DIM);
+        g_simIndex.Build(feats.data(), app.count);
+    } else {
+        std::sort(placed.begin(), placed.end());
+        PlaceSamples(placed.data(), (int)placed.size());
+        for (int idx : placed) {
+            g_simIndex.Add(idx, app.samples[idx].features);
+            g_dupIndex.Add(idx, app.samples[idx].fingerprint, app.samples[idx].fingerprintLen);
+        }
+        if (AssignClusters(placed.data(), (int)placed.size())) SortSamples();
+        else InsertIntoSortOrder(kept, touched);
+        AssignDuplicateGroups();
+    }
+    UpdateBounds();
+    UpdateRootStats();
+    ResetSampleFocus();
+
+    sprintf(app.statusMsg, "updated: +%d ~%d -%d (%.0f ms)", added, modified, (int)removed.size(), NowMs() - t0);
+    app.msgStartTime = GetTickCount();
+    return true;
+}
+
+// Idle-loop hook: collect change notifications and patch once a burst has settled
+void PollWatcher(HWND hwnd) {
+    DWORD now = GetTickCount();
+    if (now - g_library.lastPoll < 250) return;
+    g_library.lastPoll = now;
+
+    size_t before = g_library.pending.size();
+    bool dropped = false, relist = false;
+    for (auto& root : g_library.roots) {
+        bool overflow = false;
+        root->watcher.Poll(g_library.pending, &overflow);
+        if (overflow) root->overflow = dropped = true;
+        relist |= root->overflow;
+    }
+    if (g_library.pending.size() != before || dropped) { g_library.lastEvent = now; return; }
+    if (g_library.pending.empty() && !relist) return;
+    if (now - g_library.lastEvent < 1000) return;
+
+    std::vector<std::string> changed;
+    changed.swap(g_library.pending);
+    if (PatchLibrary(changed)) InvalidateRect(hwnd, NULL, FALSE);
+}
+
+// The last library and view, reopened at launch: root paths, then each sample's place
+// on the map (matched to its feature cache record by path hash), then the layout model
+typedef struct {
+    int magic, version, recordSize, roots, samples;
+    int layoutMethod, axisY, clusterMethod;
+    float offsetX, offsetY, scale, layoutSpread;
+} SessionHeader;
+
+typedef struct {
+    unsigned long long pathHash;
+    float x, y;
+    int cluster;
+} SessionRecord;
+
+// Background check of a restored library: a worker lists every root and stats each file
+// against what the caches said, and the UI thread patches the differences in as if a
+// watcher had reported them
+struct LibraryCheck {
+    std::thread worker;
+    std::atomic<bool> done{ false };
+    std::vector<std::string> changed;   // UTF-8 paths, owned by the worker until done
+} g_check;
+
+void StartLibraryCheck() {
+    struct Known { std::wstring path; unsigned long long bytes, time; };
+    std::vector<std::wstring> roots;
+    for (auto& root : g_library.roots) roots.push_back(root->path);
+    std::vector<Known> known(app.count);
+    for (int i = 0; i < app.count; i++)
+        known[i] = { app.samples[i].fullpath, app.samples[i].sourceBytes, app.samples[i].sourceTime };
+    g_check.changed.clear();
+    g_check.done = false;
+    g_check.worker = std::thread([roots = std::move(roots), known = std::move(known)]() mutable {
+        std::sort(known.begin(), known.end(), [](const Known& a, const Known& b) { return a.path < b.path; });
+        std::vector<char> seen(known.size(), 0);
+        std::vector<std::wstring> files;
+        for (const std::wstring& root : roots) CollectAudioFiles(root, files);
+        auto Changed = [](const std::wstring& path) {
+            char utf8[MAX_PATH * 4];
+            if (WideCharToMultiByte(CP_UTF8, 0, path.c_str(), -1, utf8, sizeof(utf8), NULL, NULL)) g_check.changed.push_back(utf8);
+        };
+        for (const std::wstring& path : files) {
+            auto it = std::lower_bound(known.begin(), known.end(), path, [](const Known& k, const std::wstring& p) { return k.path < p; });
+            bool found = it != known.end() && it->path == path;
+            if (found) seen[it - known.begin()] = 1;
+            WIN32_FILE_ATTRIBUTE_DATA fad;
+            if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad)) { if (found) Changed(path); continue; }
+            unsigned long long bytes = ((unsigned long long)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+            unsigned long long time = ((unsigned long long)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+            if (!found || it->bytes != bytes || it->time != time) Changed(path);
+        }
+        for (size_t k = 0; k < known.size(); k++)
+            if (!seen[k]) Changed(known[k].path);     // Deleted or moved away
+        g_check.done = true;
+    });
+}
+
+// Idle-loop hook: patch what the check found once it has finished
+void PollLibraryCheck(HWND hwnd) {
+    if (!g_check.worker.joinable() || !g_check.done) return;
+    g_check.worker.join();
+    std::vector<std::string> changed;
+    changed.swap(g_check.changed);
+    if (!PatchLibrary(changed))
+        sprintf(app.statusMsg, "library is up to date (checked in %.0f ms)", NowMs() - g_startup.restored);
+    g_startup.checked = NowMs();
+    app.msgStartTime = GetTickCount();
+    InvalidateRect(hwnd, NULL, FALSE);
+}
+
+bool GetSessionPath(wchar_t* out) { return GetAppDataPath(L"session.bin", out); }
+
+// Written at exit; an empty library removes it
+void SaveSession() {
+    wchar_t path[MAX_PATH];
+    if (!GetSessionPath(path)) return;
+    if (g_library.roots.empty()) { DeleteFileW(path); return; }
+    FILE* f = _wfopen(path, L"wb");
+    if (!f) return;
+    SessionHeader h = { 0x53534D41 /* AMSS */, 2, (int)sizeof(SessionRecord), (int)g_library.roots.size(), app.count,
+                        app.layoutMethod, app.axisY, app.clusterMethod, app.offsetX, app.offsetY, app.targetScale, app.layoutSpread };
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (size_t r = 0; r < g_library.roots.size() && ok; r++)
+        ok = fwrite(g_library.roots[r]->path, sizeof(g_library.roots[r]->path), 1, f) == 1;
+    for (int i = 0; i < app.count && ok; i++) {
+        const AudioSample& s = app.samples[i];
+        SessionRecord rec = { HashPath(s.fullpath), s.x, s.y, s.cluster };
+        ok = fwrite(&rec, sizeof(rec), 1, f) == 1;
+    }
+    ok = ok && g_layout.Save(f);
+    fclose(f);
+    if (!ok) DeleteFileW(path);
+}
+
+// Reopen the last session from the feature caches alone, so the map is usable on the
+// first frame; files are not touched until StartLibraryCheck. Samples without a saved
+// place are positioned against the saved layout model (or the map is laid out again
+// without one). Returns false if there was no usable session.
+bool RestoreSession() {
+    double t0 = NowMs();
+    wchar_t path[MAX_PATH];
+    FILE* f;
+    if (!GetSessionPath(path) || !(f = _wfopen(path, L"rb"))) return false;
+    SessionHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == 0x53534D41 && h.version == 2 &&
+              h.recordSize == (int)sizeof(SessionRecord) && h.roots > 0 && h.roots <= MAX_ROOTS &&
+              h.samples >= 0 && h.samples <= MAX_FILES && h.layoutMethod >= 0 && h.layoutMethod < LAYOUT_COUNT &&
+              h.axisY >= 0 && h.axisY < AXIS_COUNT &&
+              h.clusterMethod >= -1 && h.clusterMethod < CLUSTER_COUNT && h.scale > 0;
+    std::vector<std::wstring> rootPaths;
+    for (int r = 0; ok && r < h.roots; r++) {
+        wchar_t rootPath[MAX_PATH];
+        ok = fread(rootPath, sizeof(rootPath), 1, f) == 1;
+        rootPath[MAX_PATH - 1] = 0;
+        rootPaths.push_back(rootPath);
+    }
+    std::vector<SessionRecord> saved(ok ? h.samples : 0);
+    ok = ok && fread(saved.data(), sizeof(SessionRecord), saved.size(), f) == saved.size();
+    bool haveModel = ok && g_layout.Load(f, MAX_FILES);
+    fclose(f);
+    if (!ok) return false;
+
+    // Roots that are gone (an unplugged drive) are dropped, as AddRoots would
+    for (const std::wstring& rootPath : rootPaths) {
+        DWORD attr = GetFileAttributesW(rootPath.c_str());
+        if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY)) continue;
+        int r = (int)g_library.roots.size();
+        std::unique_ptr<LibraryRoot> root(new LibraryRoot());
+        wcscpy(root->path, rootPath.c_str());
+        g_library.roots.push_back(std::move(root));
+
+        FeatureCache cache;
+        wchar_t cachePath[MAX_PATH];
+        if (!GetCachePath(rootPath.c_str(), L"features", cachePath) || !cache.Load(cachePath)) continue;
+        if (app.count == 0 && !g_library.pinThumbBins && cache.ThumbBins() > 0) g_library.thumbs.SetBins(cache.ThumbBins());
+        g_library.thumbs.Reserve(app.count + cache.Size() < MAX_FILES ? app.count + cache.Size() : MAX_FILES);
+        for (int k = 0; k < cache.Size() && app.count < MAX_FILES; k++) {
+            AudioSample s = {0};
+            Envelope thumb;
+            cache.Get(k, &s, &thumb);
+            s.root = r;
+            app.samples[app.count] = s;
+            g_library.thumbs.Store(app.count++, thumb);
+        }
+    }
+    if (g_library.roots.empty()) return false;
+
+    app.layoutMethod = h.layoutMethod;
+    app.axisY = h.axisY;
+    app.clusterMethod = h.clusterMethod;
+    app.layoutSpread = h.layoutSpread;
+    std::sort(saved.begin(), saved.end(), [](const SessionRecord& a, const SessionRecord& b) { return a.pathHash < b.pathHash; });
+    std::vector<int> unplaced;
+    for (int i = 0; i < app.count; i++) {
+        SessionRecord probe = { HashPath(app.samples[i].fullpath) };
+        auto it = std::lower_bound(saved.begin(), saved.end(), probe,
+                                   [](const SessionRecord& a, const SessionRecord& b) { return a.pathHash < b.pathHash; });
+        if (it == saved.end() || it->pathHash != probe.pathHash) { unplaced.push_back(i); continue; }
+        app.samples[i].x = it->x;
+        app.samples[i].y = it->y;
+        app.samples[i].cluster = it->cluster;
+    }
+    bool needFit = app.layoutMethod != LAYOUT_AXES && (!haveModel || g_layout.method != app.layoutMethod || g_layout.FittedCount() == 0);
+    if (needFit) ApplyLayout();
+    else PlaceSamples(unplaced.data(), (int)unplaced.size());
+    // Restored labels stand until the next change; a new sample means a fresh fit
+    g_clusterFitCount = 0;
+    if (needFit || !unplaced.empty()) FitClusters();
+
+    SortSamples();
+    FindDuplicates();
+    BuildSimilarityIndex(SessionKey().c_str());
+    UpdateBounds();
+    UpdateRootStats();
+    MarkMapDirty();
+    StartWatching();
+    app.offsetX = h.offsetX;
+    app.offsetY = h.offsetY;
+    app.scale = app.targetScale = h.scale;
+
+    StartLibraryCheck();
+    g_startup.restored = NowMs();
+    sprintf(app.statusMsg, "restored %d samples from the last session in %.0f ms, checking files...", app.count, g_startup.restored - t0);
+    app.msgStartTime = GetTickCount();
+    return true;
 }
 
 // Folder picker dialog
@@ -879,42 +2303,155 @@ int PickFolder(HWND hwnd, char* outPath) {
     return 0;
 }
 
+// Pick a folder and open it as the whole library, or add it as another root
+void OpenFolder(HWND hwnd, bool addRoot) {
+    char path[MAX_PATH];
+    if (!PickFolder(hwnd, path)) return;
+    wchar_t folder[MAX_PATH];
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, folder, MAX_PATH);
+
+    if (!addRoot) ClearLibrary();
+    if (g_traceScans) g_tracer.Start();
+    int added = AddRoots({ folder });
+    StartWatching();
+    ResetSampleFocus();
+    if (app.count > 0) {
+        UpdateBounds(); 
+        app.offsetX = -(app.maxX + app.minX) / 2.0f; 
+        app.offsetY = -(app.maxY + app.minY) / 2.0f;
+    }
+    if (addRoot && added == 0)
+        sprintf(app.statusMsg, "folder is already part of the library.");
+    else if (addRoot)
+        sprintf(app.statusMsg, "added %d samples: %d roots, %d samples, %d duplicate groups.",
+                g_library.roots.back()->files, (int)g_library.roots.size(), app.count, app.dupGroups);
+    else if (app.count > 0)
+        sprintf(app.statusMsg, "loaded %d samples, %d duplicate groups.", app.count, app.dupGroups);
+
+    // Traced scans leave import-trace.json (chrome://tracing) and import-summary.txt
+    if (g_traceScans) {
+        g_tracer.Stop();
+        wchar_t tracePath[MAX_PATH], summaryPath[MAX_PATH];
+        FILE* f;
+        if (GetAppDataPath(L"import-trace.json", tracePath) && (f = _wfopen(tracePath, L"wb"))) {
+            g_tracer.WriteChromeTrace(f);
+            fclose(f);
+        }
+        if (GetAppDataPath(L"import-summary.txt", summaryPath) && (f = _wfopen(summaryPath, L"wb"))) {
+            WriteImportSummary(f);
+            fclose(f);
+        }
+        sprintf(app.statusMsg, "traced %d files in %.0f ms, summary in %%LOCALAPPDATA%%\\audiomap\\import-summary.txt",
+                g_totalCount.load(), g_tracer.WallMs());
+    }
+    app.msgStartTime = GetTickCount(); 
+    InvalidateRect(hwnd, NULL, FALSE);
+}
+
 // Create/resize backbuffer
 void ResizeBackBuffer(HDC hdc, int w, int h) {
     if (g_hbmBack) DeleteObject(g_hbmBack); 
     if (!g_hdcBack) g_hdcBack = CreateCompatibleDC(hdc);
-    g_hbmBack = CreateCompatibleBitmap(hdc, w, h); 
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = w;
+    bmi.bmiHeader.biHeight = -h;    // Top-down rows
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    g_hbmBack = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void**)&g_backBits, NULL, 0);
     SelectObject(g_hdcBack, g_hbmBack);
+    g_render.DropSurface();
     g_bbWidth = w; 
     g_bbHeight = h;
 }
 
 // Main rendering
+// Frame profiler table: last, p50 and p99 per DrawMap section over the rolling window
+void DrawProfilerOverlay(HDC hdc, int top) {
+    int rows = PROF_SECTIONS + 5, rowH = 15, left = 15, width = 250;
+    RECT bg = { left - 6, top - 4, left + width, top + rows * rowH + 4 };
+    SetDCBrushColor(hdc, RGB(12, 12, 15));
+    FillRect(hdc, &bg, (HBRUSH)GetStockObject(DC_BRUSH));
+
+    char buf[96];
+    auto Row = [&](int row, const char* name, const char* a, const char* b, const char* c) {
+        int y = top + row * rowH;
+        TextOutA(hdc, left, y, name, (int)strlen(name));
+        TextOutA(hdc, left + 100, y, a, (int)strlen(a));
+        TextOutA(hdc, left + 150, y, b, (int)strlen(b));
+        TextOutA(hdc, left + 200, y, c, (int)strlen(c));
+    };
+    auto Ms = [](double us, char* out) { sprintf(out, "%.2f", us / 1000.0); return out; };
+
+    SetTextColor(hdc, RGB(120, 120, 120));
+    sprintf(buf, "ms (%d frames)", g_frameProf.Frames());
+    Row(0, buf, "last", "p50", "p99");
+    for (int sct = 0; sct <= PROF_SECTIONS; sct++) {
+        FrameProfiler::Stats st = g_frameProf.Section(sct);
+        char a[16], b[16], c[16];
+        SetTextColor(hdc, sct == PROF_SECTIONS ? RGB(237, 237, 237) : RGB(180, 180, 180));
+        Row(1 + sct, sct == PROF_SECTIONS ? "frame" : g_frameProf.Name(sct), Ms(st.last, a), Ms(st.p50, b), Ms(st.p99, c));
+    }
+    FrameProfiler::Stats al = g_frameProf.Allocations();
+    char a[16], b[16], c[16];
+    sprintf(a, "%.0f", al.last); sprintf(b, "%.0f", al.p50); sprintf(c, "%.0f", al.p99);
+    SetTextColor(hdc, RGB(180, 180, 180));
+    Row(PROF_SECTIONS + 2, "allocations", a, b, c);
+    FrameProfiler::Stats ob = g_frameProf.Objects();
+    sprintf(a, "%.0f", ob.last); sprintf(b, "%.0f", ob.p50); sprintf(c, "%.0f", ob.p99);
+    Row(PROF_SECTIONS + 3, "gdi objects", a, b, c);
+
+    // Launch to first frame, and to the end of the session restore and file check
+    SetTextColor(hdc, RGB(120, 120, 120));
+    int len = sprintf(buf, "startup: first frame %.0f ms", g_startup.firstFrame - g_startup.launch);
+    if (g_startup.restored > 0) len += sprintf(buf + len, ", restore %.0f", g_startup.restored - g_startup.launch);
+    if (g_startup.checked > 0) len += sprintf(buf + len, ", checked %.0f", g_startup.checked - g_startup.launch);
+    TextOutA(hdc, left, top + (PROF_SECTIONS + 4) * rowH, buf, len);
+}
+
 void DrawMap(HDC hdc, RECT clientRect) {
     if (clientRect.right == 0 || clientRect.bottom == 0) return;
     if (!g_hdcBack || g_bbWidth != clientRect.right || g_bbHeight != clientRect.bottom) 
         ResizeBackBuffer(hdc, clientRect.right, clientRect.bottom);
 
-    Gdiplus::Graphics g(g_hdcBack);
-
-    // Clear background
-    RECT bgR = {0, 0, clientRect.right, clientRect.bottom};
-    HBRUSH hBr = CreateSolidBrush(RGB(20, 20, 25));
-    FillRect(g_hdcBack, &bgR, hBr);
-    DeleteObject(hBr);
+    // Profiler laps: each call charges the time since the previous one to a section
+    long long allocStart = g_newCount.load(std::memory_order_relaxed), objectStart = g_render.Created();
+    double lapStart = g_showProfiler ? NowMs() : 0;
+    auto Lap = [&](int section) {
+        if (!g_showProfiler) return;
+        double now = NowMs();
+        g_frameProf.Add(section, (now - lapStart) * 1000.0);
+        lapStart = now;
+    };
 
+    // Background and grid are painted by the tile pass below
+    Gdiplus::Graphics& g = g_render.Surface(g_hdcBack);
     g.SetPixelOffsetMode(Gdiplus::PixelOffsetModeHighSpeed);
     g.SetTextRenderingHint(Gdiplus::TextRenderingHintClearTypeGridFit); 
+    g.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias);
 
-    // Grid (no antialiasing for speed)
-    g.SetSmoothingMode(Gdiplus::SmoothingModeNone); 
-    Gdiplus::Pen gridPen(Gdiplus::Color(255, 35, 35, 40), 1.0f);
-    for (int x = 0; x < clientRect.right; x += 50) 
-        g.DrawLine(&gridPen, x, 0, x, clientRect.bottom);
-    for (int y = 0; y < clientRect.bottom; y += 50) 
-        g.DrawLine(&gridPen, 0, y, clientRect.right, y);
+    int cx = clientRect.right / 2; 
+    int cy = clientRect.bottom / 2;
+    int viewLeft = 0, viewTop = 0, viewRight = clientRect.right, viewBottom = clientRect.bottom;
+    
+    RECT mmRect = { clientRect.right - 180, clientRect.bottom - 130, 
+                    clientRect.right - 15, clientRect.bottom - 15 };
+    app.minimapRect = mmRect;
 
-    g.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias);
+    // Project every sample in one pass over the flat position arrays; collapsed
+    // duplicates are parked off-screen so hover/click skip them too. Everything below
+    // walks the visible list, culled to the view (plus a margin) minus the minimap
+    SyncMapView();
+    MapTransform proj = { cx + app.offsetX * app.scale * 2.0f, app.scale * 2.0f,
+                          cy - app.offsetY * app.scale, -app.scale };
+    g_mapView.proj = proj;
+    CullBox view = { viewLeft - 20, viewTop - 20, viewRight + 20, viewBottom + 20 };
+    CullBox hole = { mmRect.left, mmRect.top, mmRect.right, mmRect.bottom };
+    g_mapView.visibleCount = ProjectAndCull(g_mapView.x, g_mapView.y, g_mapView.hidden, app.count, proj, view, hole,
+                                            g_mapView.screenX, g_mapView.screenY, g_mapView.visible);
+    const int* screenX = g_mapView.screenX;
+    const int* screenY = g_mapView.screenY;
 
     // Stable flashlight source calculation
     float lightX = app.smoothMouse.x;
@@ -924,15 +2461,15 @@ void DrawMap(HDC hdc, RECT clientRect) {
     // This prevents the flashlight from moving while hovering the target
     int focusIdx = (app.menuVisible && app.menuIndex != -1) ? app.menuIndex : app.hoverIndex;
     if (focusIdx != -1) {
-        lightX = (float)app.samples[focusIdx].screenX;
-        lightY = (float)app.samples[focusIdx].screenY;
+        lightX = (float)screenX[focusIdx];
+        lightY = (float)screenY[focusIdx];
     }
 
-    // Connection lines to nearest neighbors
+    // Connection lines to nearest neighbors (queued under the dots)
     // Check lastHoverIndex to allow fading out after mouse leaves
     if (!app.isListOpen && app.lastHoverIndex != -1 && app.hoverAnim.value > 0.01f) {
 
-        AudioSample* t = &app.samples[app.lastHoverIndex];
+        int from = app.lastHoverIndex;
         
         // Alpha 0 to 200 (Fade in/out)
         int alpha = app.hoverAnim.GetAlpha(0, 200);
@@ -940,108 +2477,62 @@ void DrawMap(HDC hdc, RECT clientRect) {
         // Animation Factor for length (Ease Out Quad for snappy extension)
         float lenT = 1.0f - (1.0f - app.hoverAnim.value) * (1.0f - app.hoverAnim.value);
 
-        // Thicker lines
-        Gdiplus::Pen linePen(Gdiplus::Color(alpha, alpha, alpha, alpha), 2.5f);
-        
-        struct { int id; float dist; } closest[5];
-        for(int k=0; k<5; k++) closest[k] = { -1, FLT_MAX };
-
-        // Draw all samples
-        for (int i = 0; i < app.count; i++) {
-                if (i == app.lastHoverIndex) continue; // Skip self
-                
-                // Cull off-screen points immediately
-                if (app.samples[i].screenX < 0 || app.samples[i].screenX > clientRect.right ||
-                app.samples[i].screenY < 0 || app.samples[i].screenY > clientRect.bottom) {
-                continue;
-                }
-
-                if (abs(t->screenX - app.samples[i].screenX) > 500) continue; 
-
-                float dist = (t->zcr - app.samples[i].zcr)*(t->zcr - app.samples[i].zcr) + 
-                            (t->rms - app.samples[i].rms)*(t->rms - app.samples[i].rms);
-                if (dist < 0.5f) { 
-                    for(int k=0; k<5; k++) {
-                        if(dist < closest[k].dist) {
-                            for(int j=4; j>k; j--) closest[j] = closest[j-1];
-                            closest[k] = { i, dist };
-                            break;
-                        }
-                    }
-                }
-        }
+        // Nearest neighbours in feature space
+        int simIds[MAX_SIMILAR]; 
+        float simDist[MAX_SIMILAR];
+        int simCount = g_simIndex.QueryId(app.lastHoverIndex, 5, simIds, simDist);
 
-        for(int k=0; k<5; k++) {
-            if(closest[k].id != -1) {
-                AudioSample* target = &app.samples[closest[k].id];
+        for(int k=0; k<simCount; k++) {
+            if(simIds[k] < app.count) {
+                AudioSample* target = &app.samples[simIds[k]];
+                if (g_mapView.hidden[simIds[k]]) continue;
                 
                 if (alpha > 5) {
-                    Gdiplus::Point ptStart(t->screenX, t->screenY);
+                    Gdiplus::PointF ptStart((REAL)screenX[from], (REAL)screenY[from]);
                     
                     // --- ANIMATION: Extend line based on hover value ---
-                    float dx = (float)(target->screenX - t->screenX);
-                    float dy = (float)(target->screenY - t->screenY);
+                    float dx = (float)(screenX[simIds[k]] - screenX[from]);
+                    float dy = (float)(screenY[simIds[k]] - screenY[from]);
                     
                     // Interpolate end point
-                    Gdiplus::Point ptEnd(
-                        t->screenX + (int)(dx * lenT),
-                        t->screenY + (int)(dy * lenT)
+                    Gdiplus::PointF ptEnd(
+                        (REAL)(screenX[from] + (int)(dx * lenT)),
+                        (REAL)(screenY[from] + (int)(dy * lenT))
                     );
 
                     // Don't draw if length is too small (avoids gradient errors)
-                    if (abs(ptEnd.X - ptStart.X) < 1 && abs(ptEnd.Y - ptStart.Y) < 1) continue;
+                    if (fabsf(ptEnd.X - ptStart.X) < 1 && fabsf(ptEnd.Y - ptStart.Y) < 1) continue;
 
                     // Center Color: Pure White
                     Gdiplus::Color colCenter(alpha, 255, 255, 255);
 
                     // Neighbor Color
-                    int nR = GetRValue(target->color);
-                    int nG = GetGValue(target->color);
-                    int nB = GetBValue(target->color);
+                    COLORREF tipCol = SampleColor(*target);
+                    int nR = GetRValue(tipCol);
+                    int nG = GetGValue(tipCol);
+                    int nB = GetBValue(tipCol);
                     Gdiplus::Color colNeighbor(alpha, nR, nG, nB);
 
                     // Gradient scales with the line, keeping the tip the neighbor's color
-                    Gdiplus::LinearGradientBrush gradBrush(ptStart, ptEnd, colCenter, colNeighbor);
-                    Gdiplus::Pen gradPen(&gradBrush, 2.5f);
-                    
-                    g.DrawLine(&gradPen, ptStart, ptEnd);
+                    g_tiles.Segment(ptStart.X, ptStart.Y, ptEnd.X, ptEnd.Y, 2.5f, colCenter.GetValue(), colNeighbor.GetValue());
 
                     if (lenT > 0.01f && lenT < 0.99f) {
                         float pX = (float)ptStart.X + dx * lenT;
                         float pY = (float)ptStart.Y + dy * lenT;
                         float size = 8.0f;
 
-                        Gdiplus::GraphicsPath path;
-                        path.AddEllipse(pX - size/2, pY - size/2, size, size);
-
-                        Gdiplus::PathGradientBrush pthGrBrush(&path);
                         // Core is bright white, edges transparent
-                        Gdiplus::Color centerCol(alpha, 255, 255, 255);
-                        Gdiplus::Color surroundCol(0, 255, 255, 255);
-                        int count = 1;
-                        
-                        pthGrBrush.SetCenterColor(centerCol);
-                        pthGrBrush.SetSurroundColors(&surroundCol, &count);
-                        
-                        g.FillEllipse(&pthGrBrush, pX - size/2, pY - size/2, size, size);
+                        g_tiles.Glow(pX, pY, size / 2, Gdiplus::Color(alpha, 255, 255, 255).GetValue());
                     }
                 }
             }
         }
     }
 
-    int cx = clientRect.right / 2; 
-    int cy = clientRect.bottom / 2;
-    int viewLeft = 0, viewTop = 0, viewRight = clientRect.right, viewBottom = clientRect.bottom;
-    
-    RECT mmRect = { clientRect.right - 180, clientRect.bottom - 130, 
-                    clientRect.right - 15, clientRect.bottom - 15 };
-    app.minimapRect = mmRect;
+    Lap(PROF_LINES);
 
     // Font setup (Unicode)
-    HFONT hFontUI = CreateFontA(-11, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, 
-                                DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, 
-                                CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, "Segoe UI");
+    HFONT hFontUI = g_render.UiFont();
     HFONT hOldFont = (HFONT)SelectObject(g_hdcBack, hFontUI);
     SetBkMode(g_hdcBack, TRANSPARENT);
 
@@ -1063,29 +2554,19 @@ void DrawMap(HDC hdc, RECT clientRect) {
     RECT drawnRects[MAX_FILES]; 
     int drawnCount = 0;
 
-// Draw all samples
-    for (int i = 0; i < app.count; i++) {
+// Queue the visible samples for the tile pass
+    for (int k = 0; k < g_mapView.visibleCount; k++) {
+        int i = g_mapView.visible[k];
         AudioSample* s = &app.samples[i];
 
-        float fx = cx + (s->zcr + app.offsetX) * app.scale * 2.0f;
-        float fy = cy - (s->rms + app.offsetY) * app.scale;
-        s->screenX = (int)fx; 
-        s->screenY = (int)fy;
-
-        // Culling: Skip if off-screen or covered by minimap
-        if (s->screenX < viewLeft - 20 || s->screenX > viewRight + 20 || 
-            s->screenY < viewTop - 20 || s->screenY > viewBottom + 20) continue;
-        if (s->screenX >= mmRect.left && s->screenX <= mmRect.right && 
-            s->screenY >= mmRect.top && s->screenY <= mmRect.bottom) continue;
-
         bool isFocused = (i == app.hoverIndex) || (app.menuVisible && i == app.menuIndex);
         
         // Base radius (no animation)
         float r = baseRadius;
 
         // Flashlight effect (relative to stable light source)
-        float dx = (float)(s->screenX - lightX);
-        float dy = (float)(s->screenY - lightY);
+        float dx = (float)(screenX[i] - lightX);
+        float dy = (float)(screenY[i] - lightY);
         float distSq = dx*dx + dy*dy;
         
         if (distSq < 22500.0f) { // 150px radius
@@ -1093,41 +2574,7 @@ void DrawMap(HDC hdc, RECT clientRect) {
             r += (1.0f - dist / 150.0f) * 10.0f;
         }
 
-        // Text label
-        bool showText = (!isFocused && app.scale > 80.0f && drawnCount < 100);
-        if (showText) {
-            SIZE sz; 
-            GetTextExtentPoint32W(g_hdcBack, s->filename, (int)wcslen(s->filename), &sz);
-            RECT rTxt = { s->screenX + (int)r + 4, s->screenY - sz.cy/2, 
-                          s->screenX + (int)r + 4 + sz.cx, s->screenY + sz.cy/2 };
-            if (rTxt.right >= clientRect.right || IsRectOverlap(rTxt, drawnRects, drawnCount)) showText = false;
-            else drawnRects[drawnCount++] = rTxt;
-        }
-        
-        s->textAnim.Update(showText, 0.08f); 
-        if (s->textAnim.value > 0.01f) {
-            // Border fade logic
-            int margin = 100; // Distance to start fading
-            int dist = s->screenX; // Left
-            if (clientRect.right - s->screenX < dist) dist = clientRect.right - s->screenX; // Right
-            if (s->screenY < dist) dist = s->screenY; // Top
-            if (clientRect.bottom - s->screenY < dist) dist = clientRect.bottom - s->screenY; // Bottom
-            
-            float edgeFactor = 1.0f;
-            if (dist < margin) edgeFactor = (float)dist / (float)margin;
-            if (edgeFactor < 0.0f) edgeFactor = 0.0f;
-
-            // Target color is current brightness
-            int val = 20 + (int)((130 - 20) * s->textAnim.value);
-            
-            // Interpolate towards background color (20, 20, 25) based on edgeFactor
-            int R = 20 + (int)((val - 20) * edgeFactor);
-            int G = 20 + (int)((val - 20) * edgeFactor);
-            int B = 25 + (int)((val - 25) * edgeFactor);
-            
-            SetTextColor(g_hdcBack, RGB(R, G, B));
-            TextOutW(g_hdcBack, s->screenX + (int)r + 4, s->screenY - 6, s->filename, (int)wcslen(s->filename));
-        }
+        g_mapView.radius[k] = r;
 
         // Dots
         Gdiplus::Color dotCol; 
@@ -1140,12 +2587,13 @@ void DrawMap(HDC hdc, RECT clientRect) {
             int r = 200 + (int)(sinf(t + phase) * 55.0f);
             int g = 200 + (int)(sinf(t + phase + 2.094f) * 55.0f); // +120 deg
             int b = 200 + (int)(sinf(t + phase + 4.188f) * 55.0f); // +240 deg
-            
             dotCol = Gdiplus::Color(255, r, g, b);
         } else {
-            dotCol.SetFromCOLORREF(s->color);
+            dotCol.SetFromCOLORREF(SampleColor(*s));
         }
 
+        float sx = (float)screenX[i], sy = (float)screenY[i];
+
         // Check isDragMode instead of isCtrlHold
         if (app.isDragMode) {
             // Desaturate color (visual feedback for drag mode)
@@ -1159,33 +2607,80 @@ void DrawMap(HDC hdc, RECT clientRect) {
                 (gray * 7 + grn * 3) / 10,
                 (gray * 7 + blu * 3) / 10);
             
-            Gdiplus::SolidBrush br(dotCol);
-            
-        if (i == app.hoverIndex) {
-                    // Active Target cursor
-                    g.FillEllipse(&br, s->screenX - r, s->screenY - r, r*2, r*2); 
-                    Gdiplus::SolidBrush whiteBr(Gdiplus::Color(255, 255, 255, 255));
-                    g.FillEllipse(&whiteBr, s->screenX - 2.5f, s->screenY - 2.5f, 5.0f, 5.0f);
-                } else {
-                    // Passive dots
-                    g.FillEllipse(&br, s->screenX - r, s->screenY - r, r*2, r*2);
-                }
-            } 
-            else {
-            // Standard Drawing
+            g_tiles.Disc(sx, sy, r, dotCol.GetValue());
+            // Active Target cursor
+            if (i == app.hoverIndex) g_tiles.Disc(sx, sy, 2.5f, 0xffffffff);
+        } 
+        else {
+            // Standard Drawing; samples outside the metadata filters stay as faint dots
             if (isFocused) dotCol = Gdiplus::Color(255, 237, 237, 237);
-            Gdiplus::SolidBrush br(dotCol);
-            g.FillEllipse(&br, s->screenX - r, s->screenY - r, r*2, r*2);
+            else if (!g_meta.Match(i)) dotCol = Gdiplus::Color(35, dotCol.GetRed(), dotCol.GetGreen(), dotCol.GetBlue());
+            g_tiles.Disc(sx, sy, r, dotCol.GetValue());
         }
 
+        // Duplicate marker: thin ring around every member of a group
+        if (s->dupOf >= 0)
+            g_tiles.Ring(sx, sy, r + 3, 1.0f, Gdiplus::Color(app.isDragMode ? 60 : 110, 237, 237, 237).GetValue());
+
+        // Selected: bright ring just outside the dot
+        if (g_selection.flag[i]) g_tiles.Ring(sx, sy, r + 1.5f, 2.0f, Gdiplus::Color(230, 237, 237, 237).GetValue());
+
         // Ripple effect
         if (s->rippleAnim > 0.01f) {
             float t = 1.0f - s->rippleAnim; // 0.0 to 1.0
             float rad = r * 2.0f + (t * 100.0f); // Smaller expansion
             int ripAlpha = (int)(120 * s->rippleAnim); // More subtle opacity
+            g_tiles.Ring(sx, sy, rad, 1.5f, Gdiplus::Color(ripAlpha, 255, 255, 255).GetValue());
+        }
+    }
+    Lap(PROF_DOTS);
+
+    // Background, grid, neighbour lines and dots, rasterised tile by tile on the pool
+    GdiFlush();
+    g_tiles.Render({ g_backBits, g_bbWidth, g_bbHeight, g_bbWidth }, 0x141419, 0x232328, 50);
+    Lap(PROF_TILES);
+
+    // Labels and the hover widget go over the finished map layer
+    for (int k = 0; k < g_mapView.visibleCount; k++) {
+        int i = g_mapView.visible[k];
+        AudioSample* s = &app.samples[i];
+        float r = g_mapView.radius[k];
+        bool isFocused = (i == app.hoverIndex) || (app.menuVisible && i == app.menuIndex);
+
+        // Text label
+        bool showText = (!isFocused && app.scale > 80.0f && drawnCount < 100);
+        if (showText) {
+            SIZE sz; 
+            GetTextExtentPoint32W(g_hdcBack, s->filename, (int)wcslen(s->filename), &sz);
+            RECT rTxt = { screenX[i] + (int)r + 4, screenY[i] - sz.cy/2, 
+                          screenX[i] + (int)r + 4 + sz.cx, screenY[i] + sz.cy/2 };
+            if (rTxt.right >= clientRect.right || IsRectOverlap(rTxt, drawnRects, drawnCount)) showText = false;
+            else drawnRects[drawnCount++] = rTxt;
+        }
+        
+        s->textAnim.Update(showText, 0.08f); 
+        if (s->textAnim.value > 0.01f) {
+            // Border fade logic
+            int margin = 100; // Distance to start fading
+            int dist = screenX[i]; // Left
+            if (clientRect.right - screenX[i] < dist) dist = clientRect.right - screenX[i]; // Right
+            if (screenY[i] < dist) dist = screenY[i]; // Top
+            if (clientRect.bottom - screenY[i] < dist) dist = clientRect.bottom - screenY[i]; // Bottom
+            
+            float edgeFactor = 1.0f;
+            if (dist < margin) edgeFactor = (float)dist / (float)margin;
+            if (edgeFactor < 0.0f) edgeFactor = 0.0f;
+
+            // Target color is current brightness
+            int val = 20 + (int)((130 - 20) * s->textAnim.value);
+            
+            // Interpolate towards background color (20, 20, 25) based on edgeFactor
+            int R = 20 + (int)((val - 20) * edgeFactor);
+            int G = 20 + (int)((val - 20) * edgeFactor);
+            int B = 25 + (int)((val - 25) * edgeFactor);
             
-            Gdiplus::Pen ripPen(Gdiplus::Color(ripAlpha, 255, 255, 255), 1.5f);
-            g.DrawEllipse(&ripPen, s->screenX - rad, s->screenY - rad, rad * 2, rad * 2);
+            SetTextColor(g_hdcBack, RGB(R, G, B));
+            TextOutW(g_hdcBack, screenX[i] + (int)r + 4, screenY[i] - 6, s->filename, (int)wcslen(s->filename));
         }
 
         // Hover widget (force full alpha if menu is open for this item)
@@ -1195,7 +2690,7 @@ void DrawMap(HDC hdc, RECT clientRect) {
             // Hide hint if menu is open
             if (!app.menuVisible) {
                 SetTextColor(g_hdcBack, RGB(120, 120, 120)); 
-                TextOutA(g_hdcBack, s->screenX + (int)r + 12, s->screenY - 5, "right click for more info", 25);
+                TextOutA(g_hdcBack, screenX[i] + (int)r + 12, screenY[i] - 5, "right click for more info", 25);
             }
             
             g.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias); 
@@ -1205,17 +2700,20 @@ void DrawMap(HDC hdc, RECT clientRect) {
             Gdiplus::Color waveCol((int)(pulse * finalAlpha), 237, 237, 237);
             
             float wfW = 80.0f, wfH = 30.0f;
-            float drawX = s->screenX - wfW/2.0f;
-            float drawY = s->screenY - r - 10.0f - wfH;
+            float drawX = screenX[i] - wfW/2.0f;
+            float drawY = screenY[i] - r - 10.0f - wfH;
             
-            Gdiplus::Pen wPen(waveCol, 1.0f);
-            for(int w=0; w<WAVEFORM_RES-1; w++) {
-                float x1 = drawX + ((float)w * wfW / (float)WAVEFORM_RES);
-                float y1 = (drawY + wfH/2.0f) - (s->visualData[w] * (wfH/2.0f));
-                float x2 = drawX + ((float)(w+1) * wfW / (float)WAVEFORM_RES);
-                float y2 = (drawY + wfH/2.0f) - (s->visualData[w+1] * (wfH/2.0f));
-                g.DrawLine(&wPen, x1, y1, x2, y2);
+            // Min/max envelope: maxes left to right along the top, mins back along the bottom
+            const signed char* env = g_library.thumbs.Get(i);
+            int bins = g_library.thumbs.Bins();
+            Gdiplus::PointF outline[THUMB_MAX_BINS * 2];
+            for (int w = 0; w < bins; w++) {
+                float x = drawX + (w + 0.5f) * wfW / bins;
+                outline[w] = Gdiplus::PointF(x, (drawY + wfH/2.0f) - ThumbValue(env[w * 2 + 1]) * (wfH/2.0f));
+                outline[bins * 2 - 1 - w] = Gdiplus::PointF(x, (drawY + wfH/2.0f) - ThumbValue(env[w * 2]) * (wfH/2.0f));
             }
+            g.FillPolygon(&g_render.Fill(Gdiplus::Color(waveCol.GetA() / 3, 237, 237, 237)), outline, bins * 2);
+            g.DrawPolygon(&g_render.Stroke(waveCol, 1.0f), outline, bins * 2);
 
             SetTextColor(g_hdcBack, BlendColor((int)(255 * finalAlpha)));
             SIZE sz; 
@@ -1225,33 +2723,49 @@ void DrawMap(HDC hdc, RECT clientRect) {
         }
     }
 
+    // Selection gesture in progress
+    if (g_selection.gesture != SELECT_NONE && g_selection.outline.size() >= 2) {
+        const std::vector<Gdiplus::PointF>& o = g_selection.outline;
+        Gdiplus::SolidBrush& fill = g_render.Fill(Gdiplus::Color(25, 237, 237, 237));
+        Gdiplus::Pen& pen = g_render.Stroke(Gdiplus::Color(160, 237, 237, 237), 1.0f);
+        if (g_selection.gesture == SELECT_RECT) {
+            float l = o[0].X < o[1].X ? o[0].X : o[1].X, t = o[0].Y < o[1].Y ? o[0].Y : o[1].Y;
+            float w = fabsf(o[1].X - o[0].X), h = fabsf(o[1].Y - o[0].Y);
+            g.FillRectangle(&fill, l, t, w, h);
+            g.DrawRectangle(&pen, l, t, w, h);
+        } else {
+            g.FillPolygon(&fill, o.data(), (int)o.size());
+            g.DrawPolygon(&pen, o.data(), (int)o.size());
+        }
+    }
+    Lap(PROF_LABELS);
+
     // Context menu
     if (app.menuIndex >= 0 && app.menuIndex < app.count && app.menuVisible && app.menuAnim.value > 0.01f) {
         AudioSample* s = &app.samples[app.menuIndex];
         
-        // Find most similar sample
+        // Most similar sample in feature space
         int simIdx = -1; 
-        float minDist = FLT_MAX;
-        for(int i=0; i<app.count; i++) { 
-            if(i==app.menuIndex) continue; 
-            float d = (s->zcr - app.samples[i].zcr) * (s->zcr - app.samples[i].zcr) + 
-                      (s->rms - app.samples[i].rms) * (s->rms - app.samples[i].rms); 
-            if(d < minDist) {
-                minDist = d; 
-                simIdx = i;
-            }
-        }
+        float simDist;
+        if (g_simIndex.QueryId(app.menuIndex, 1, &simIdx, &simDist) == 0 || simIdx >= app.count) simIdx = -1;
 
-        char lines[5][128]; 
+        char lines[8][128]; 
         sprintf(lines[0], "%.2f MB", s->fileSize/(1024.0*1024.0)); 
         sprintf(lines[1], "%.2fs (%d Hz)", s->duration, s->sampleRate);
         sprintf(lines[2], "%d Samples", s->numSamples); 
-        sprintf(lines[3], "%d-bit %s", s->bitsPerSample, s->channels==2?"Stereo":"Mono");
+        const char* layout = s->channels == 1 ? "Mono" : (s->channels == 2 ? "Stereo" : "Multichannel");
+        if (s->bitsPerSample > 0) sprintf(lines[3], "%d-bit%s %s", s->bitsPerSample, s->isFloat ? " float" : "", layout);
+        else sprintf(lines[3], "Compressed %s", layout);
         sprintf(lines[4], "ZCR: %.2f  RMS: %.2f", s->zcr, s->rms);
+        sprintf(lines[5], "%.1f LUFS (%.1f max)  %.1f dBTP", s->loudness.integrated, s->loudness.shortTermMax, s->loudness.truePeak);
+        int nLines = 6;
+        if (s->rhythm.tempo > 0.0f) sprintf(lines[nLines++], "%.1f BPM  %d onsets  loop %.2f", s->rhythm.tempo, s->rhythm.onsets, s->rhythm.loopability);
+        else sprintf(lines[nLines++], "%d onset%s", s->rhythm.onsets, s->rhythm.onsets == 1 ? "" : "s");
+        if (s->dupOf >= 0) sprintf(lines[nLines++], "Dup: %d %s%s", s->dupCopies, s->dupCopies == 1 ? "copy" : "copies", s->dupOf == app.menuIndex ? " (kept)" : "");
 
         int maxW=0; 
         SIZE sz; 
-        for(int i=0; i<5; i++){
+        for(int i=0; i<nLines; i++){
             GetTextExtentPoint32A(g_hdcBack, lines[i], (int)strlen(lines[i]), &sz); 
             if(sz.cx>maxW) maxW=sz.cx;
         }
@@ -1265,41 +2779,163 @@ void DrawMap(HDC hdc, RECT clientRect) {
              if (45 + szSim.cx > maxW) maxW = 45 + szSim.cx;
         }
 
-        int mx = s->screenX + 20; 
-        int my = s->screenY + 25; 
+        int mx = screenX[app.menuIndex] + 20; 
+        int my = screenY[app.menuIndex] + 25; 
         int menuW = maxW + 20; 
-        int menuH = 6 * 16 + 12; 
+        int menuH = (nLines + 1) * 16 + 12; 
 
-        if(my + menuH > clientRect.bottom) my = s->screenY - menuH - 25; 
-        if(mx + menuW > clientRect.right) mx = s->screenX - menuW - 20;
+        if(my + menuH > clientRect.bottom) my = screenY[app.menuIndex] - menuH - 25; 
+        if(mx + menuW > clientRect.right) mx = screenX[app.menuIndex] - menuW - 20;
 
         // Top/left safety clamps
         if(my < 0) my = 0;
         if(mx < 0) mx = 0;
 
         int a = app.menuAnim.GetAlpha(0, 210); 
-        Gdiplus::SolidBrush mb(Gdiplus::Color(a, 15, 15, 15)); 
-        g.FillRectangle(&mb, mx-5, my-5, menuW, menuH);
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(a, 15, 15, 15)), mx-5, my-5, menuW, menuH);
 
         int ta = app.menuAnim.GetAlpha(0, 220); 
         SetTextColor(g_hdcBack, RGB(ta, ta, ta+5));
-        for(int i=0; i<5; i++) 
+        for(int i=0; i<nLines; i++) 
             TextOutA(g_hdcBack, mx, my+i*16, lines[i], (int)strlen(lines[i]));
         
-        TextOutA(g_hdcBack, mx, my+5*16, "Sim:", 4);
+        TextOutA(g_hdcBack, mx, my+nLines*16, "Sim:", 4);
         if(simIdx != -1) { 
             Gdiplus::Color c; 
-            c.SetFromCOLORREF(app.samples[simIdx].color); 
-            Gdiplus::SolidBrush sb(Gdiplus::Color(ta, c.GetRed(), c.GetGreen(), c.GetBlue())); 
-            g.FillEllipse(&sb, mx+30, my+5*16+5, 7, 7); 
+            c.SetFromCOLORREF(SampleColor(app.samples[simIdx])); 
+            g.FillEllipse(&g_render.Fill(Gdiplus::Color(ta, c.GetRed(), c.GetGreen(), c.GetBlue())), mx+30, my+nLines*16+5, 7, 7); 
             // Fix: Use TextOutW for Unicode filename
-            TextOutW(g_hdcBack, mx+45, my+5*16, app.samples[simIdx].filename, 
+            TextOutW(g_hdcBack, mx+45, my+nLines*16, app.samples[simIdx].filename, 
                     (int)wcslen(app.samples[simIdx].filename));
         }
     }
 
+    Lap(PROF_MENU);
+
+    // Similar sounds panel (top-N neighbours of the focused sample)
+    app.simPanelCount = 0;
+    SetRectEmpty(&app.simPanelRect);
+    int simFocus = (app.menuVisible && app.menuIndex != -1) ? app.menuIndex : app.lastHoverIndex;
+    if (app.isSimilarOpen && simFocus >= 0 && simFocus < app.count) {
+        float simDists[MAX_SIMILAR];
+        int found = g_simIndex.QueryId(simFocus, app.simPanelN, app.simPanelIds, simDists);
+        int rowH = 18, headerH = 24, panelW = 260;
+        int maxRows = (clientRect.bottom - 220) / rowH;
+        if (found > maxRows) found = maxRows;
+        if (found < 0) found = 0;
+        app.simPanelCount = found;
+
+        int px = clientRect.right - panelW - 15, py = 45;
+        app.simPanelRect = { px, py, px + panelW, py + headerH + found * rowH + 6 };
+
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(210, 15, 15, 15)), px, py, panelW, app.simPanelRect.bottom - py);
+
+        wchar_t title[MAX_PATH + 16];
+        swprintf(title, MAX_PATH + 16, L"similar to %s", app.samples[simFocus].filename);
+        RECT rTitle = { px + 8, py + 4, px + panelW - 8, py + headerH };
+        SetTextColor(g_hdcBack, RGB(150, 150, 150));
+        DrawTextW(g_hdcBack, title, -1, &rTitle, DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
+
+        for (int k = 0; k < found; k++) {
+            AudioSample* n = &app.samples[app.simPanelIds[k]];
+            int rowY = py + headerH + k * rowH;
+            bool hoverRow = app.currentMouse.x >= px && app.currentMouse.x <= px + panelW &&
+                            app.currentMouse.y >= rowY && app.currentMouse.y < rowY + rowH;
+
+            Gdiplus::Color c; 
+            c.SetFromCOLORREF(SampleColor(*n));
+            g.FillEllipse(&g_render.Fill(Gdiplus::Color(255, c.GetRed(), c.GetGreen(), c.GetBlue())), px + 10, rowY + 5, 7, 7);
+
+            char dist[16];
+            sprintf(dist, "%.2f", sqrtf(simDists[k]));
+            SIZE szDist; 
+            GetTextExtentPoint32A(g_hdcBack, dist, (int)strlen(dist), &szDist);
+            SetTextColor(g_hdcBack, RGB(90, 90, 95));
+            TextOutA(g_hdcBack, px + panelW - 8 - szDist.cx, rowY + 1, dist, (int)strlen(dist));
+
+            int val = hoverRow ? 237 : 180;
+            SetTextColor(g_hdcBack, RGB(val, val, val));
+            RECT rName = { px + 24, rowY + 1, px + panelW - 16 - szDist.cx, rowY + rowH };
+            DrawTextW(g_hdcBack, n->filename, -1, &rName, DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
+        }
+    }
+
     app.fps.Draw(g_hdcBack, app.currentMouse);
 
+    // Metadata filters: per-column histograms of all (dim) and matching (bright) samples;
+    // drag across one to keep a range, click or right-click it to clear
+    int leftPanelTop = 45 + (g_library.roots.size() > 1 ? (int)g_library.roots.size() * 16 : 0);
+    SetRectEmpty(&app.filterPanelRect);
+    if (app.isFilterOpen && g_meta.Size() > 0) {
+        int rowH = 34, labelH = 14, histH = 16, headerH = 24, panelW = 260;
+        int columns = g_meta.Columns();
+        int px = 15, py = leftPanelTop;
+        int hx = px + 8, hw = panelW - 16;
+        app.filterPanelRect = { px, py, px + panelW, py + headerH + columns * rowH + 4 };
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(210, 15, 15, 15)), px, py, panelW, app.filterPanelRect.bottom - py);
+
+        char line[96];
+        sprintf(line, "filters: %d / %d%s", g_meta.Matches(), g_meta.Size(), app.hideFiltered ? " (hiding others)" : "");
+        SetTextColor(g_hdcBack, RGB(150, 150, 150));
+        TextOutA(g_hdcBack, px + 8, py + 4, line, (int)strlen(line));
+
+        int all[META_HIST_BINS], kept[META_HIST_BINS];
+        for (int c = 0; c < columns; c++) {
+            int rowY = py + headerH + c * rowH, histY = rowY + labelH;
+            bool active = g_meta.Active(c);
+
+            SetTextColor(g_hdcBack, active ? RGB(237, 237, 237) : RGB(120, 120, 120));
+            const char* name = MetaColumnName(c);
+            TextOutA(g_hdcBack, hx, rowY - 1, name, (int)strlen(name));
+            if (active) {
+                char lo[32], hi[32];
+                FormatMetaValue(c, g_meta.RangeLo(c), lo);
+                FormatMetaValue(c, g_meta.RangeHi(c), hi);
+                sprintf(line, "%s - %s  (%d)", lo, hi, g_meta.Kept(c));
+            } else {
+                char lo[32], hi[32];
+                FormatMetaValue(c, g_meta.Min(c), lo);
+                FormatMetaValue(c, g_meta.Max(c), hi);
+                sprintf(line, "%s - %s", lo, hi);
+            }
+            SIZE szRange;
+            GetTextExtentPoint32A(g_hdcBack, line, (int)strlen(line), &szRange);
+            SetTextColor(g_hdcBack, RGB(90, 90, 95));
+            TextOutA(g_hdcBack, hx + hw - szRange.cx, rowY - 1, line, (int)strlen(line));
+
+            g_meta.Histogram(c, false, all);
+            g_meta.Histogram(c, true, kept);
+            int peak = 1;
+            for (int b = 0; b < META_HIST_BINS; b++) if (all[b] > peak) peak = all[b];
+            for (int b = 0; b < META_HIST_BINS; b++) {
+                int x0 = hx + b * hw / META_HIST_BINS, x1 = hx + (b + 1) * hw / META_HIST_BINS - 1;
+                int hAll = (all[b] * histH + peak - 1) / peak, hKept = (kept[b] * histH + peak - 1) / peak;
+                if (hAll > 0) g.FillRectangle(&g_render.Fill(Gdiplus::Color(255, 45, 45, 50)), x0, histY + histH - hAll, x1 - x0, hAll);
+                if (hKept > 0) g.FillRectangle(&g_render.Fill(Gdiplus::Color(255, 160, 160, 165)), x0, histY + histH - hKept, x1 - x0, hKept);
+            }
+            if (active && g_meta.Max(c) > g_meta.Min(c)) {
+                float span = g_meta.Max(c) - g_meta.Min(c);
+                int x0 = hx + (int)((g_meta.RangeLo(c) - g_meta.Min(c)) / span * hw);
+                int x1 = hx + (int)((g_meta.RangeHi(c) - g_meta.Min(c)) / span * hw);
+                g.FillRectangle(&g_render.Fill(Gdiplus::Color(40, 237, 237, 237)), x0, histY, x1 - x0 + 1, histH);
+            }
+        }
+    }
+
+    // Per-root stats for multi-root sessions (folder name, files, duplicates, length, size)
+    if (g_library.roots.size() > 1) {
+        SetTextColor(g_hdcBack, RGB(80, 80, 80));
+        for (size_t r = 0; r < g_library.roots.size(); r++) {
+            const LibraryRoot* root = g_library.roots[r].get();
+            const wchar_t* name = wcsrchr(root->path, L'\\');
+            wchar_t line[MAX_PATH + 96];
+            swprintf(line, MAX_PATH + 96, L"%s  %d files  %d dups  %.0f min  %.0f MB", name ? name + 1 : root->path,
+                     root->files, root->duplicates, root->duration / 60.0, root->bytes / 1048576.0);
+            TextOutW(g_hdcBack, 15, 37 + (int)r * 16, line, (int)wcslen(line));
+        }
+    }
+    Lap(PROF_PANELS);
+
     g.SetSmoothingMode(Gdiplus::SmoothingModeNone);
 
     // Oscilloscope
@@ -1321,7 +2957,8 @@ void DrawMap(HDC hdc, RECT clientRect) {
             RECT oscRect = { oscX, oscY, oscX + oscW, oscY + oscH };
             
             // Pass the new 'oscAlpha' argument to fix "too few arguments" error
-            app.osc.Draw(g_hdcBack, oscRect, app.audioMem, app.playStartTime, app.playByteRate, oscAlpha, app.playBufferSize);
+            app.osc.Draw(g_hdcBack, g, oscRect, app.audioMem, app.playStartTime, app.playByteRate, oscAlpha, app.playBufferSize);
+        Lap(PROF_OSC);
 
         // Minimap
         int mmW = 120, mmH = 120;
@@ -1342,18 +2979,9 @@ void DrawMap(HDC hdc, RECT clientRect) {
             int centerY = mmY + mmH / 2;
             int radius = (int)(sqrtf((float)(mmW * mmW + mmH * mmH)) / 2.0f);
             
-            Gdiplus::GraphicsPath path;
-            path.AddEllipse(centerX - radius, centerY - radius, radius * 2, radius * 2);
-            
-            Gdiplus::PathGradientBrush brush(&path);
-            Gdiplus::Color centerColor(app.animMinimap.GetAlpha(255, 200), 10, 10, 15);
-            Gdiplus::Color edgeColor(app.animMinimap.GetAlpha(0, 0), 10, 10, 15);
-            
-            brush.SetCenterColor(centerColor);
-            int count = 1;
-            brush.SetSurroundColors(&edgeColor, &count);
-            
-            g.FillRectangle(&brush, mmX, mmY, mmW, mmH);
+            g_render.Glow(g, Gdiplus::RectF((REAL)(centerX - radius), (REAL)(centerY - radius), (REAL)(radius * 2), (REAL)(radius * 2)),
+                          Gdiplus::RectF((REAL)mmX, (REAL)mmY, (REAL)mmW, (REAL)mmH),
+                          Gdiplus::Color(app.animMinimap.GetAlpha(255, 200), 10, 10, 15));
         }
 
         float rangeX = app.maxX - app.minX; 
@@ -1361,16 +2989,22 @@ void DrawMap(HDC hdc, RECT clientRect) {
         if (rangeX < 0.001f) rangeX = 1.0f;
         if (rangeY < 0.001f) rangeY = 1.0f;
 
-        // Draw dots
+        // Draw dots, summing where each cluster's dots land
+        float clusterX[MAX_CLUSTERS] = {}, clusterY[MAX_CLUSTERS] = {};
+        int clusterN[MAX_CLUSTERS] = {};
         for(int i=0; i<app.count; i++) {
-            float nX = (app.samples[i].zcr - app.minX) / rangeX;
-            float nY = (app.samples[i].rms - app.minY) / rangeY;
+            if (app.collapseDuplicates && app.samples[i].dupOf >= 0 && app.samples[i].dupOf != i) continue;
+            float nX = (app.samples[i].x - app.minX) / rangeX;
+            float nY = (app.samples[i].y - app.minY) / rangeY;
             
             int mx = mmX + 5 + (int)(nX * (mmW - 10));
             int my = mmY + mmH - 5 - (int)(nY * (mmH - 10));
             
+            int cl = app.samples[i].cluster;
+            if (app.clusterMethod >= 0 && cl >= 0) { clusterX[cl] += mx; clusterY[cl] += my; clusterN[cl]++; }
+
             if(mx >= mmX && mx < mmX+mmW && my >= mmY && my < mmY+mmH) {
-                COLORREF c = app.samples[i].color;
+                COLORREF c = SampleColor(app.samples[i]);
                 int r = GetRValue(c);
                 int g = GetGValue(c);
                 int b = GetBValue(c);
@@ -1403,9 +3037,17 @@ void DrawMap(HDC hdc, RECT clientRect) {
                 SetPixel(g_hdcBack, mx, my, RGB(dr, dg, db));
             }
         }
+
+        // Cluster centroids as rings in their colour
+        for (int c = 0; c < MAX_CLUSTERS; c++) {
+            if (clusterN[c] == 0) continue;
+            COLORREF cc = ClusterColor(c);
+            float ccx = clusterX[c] / clusterN[c], ccy = clusterY[c] / clusterN[c];
+            g.DrawEllipse(&g_render.Stroke(Gdiplus::Color(alpha, GetRValue(cc), GetGValue(cc), GetBValue(cc)), 1.5f), ccx - 3.0f, ccy - 3.0f, 6.0f, 6.0f);
+        }
         
         // Viewport rect
-        Gdiplus::Pen viewPen(Gdiplus::Color(alpha, 237, 237, 237), 1.0f);
+        Gdiplus::Pen& viewPen = g_render.Stroke(Gdiplus::Color(alpha, 237, 237, 237), 1.0f);
         
         float wL = -app.offsetX - (cx / (app.scale * 2.0f)); 
         float wR = -app.offsetX + ((clientRect.right - cx) / (app.scale * 2.0f));
@@ -1422,14 +3064,15 @@ void DrawMap(HDC hdc, RECT clientRect) {
         if (vT < mmY) vT = mmY; if (vB > mmY + mmH) vB = mmY + mmH;
         g.DrawRectangle(&viewPen, vL, vT, vR - vL, vB - vT);
     }
+    Lap(PROF_MINIMAP);
 
     // Buttons
     int btnW = 70, btnH = 26, btnY = clientRect.bottom - 40; 
-    Gdiplus::SolidBrush btnBg(Gdiplus::Color(255, 20, 20, 25));
+    Gdiplus::SolidBrush& btnBg = g_render.Fill(Gdiplus::Color(255, 20, 20, 25));
 
     // Open button
     int alpha1 = app.animBtnOpen.GetAlpha(100, 237);
-    Gdiplus::Pen btnPen1(Gdiplus::Color(alpha1, 237, 237, 237), 1.0f);
+    Gdiplus::Pen& btnPen1 = g_render.Stroke(Gdiplus::Color(alpha1, 237, 237, 237), 1.0f);
     g.FillRectangle(&btnBg, 15, btnY, btnW, btnH);
     g.DrawRectangle(&btnPen1, 15, btnY, btnW, btnH);
     SetTextColor(g_hdcBack, BlendColor(alpha1));
@@ -1449,7 +3092,7 @@ void DrawMap(HDC hdc, RECT clientRect) {
     // List button
     int btn2X = 95;
     int alpha2 = app.animBtnList.GetAlpha(100, 237);
-    Gdiplus::Pen btnPen2(Gdiplus::Color(alpha2, 237, 237, 237), 1.0f);
+    Gdiplus::Pen& btnPen2 = g_render.Stroke(Gdiplus::Color(alpha2, 237, 237, 237), 1.0f);
     g.FillRectangle(&btnBg, btn2X, btnY, btnW, btnH);
     g.DrawRectangle(&btnPen2, btn2X, btnY, btnW, btnH);
     SetTextColor(g_hdcBack, BlendColor(alpha2));
@@ -1467,13 +3110,12 @@ void DrawMap(HDC hdc, RECT clientRect) {
     int dVal = isActive ? 237 : 120; // 237 = #ED
 
     Gdiplus::Color dColor(dAlpha, dVal, dVal, dVal);
-    Gdiplus::Pen btnPen3(dColor, 1.0f);
+    Gdiplus::Pen& btnPen3 = g_render.Stroke(dColor, 1.0f);
 
     // Background fill
     if (isActive) {
         // Dim white fill when active
-        Gdiplus::SolidBrush activeBg(Gdiplus::Color(40, 237, 237, 237)); 
-        g.FillRectangle(&activeBg, btn3X, btnY, btnW, btnH);
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(40, 237, 237, 237)), btn3X, btnY, btnW, btnH);
     } else {
         g.FillRectangle(&btnBg, btn3X, btnY, btnW, btnH);
     }
@@ -1512,6 +3154,7 @@ void DrawMap(HDC hdc, RECT clientRect) {
             TextOutA(g_hdcBack, 15, clientRect.bottom - 58, app.statusMsg, (int)strlen(app.statusMsg));
         }
     }
+    Lap(PROF_HUD);
 
 // List panel
     if (app.listOpenAnim.value > 0.01f) {
@@ -1520,12 +3163,10 @@ void DrawMap(HDC hdc, RECT clientRect) {
         int headerOffset = 24; 
         
         int alphaDim = app.listOpenAnim.GetAlpha(0, 200);
-        Gdiplus::SolidBrush dimBrush(Gdiplus::Color(alphaDim, 0, 0, 0));
-        g.FillRectangle(&dimBrush, 0, 0, clientRect.right, clientRect.bottom);
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(alphaDim, 0, 0, 0)), 0, 0, clientRect.right, clientRect.bottom);
 
         int alphaWin = app.listOpenAnim.GetAlpha(0, 255);
-        Gdiplus::SolidBrush listBg(Gdiplus::Color(alphaWin, 30, 30, 35));
-        g.FillRectangle(&listBg, listX, listY, listW, listH);
+        g.FillRectangle(&g_render.Fill(Gdiplus::Color(alphaWin, 30, 30, 35)), listX, listY, listW, listH);
 
         const char* escHint = "esc to close";
         SIZE szHint;
@@ -1534,6 +3175,15 @@ void DrawMap(HDC hdc, RECT clientRect) {
         SetTextColor(g_hdcBack, RGB(hintAlpha, hintAlpha, hintAlpha));
         TextOutA(g_hdcBack, listX + (listW - szHint.cx) / 2, listY + 5, escHint, (int)strlen(escHint));
 
+        // Loudness columns left of "find": integrated LUFS and true peak, right-aligned
+        SIZE szFind, szHead;
+        GetTextExtentPoint32A(g_hdcBack, "find", 4, &szFind);
+        int peakRight = listX + listW - 56 - szFind.cx, lufsRight = peakRight - 44;
+        GetTextExtentPoint32A(g_hdcBack, "lufs", 4, &szHead);
+        TextOutA(g_hdcBack, lufsRight - szHead.cx, listY + 5, "lufs", 4);
+        GetTextExtentPoint32A(g_hdcBack, "dbtp", 4, &szHead);
+        TextOutA(g_hdcBack, peakRight - szHead.cx, listY + 5, "dbtp", 4);
+
         int itemH = 25, totalH = app.count * itemH;
         int viewH = listH - headerOffset;
         
@@ -1545,14 +3195,11 @@ void DrawMap(HDC hdc, RECT clientRect) {
              int sbW = (int)app.scrollAnim.GetFloat(4.0f, 12.0f); 
              int sbAlpha = app.listOpenAnim.GetAlpha(0, app.scrollAnim.GetAlpha(100, 180));
              int sbX = (listX + listW) - sbW; 
-             Gdiplus::SolidBrush sbBrush(Gdiplus::Color(sbAlpha, 80, 80, 90));
-             g.FillRectangle(&sbBrush, sbX, sbY, sbW, sbH);
+             g.FillRectangle(&g_render.Fill(Gdiplus::Color(sbAlpha, 80, 80, 90)), sbX, sbY, sbW, sbH);
         }
 
-        Gdiplus::Region region(Gdiplus::Rect(listX, listY + headerOffset, listW, listH - headerOffset)); 
-        g.SetClip(&region);
-        HRGN hRgn = CreateRectRgn(listX, listY + headerOffset, listX + listW, listY + listH); 
-        SelectClipRgn(g_hdcBack, hRgn);
+        g.SetClip(Gdiplus::Rect(listX, listY + headerOffset, listW, listH - headerOffset));
+        SelectClipRgn(g_hdcBack, g_render.ClipRegion(listX, listY + headerOffset, listX + listW, listY + listH));
 
         int startIdx = (int)(app.listScrollY / itemH); 
         int visibleCount = (viewH / itemH) + 2;
@@ -1587,15 +3234,16 @@ void DrawMap(HDC hdc, RECT clientRect) {
             if (fadeAlpha < 0.0f) fadeAlpha = 0.0f; 
             if (fadeAlpha > 1.0f) fadeAlpha = 1.0f;
 
-            Gdiplus::Color c; c.SetFromCOLORREF(s->color); 
+            Gdiplus::Color c; c.SetFromCOLORREF(SampleColor(*s)); 
             int finalDotAlpha = (int)(alphaWin * fadeAlpha);
-            Gdiplus::SolidBrush b(Gdiplus::Color(finalDotAlpha, c.GetRed(), c.GetGreen(), c.GetBlue()));
-            g.FillEllipse(&b, listX + 10, yPos + 7, 10, 10);
+            // A faint rule in the group's colour where a new cluster starts
+            if (app.clusterMethod >= 0 && i > 0 && app.samples[app.sortedIndices[i - 1]].cluster != s->cluster)
+                g.FillRectangle(&g_render.Fill(Gdiplus::Color(finalDotAlpha / 4, c.GetRed(), c.GetGreen(), c.GetBlue())), listX + 10, yPos, listW - 20, 1);
+            g.FillEllipse(&g_render.Fill(Gdiplus::Color(finalDotAlpha, c.GetRed(), c.GetGreen(), c.GetBlue())), listX + 10, yPos + 7, 10, 10);
             
             if (sIdx == app.listClickedIdx && app.listClickAnim > 0.01f) {
                 int wAlpha = (int)(200 * app.listClickAnim * fadeAlpha); 
-                Gdiplus::SolidBrush flash(Gdiplus::Color(wAlpha, 255, 255, 255));
-                g.FillEllipse(&flash, listX + 10, yPos + 7, 10, 10);
+                g.FillEllipse(&g_render.Fill(Gdiplus::Color(wAlpha, 255, 255, 255)), listX + 10, yPos + 7, 10, 10);
             }
         }
 
@@ -1635,6 +3283,17 @@ void DrawMap(HDC hdc, RECT clientRect) {
             const char* goTxt = "find";
             SIZE szGo; GetTextExtentPoint32A(g_hdcBack, goTxt, 4, &szGo);
             int goX = listX + listW - 40 - szGo.cx;
+
+            // Long names end under the loudness columns
+            char lufs[16], peak[16];
+            int lufsLen = sprintf(lufs, "%.1f", s->loudness.integrated), peakLen = sprintf(peak, "%.1f", s->loudness.truePeak);
+            SIZE szL, szP;
+            GetTextExtentPoint32A(g_hdcBack, lufs, lufsLen, &szL);
+            GetTextExtentPoint32A(g_hdcBack, peak, peakLen, &szP);
+            g.FillRectangle(&g_render.Fill(Gdiplus::Color(alphaWin, 30, 30, 35)), lufsRight - 40, yPos + 2, listX + listW - 20 - (lufsRight - 40), itemH - 4);
+            SetTextColor(g_hdcBack, RGB(30 + (int)((120 - 30) * fadeAlpha), 30 + (int)((120 - 30) * fadeAlpha), 35 + (int)((120 - 35) * fadeAlpha)));
+            TextOutA(g_hdcBack, lufsRight - szL.cx, yPos + 4, lufs, lufsLen);
+            TextOutA(g_hdcBack, peakRight - szP.cx, yPos + 4, peak, peakLen);
             
             // Check hover for find specifically
             POINT pt = app.currentMouse;
@@ -1653,13 +3312,22 @@ void DrawMap(HDC hdc, RECT clientRect) {
         
         g.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias); 
         SelectClipRgn(g_hdcBack, NULL); 
-        DeleteObject(hRgn); 
         g.ResetClip();
     }
+    Lap(PROF_LIST);
+
+    // The overlay itself is not charged to any section
+    if (g_showProfiler) {
+        DrawProfilerOverlay(g_hdcBack, IsRectEmpty(&app.filterPanelRect) ? leftPanelTop : app.filterPanelRect.bottom + 8);
+        lapStart = NowMs();
+    }
 
     SelectObject(g_hdcBack, hOldFont); 
-    DeleteObject(hFontUI);
+    g.Flush();
     BitBlt(hdc, 0, 0, clientRect.right, clientRect.bottom, g_hdcBack, 0, 0, SRCCOPY);
+    Lap(PROF_BLIT);
+    if (g_showProfiler) g_frameProf.EndFrame(g_newCount.load(std::memory_order_relaxed) - allocStart, g_render.Created() - objectStart);
+    if (g_startup.firstFrame == 0) g_startup.firstFrame = NowMs();
 }
 
 // App icon
@@ -1737,6 +3405,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         app.targetScale = 300.0f; 
         app.hoverIndex = -1; 
         app.lastHoverIndex = -1;
+        app.simPanelN = 10;
+        app.filterDragColumn = -1;
         OleInitialize(NULL);
         MFStartup(MF_VERSION);
         sprintf(app.statusMsg, "click 'open' or press 'o' to load samples.");
@@ -1806,33 +3476,160 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             case VK_ESCAPE:
                 if (app.isListOpen) {
                     app.isListOpen = false;
+                } else if (!g_selection.ids.empty()) {
+                    ClearSelection();
                 } else {
                     PostQuitMessage(0);
                 }
                 break;
 
             case 'O': // Open folder
+                OpenFolder(hwnd, false);
+                break;
+
+            case 'A': // Add a folder to the library
+                OpenFolder(hwnd, true);
+                break;
+
+            case 'R': // Remove the focused sample's root from the library
                 {
-                    char path[MAX_PATH];
-                    if (PickFolder(hwnd, path)) {
-                        for(int i=0; i<app.count; i++) free(app.samples[i].visualData);
-                        app.count = 0; 
-                        ScanDirectory(path);
-                        if (app.count > 0) {
-                            UpdateBounds(); 
-                            app.offsetX = -(app.maxX + app.minX) / 2.0f; 
-                            app.offsetY = -(app.maxY + app.minY) / 2.0f;
-                            sprintf(app.statusMsg, "loaded %d samples.", app.count);
-                        }
-                        app.msgStartTime = GetTickCount(); 
-                        InvalidateRect(hwnd, NULL, FALSE);
+                    int focus = (app.menuVisible && app.menuIndex != -1) ? app.menuIndex : app.hoverIndex;
+                    if (focus < 0 || focus >= app.count) focus = app.lastHoverIndex;
+                    if (focus >= 0 && focus < app.count && g_library.roots.size() > 1) {
+                        int r = app.samples[focus].root, files = g_library.roots[r]->files;
+                        RemoveRoot(r);
+                        sprintf(app.statusMsg, "removed %d samples: %d roots, %d samples left.", files, (int)g_library.roots.size(), app.count);
+                    } else {
+                        sprintf(app.statusMsg, "hover a sample of the root to remove (the last root stays).");
                     }
+                    app.msgStartTime = GetTickCount();
+                    InvalidateRect(hwnd, NULL, FALSE);
                 }
                 break;
 
             case 'L': // Toggle list
                 app.isListOpen = !app.isListOpen;
                 break;
+
+            case 'N': // Toggle similar panel
+                app.isSimilarOpen = !app.isSimilarOpen;
+                break;
+
+            case VK_OEM_4: // '[' fewer similar results
+            case VK_OEM_6: // ']' more similar results
+                app.simPanelN += (wParam == VK_OEM_6) ? 5 : -5;
+                if (app.simPanelN < 5) app.simPanelN = 5;
+                if (app.simPanelN > 30) app.simPanelN = 30;
+                sprintf(app.statusMsg, "similar: top %d", app.simPanelN);
+                app.msgStartTime = GetTickCount();
+                break;
+
+            case 'M': // Cycle map layout; shift+M re-fits the current one (patched points included)
+                if (app.count > 0) {
+                    bool refit = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
+                    if (!refit) app.layoutMethod = (app.layoutMethod + 1) % LAYOUT_COUNT;
+                    DWORD start = GetTickCount();
+                    ApplyLayout();
+                    UpdateBounds();
+                    app.offsetX = -(app.maxX + app.minX) / 2.0f; 
+                    app.offsetY = -(app.maxY + app.minY) / 2.0f;
+                    sprintf(app.statusMsg, "layout: %s%s (%lu ms)", LayoutName(app.layoutMethod), refit ? " re-fit" : "", GetTickCount() - start);
+                    app.msgStartTime = GetTickCount();
+                }
+                break;
+
+            case 'Y': // Cycle the axes layout's vertical axis: rms, lufs, short-term max, true peak
+                if (app.count > 0) {
+                    app.axisY = app.layoutMethod == LAYOUT_AXES ? (app.axisY + 1) % AXIS_COUNT : app.axisY;
+                    app.layoutMethod = LAYOUT_AXES;
+                    ApplyLayout();
+                    UpdateBounds();
+                    app.offsetX = -(app.maxX + app.minX) / 2.0f;
+                    app.offsetY = -(app.maxY + app.minY) / 2.0f;
+                    sprintf(app.statusMsg, "layout: axes, zcr / %s", AxisName(app.axisY));
+                    app.msgStartTime = GetTickCount();
+                }
+                break;
+
+            case 'K': { // Cycle map clustering: k-means, dbscan, off
+                app.clusterMethod = app.clusterMethod + 1 >= CLUSTER_COUNT ? -1 : app.clusterMethod + 1;
+                double start = NowMs();
+                FitClusters();
+                SortSamples();
+                if (app.clusterMethod < 0) sprintf(app.statusMsg, "clusters: off");
+                else sprintf(app.statusMsg, "clusters: %s, %d groups (%.0f ms)", ClusterName(app.clusterMethod), g_cluster.Count(), NowMs() - start);
+                app.msgStartTime = GetTickCount();
+                InvalidateRect(hwnd, NULL, FALSE);
+            } break;
+
+            case 'W': // Toggle watch-folder mode
+                g_library.watchEnabled = !g_library.watchEnabled;
+                g_library.pending.clear();
+                for (auto& root : g_library.roots) {
+                    root->watcher.Stop();
+                    // Changes made while paused are caught by a full re-list
+                    root->overflow = g_library.watchEnabled;
+                }
+                g_library.lastEvent = GetTickCount();
+                StartWatching();
+                sprintf(app.statusMsg, "watch folder: %s", g_library.watchEnabled ? "on" : "off");
+                app.msgStartTime = GetTickCount();
+                break;
+
+            case 'T': // Trace the next scans
+                g_traceScans = !g_traceScans;
+                sprintf(app.statusMsg, "import tracing: %s", g_traceScans ? "on (next open or add)" : "off");
+                app.msgStartTime = GetTickCount();
+                break;
+
+            case 'P': // Frame profiler overlay; shift+P writes its window to CSV
+                if (GetKeyState(VK_SHIFT) & 0x8000) {
+                    wchar_t csvPath[MAX_PATH];
+                    FILE* f;
+                    if (g_frameProf.Frames() > 0 && GetAppDataPath(L"frame-profile.csv", csvPath) && (f = _wfopen(csvPath, L"wb"))) {
+                        g_frameProf.WriteCsv(f);
+                        fclose(f);
+                        sprintf(app.statusMsg, "%d frames written to %%LOCALAPPDATA%%\\audiomap\\frame-profile.csv", g_frameProf.Frames());
+                    } else {
+                        sprintf(app.statusMsg, "no profiled frames to write (press 'p' first).");
+                    }
+                } else {
+                    g_showProfiler = !g_showProfiler;
+                    if (g_showProfiler) g_frameProf.Reset();
+                    sprintf(app.statusMsg, "frame profiler: %s", g_showProfiler ? "on" : "off");
+                }
+                app.msgStartTime = GetTickCount();
+                InvalidateRect(hwnd, NULL, FALSE);
+                break;
+
+            case 'H': { // Cycle the hover thumbnail resolution; root caches follow it
+                int bins = g_library.thumbs.Bins() * 2;
+                if (bins > THUMB_MAX_BINS) bins = 32;
+                g_library.thumbs.SetBins(bins);
+                for (auto& root : g_library.roots) root->cacheDirty = true;
+                sprintf(app.statusMsg, "thumbnails: %d bins, %d KB", bins, (int)(g_library.thumbs.Bytes() / 1024));
+                app.msgStartTime = GetTickCount();
+                InvalidateRect(hwnd, NULL, FALSE);
+            } break;
+
+            case 'F': // Metadata filter panel; shift+F hides filtered-out samples instead of dimming them
+                if (GetKeyState(VK_SHIFT) & 0x8000) {
+                    app.hideFiltered = !app.hideFiltered;
+                    g_mapView.count = -1;
+                    sprintf(app.statusMsg, "filtered-out samples: %s", app.hideFiltered ? "hidden" : "dimmed");
+                    app.msgStartTime = GetTickCount();
+                } else {
+                    app.isFilterOpen = !app.isFilterOpen;
+                }
+                InvalidateRect(hwnd, NULL, FALSE);
+                break;
+
+            case 'C': // Collapse duplicate groups to their kept copy
+                app.collapseDuplicates = !app.collapseDuplicates;
+                MarkMapDirty();
+                sprintf(app.statusMsg, "duplicates: %s (%d groups)", app.collapseDuplicates ? "collapsed" : "shown", app.dupGroups);
+                app.msgStartTime = GetTickCount();
+                break;
         }
     } return 0;
     
@@ -1858,6 +3655,29 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             return 0;
         }
 
+        // Similar panel rows
+        if (app.simPanelCount > 0 && mx >= app.simPanelRect.left && mx <= app.simPanelRect.right &&
+            my >= app.simPanelRect.top && my <= app.simPanelRect.bottom) {
+            int row = (my - (app.simPanelRect.top + 24)) / 18;
+            if (my >= app.simPanelRect.top + 24 && row >= 0 && row < app.simPanelCount) {
+                int id = app.simPanelIds[row];
+                PlayAudio(id);
+                app.samples[id].rippleAnim = 1.0f;
+            }
+            return 0;
+        }
+
+        // Filter panel: a drag across a histogram sets its range
+        if (PtInRect(&app.filterPanelRect, { mx, my })) {
+            int c = FilterColumnAt(mx, my);
+            if (c >= 0) {
+                app.filterDragColumn = c;
+                app.filterDragX = mx;
+                SetCapture(hwnd);
+            }
+            return 0;
+        }
+
         // Minimap
         if (app.count > 0 && mx >= app.minimapRect.left && mx <= app.minimapRect.right &&
             my >= app.minimapRect.top && my <= app.minimapRect.bottom) {
@@ -1868,20 +3688,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         
         // Open button
         if (mx >= 15 && mx <= 85 && my >= r.bottom - 40 && my <= r.bottom - 14) {
-            char path[MAX_PATH];
-            if (PickFolder(hwnd, path)) {
-                for(int i=0; i<app.count; i++) free(app.samples[i].visualData);
-                app.count = 0; 
-                ScanDirectory(path);
-                if (app.count > 0) {
-                    UpdateBounds(); 
-                    app.offsetX = -(app.maxX + app.minX) / 2.0f; 
-                    app.offsetY = -(app.maxY + app.minY) / 2.0f;
-                    sprintf(app.statusMsg, "loaded %d samples.", app.count);
-                }
-                app.msgStartTime = GetTickCount(); 
-                InvalidateRect(hwnd, NULL, FALSE);
-            }
+            OpenFolder(hwnd, false);
             return 0;
         }
 
@@ -1920,8 +3727,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                             app.isListOpen = false;
 
                             // Center camera: offset = -position
-                            app.offsetX = -app.samples[actualIdx].zcr;
-                            app.offsetY = -app.samples[actualIdx].rms;
+                            app.offsetX = -app.samples[actualIdx].x;
+                            app.offsetY = -app.samples[actualIdx].y;
 
                             // Trigger visual feedback
                             app.samples[actualIdx].rippleAnim = 1.0f;
@@ -1940,6 +3747,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         // Main canvas logic
         app.menuVisible = 0; 
 
+        // Shift+drag selects a rectangle, ctrl+drag a lasso; a click without a drag clears
+        if (wParam & (MK_SHIFT | MK_CONTROL)) {
+            g_selection.gesture = (wParam & MK_CONTROL) ? SELECT_LASSO : SELECT_RECT;
+            g_selection.outline.assign(1, Gdiplus::PointF((float)mx, (float)my));
+            SetCapture(hwnd);
+            return 0;
+        }
+
         // If drag mode is on and we clicked a dot: prepare to drag
         if (app.isDragMode && app.hoverIndex >= 0 && app.hoverIndex < app.count) {
             app.dragCandidate = app.hoverIndex;
@@ -1971,6 +3786,22 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
     case WM_LBUTTONUP: 
     case WM_MBUTTONUP:
+        // A click without a drag clears the histogram's filter
+        if (app.filterDragColumn >= 0 && abs((short)LOWORD(lParam) - app.filterDragX) <= 2) {
+            g_meta.ClearRange(app.filterDragColumn);
+            MarkFilterChanged();
+            InvalidateRect(hwnd, NULL, FALSE);
+        }
+        app.filterDragColumn = -1;
+        if (g_selection.gesture != SELECT_NONE) {
+            if (g_selection.outline.size() < 2) ClearSelection();
+            else sprintf(app.statusMsg, "selected %d samples%s", (int)g_selection.ids.size(),
+                         g_selection.ids.empty() ? "" : " (drag mode: drag one out to take them all)");
+            app.msgStartTime = GetTickCount();
+            g_selection.gesture = SELECT_NONE;
+            g_selection.outline.clear();
+            InvalidateRect(hwnd, NULL, FALSE);
+        }
         app.isDragging = 0; 
         app.isMinimapDragging = 0; 
         app.isScrollDragging = 0;
@@ -1979,6 +3810,16 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
 
     case WM_RBUTTONDOWN:
+        if (PtInRect(&app.filterPanelRect, { (short)LOWORD(lParam), (short)HIWORD(lParam) })) {
+            // Right-click a histogram to clear it, the header to clear every filter
+            int c = FilterColumnAt((short)LOWORD(lParam), (short)HIWORD(lParam));
+            if (c >= 0) g_meta.ClearRange(c);
+            else if ((short)HIWORD(lParam) < app.filterPanelRect.top + 24) g_meta.ClearAll();
+            MarkFilterChanged();
+            InvalidateRect(hwnd, NULL, FALSE);
+            return 0;
+        }
+
         if (app.isListOpen) {
             RECT r; 
             GetClientRect(hwnd, &r);
@@ -2027,6 +3868,28 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         app.currentMouse.x = mx; 
         app.currentMouse.y = my;
 
+        // Filter range drag
+        if (app.filterDragColumn >= 0) {
+            if (abs(mx - app.filterDragX) > 2) {
+                int c = app.filterDragColumn;
+                g_meta.SetRange(c, FilterValueAt(c, app.filterDragX), FilterValueAt(c, mx));
+                MarkFilterChanged();
+                InvalidateRect(hwnd, NULL, FALSE);
+            }
+            return 0;
+        }
+
+        // Selection gesture: the selection follows the outline live
+        if (g_selection.gesture != SELECT_NONE) {
+            std::vector<Gdiplus::PointF>& o = g_selection.outline;
+            Gdiplus::PointF pt((float)mx, (float)my);
+            if (g_selection.gesture == SELECT_RECT) { o.resize(2); o[1] = pt; }
+            else if (fabsf(pt.X - o.back().X) + fabsf(pt.Y - o.back().Y) >= 3.0f) o.push_back(pt);
+            UpdateSelectionGesture();
+            InvalidateRect(hwnd, NULL, FALSE);
+            return 0;
+        }
+
         // Check for drag drop init
         if (app.isDragMode && app.dragCandidate != -1) {
             int dist = abs(mx - app.lastMouse.x) + abs(my - app.lastMouse.y);
@@ -2038,7 +3901,13 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 app.isDragging = 0; 
                 
                 DropSource* pdsrc = new DropSource();
-                DataObject* pdobj = new DataObject(app.samples[app.dragCandidate].fullpath);
+                // A selected dot carries the whole selection
+                std::vector<const wchar_t*> paths;
+                if (g_selection.flag[app.dragCandidate])
+                    for (int id : g_selection.ids) paths.push_back(app.samples[id].fullpath);
+                else
+                    paths.push_back(app.samples[app.dragCandidate].fullpath);
+                DataObject* pdobj = new DataObject(paths);
                 DWORD effect;
                 DoDragDrop(pdobj, pdsrc, DROPEFFECT_COPY, &effect);
                 
@@ -2142,18 +4011,17 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         
         bool inMinimap = (app.count > 0 && mx >= app.minimapRect.left && mx <= app.minimapRect.right && 
                         my >= app.minimapRect.top && my <= app.minimapRect.bottom);
+        bool inSimPanel = (app.simPanelCount > 0 && mx >= app.simPanelRect.left && mx <= app.simPanelRect.right &&
+                        my >= app.simPanelRect.top && my <= app.simPanelRect.bottom);
+        bool inFilterPanel = PtInRect(&app.filterPanelRect, { mx, my }) != 0;
                         
-        if (!inMinimap && !app.isDragging) { // Don't hover dots while panning
-            RECT r; 
-            GetClientRect(hwnd, &r);
-            int safeLeft = -50, safeRight = r.right + 50;
-            int safeTop = -50, safeBottom = r.bottom + 50;
-
-            for (int i = 0; i < app.count; i++) {
-                int sx = app.samples[i].screenX;
-                int sy = app.samples[i].screenY;
-
-                if (sx < safeLeft || sx > safeRight || sy < safeTop || sy > safeBottom) continue;
+        if (!inMinimap && !inSimPanel && !inFilterPanel && !app.isDragging) { // Don't hover dots while panning
+            // Only dots drawn last frame (already culled to the view); the visible
+            // list is in index order, so the lowest index under the cursor still wins
+            for (int k = 0; k < g_mapView.visibleCount; k++) {
+                int i = g_mapView.visible[k];
+                int sx = g_mapView.screenX[i];
+                int sy = g_mapView.screenY[i];
 
                 if(abs(mx - sx) + abs(my - sy) < 25) { // Click radius
                     app.hoverIndex = i;
@@ -2174,8 +4042,11 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     } return 0;
 
     case WM_DESTROY:
-        for(int i=0; i<app.count; i++) free(app.samples[i].visualData);
+        if (g_check.worker.joinable()) g_check.worker.join();
+        SaveSession();
+        ClearLibrary();
         if(app.audioMem) free(app.audioMem);
+        g_render.Release();
         if(g_hbmBack) DeleteObject(g_hbmBack); 
         if(g_hdcBack) DeleteDC(g_hdcBack);
         MFShutdown(); 
@@ -2186,10 +4057,193 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
+// Write a path as UTF-8, quoted for CSV ("" escapes) or JSON (\\ and \" escapes)
+static void WritePathUtf8(FILE* f, const wchar_t* path, bool json) {
+    char utf8[MAX_PATH * 4];
+    WideCharToMultiByte(CP_UTF8, 0, path, -1, utf8, sizeof(utf8), NULL, NULL);
+    fputc('"', f);
+    for (const char* c = utf8; *c; c++) {
+        if (*c == '"') fputs(json ? "\\\"" : "\"\"", f);
+        else if (*c == '\\' && json) fputs("\\\\", f);
+        else fputc(*c, f);
+    }
+    fputc('"', f);
+}
+
+void WriteFeatureTable(FILE* f, bool json) {
+    if (!json) {
+        fprintf(f, "path,duration,sample_rate,channels,bits,float,zcr,rms,lufs,short_term_max,true_peak,tempo,onset_count");
+        for (int d = 0; d < FEATURE_DIM; d++) fprintf(f, ",%s", FeatureName(d));
+        fprintf(f, ",x,y,cluster,dup_of\n");
+    }
+    for (int i = 0; i < app.count; i++) {
+        const AudioSample* s = &app.samples[i];
+        const AudioSample* kept = (s->dupOf >= 0 && s->dupOf != i) ? &app.samples[s->dupOf] : NULL;
+        if (json) {
+            fprintf(f, "{\"path\":");
+            WritePathUtf8(f, s->fullpath, true);
+            fprintf(f, ",\"duration\":%.4f,\"sample_rate\":%d,\"channels\":%d,\"bits\":%d,\"float\":%s,\"zcr\":%.6g,\"rms\":%.6g",
+                    s->duration, s->sampleRate, s->channels, s->bitsPerSample, s->isFloat ? "true" : "false", s->zcr, s->rms);
+            fprintf(f, ",\"lufs\":%.2f,\"short_term_max\":%.2f,\"true_peak\":%.2f,\"tempo\":%.2f,\"onset_count\":%d",
+                    s->loudness.integrated, s->loudness.shortTermMax, s->loudness.truePeak, s->rhythm.tempo, s->rhythm.onsets);
+            for (int d = 0; d < FEATURE_DIM; d++) fprintf(f, ",\"%s\":%.6g", FeatureName(d), s->features[d]);
+            fprintf(f, ",\"x\":%.6g,\"y\":%.6g,\"cluster\":%d,\"dup_of\":", s->x, s->y, app.clusterMethod >= 0 ? s->cluster : CLUSTER_NOISE);
+            if (kept) WritePathUtf8(f, kept->fullpath, true); else fprintf(f, "null");
+            fprintf(f, "}\n");
+        } else {
+            WritePathUtf8(f, s->fullpath, false);
+            fprintf(f, ",%.4f,%d,%d,%d,%d,%.6g,%.6g,%.2f,%.2f,%.2f,%.2f,%d", s->duration, s->sampleRate, s->channels, s->bitsPerSample,
+                    (int)s->isFloat, s->zcr, s->rms, s->loudness.integrated, s->loudness.shortTermMax, s->loudness.truePeak,
+                    s->rhythm.tempo, s->rhythm.onsets);
+            for (int d = 0; d < FEATURE_DIM; d++) fprintf(f, ",%.6g", s->features[d]);
+            fprintf(f, ",%.6g,%.6g,%d,", s->x, s->y, app.clusterMethod >= 0 ? s->cluster : CLUSTER_NOISE);
+            if (kept) WritePathUtf8(f, kept->fullpath, false);
+            fprintf(f, "\n");
+        }
+    }
+}
+
+// Headless import: audiomap.exe --scan <folder> [--scan <folder>...] [--out <file>] [--format csv|jsonl|cache]
+//                  [--layout axes|pca|tsne|umap] [--y-axis rms|lufs|short-term|true-peak]
+//                  [--cluster kmeans|dbscan|off] [--threads n] [--no-cache]
+//                  [--time] [--progress]
+//                  [--trace <file.json>] [--thumb-bins n]
+// Uses the same decode/feature/layout code as the GUI; returns a process exit code.
+int RunScanCli(int argc, wchar_t** argv) {
+    std::vector<std::wstring> folders;
+    const wchar_t* outPath = NULL;
+    const wchar_t* tracePath = NULL;
+    const wchar_t* format = L"csv";
+    int threads = 0;
+    bool useCache = true, showTime = false, showProgress = false, badValue = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (wcscmp(argv[i], L"--scan") == 0 && hasValue) folders.push_back(argv[++i]);
+        else if (wcscmp(argv[i], L"--out") == 0 && hasValue) outPath = argv[++i];
+        else if (wcscmp(argv[i], L"--format") == 0 && hasValue) format = argv[++i];
+        else if (wcscmp(argv[i], L"--trace") == 0 && hasValue) tracePath = argv[++i];
+        else if (wcscmp(argv[i], L"--threads") == 0 && hasValue) threads = _wtoi(argv[++i]);
+        else if (wcscmp(argv[i], L"--layout") == 0 && hasValue) {
+            const wchar_t* m = argv[++i];
+            app.layoutMethod = !wcscmp(m, L"pca") ? LAYOUT_PCA : !wcscmp(m, L"tsne") ? LAYOUT_TSNE :
+                               !wcscmp(m, L"umap") ? LAYOUT_UMAP : LAYOUT_AXES;
+            badValue |= app.layoutMethod == LAYOUT_AXES && wcscmp(m, L"axes") != 0;
+        }
+        else if (wcscmp(argv[i], L"--y-axis") == 0 && hasValue) {
+            const wchar_t* m = argv[++i];
+            app.axisY = !wcscmp(m, L"lufs") ? AXIS_LUFS : !wcscmp(m, L"short-term") ? AXIS_SHORT_TERM :
+                        !wcscmp(m, L"true-peak") ? AXIS_TRUE_PEAK : AXIS_RMS;
+            badValue |= app.axisY == AXIS_RMS && wcscmp(m, L"rms") != 0;
+        }
+        else if (wcscmp(argv[i], L"--cluster") == 0 && hasValue) {
+            const wchar_t* m = argv[++i];
+            app.clusterMethod = !wcscmp(m, L"kmeans") ? CLUSTER_KMEANS : !wcscmp(m, L"dbscan") ? CLUSTER_DBSCAN : -1;
+            badValue |= app.clusterMethod < 0 && wcscmp(m, L"off") != 0;
+        }
+        else if (wcscmp(argv[i], L"--decoder") == 0 && hasValue) {
+            const wchar_t* m = argv[++i];
+            g_nativeDecode = wcscmp(m, L"mf") != 0;
+            badValue |= g_nativeDecode && wcscmp(m, L"native") != 0;
+        }
+        else if (wcscmp(argv[i], L"--thumb-bins") == 0 && hasValue) {
+            g_library.thumbs.SetBins(_wtoi(argv[++i]));
+            g_library.pinThumbBins = true;
+        }
+        else if (wcscmp(argv[i], L"--no-cache") == 0) useCache = false;
+        else if (wcscmp(argv[i], L"--time") == 0) showTime = true;
+        else if (wcscmp(argv[i], L"--progress") == 0) showProgress = true;
+        else { fwprintf(stderr, L"unknown option: %s\n", argv[i]); return 2; }
+    }
+    bool json = wcscmp(format, L"jsonl") == 0, binary = wcscmp(format, L"cache") == 0;
+    if (folders.empty() || badValue || (!json && !binary && wcscmp(format, L"csv") != 0) || (binary && !outPath)) {
+        fprintf(stderr, "usage: audiomap --scan <folder> [--scan <folder>...] [--out <file>] [--format csv|jsonl|cache]\n"
+                        "                [--layout axes|pca|tsne|umap] [--y-axis rms|lufs|short-term|true-peak]\n"
+                        "                [--cluster kmeans|dbscan|off] [--thumb-bins n] [--threads n] [--decoder native|mf]\n"
+                        "                [--no-cache] [--time] [--progress] [--trace <file.json>]\n");
+        return 2;
+    }
+
+    OleInitialize(NULL);
+    MFStartup(MF_VERSION);
+
+    std::atomic<bool> scanning(true);
+    std::thread progress;
+    if (showProgress) {
+        progress = std::thread([&]() {
+            while (scanning) {
+                fprintf(stderr, "\ranalysed %d / %d", g_processedCount.load(), g_totalCount.load());
+                Sleep(200);
+            }
+            fprintf(stderr, "\ranalysed %d / %d\n", g_processedCount.load(), g_totalCount.load());
+        });
+    }
+    if (showTime || tracePath) g_tracer.Start();
+    double start = NowMs();
+    AddRoots(folders, threads, useCache);
+    double total = NowMs() - start;
+    g_tracer.Stop();
+    scanning = false;
+    if (progress.joinable()) progress.join();
+
+    int result = 0;
+    if (binary) {
+        FeatureCache out;
+        if (!out.Save(outPath, app.samples, g_library.thumbs, app.count)) result = 1;
+    } else {
+        FILE* f = outPath ? _wfopen(outPath, L"wb") : stdout;
+        if (f) {
+            WriteFeatureTable(f, json);
+            if (f != stdout) fclose(f);
+        } else {
+            result = 1;
+        }
+    }
+    if (result) fwprintf(stderr, L"cannot write %s\n", outPath);
+    if (tracePath) {
+        FILE* f = _wfopen(tracePath, L"wb");
+        if (!f || !g_tracer.WriteChromeTrace(f)) { fwprintf(stderr, L"cannot write %s\n", tracePath); result = 1; }
+        if (f) fclose(f);
+    }
+
+    if (showTime) {
+        fprintf(stderr, "%d files, %d samples, %d duplicate groups\n", g_totalCount.load(), app.count, app.dupGroups);
+        for (auto& root : g_library.roots)
+            fwprintf(stderr, L"  %s: %d samples, %d duplicates, %.1f min, %.1f MB\n", root->path, root->files, root->duplicates,
+                     root->duration / 60.0, root->bytes / 1048576.0);
+        fprintf(stderr, "collect %.1f ms, analyse %.1f ms, layout %.1f ms, duplicates %.1f ms, index %.1f ms, total %.1f ms\n",
+                g_scanTimings.collect, g_scanTimings.analyse, g_scanTimings.layout, g_scanTimings.duplicates, g_scanTimings.index, total);
+        if (total > 0) fprintf(stderr, "%.1f files/s\n", g_totalCount.load() * 1000.0 / total);
+        fprintf(stderr, "\n");
+        WriteImportSummary(stderr);
+    }
+
+    ClearLibrary();
+    MFShutdown();
+    OleUninitialize();
+    return result;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
+    if (strstr(lpCmdLine, "--scan") != NULL) {
+        // Streams the caller redirected (map.csv, a pipe) are kept; only missing ones
+        // go to the parent's console, or a new one
+        HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE), err = GetStdHandle(STD_ERROR_HANDLE);
+        bool needOut = out == NULL || out == INVALID_HANDLE_VALUE, needErr = err == NULL || err == INVALID_HANDLE_VALUE;
+        if (needOut || needErr) {
+            if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
+            if (needOut) freopen("CONOUT$", "w", stdout);
+            if (needErr) freopen("CONOUT$", "w", stderr);
+        }
+        int argc = 0;
+        wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        int result = argv ? RunScanCli(argc, argv) : 2;
+        LocalFree(argv);
+        return result;
+    }
+
+    g_startup.launch = NowMs();
     timeBeginPeriod(1);
 
-    srand(GetTickCount()); 
     ULONG_PTR gdiplusToken; 
     GdiplusStartupInput gdiplusStartupInput;
     GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
@@ -2212,7 +4266,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     HICON hIcon = CreateSineIcon(hInstance);
     SendMessage(hwnd, WM_SETICON, ICON_BIG, (LPARAM)hIcon);
     SendMessage(hwnd, WM_SETICON, ICON_SMALL, (LPARAM)hIcon);
-    
+
+    // Reopen the last library before the first frame; files are checked in the background
+    RestoreSession();
     ShowWindow(hwnd, nCmdShow);
 
     // Init smooth mouse to center
@@ -2235,6 +4291,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
              lastPerfCount = perfCount;
              
              app.fps.Update((float)dt);
+             PollLibraryCheck(hwnd);
+             PollWatcher(hwnd);
 
              float smoothSpeed = 0.25f;
              app.smoothMouse.x += (app.currentMouse.x - app.smoothMouse.x) * smoothSpeed;
@@ -0,0 +1,847 @@
+// Benchmarks for the analysis core (no GUI, no platform decoders)
+//
+//   audiomap_bench [layout|similar|analysis|loudness|rhythm|dups|relax|decode|render|project|publish|filter|select|cluster|all] [--quick] [--wav-dir DIR] [--threads N] [--mp3 FILE]
+
+#include "core/cluster.h"
+#include "core/decoder.h"
+#include "core/features.h"
+#include "core/fingerprint.h"
+#include "core/flac.h"
+#include "core/layout.h"
+#include "core/loudness.h"
+#include "core/metadata.h"
+#include "core/parallel.h"
+#include "core/pcmfile.h"
+#include "core/project.h"
+#include "core/raster.h"
+#include "core/selection.h"
+#include "core/similarity.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int g_threads = 0;
+static bool g_quick = false;
+
+static double NowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Gaussian-ish clusters in feature space
+static void MakeSyntheticFeatures(int n, std::vector<float>& feats) {
+    feats.resize((size_t)n * FEATURE_DIM);
+    for (int i = 0; i < n; i++) {
+        unsigned int cluster = HashU32(i) % 24;
+        for (int d = 0; d < FEATURE_DIM; d++) {
+            float center = (float)(HashU32(cluster * 97 + d) % 1000) / 100.0f;
+            float noise = 0;
+            for (int k = 0; k < 4; k++) noise += (float)(HashU32(i * 131 + d * 17 + k) % 1000) / 1000.0f - 0.5f;
+            feats[(size_t)i * FEATURE_DIM + d] = center + noise * 0.6f;
+        }
+    }
+}
+
+// Decaying harmonic tone plus filtered noise, different per seed
+static void MakeSyntheticPcm(int seed, int rate, float secs, std::vector<short>& out) {
+    int n = (int)(rate * secs);
+    out.resize(n);
+    unsigned int st = HashU32(seed + 1);
+    float f1 = 100.0f + HashU32(seed * 3) % 800, f2 = 200.0f + HashU32(seed * 5) % 3000;
+    float decay = 2.0f + HashU32(seed * 7) % 10, lp = 0;
+    for (int i = 0; i < n; i++) {
+        float t = (float)i / rate;
+        st = HashU32(st);
+        lp += 0.2f * ((st & 0xffff) / 32768.0f - 1.0f - lp);
+        float harm = 0;
+        for (int k = 1; k <= 8; k++) harm += sinf(6.2831853f * f1 * k * t * (1 + 0.3f * t)) / k;
+        float v = expf(-decay * t) * (0.3f * harm + 0.3f * sinf(6.2831853f * f2 * t) + 0.4f * lp) * 0.5f;
+        out[i] = (short)(v > 1 ? 32767 : (v < -1 ? -32767 : v * 32767));
+    }
+}
+
+static void BenchLayout() {
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 10000 } : std::vector<int>{ 10000, 50000, 100000, 200000 };
+    printf("layout benchmark, %u threads\n", std::thread::hardware_concurrency());
+    printf("%-8s %-6s %12s %14s\n", "n", "method", "fit ms", "place 1% ms");
+    for (int n : sizes) {
+        std::vector<float> feats;
+        MakeSyntheticFeatures(n, feats);
+        int fitN = n - n / 100;
+        std::vector<float> xy((size_t)n * 2);
+
+        for (int m = LAYOUT_PCA; m < LAYOUT_COUNT; m++) {
+            LayoutEngine engine;
+            engine.method = m;
+            engine.numThreads = g_threads;
+            engine.tsneIterations = 250;
+            engine.umapEpochs = 100;
+
+            double t0 = NowMs();
+            engine.Fit(feats.data(), fitN, xy.data());
+            double fitMs = NowMs() - t0;
+
+            t0 = NowMs();
+            engine.Place(feats.data() + (size_t)fitN * FEATURE_DIM, n - fitN, xy.data() + (size_t)fitN * 2);
+            printf("%-8d %-6s %12.1f %14.2f\n", n, LayoutName(m), fitMs, NowMs() - t0);
+            fflush(stdout);
+        }
+    }
+}
+
+// Query latency and recall@10 against brute force in the same standardized space
+static void BenchSimilar() {
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 10000 } : std::vector<int>{ 10000, 100000, 500000 };
+    printf("similarity benchmark, %u threads\n", std::thread::hardware_concurrency());
+    printf("%-8s %12s %12s %10s\n", "n", "build ms", "query us", "recall@10");
+    for (int n : sizes) {
+        std::vector<float> feats;
+        MakeSyntheticFeatures(n, feats);
+        SimilarityIndex index;
+        index.numThreads = g_threads;
+
+        double t0 = NowMs();
+        index.Build(feats.data(), n);
+        double buildMs = NowMs() - t0;
+
+        const int queries = 10000;
+        int ids[10]; float dists[10];
+        t0 = NowMs();
+        for (int q = 0; q < queries; q++) index.QueryId((int)(HashU32(q) % (unsigned int)n), 10, ids, dists);
+        double queryUs = (NowMs() - t0) * 1000.0 / queries;
+
+        double mean[FEATURE_DIM], invStd[FEATURE_DIM];
+        for (int d = 0; d < FEATURE_DIM; d++) {
+            double sum = 0, sumSq = 0;
+            for (int i = 0; i < n; i++) { double v = feats[(size_t)i * FEATURE_DIM + d]; sum += v; sumSq += v * v; }
+            mean[d] = sum / n;
+            double var = sumSq / n - mean[d] * mean[d];
+            invStd[d] = (var > 1e-12) ? 1.0 / sqrt(var) : 0.0;
+        }
+        const int checks = 50;
+        int hits = 0;
+        std::vector<std::pair<float, int>> exact(n);
+        for (int q = 0; q < checks; q++) {
+            int id = (int)(HashU32(q) % (unsigned int)n);
+            int found = index.QueryId(id, 10, ids, dists);
+            const float* a = &feats[(size_t)id * FEATURE_DIM];
+            for (int i = 0; i < n; i++) {
+                const float* b = &feats[(size_t)i * FEATURE_DIM];
+                double dist = 0;
+                for (int d = 0; d < FEATURE_DIM; d++) { double t = (a[d] - b[d]) * invStd[d]; dist += t * t; }
+                exact[i] = { (i == id) ? FLT_MAX : (float)dist, i };
+            }
+            std::partial_sort(exact.begin(), exact.begin() + 10, exact.end());
+            for (int j = 0; j < found; j++)
+                for (int e = 0; e < 10; e++) if (ids[j] == exact[e].second) { hits++; break; }
+        }
+        printf("%-8d %12.1f %12.2f %10.3f\n", n, buildMs, queryUs, hits / (10.0 * checks));
+        fflush(stdout);
+    }
+}
+
+// Feature extraction throughput over decoded PCM (one file per task, like ScanDirectory)
+template <typename T>
+static void BenchAnalysisOn(const std::vector<std::vector<T>>& pcm, const std::vector<int>& rates,
+                            const std::vector<int>& chans, const char* label) {
+    int n = (int)pcm.size();
+    std::vector<SampleAnalysis> out(n);
+    double audioSec = 0;
+    for (int i = 0; i < n; i++) audioSec += (double)pcm[i].size() / chans[i] / rates[i];
+
+    for (int threads : { 1, g_threads }) {
+        double t0 = NowMs();
+        ParallelRanges(n, threads, [&](int start, int end) {
+            for (int i = start; i < end; i++)
+                AnalyzePcm(pcm[i].data(), (int)pcm[i].size(), rates[i], chans[i], &out[i]);
+        });
+        double ms = NowMs() - t0;
+        printf("%-10s %6d files %8.1f s audio %3d thr %10.1f ms %10.0f files/s %8.0fx realtime\n",
+               label, n, audioSec, threads ? threads : (int)std::thread::hardware_concurrency(),
+               ms, n * 1000.0 / ms, audioSec * 1000.0 / ms);
+        fflush(stdout);
+    }
+}
+
+static void BenchAnalysis() {
+    int n = g_quick ? 200 : 2000;
+    std::vector<std::vector<short>> pcm(n);
+    std::vector<int> rates(n, 44100), chans(n, 1);
+    for (int i = 0; i < n; i++) MakeSyntheticPcm(i, 44100, 0.5f + (i % 5) * 0.5f, pcm[i]);
+    printf("analysis benchmark (synthetic one-shots)\n");
+    BenchAnalysisOn(pcm, rates, chans, "int16");
+    // Same material through the float path used for 24-bit and float sources
+    std::vector<std::vector<float>> pcmFloat(n);
+    for (int i = 0; i < n; i++) {
+        pcmFloat[i].resize(pcm[i].size());
+        for (size_t j = 0; j < pcm[i].size(); j++) pcmFloat[i][j] = pcm[i][j] / 32768.0f;
+    }
+    BenchAnalysisOn(pcmFloat, rates, chans, "float");
+    // Stereo pairs: per-channel crossings and the mid/side pass
+    std::vector<std::vector<short>> pcmStereo(n / 2);
+    std::vector<int> stereo(n / 2, 2);
+    for (int i = 0; i < n / 2; i++) {
+        const std::vector<short>& l = pcm[i * 2];
+        const std::vector<short>& r = pcm[i * 2 + 1];
+        size_t len = l.size() < r.size() ? l.size() : r.size();
+        pcmStereo[i].resize(len * 2);
+        for (size_t j = 0; j < len; j++) { pcmStereo[i][j * 2] = l[j]; pcmStereo[i][j * 2 + 1] = r[j]; }
+    }
+    rates.resize(n / 2);
+    BenchAnalysisOn(pcmStereo, rates, stereo, "stereo");
+}
+
+// Loudness measurement: its share of the import analysis (AnalyzePcm includes it) over
+// the analysis suite's one-shots, then the two kernels, scalar vs sse2, on 60 s of stereo
+static void BenchLoudness() {
+    int n = g_quick ? 200 : 2000;
+    std::vector<std::vector<short>> pcm(n);
+    double audioSec = 0;
+    for (int i = 0; i < n; i++) {
+        MakeSyntheticPcm(i, 44100, 0.5f + (i % 5) * 0.5f, pcm[i]);
+        audioSec += pcm[i].size() / 44100.0;
+    }
+    SampleAnalysis a;
+    Loudness l;
+    double t0 = NowMs();
+    for (int i = 0; i < n; i++) AnalyzePcm(pcm[i].data(), (int)pcm[i].size(), 44100, 1, &a);
+    double analysisMs = NowMs() - t0;
+    t0 = NowMs();
+    for (int i = 0; i < n; i++) MeasureLoudness(pcm[i].data(), (int)pcm[i].size(), 44100, 1, &l);
+    double loudnessMs = NowMs() - t0;
+    printf("loudness benchmark, 1 thread\n");
+    printf("%d one-shots (%.0f s audio): analysis %.1f ms, of which loudness %.1f ms (%.0f%%, %.0fx realtime)\n",
+           n, audioSec, analysisMs, loudnessMs, 100.0 * loudnessMs / analysisMs, audioSec * 1000.0 / loudnessMs);
+
+    const int rate = 48000, frames = rate * (g_quick ? 10 : 60);
+    std::vector<float> left(frames + 2 * TRUE_PEAK_PAD), right(frames);
+    unsigned int st = 1;
+    for (int i = 0; i < frames; i++) {      // Sustained, so neither path runs into denormals
+        st = HashU32(st);
+        float noise = (float)(st & 0xffff) / 65536.0f - 0.5f;
+        left[TRUE_PEAK_PAD + i] = 0.3f * sinf(0.031f * i) + 0.2f * noise;
+        right[i] = 0.3f * sinf(0.057f * i) - 0.2f * noise;
+    }
+    const float* x = &left[TRUE_PEAK_PAD];
+    KWeighting k(rate);
+    printf("%-16s %12s %12s %9s\n", "kernel (60 s)", "scalar ms", "simd ms", "speedup");
+    double ms[2];
+    for (int simd = 0; simd < 2; simd++) {
+        KWeightState st;
+        float sq[2];
+        t0 = NowMs();
+        for (int p = 0; p < frames; p += rate / 10) (simd ? KWeightEnergy : KWeightEnergyScalar)(k, &st, x + p, &right[p], rate / 10, sq);
+        ms[simd] = NowMs() - t0;
+    }
+    printf("%-16s %12.2f %12.2f %8.1fx\n", "k-weight stereo", ms[0], ms[1], ms[0] / ms[1]);
+    for (int simd = 0; simd < 2; simd++) {
+        KWeightState st;
+        float sq[2];
+        t0 = NowMs();
+        for (int p = 0; p < frames; p += rate / 10) (simd ? KWeightEnergy : KWeightEnergyScalar)(k, &st, x + p, NULL, rate / 10, sq);
+        ms[simd] = NowMs() - t0;
+    }
+    printf("%-16s %12.2f %12.2f %8.1fx\n", "k-weight mono", ms[0], ms[1], ms[0] / ms[1]);
+    float peaks[2];
+    for (int simd = 0; simd < 2; simd++) {
+        t0 = NowMs();
+        peaks[simd] = (simd ? OversampledPeak : OversampledPeakScalar)(x, frames, 4);
+        ms[simd] = NowMs() - t0;
+    }
+    printf("%-16s %12.2f %12.2f %8.1fx%s\n", "true peak 4x", ms[0], ms[1], ms[0] / ms[1], peaks[0] == peaks[1] ? "" : "  (MISMATCH)");
+    fflush(stdout);
+}
+
+static void BenchRhythm() {
+    int n = g_quick ? 200 : 2000;
+    std::vector<std::vector<short>> pcm(n);
+    std::vector<float> mono;
+    double audioSec = 0;
+    for (int i = 0; i < n; i++) {
+        MakeSyntheticPcm(i, 44100, 0.5f + (i % 5) * 0.5f, pcm[i]);
+        audioSec += pcm[i].size() / 44100.0;
+    }
+    SampleAnalysis a;
+    Rhythm r;
+    double t0 = NowMs();
+    for (int i = 0; i < n; i++) AnalyzePcm(pcm[i].data(), (int)pcm[i].size(), 44100, 1, &a);
+    double analysisMs = NowMs() - t0, rhythmMs = 0;
+    for (int i = 0; i < n; i++) {
+        mono.resize(pcm[i].size());
+        for (size_t j = 0; j < mono.size(); j++) mono[j] = pcm[i][j] / 32768.0f;
+        t0 = NowMs();
+        AnalyzeRhythm(mono.data(), (int)mono.size(), (int)mono.size(), 44100, &r);
+        rhythmMs += NowMs() - t0;
+    }
+    printf("rhythm benchmark, 1 thread\n");
+    printf("%d one-shots (%.0f s audio): analysis %.1f ms, of which rhythm %.1f ms (%.0f%%, %.0fx realtime)\n",
+           n, audioSec, analysisMs, rhythmMs, 100.0 * rhythmMs / analysisMs, audioSec * 1000.0 / rhythmMs);
+
+    // Two-bar kick/hat loops from 70 to 180 BPM, trimmed to length and cut from longer files
+    int loops = g_quick ? 50 : 500, exact = 0, octave = 0, within = 0, scored = 0, cut = 0;
+    unsigned int st = 3;
+    audioSec = 0; rhythmMs = 0;
+    for (int i = 0; i < loops; i++) {
+        float bpm = 70.0f + 110.0f * i / loops;
+        int beat = (int)(44100 * 60.0f / bpm), frames = beat * 8;
+        mono.assign(frames, 0.0f);
+        for (int h = 0; h < 16; h++) {
+            int s = h * beat / 2;
+            for (int j = 0; j < 11025 && s + j < frames; j++) {
+                st = HashU32(st);
+                float noise = (float)(st & 0xffff) / 32768.0f - 1.0f;
+                mono[s + j] += h % 2 == 0 ? 0.8f * sinf(6.2831853f * (50.0f + 100.0f * expf(-j / 800.0f)) * j / 44100.0f) * expf(-j / 3528.0f)
+                                          : 0.2f * noise * expf(-j / 441.0f);
+            }
+        }
+        audioSec += frames / 44100.0;
+        t0 = NowMs();
+        AnalyzeRhythm(mono.data(), frames, frames, 44100, &r);
+        rhythmMs += NowMs() - t0;
+        exact += fabsf(r.tempo - bpm) < 0.01f * bpm;
+        octave += fabsf(r.tempo - 2.0f * bpm) < 0.02f * bpm || fabsf(2.0f * r.tempo - bpm) < 0.02f * bpm;
+        scored += r.loopability > 0.5f;
+        AnalyzeRhythm(mono.data(), frames, frames * 4, 44100, &r);
+        within += fabsf(r.tempo - bpm) < 0.02f * bpm;
+        cut += r.loopability == 0.0f;
+    }
+    printf("%d loops (%.0f s audio): %.1f ms (%.0fx realtime)\n", loops, audioSec, rhythmMs, audioSec * 1000.0 / rhythmMs);
+    printf("trimmed: tempo within 1%% %d, an octave off %d, loop score > 0.5 %d; cut from longer files: tempo within 2%% %d, loop score 0 %d\n",
+           exact, octave, scored, within, cut);
+    fflush(stdout);
+}
+
+static void BenchDups() {
+    int n = g_quick ? 1000 : 10000;
+    printf("duplicate grouping benchmark, %d fingerprints\n", n);
+    std::vector<unsigned int> fps((size_t)n * FP_FRAMES);
+    std::vector<int> lens(n), group(n);
+    std::vector<short> pcm;
+    std::vector<float> mono;
+    // A few hundred distinct sounds, repeated with small gain changes to form groups
+    for (int i = 0; i < n; i++) {
+        MakeSyntheticPcm(i % (n / 4 + 1), 22050, 1.0f, pcm);
+        float gain = 1.0f - 0.1f * (i / (n / 4 + 1));
+        mono.resize(pcm.size());
+        for (size_t j = 0; j < pcm.size(); j++) mono[j] = pcm[j] / 32768.0f * gain;
+        lens[i] = ComputeFingerprint(mono.data(), (int)mono.size(), 22050, &fps[(size_t)i * FP_FRAMES], FP_FRAMES);
+    }
+    double t0 = NowMs();
+    int groups = GroupDuplicates(fps.data(), lens.data(), FP_FRAMES, n, 0.2f, group.data(), g_threads);
+    printf("%-8d %12.1f ms %8d groups\n", n, NowMs() - t0, groups);
+}
+
+static void BenchRelax() {
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 10000 } : std::vector<int>{ 10000, 100000 };
+    printf("de-overlap benchmark\n");
+    for (int n : sizes) {
+        std::vector<float> xy((size_t)n * 2);
+        std::vector<unsigned int> keys(n);
+        for (int i = 0; i < n; i++) {
+            keys[i] = HashU32(i);
+            xy[i * 2] = (float)(HashU32(i * 2) % 10000) / 10000.0f;
+            xy[i * 2 + 1] = (float)(HashU32(i * 2 + 1) % 10000) / 10000.0f;
+        }
+        float minDist = 0.4f * sqrtf(1.0f / n);
+        double t0 = NowMs();
+        RelaxOverlaps(xy.data(), keys.data(), n, minDist, 16, g_threads);
+        printf("%-8d %12.1f ms\n", n, NowMs() - t0);
+    }
+}
+
+// One 4K map frame (background, grid, dots, duplicate rings, neighbour lines) per
+// Render, at 1, 2, 4, ... threads up to the core count (or --threads)
+static void BenchRender() {
+    const int w = 3840, h = 2160, frames = g_quick ? 10 : 60;
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 5000 } : std::vector<int>{ 1000, 5000, 20000 };
+    int maxThreads = g_threads > 0 ? g_threads : (int)std::thread::hardware_concurrency();
+    if (maxThreads < 1) maxThreads = 1;
+    std::vector<unsigned int> pixels((size_t)w * h);
+    printf("tile render benchmark, %dx%d, %d frames\n", w, h, frames);
+    printf("%-8s %8s %12s %9s\n", "dots", "threads", "ms/frame", "speedup");
+    for (int n : sizes) {
+        double single = 0;
+        for (int threads = 1;; threads = (threads * 2 > maxThreads) ? maxThreads : threads * 2) {
+            TileRasterizer tiles(threads);
+            double t0 = NowMs();
+            for (int f = 0; f < frames; f++) {
+                for (int i = 0; i < 5; i++)
+                    tiles.Segment(w / 2.0f, h / 2.0f, (float)(HashU32(i + f) % w), (float)(HashU32(i * 3 + f) % h), 2.5f,
+                                  0xc8ffffff, 0xc8000000u | (HashU32(i) & 0xffffff));
+                for (int i = 0; i < n; i++) {
+                    float x = (float)(HashU32(i * 2) % w) + f, y = (float)(HashU32(i * 2 + 1) % h);
+                    float r = 6.0f + (float)(HashU32(i * 5) % 100) / 10.0f;
+                    tiles.Disc(x, y, r, 0xff000000u | (HashU32(i) & 0xffffff));
+                    if (i % 10 == 0) tiles.Ring(x, y, r + 3, 1.0f, 0x6eededed);
+                }
+                tiles.Render({ pixels.data(), w, h, w }, 0x141419, 0x232328, 50);
+            }
+            double ms = (NowMs() - t0) / frames;
+            if (threads == 1) single = ms;
+            printf("%-8d %8d %12.2f %8.2fx\n", n, threads, ms, single / ms);
+            if (threads >= maxThreads) break;
+        }
+    }
+}
+
+// Per-frame world-to-screen projection and culling of the whole map: one point at a
+// time out of a large per-sample record (the old layout, ~2 KB apart like the app's
+// sample struct) vs the flat arrays, scalar and vectorised
+static void BenchProject() {
+    struct Record { float x, y; int screenX, screenY; bool hidden; char rest[2032]; };
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 5000 } : std::vector<int>{ 5000, 20000 };
+    const int frames = g_quick ? 200 : 1000;
+    printf("projection benchmark, %d frames, 1920x1080 view\n", frames);
+    printf("%-8s %12s %12s %12s %9s\n", "points", "record us", "scalar us", "simd us", "visible");
+    for (int n : sizes) {
+        std::vector<Record> records(n);
+        std::vector<float> x(n), y(n);
+        std::vector<unsigned char> hidden(n);
+        for (int i = 0; i < n; i++) {
+            x[i] = records[i].x = (float)(HashU32(i * 2) % 20000) / 100.0f - 100.0f;
+            y[i] = records[i].y = (float)(HashU32(i * 2 + 1) % 20000) / 100.0f - 100.0f;
+            hidden[i] = records[i].hidden = (i % 20 == 0);
+        }
+        std::vector<int> sx(n), sy(n), vis(n);
+        CullBox view = { -20, -20, 1940, 1100 }, hole = { 1740, 950, 1905, 1065 };
+        int visible = 0;
+        auto Transform = [](int f) {
+            float scale = 4.0f + (f % 50) * 0.1f;
+            return MapTransform{ 960.0f + (f % 40 - 20) * scale * 2.0f, scale * 2.0f, 540.0f, -scale };   // Zoom and pan
+        };
+
+        double t0 = NowMs();
+        for (int f = 0; f < frames; f++) {
+            MapTransform t = Transform(f);
+            visible = 0;
+            for (int i = 0; i < n; i++) {
+                Record& r = records[i];
+                r.screenX = (int)(t.offsetX + r.x * t.scaleX);
+                r.screenY = (int)(t.offsetY + r.y * t.scaleY);
+                if (r.hidden) { r.screenX = r.screenY = PROJECT_PARKED; continue; }
+                if (r.screenX < view.left || r.screenX > view.right || r.screenY < view.top || r.screenY > view.bottom) continue;
+                if (r.screenX >= hole.left && r.screenX <= hole.right && r.screenY >= hole.top && r.screenY <= hole.bottom) continue;
+                vis[visible++] = i;
+            }
+        }
+        double record = (NowMs() - t0) * 1000.0 / frames;
+        t0 = NowMs();
+        for (int f = 0; f < frames; f++)
+            ProjectAndCullScalar(x.data(), y.data(), hidden.data(), n, Transform(f), view, hole, sx.data(), sy.data(), vis.data());
+        double scalar = (NowMs() - t0) * 1000.0 / frames;
+        t0 = NowMs();
+        for (int f = 0; f < frames; f++)
+            ProjectAndCull(x.data(), y.data(), hidden.data(), n, Transform(f), view, hole, sx.data(), sy.data(), vis.data());
+        double simd = (NowMs() - t0) * 1000.0 / frames;
+        printf("%-8d %12.1f %12.1f %12.1f %9d\n", n, record, scalar, simd, visible);
+    }
+}
+
+// Import result publishing: workers produce ~2 KB records (like the app's samples) and
+// append them under one mutex, or publish lock-free into reserved slots and restore
+// input order afterwards. Lock wait/hold are summed over all workers.
+static void BenchPublish() {
+    struct Record { int input; char data[2044]; };
+    const int n = g_quick ? 20000 : 100000;
+    int threads = g_threads > 0 ? g_threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    std::vector<Record> out(n);
+    auto Produce = [](int i, Record& r) {
+        unsigned int h = (unsigned int)i;
+        for (int k = 0; k < 2000; k++) h = HashU32(h + k);      // Stand-in for analysis
+        r.input = i;
+        memset(r.data, (int)(h & 255), sizeof(r.data));
+        return (h & 15) != 0;                                   // Some files fail to load
+    };
+    printf("publish benchmark, %d records of %d bytes, %d threads\n", n, (int)sizeof(Record), threads);
+
+    std::mutex mutex;
+    std::atomic<long long> waitNs(0), holdNs(0);
+    int count = 0;
+    double t0 = NowMs();
+    ParallelRanges(n, threads, [&](int start, int end) {
+        Record temp;
+        for (int i = start; i < end; i++) {
+            if (!Produce(i, temp)) continue;
+            auto a = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(mutex);
+            auto b = std::chrono::steady_clock::now();
+            out[count++] = temp;
+            auto c = std::chrono::steady_clock::now();
+            waitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+            holdNs += std::chrono::duration_cast<std::chrono::nanoseconds>(c - b).count();
+        }
+    });
+    double mutexMs = NowMs() - t0;
+    bool ordered = true;
+    for (int i = 1; i < count; i++) ordered &= out[i - 1].input < out[i].input;
+    printf("mutex     %10.1f ms   lock wait %8.2f ms   lock hold %8.2f ms   input order %s\n", mutexMs,
+           waitNs / 1e6, holdNs / 1e6, ordered ? "yes" : "no");
+
+    SlotReservation slots(n);
+    t0 = NowMs();
+    ParallelRanges(n, threads, [&](int start, int end) {
+        Record temp;
+        for (int i = start; i < end; i++) {
+            if (!Produce(i, temp)) continue;
+            int slot = slots.Reserve(i);
+            if (slot >= 0) out[slot] = temp;
+        }
+    });
+    double produced = NowMs();
+    PermuteInPlace(out.data(), slots.Order());
+    double slotMs = NowMs() - t0, reorderMs = NowMs() - produced;
+    ordered = slots.Count() == count;
+    for (int i = 1; i < slots.Count(); i++) ordered &= out[i - 1].input < out[i].input;
+    printf("reserved  %10.1f ms   reorder   %8.2f ms   no lock               input order %s\n", slotMs, reorderMs,
+           ordered ? "yes" : "no");
+}
+
+// Metadata range filters: index build, then live slider drags (each step moves one
+// bound), filters combining, and the matching-sample histogram redrawn per step
+static void BenchFilter() {
+    const int n = g_quick ? 100000 : 500000, columns = 4 + FEATURE_DIM, steps = 200;
+    std::vector<float> v((size_t)n * columns);
+    const float rates[] = { 22050, 44100, 48000, 96000 };
+    for (int i = 0; i < n; i++) {
+        v[i] = log10f(0.05f + (float)(HashU32(i) % 100000) / 5000.0f);     // log duration
+        v[(size_t)n + i] = rates[HashU32(i + 1) % 4];
+        v[(size_t)2 * n + i] = (float)(1 + HashU32(i + 2) % 2);
+        v[(size_t)3 * n + i] = log10f(1000.0f + (float)(HashU32(i + 3) % 10000000));
+        for (int c = 4; c < columns; c++) v[(size_t)c * n + i] = (float)(HashU32(i * columns + c) % 10000) / 10000.0f;
+    }
+    printf("filter benchmark, %d samples, %d columns\n", n, columns);
+    MetadataIndex meta;
+    double t0 = NowMs();
+    meta.Build(v.data(), n, columns);
+    printf("build %28.1f ms\n", NowMs() - t0);
+
+    meta.SetRange(1, 48000, 48000);
+    meta.SetRange(4, 0.0f, 0.3f);                                           // Quiet
+    t0 = NowMs();
+    for (int s = 0; s < steps; s++) meta.SetRange(0, -1.5f, -1.5f + 1.5f * s / steps);   // Drag the upper bound to 1 s
+    double drag = (NowMs() - t0) * 1000.0 / steps;
+    int hist[META_HIST_BINS];
+    t0 = NowMs();
+    for (int s = 0; s < steps; s++) meta.Histogram(0, true, hist);
+    double histUs = (NowMs() - t0) * 1000.0 / steps;
+    t0 = NowMs();
+    for (int s = 0; s < steps; s++) { meta.ClearRange(5); meta.SetRange(5, 0.5f, 1.0f); }       // Toggle "noisy"
+    double toggle = (NowMs() - t0) * 1000.0 / steps / 2;
+    printf("drag step (3 filters) %12.1f us\n", drag);
+    printf("toggle filter %20.1f us\n", toggle);
+    printf("histogram (matching) %13.1f us\n", histUs);
+    printf("%d / %d match\n", meta.Matches(), n);
+}
+
+// Map selection: grid build, then rectangle and lasso drags re-queried on every mouse
+// move, against scanning every point
+static void BenchSelect() {
+    const int n = g_quick ? 100000 : 500000, steps = 100;
+    std::vector<float> x(n), y(n);
+    for (int i = 0; i < n; i++) {
+        unsigned int cluster = HashU32(i) % 40;
+        x[i] = (float)(HashU32(cluster) % 1000) + (float)(HashU32(i * 3 + 1) % 10000) / 50.0f;
+        y[i] = (float)(HashU32(cluster + 99) % 1000) + (float)(HashU32(i * 3 + 2) % 10000) / 50.0f;
+    }
+    printf("select benchmark, %d points\n", n);
+    PointGrid grid;
+    double t0 = NowMs();
+    grid.Build(x.data(), y.data(), n);
+    printf("grid build %23.1f ms\n", NowMs() - t0);
+
+    // The rectangle and the lasso grow from a corner of the map over the drag
+    std::vector<int> got;
+    size_t picked = 0;
+    t0 = NowMs();
+    for (int s = 1; s <= steps; s++) {
+        grid.QueryRect(100.0f, 100.0f, 100.0f + 5.0f * s, 100.0f + 4.0f * s, got);
+        picked += got.size();
+    }
+    double rectUs = (NowMs() - t0) * 1000.0 / steps;
+    size_t rectAvg = picked / steps;
+    t0 = NowMs();
+    size_t scanned = 0;
+    for (int s = 1; s <= steps; s += 10) {
+        float x1 = 100.0f + 5.0f * s, y1 = 100.0f + 4.0f * s;
+        got.clear();
+        for (int i = 0; i < n; i++)
+            if (x[i] >= 100.0f && x[i] <= x1 && y[i] >= 100.0f && y[i] <= y1) got.push_back(i);
+        scanned += got.size();
+    }
+    double rectScanUs = (NowMs() - t0) * 1000.0 / ((steps + 9) / 10);
+
+    const int m = 256;
+    std::vector<float> px(m), py(m);
+    auto Outline = [&](float radius) {
+        for (int k = 0; k < m; k++) {
+            float a = 6.2831853f * k / m, r = radius * (0.75f + 0.25f * sinf(a * 5));   // Wobbly, concave
+            px[k] = 500.0f + r * cosf(a);
+            py[k] = 500.0f + r * sinf(a);
+        }
+    };
+    picked = 0;
+    t0 = NowMs();
+    for (int s = 1; s <= steps; s++) {
+        Outline(4.0f * s);
+        grid.QueryLasso(px.data(), py.data(), m, got);
+        picked += got.size();
+    }
+    double lassoUs = (NowMs() - t0) * 1000.0 / steps;
+    size_t lassoAvg = picked / steps;
+    t0 = NowMs();
+    for (int s = 1; s <= steps; s += 10) {
+        Outline(4.0f * s);
+        got.clear();
+        for (int i = 0; i < n; i++)
+            if (PointInPolygon(x[i], y[i], px.data(), py.data(), m)) got.push_back(i);
+        scanned += got.size();
+    }
+    double lassoScanUs = (NowMs() - t0) * 1000.0 / ((steps + 9) / 10);
+    printf("rect drag step %19.1f us   scan %10.1f us   (avg %zu selected)\n", rectUs, rectScanUs, rectAvg);
+    printf("lasso drag step (%d pts) %8.1f us   scan %10.1f us   (avg %zu selected)\n", m, lassoUs, lassoScanUs, lassoAvg);
+}
+
+// Map colouring: a full fit per method, then labelling 1% more samples against it
+static void BenchCluster() {
+    std::vector<int> sizes = g_quick ? std::vector<int>{ 10000 } : std::vector<int>{ 10000, 100000 };
+    printf("cluster benchmark, %u threads\n", std::thread::hardware_concurrency());
+    printf("%-8s %-7s %12s %14s %9s %8s\n", "n", "method", "fit ms", "assign 1% ms", "clusters", "noise");
+    for (int n : sizes) {
+        std::vector<float> feats;
+        MakeSyntheticFeatures(n, feats);
+        int fitN = n - n / 100;
+        std::vector<int> labels(n);
+        for (int m = CLUSTER_KMEANS; m < CLUSTER_COUNT; m++) {
+            ClusterEngine engine;
+            engine.method = m;
+            engine.numThreads = g_threads;
+
+            double t0 = NowMs();
+            engine.Fit(feats.data(), fitN, labels.data());
+            double fitMs = NowMs() - t0;
+
+            t0 = NowMs();
+            engine.Assign(feats.data() + (size_t)fitN * FEATURE_DIM, n - fitN, labels.data() + fitN);
+            double assignMs = NowMs() - t0;
+            int noise = (int)std::count(labels.begin(), labels.end(), CLUSTER_NOISE);
+            printf("%-8d %-7s %12.1f %14.2f %9d %8d\n", n, ClusterName(m), fitMs, assignMs, engine.Count(), noise);
+            fflush(stdout);
+        }
+    }
+}
+
+// Minimal 16-bit PCM WAV image
+static void MakeWavImage(const std::vector<short>& pcm, int rate, int channels, std::vector<unsigned char>& out) {
+    unsigned int dataBytes = (unsigned int)(pcm.size() * 2);
+    unsigned int v[] = { 0x46464952, 36 + dataBytes, 0x45564157, 0x20746d66, 16,
+                         1u | (unsigned)channels << 16, (unsigned)rate, (unsigned)(rate * channels * 2),
+                         (unsigned)(channels * 2) | 16u << 16, 0x61746164, dataBytes };
+    out.resize(sizeof(v) + dataBytes);
+    memcpy(out.data(), v, sizeof(v));      // Little-endian host
+    memcpy(out.data() + sizeof(v), pcm.data(), dataBytes);
+}
+
+// Full decode of every image, then random seeks plus a short read, like previewing from
+// a click position
+static void TimeDecode(const char* codec, const std::vector<std::vector<unsigned char>>& img, double bytes, double audioSec) {
+    std::vector<short> out;
+    double t0 = NowMs();
+    for (size_t i = 0; i < img.size(); i++) {
+        std::unique_ptr<AudioStream> s = OpenAudioStream(img[i].data(), img[i].size());
+        out.clear();
+        if (s) DecodeStream(*s, out);
+    }
+    double ms = NowMs() - t0;
+    int seeks = g_quick ? 200 : 2000;
+    short window[1024 * 2];
+    t0 = NowMs();
+    for (int q = 0; q < seeks; q++) {
+        int i = (int)(HashU32(q) % img.size());
+        std::unique_ptr<AudioStream> s = OpenAudioStream(img[i].data(), img[i].size());
+        if (s && s->Seek((long long)(HashU32(q * 7 + 1) % (unsigned)s->frames))) s->Read(window, 1024);
+    }
+    double seekMs = NowMs() - t0;
+    printf("%-5s decode %10.1f ms %8.0f MB/s %8.0fx realtime   seek %6.1f us\n", codec, ms,
+           bytes / 1048576.0 * 1000.0 / ms, audioSec * 1000.0 / ms, seekMs * 1000.0 / seeks);
+}
+
+// Full decode and random-seek cost per built-in codec on the same stereo material; the
+// core has no mp3 encoder, so mp3 is timed on a file given with --mp3
+static void BenchDecode(const char* mp3Path) {
+    int files = g_quick ? 4 : 16, rate = 44100;
+    float secs = 30.0f;
+    printf("decode benchmark, %d x %.0f s stereo 16-bit\n", files, secs);
+    std::vector<std::vector<unsigned char>> wav(files), flac(files);
+    double audioSec = 0, wavBytes = 0, flacBytes = 0;
+    std::vector<short> l, r, pcm, hit;
+    for (int i = 0; i < files; i++) {
+        // A run of short hits, so the material does not decay into silence
+        l.clear(); r.clear();
+        for (int k = 0; k < (int)secs; k++) {
+            MakeSyntheticPcm(i * 64 + k * 2, rate, 1.0f, hit);
+            l.insert(l.end(), hit.begin(), hit.end());
+            MakeSyntheticPcm(i * 64 + k * 2 + 1, rate, 1.0f, hit);
+            r.insert(r.end(), hit.begin(), hit.end());
+        }
+        pcm.resize(l.size() * 2);
+        std::vector<int> ints(pcm.size());
+        for (size_t j = 0; j < l.size(); j++) {
+            pcm[j * 2] = l[j]; pcm[j * 2 + 1] = (short)((l[j] + r[j]) / 2);
+            ints[j * 2] = pcm[j * 2]; ints[j * 2 + 1] = pcm[j * 2 + 1];
+        }
+        MakeWavImage(pcm, rate, 2, wav[i]);
+        EncodeFlac(ints.data(), (long long)l.size(), 2, 16, rate, FlacEncodeOptions(), flac[i]);
+        audioSec += secs;
+        wavBytes += wav[i].size();
+        flacBytes += flac[i].size();
+    }
+    printf("flac ratio %.2f\n", flacBytes / wavBytes);
+    TimeDecode("wav", wav, wavBytes, audioSec);
+    TimeDecode("flac", flac, flacBytes, audioSec);
+    if (!mp3Path) return;
+
+    MappedFile file;
+    std::unique_ptr<AudioStream> s;
+    if (file.Open(mp3Path)) s = OpenAudioStream(file.Data(), file.Size());
+    if (!s || strcmp(s->codec, "mp3") || s->frames == 0) {
+        fprintf(stderr, "%s: not an mp3 file the built-in decoder reads\n", mp3Path);
+        return;
+    }
+    double fileSec = (double)s->frames / s->sampleRate;
+    printf("mp3 %s: %.1f s, %d Hz, %d ch, %.0f kbps\n", mp3Path, fileSec, s->sampleRate, s->channels,
+           file.Size() * 8.0 / 1000.0 / fileSec);
+    std::vector<std::vector<unsigned char>> mp3(files, std::vector<unsigned char>(file.Data(), file.Data() + file.Size()));
+    TimeDecode("mp3", mp3, (double)file.Size() * files, fileSec * files);
+}
+
+// Import (decode + analysis) of one file read into a heap buffer, like a copying decoder
+static bool ImportBuffered(const std::string& path, SampleAnalysis* out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::vector<unsigned char> bytes;
+    unsigned char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0) bytes.insert(bytes.end(), chunk, chunk + got);
+    fclose(f);
+    PcmFormat fmt;
+    if (!ParsePcmFile(bytes.data(), bytes.size(), &fmt)) return false;
+    std::vector<short> scratch;
+    const short* pcm = PcmAsInt16(fmt, scratch);
+    std::vector<short> copy(pcm, pcm + (size_t)fmt.frames * fmt.channels);
+    return AnalyzePcm(copy.data(), (int)copy.size(), fmt.sampleRate, fmt.channels, out);
+}
+
+// Import straight from the mapping (zero copy for 16-bit little-endian data)
+static bool ImportMapped(const std::string& path, SampleAnalysis* out, bool* zeroCopy) {
+    *zeroCopy = false;
+    MappedFile file;
+    PcmFormat fmt;
+    if (!file.Open(path.c_str()) || !ParsePcmFile(file.Data(), file.Size(), &fmt)) return false;
+    std::vector<short> scratch;
+    const short* pcm = PcmAsInt16(fmt, scratch);
+    *zeroCopy = (const unsigned char*)pcm == fmt.data;
+    return AnalyzePcm(pcm, (int)(fmt.frames * fmt.channels), fmt.sampleRate, fmt.channels, out);
+}
+
+// Import + grouping over a real folder of WAV/AIFF files
+static void BenchWavDir(const char* dir) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(dir, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        std::string ext = it->path().extension().string();
+        for (auto& c : ext) c = (char)tolower((unsigned char)c);
+        if (ext == ".wav" || ext == ".aif" || ext == ".aiff" || ext == ".aifc") paths.push_back(it->path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    int n = (int)paths.size();
+    printf("%s: %d wav/aiff files\n", dir, n);
+    if (n == 0) return;
+
+    // Warm the page cache so both paths read from memory
+    std::vector<SampleAnalysis> out(n);
+    std::vector<char> ok(n), zeroCopy(n);
+    ParallelRanges(n, g_threads, [&](int start, int end) {
+        for (int i = start; i < end; i++) { bool z; ok[i] = ImportMapped(paths[i], &out[i], &z); zeroCopy[i] = z; }
+    });
+    int decoded = 0, direct = 0;
+    double audioSec = 0;
+    for (int i = 0; i < n; i++) if (ok[i]) { decoded++; direct += zeroCopy[i]; audioSec += out[i].duration; }
+    printf("%d decoded natively (%d zero-copy), %.1f s audio\n", decoded, direct, audioSec);
+    if (decoded == 0) return;
+
+    double ms[2];
+    for (int mode = 0; mode < 2; mode++) {
+        double t0 = NowMs();
+        ParallelRanges(n, g_threads, [&](int start, int end) {
+            for (int i = start; i < end; i++) {
+                bool z;
+                if (mode == 0) ImportBuffered(paths[i], &out[i]);
+                else ImportMapped(paths[i], &out[i], &z);
+            }
+        });
+        ms[mode] = NowMs() - t0;
+        printf("%-9s import %10.1f ms %10.0f files/s %8.0fx realtime\n", mode ? "mapped" : "buffered",
+               ms[mode], decoded * 1000.0 / ms[mode], audioSec * 1000.0 / ms[mode]);
+    }
+    printf("mapped speedup %.2fx\n", ms[0] / ms[1]);
+
+    std::vector<unsigned int> fps((size_t)n * FP_FRAMES);
+    std::vector<int> lens(n), group(n);
+    for (int i = 0; i < n; i++) {
+        memcpy(&fps[(size_t)i * FP_FRAMES], out[i].fingerprint, sizeof(out[i].fingerprint));
+        lens[i] = ok[i] ? out[i].fingerprintLen : 0;
+    }
+    double t0 = NowMs();
+    int groups = GroupDuplicates(fps.data(), lens.data(), FP_FRAMES, n, 0.2f, group.data(), g_threads);
+    printf("duplicates: %d groups in %.1f ms\n", groups, NowMs() - t0);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> which;
+    const char* wavDir = NULL, *mp3Path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick")) g_quick = true;
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) g_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--wav-dir") && i + 1 < argc) wavDir = argv[++i];
+        else if (!strcmp(argv[i], "--mp3") && i + 1 < argc) mp3Path = argv[++i];
+        else if (argv[i][0] != '-') which.push_back(argv[i]);
+        else {
+            fprintf(stderr, "usage: audiomap_bench [layout|similar|analysis|loudness|rhythm|dups|relax|decode|render|project|publish|filter|select|cluster|all] [--quick] [--threads N] [--wav-dir DIR] [--mp3 FILE]\n");
+            return 2;
+        }
+    }
+    if (which.empty() && !wavDir) which.push_back("all");
+    auto Want = [&](const char* name) {
+        for (auto& w : which) if (w == name || w == "all") return true;
+        return false;
+    };
+
+    if (Want("analysis")) BenchAnalysis();
+    if (Want("loudness")) BenchLoudness();
+    if (Want("rhythm")) BenchRhythm();
+    if (Want("dups")) BenchDups();
+    if (Want("relax")) BenchRelax();
+    if (Want("similar")) BenchSimilar();
+    if (Want("layout")) BenchLayout();
+    if (Want("decode")) BenchDecode(mp3Path);
+    if (Want("render")) BenchRender();
+    if (Want("project")) BenchProject();
+    if (Want("publish")) BenchPublish();
+    if (Want("filter")) BenchFilter();
+    if (Want("select")) BenchSelect();
+    if (Want("cluster")) BenchCluster();
+    if (wavDir) BenchWavDir(wavDir);
+    return 0;
+}
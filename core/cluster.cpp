@@ -0,0 +1,311 @@
+#include "cluster.h"
+#include "parallel.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+const char* ClusterName(int method) {
+    switch (method) {
+        case CLUSTER_KMEANS: return "k-means";
+        case CLUSTER_DBSCAN: return "dbscan";
+    }
+    return "?";
+}
+
+static float Dist2(const float* a, const float* b) {
+    float s = 0;
+    for (int d = 0; d < FEATURE_DIM; d++) { float t = a[d] - b[d]; s += t * t; }
+    return s;
+}
+
+void ClusterEngine::Standardize(const float* feats, int n, std::vector<float>& z) const {
+    z.resize((size_t)n * FEATURE_DIM);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++)
+            for (int d = 0; d < FEATURE_DIM; d++)
+                z[(size_t)i * FEATURE_DIM + d] = (feats[(size_t)i * FEATURE_DIM + d] - mean[d]) * invStd[d];
+    });
+}
+
+int ClusterEngine::Nearest(const float* z) const {
+    int best = 0;
+    float bestD = FLT_MAX;
+    for (int c = 0; c < count; c++) {
+        float d = Dist2(z, &centroids[(size_t)c * FEATURE_DIM]);
+        if (d < bestD) { bestD = d; best = c; }
+    }
+    return best;
+}
+
+void ClusterEngine::Fit(const float* feats, int n, int* labels) {
+    count = 0; fitted = 0;
+    sizes.clear(); centroids.clear(); weights.clear();
+    corePoints.clear(); coreLabels.clear();
+    coreTree.Build(NULL, 0, FEATURE_DIM);
+    if (n <= 0) return;
+
+    for (int d = 0; d < FEATURE_DIM; d++) {
+        double sum = 0, sumSq = 0;
+        for (int i = 0; i < n; i++) { double v = feats[(size_t)i * FEATURE_DIM + d]; sum += v; sumSq += v * v; }
+        double m = sum / n, var = sumSq / n - m * m;
+        mean[d] = (float)m;
+        invStd[d] = (var > 1e-12) ? (float)(1.0 / sqrt(var)) : 0.0f;
+    }
+    std::vector<float> z;
+    Standardize(feats, n, z);
+    if (method == CLUSTER_DBSCAN) FitDbscan(z, n, labels);
+    else FitKMeans(z, n, labels);
+    fitted = n;
+}
+
+void ClusterEngine::FitKMeans(const std::vector<float>& z, int n, int* labels) {
+    int k = clusters > 0 ? clusters : (int)sqrtf(n / 10.0f);
+    if (k < 2) k = 2;
+    if (k > 20 && clusters <= 0) k = 20;
+    if (k > MAX_CLUSTERS) k = MAX_CLUSTERS;
+    if (k > n) k = n;
+    count = k;
+
+    // k-means++ seeding on an evenly strided sample, with hashed draws
+    int m = n < 4096 ? n : 4096;
+    std::vector<const float*> sample(m);
+    for (int i = 0; i < m; i++) sample[i] = &z[(size_t)((long long)i * n / m) * FEATURE_DIM];
+    centroids.assign((size_t)k * FEATURE_DIM, 0.0f);
+    memcpy(&centroids[0], sample[HashU32(0x5eed) % m], sizeof(float) * FEATURE_DIM);
+    std::vector<float> nearest(m, FLT_MAX);
+    for (int c = 1; c < k; c++) {
+        double total = 0;
+        for (int i = 0; i < m; i++) {
+            nearest[i] = std::min(nearest[i], Dist2(sample[i], &centroids[(size_t)(c - 1) * FEATURE_DIM]));
+            total += nearest[i];
+        }
+        double target = total * (HashU32(0x5eed + c) / 4294967296.0);
+        int pick = m - 1;
+        for (int i = 0; i < m; i++) {
+            target -= nearest[i];
+            if (target < 0) { pick = i; break; }
+        }
+        memcpy(&centroids[(size_t)c * FEATURE_DIM], sample[pick], sizeof(float) * FEATURE_DIM);
+    }
+
+    // Mini-batches: assignment in parallel, per-centre learning rate 1 / points absorbed
+    // applied in batch order, so the result is the same on any thread count
+    weights.assign(k, 0.0);
+    int batch = batchSize < n ? batchSize : n;
+    std::vector<int> members(batch), assigned(batch);
+    for (int b = 0; b < batches; b++) {
+        for (int j = 0; j < batch; j++) members[j] = (int)(HashU32(b * 0x9e3779b1u + j) % (unsigned)n);
+        ParallelRanges(batch, numThreads, [&](int start, int end) {
+            for (int j = start; j < end; j++) assigned[j] = Nearest(&z[(size_t)members[j] * FEATURE_DIM]);
+        });
+        for (int j = 0; j < batch; j++) {
+            int c = assigned[j];
+            float eta = (float)(1.0 / (weights[c] += 1.0));
+            float* cen = &centroids[(size_t)c * FEATURE_DIM];
+            const float* p = &z[(size_t)members[j] * FEATURE_DIM];
+            for (int d = 0; d < FEATURE_DIM; d++) cen[d] += eta * (p[d] - cen[d]);
+        }
+    }
+
+    // Full Lloyd passes. Sums are kept per fixed chunk of points and added in chunk
+    // order, so the rounding does not depend on how threads split the points.
+    const int chunk = 4096;
+    int chunks = (n + chunk - 1) / chunk;
+    std::vector<double> sums((size_t)chunks * k * FEATURE_DIM);
+    std::vector<int> counts((size_t)chunks * k);
+    for (int pass = 0; pass <= refinePasses; pass++) {
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) labels[i] = Nearest(&z[(size_t)i * FEATURE_DIM]);
+        });
+        if (pass == refinePasses) break;
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        ParallelRanges(chunks, numThreads, [&](int start, int end) {
+            for (int ch = start; ch < end; ch++) {
+                double* s = &sums[(size_t)ch * k * FEATURE_DIM];
+                int* cnt = &counts[(size_t)ch * k];
+                for (int i = ch * chunk; i < n && i < (ch + 1) * chunk; i++) {
+                    cnt[labels[i]]++;
+                    for (int d = 0; d < FEATURE_DIM; d++) s[(size_t)labels[i] * FEATURE_DIM + d] += z[(size_t)i * FEATURE_DIM + d];
+                }
+            }
+        });
+        for (int c = 0; c < k; c++) {
+            double s[FEATURE_DIM] = { 0 };
+            int total = 0;
+            for (int ch = 0; ch < chunks; ch++) {
+                total += counts[(size_t)ch * k + c];
+                for (int d = 0; d < FEATURE_DIM; d++) s[d] += sums[((size_t)ch * k + c) * FEATURE_DIM + d];
+            }
+            if (total == 0) continue;           // An empty centre keeps its place
+            for (int d = 0; d < FEATURE_DIM; d++) centroids[(size_t)c * FEATURE_DIM + d] = (float)(s[d] / total);
+        }
+    }
+
+    RankBySize(labels, n, k);
+    weights.assign(count, 0.0);
+    for (int c = 0; c < count; c++) weights[c] = sizes[c];
+}
+
+void ClusterEngine::FitDbscan(const std::vector<float>& z, int n, int* labels) {
+    int m = (fitSample > 0 && n > fitSample) ? fitSample : n;
+    if (m == n) { FitDbscanOn(z.data(), n, labels); return; }
+
+    // Fit a strided sample (the kNN graph is the cost), then label the other points by
+    // their nearest core point as Assign does and renumber by the full sizes
+    std::vector<float> zs((size_t)m * FEATURE_DIM);
+    std::vector<int> pick(m), own(m);
+    for (int j = 0; j < m; j++) {
+        pick[j] = (int)((long long)j * n / m);
+        memcpy(&zs[(size_t)j * FEATURE_DIM], &z[(size_t)pick[j] * FEATURE_DIM], sizeof(float) * FEATURE_DIM);
+    }
+    FitDbscanOn(zs.data(), m, own.data());
+    LabelByCore(z.data(), n, labels);
+    for (int j = 0; j < m; j++) labels[pick[j]] = own[j];
+    std::vector<int> rank = RankBySize(labels, n, count);
+    for (int& c : coreLabels) c = rank[c];
+}
+
+void ClusterEngine::FitDbscanOn(const float* z, int n, int* labels) {
+    int minPts = minPoints < 2 ? 2 : minPoints;
+    int kg = graphNeighbors > minPts - 1 ? graphNeighbors : minPts - 1;
+    if (kg > n - 1) kg = n - 1;
+    if (kg < minPts - 1) {                  // Too few points for any dense region
+        for (int i = 0; i < n; i++) labels[i] = CLUSTER_NOISE;
+        sizes.clear();
+        count = 0;
+        return;
+    }
+    std::vector<int> nbr;
+    std::vector<float> nbrDist;
+    BuildKnnGraph(z, n, FEATURE_DIM, kg, numThreads, nbr, nbrDist);
+
+    // Core distance: to the (minPoints - 1)th neighbour
+    std::vector<float> coreDist(n);
+    for (int i = 0; i < n; i++) coreDist[i] = nbrDist[(size_t)i * kg + minPts - 2];
+    if (eps > 0) {
+        eps2 = eps * eps;
+    } else {
+        std::vector<float> sorted = coreDist;
+        std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+        // Half the points are core at the median; 1.5x reaches the sparser edges of clusters
+        eps2 = sorted[n / 2] * 1.5f * 1.5f;
+    }
+    radius = sqrtf(eps2);
+
+    // Union core points along graph edges within eps
+    std::vector<int> parent(n);
+    for (int i = 0; i < n; i++) parent[i] = i;
+    auto Find = [&](int a) {
+        while (parent[a] != a) { parent[a] = parent[parent[a]]; a = parent[a]; }
+        return a;
+    };
+    for (int i = 0; i < n; i++) {
+        if (coreDist[i] > eps2) continue;
+        for (int e = 0; e < kg; e++) {
+            int j = nbr[(size_t)i * kg + e];
+            if (nbrDist[(size_t)i * kg + e] > eps2) break;
+            if (j < 0 || coreDist[j] > eps2) continue;
+            int a = Find(i), b = Find(j);
+            if (a != b) { if (a < b) parent[b] = a; else parent[a] = b; }
+        }
+    }
+
+    // Core points label by root; others take their nearest core neighbour within eps
+    std::vector<int> rootLabel(n, -1);
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        labels[i] = CLUSTER_NOISE;
+        if (coreDist[i] > eps2) continue;
+        int r = Find(i);
+        if (rootLabel[r] < 0) rootLabel[r] = found++;
+        labels[i] = rootLabel[r];
+    }
+    for (int i = 0; i < n; i++) {
+        if (coreDist[i] <= eps2) continue;
+        for (int e = 0; e < kg; e++) {
+            int j = nbr[(size_t)i * kg + e];
+            if (j < 0 || nbrDist[(size_t)i * kg + e] > eps2) break;
+            if (coreDist[j] <= eps2) { labels[i] = rootLabel[Find(j)]; break; }
+        }
+    }
+    RankBySize(labels, n, found);
+
+    // Keep the labelled core points to place new ones
+    for (int i = 0; i < n; i++) {
+        if (coreDist[i] > eps2 || labels[i] == CLUSTER_NOISE) continue;
+        corePoints.insert(corePoints.end(), &z[(size_t)i * FEATURE_DIM], &z[(size_t)(i + 1) * FEATURE_DIM]);
+        coreLabels.push_back(labels[i]);
+    }
+    coreTree.Build(corePoints.data(), (int)coreLabels.size(), FEATURE_DIM);
+}
+
+std::vector<int> ClusterEngine::RankBySize(int* labels, int n, int found) {
+    std::vector<int> size(found, 0), first(found, n);
+    for (int i = 0; i < n; i++) {
+        if (labels[i] < 0) continue;
+        size[labels[i]]++;
+        first[labels[i]] = std::min(first[labels[i]], i);
+    }
+    std::vector<int> order(found);
+    for (int c = 0; c < found; c++) order[c] = c;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return size[a] != size[b] ? size[a] > size[b] : first[a] < first[b];
+    });
+    count = 0;
+    std::vector<int> rank(found, CLUSTER_NOISE);
+    for (int r = 0; r < found && r < MAX_CLUSTERS; r++) {
+        if (size[order[r]] == 0) break;
+        rank[order[r]] = count++;
+    }
+    for (int i = 0; i < n; i++) if (labels[i] >= 0) labels[i] = rank[labels[i]];
+
+    sizes.assign(count, 0);
+    for (int i = 0; i < n; i++) if (labels[i] >= 0) sizes[labels[i]]++;
+    if (!centroids.empty()) {
+        std::vector<float> ranked((size_t)count * FEATURE_DIM);
+        for (int c = 0; c < found; c++)
+            if (rank[c] >= 0) memcpy(&ranked[(size_t)rank[c] * FEATURE_DIM], &centroids[(size_t)c * FEATURE_DIM], sizeof(float) * FEATURE_DIM);
+        centroids.swap(ranked);
+    }
+    return rank;
+}
+
+void ClusterEngine::LabelByCore(const float* z, int n, int* labels) const {
+    float limit = nextafterf(eps2, FLT_MAX);       // Within eps, inclusive
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            int idx;
+            float d;
+            bool near = coreLabels.size() > 0 && coreTree.Query(z + (size_t)i * FEATURE_DIM, 1, -1, &idx, &d, limit) == 1;
+            labels[i] = near ? coreLabels[idx] : CLUSTER_NOISE;
+        }
+    });
+}
+
+void ClusterEngine::Assign(const float* feats, int n, int* labels) {
+    if (n <= 0) return;
+    if (fitted == 0 || (count == 0 && method != CLUSTER_DBSCAN)) {
+        for (int i = 0; i < n; i++) labels[i] = CLUSTER_NOISE;
+        return;
+    }
+    std::vector<float> z;
+    Standardize(feats, n, z);
+    if (method == CLUSTER_DBSCAN) {
+        LabelByCore(z.data(), n, labels);
+    } else {
+        // In order, each point nudging its centre like one more mini-batch member
+        for (int i = 0; i < n; i++) {
+            const float* p = &z[(size_t)i * FEATURE_DIM];
+            int c = Nearest(p);
+            float eta = (float)(1.0 / (weights[c] += 1.0));
+            float* cen = &centroids[(size_t)c * FEATURE_DIM];
+            for (int d = 0; d < FEATURE_DIM; d++) cen[d] += eta * (p[d] - cen[d]);
+            labels[i] = c;
+        }
+    }
+    for (int i = 0; i < n; i++) if (labels[i] >= 0) sizes[labels[i]]++;
+    fitted += n;
+}
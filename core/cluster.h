@@ -0,0 +1,69 @@
+// Clustering of feature vectors (map colours, list grouping)
+#pragma once
+
+#include "features.h"
+#include "kdtree.h"
+
+#include <vector>
+
+enum ClusterMethod { CLUSTER_KMEANS, CLUSTER_DBSCAN, CLUSTER_COUNT };
+
+const char* ClusterName(int method);
+
+#define CLUSTER_NOISE (-1)   // DBSCAN points in no dense region
+#define MAX_CLUSTERS 64      // Smaller clusters past this many count as noise
+
+// Groups standardized feature vectors into clusters numbered by descending size.
+// Mini-batch k-means (Sculley 2010) trains on hashed batches from a k-means++ seeding,
+// then refines with full Lloyd passes. DBSCAN runs on the exact kNN graph: a point
+// with minPoints - 1 neighbours within eps is core, core points joined by a graph edge
+// within eps share a cluster, and the rest join their nearest core neighbour within
+// eps or stay noise (links past the graph's neighbours are not followed). Past
+// fitSample points it fits a strided sample and labels the rest like Assign. Work is
+// split over points; results do not depend on the thread count.
+class ClusterEngine {
+public:
+    int method = CLUSTER_KMEANS;
+    int numThreads = 0;          // 0 = hardware concurrency
+    int clusters = 0;            // k-means k, 0 = pick from n
+    int batchSize = 2048;
+    int batches = 50;
+    int refinePasses = 3;
+    int minPoints = 10;          // DBSCAN, counting the point itself
+    int graphNeighbors = 16;     // DBSCAN kNN graph degree (>= minPoints - 1)
+    float eps = 0;               // DBSCAN radius (standardized units), 0 = 1.5x median core distance
+    int fitSample = 20000;       // DBSCAN fits at most this many points (strided), 0 = all
+
+    // Fit a fresh model for n points; labels receive a cluster or CLUSTER_NOISE
+    void Fit(const float* feats, int n, int* labels);
+
+    // Label n new points against the fitted model without relabelling the fitted ones:
+    // nearest centroid (which moves towards them), or the nearest core point within eps
+    void Assign(const float* feats, int n, int* labels);
+
+    int Count() const { return count; }
+    int Size(int c) const { return sizes[c]; }
+    int FittedCount() const { return fitted; }
+    float Radius() const { return radius; }   // DBSCAN eps used by the last fit
+
+private:
+    float mean[FEATURE_DIM], invStd[FEATURE_DIM];
+    int count = 0, fitted = 0;
+    std::vector<int> sizes;
+    std::vector<float> centroids;            // count * FEATURE_DIM (k-means)
+    std::vector<double> weights;             // Points each centroid has absorbed
+    std::vector<float> corePoints;           // Standardized core points (DBSCAN)
+    std::vector<int> coreLabels;
+    KdTree coreTree;
+    float eps2 = 0, radius = 0;
+
+    void Standardize(const float* feats, int n, std::vector<float>& z) const;
+    int Nearest(const float* z) const;
+    void FitKMeans(const std::vector<float>& z, int n, int* labels);
+    void FitDbscan(const std::vector<float>& z, int n, int* labels);
+    void FitDbscanOn(const float* z, int n, int* labels);
+    void LabelByCore(const float* z, int n, int* labels) const;
+    // Renumber clusters by descending size (ties by first member), dropping those past
+    // MAX_CLUSTERS; returns each old cluster's new number
+    std::vector<int> RankBySize(int* labels, int n, int found);
+};
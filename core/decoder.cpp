@@ -0,0 +1,131 @@
+#include "decoder.h"
+#include "features.h"
+#include "flac.h"
+#include "mp3.h"
+#include "pcmfile.h"
+#include "trace.h"
+
+// WAV/AIFF: the samples are already laid out in the image, so reads convert in place
+class PcmStream : public AudioStream {
+public:
+    explicit PcmStream(const PcmFormat& f) : fmt(f) {
+        sampleRate = f.sampleRate; channels = f.channels;
+        bitsPerSample = f.bitsPerSample; frames = f.frames;
+        isFloat = f.isFloat;
+        codec = f.container;
+    }
+
+    int Read(short* out, int maxFrames) override {
+        int n = Take(maxFrames);
+        if (n > 0) PcmToInt16(fmt, next, n, out);
+        next += n;
+        return n;
+    }
+
+    int ReadFloat(float* out, int maxFrames) override {
+        int n = Take(maxFrames);
+        if (n > 0) PcmToFloat(fmt, next, n, out);
+        next += n;
+        return n;
+    }
+
+    bool Seek(long long frame) override {
+        next = frame < 0 ? 0 : (frame > frames ? frames : frame);
+        return true;
+    }
+
+private:
+    PcmFormat fmt;
+    long long next = 0;
+
+    int Take(int maxFrames) const {
+        long long left = frames - next;
+        return left < maxFrames ? (left > 0 ? (int)left : 0) : maxFrames;
+    }
+};
+
+std::unique_ptr<AudioStream> OpenAudioStream(const unsigned char* data, size_t size) {
+    PcmFormat fmt;
+    if (ParsePcmFile(data, size, &fmt)) return std::unique_ptr<AudioStream>(new PcmStream(fmt));
+    std::unique_ptr<AudioStream> flac = OpenFlacStream(data, size);
+    if (flac) return flac;
+    return OpenMp3Stream(data, size);
+}
+
+static int ReadInto(AudioStream& stream, short* out, int n) { return stream.Read(out, n); }
+static int ReadInto(AudioStream& stream, float* out, int n) { return stream.ReadFloat(out, n); }
+
+template <typename T>
+static bool DecodeInto(AudioStream& stream, std::vector<T>& out, long long maxFrames) {
+    if (stream.channels < 1) return false;
+    const int chunk = 8192;
+    size_t start = out.size();
+    if (stream.frames > 0) {
+        long long want = (maxFrames >= 0 && maxFrames < stream.frames) ? maxFrames : stream.frames;
+        out.reserve(start + (size_t)want * stream.channels);
+    }
+    long long done = 0;
+    while (maxFrames < 0 || done < maxFrames) {
+        int n = chunk;
+        if (maxFrames >= 0 && maxFrames - done < n) n = (int)(maxFrames - done);
+        size_t at = out.size();
+        out.resize(at + (size_t)n * stream.channels);
+        int got = ReadInto(stream, &out[at], n);
+        out.resize(at + (size_t)got * stream.channels);
+        done += got;
+        if (got < n) break;
+    }
+    return out.size() > start;
+}
+
+bool DecodeStream(AudioStream& stream, std::vector<short>& out, long long maxFrames) {
+    return DecodeInto(stream, out, maxFrames);
+}
+
+bool DecodeStream(AudioStream& stream, std::vector<float>& out, long long maxFrames) {
+    return DecodeInto(stream, out, maxFrames);
+}
+
+bool AnalyzeAudioImage(const unsigned char* data, size_t size, SampleAnalysis* out) {
+    int bits;
+    bool isFloat, ok;
+    PcmFormat fmt;
+    if (ParsePcmFile(data, size, &fmt)) {
+        // Uncompressed: analysed in place from the image where the layout allows
+        bits = fmt.bitsPerSample; isFloat = fmt.isFloat;
+        int count = (int)(fmt.frames * fmt.channels);
+        if (bits <= 16 && !isFloat) {
+            std::vector<short> scratch;
+            const short* pcm;
+            { TraceScope t("decode"); pcm = PcmAsInt16(fmt, scratch); }
+            TraceScope t("analyse");
+            ok = AnalyzePcm(pcm, count, fmt.sampleRate, fmt.channels, out);
+        } else {
+            std::vector<float> scratch;
+            const float* pcm;
+            { TraceScope t("decode"); pcm = PcmAsFloat(fmt, scratch); }
+            TraceScope t("analyse");
+            ok = AnalyzePcm(pcm, count, fmt.sampleRate, fmt.channels, out);
+        }
+    } else {
+        // Compressed: decoded in full; lossy codecs (no source depth) as float
+        std::unique_ptr<AudioStream> stream = OpenAudioStream(data, size);
+        if (!stream) return false;
+        bits = stream->bitsPerSample; isFloat = stream->isFloat;
+        if (bits > 0 && bits <= 16 && !isFloat) {
+            std::vector<short> pcm;
+            { TraceScope t("decode"); ok = DecodeStream(*stream, pcm); }
+            TraceScope t("analyse");
+            ok = ok && AnalyzePcm(pcm.data(), (int)pcm.size(), stream->sampleRate, stream->channels, out);
+        } else {
+            std::vector<float> pcm;
+            { TraceScope t("decode"); ok = DecodeStream(*stream, pcm); }
+            TraceScope t("analyse");
+            ok = ok && AnalyzePcm(pcm.data(), (int)pcm.size(), stream->sampleRate, stream->channels, out);
+        }
+    }
+    if (!ok) return false;
+    out->bitsPerSample = bits;
+    out->isFloat = isFloat;
+    return true;
+}
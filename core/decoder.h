@@ -0,0 +1,42 @@
+// Built-in decoders behind a common streaming interface
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Pull-based PCM source over an in-memory (usually mapped) file image, which must
+// outlive the stream
+class AudioStream {
+public:
+    virtual ~AudioStream() {}
+
+    int sampleRate = 0, channels = 0;
+    int bitsPerSample = 0;              // Source resolution, 0 for lossy codecs
+    long long frames = 0;               // Total frames, 0 if the header does not say
+    bool isFloat = false;               // Source stores floating point samples
+    const char* codec = "";             // "wav", "aiff", "flac", "mp3"
+
+    // Reads up to maxFrames interleaved 16-bit frames; returns frames read (0 at end or on error)
+    virtual int Read(short* out, int maxFrames) = 0;
+
+    // Same as float in [-1, 1] at the source's full resolution
+    virtual int ReadFloat(float* out, int maxFrames) = 0;
+
+    // Positions the next Read at frame (clamped to the end); false if the stream is damaged
+    virtual bool Seek(long long frame) = 0;
+};
+
+// Stream for a PCM WAV/AIFF, FLAC or mp3 image; NULL when no built-in decoder handles it
+std::unique_ptr<AudioStream> OpenAudioStream(const unsigned char* data, size_t size);
+
+// Appends up to maxFrames frames (all when < 0) from the current position to out
+bool DecodeStream(AudioStream& stream, std::vector<short>& out, long long maxFrames = -1);
+bool DecodeStream(AudioStream& stream, std::vector<float>& out, long long maxFrames = -1);
+
+struct SampleAnalysis;
+
+// Analyses a WAV/AIFF/FLAC/mp3 image with the built-in decoders: 16-bit and lower sources
+// as 16-bit samples (zero copy from a mapping when possible), deeper, float or lossy ones
+// as float. Reports the source's bit depth and format; false when no built-in decoder
+// handles the image.
+bool AnalyzeAudioImage(const unsigned char* data, size_t size, SampleAnalysis* out);
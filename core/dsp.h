@@ -0,0 +1,5 @@
+// Small DSP building blocks shared by the analysis stages
+#pragma once
+
+// In-place iterative radix-2 complex FFT (n must be a power of two)
+void FftRadix2(float* re, float* im, int n);
@@ -0,0 +1,151 @@
+#include "features.h"
+#include "fingerprint.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+const char* FeatureName(int f) {
+    static const char* names[] = { "rms", "zcr", "crest", "duration", "attack", "decay", "lowband", "brightness", "width", "onsets", "loop" };
+    return (f >= 0 && f < FEATURE_DIM) ? names[f] : "?";
+}
+
+// Per sample type: full-scale value, the type channel sums are accumulated in
+// (integer for 16-bit, so the downmix stays exact) and the type for sums of squares
+template <typename T> struct SampleTraits;
+template <> struct SampleTraits<short> {
+    typedef int Sum; typedef long long SumSq;
+    static constexpr float full = 32768.0f;
+    static long long Square(short v) { return (int)v * v; }
+};
+template <> struct SampleTraits<float> {
+    typedef float Sum; typedef double SumSq;
+    static constexpr float full = 1.0f;
+    static double Square(float v) { return v * v; }
+};
+
+// Energy and zero crossings of one channel of an interleaved buffer. Both sums are
+// plain reductions without branches, so the loop vectorises.
+template <typename T>
+static void ChannelStats(const T* x, int frames, int stride, double* sumSq, int* crossings) {
+    typedef SampleTraits<T> Traits;
+    typename Traits::SumSq sq = 0;
+    int cross = 0;
+    for (int f = 0; f < frames; f++) sq += Traits::Square(x[(size_t)f * stride]);
+    for (int f = 1; f < frames; f++) {
+        T a = x[(size_t)(f - 1) * stride], b = x[(size_t)f * stride];
+        cross += ((b < 0) & (a > 0)) | ((b > 0) & (a < 0));
+    }
+    *sumSq += (double)sq / ((double)Traits::full * Traits::full);
+    *crossings += cross;
+}
+
+template <typename T>
+static bool AnalyzeSamples(const T* rawData, int numSamples, int rate, int ch, SampleAnalysis* s) {
+    typedef SampleTraits<T> Traits;
+    if (!rawData || numSamples <= 0 || rate <= 0) return false;
+    if (ch < 1) ch = 1;
+    memset(s, 0, sizeof(*s));
+    int frames = numSamples / ch;
+    if (frames <= 0) return false;
+
+    // Level and zero crossings per channel, so interleaved neighbours (left and right
+    // of one frame) never count as a crossing
+    double totalSq = 0;
+    int crossings = 0;
+    for (int c = 0; c < ch; c++) ChannelStats(rawData + c, frames, ch, &totalSq, &crossings);
+
+    // Timbre/envelope features on the mono downmix
+    double monoSq = 0, lowSq = 0, diffSq = 0, lateSq = 0;
+    float peak = 0.0f, low = 0.0f, prev = 0.0f;
+    int peakFrame = 0;
+    long long monoCap = (long long)rate * 30;
+    std::vector<float> mono(frames < monoCap ? (size_t)frames : (size_t)monoCap);
+    float lowCoef = 1.0f - expf(-6.2831853f * 200.0f / (float)rate);
+    float envMin[THUMB_MAX_BINS], envMax[THUMB_MAX_BINS];
+    for (int b = 0; b < THUMB_MAX_BINS; b++) { envMin[b] = 1e30f; envMax[b] = -1e30f; }
+    for (int f = 0; f < frames; f++) {
+        typename Traits::Sum sum = 0;
+        for (int c = 0; c < ch; c++) sum += rawData[f * ch + c];
+        float m = sum / (Traits::full * ch);
+        if (f < (int)mono.size()) mono[f] = m;
+        int bin = (int)((long long)f * THUMB_MAX_BINS / frames);
+        if (m < envMin[bin]) envMin[bin] = m;
+        if (m > envMax[bin]) envMax[bin] = m;
+        low += lowCoef * (m - low);
+        float d = m - prev; prev = m;
+        monoSq += m * m; lowSq += low * low; diffSq += d * d;
+        if (f >= frames / 2) lateSq += m * m;
+        if (fabsf(m) > peak) { peak = fabsf(m); peakFrame = f; }
+    }
+
+    // Files shorter than the envelope leave bins empty; they repeat the previous one
+    s->envelope.bins = THUMB_MAX_BINS;
+    for (int b = 0; b < THUMB_MAX_BINS; b++) {
+        if (b > 0 && envMin[b] > envMax[b]) { envMin[b] = envMin[b - 1]; envMax[b] = envMax[b - 1]; }
+        s->envelope.minMax[b * 2] = QuantizeMin(envMin[b]);
+        s->envelope.minMax[b * 2 + 1] = QuantizeMax(envMax[b]);
+    }
+
+    // Mid/side energy of the front pair: side share 0 for mono or identical
+    // channels, 0.5 for unrelated ones, 1 for opposite polarity
+    float width = 0.0f;
+    if (ch >= 2) {
+        double midSq = 0, sideSq = 0;
+        for (int f = 0; f < frames; f++) {
+            float l = rawData[(size_t)f * ch] / Traits::full, r = rawData[(size_t)f * ch + 1] / Traits::full;
+            float mid = 0.5f * (l + r), side = 0.5f * (l - r);
+            midSq += mid * mid; sideSq += side * side;
+        }
+        if (midSq + sideSq > 1e-12) width = (float)(sideSq / (midSq + sideSq));
+    }
+    
+    int count = frames * ch;
+    float rawRms = (float)sqrt(sqrt(totalSq / count)); 
+    float rawZcr = (float)sqrt((float)crossings / count);
+    float spreadRms = powf(rawRms, 0.33f); 
+    float spreadZcr = powf(rawZcr, 0.33f);
+    
+    s->rms = spreadRms * 5.0f; 
+    s->zcr = spreadZcr * 5.0f; 
+
+    float monoRms = (frames > 0) ? (float)sqrt(monoSq / frames) : 0.0f;
+    float safeSq = (monoSq > 1e-12) ? (float)monoSq : 1e-12f;
+    s->features[FEAT_RMS] = rawRms;
+    s->features[FEAT_ZCR] = rawZcr;
+    s->features[FEAT_CREST] = (monoRms > 1e-6f) ? log10f(peak / monoRms + 1e-6f) : 0.0f;
+    s->features[FEAT_DURATION] = logf(1.0f + (float)frames / (float)rate);
+    s->features[FEAT_ATTACK] = (frames > 1) ? (float)peakFrame / (float)(frames - 1) : 0.0f;
+    s->features[FEAT_DECAY] = (float)(lateSq / safeSq);
+    s->features[FEAT_LOWBAND] = (float)(lowSq / safeSq);
+    s->features[FEAT_BRIGHTNESS] = (float)(diffSq / (4.0 * safeSq));
+    s->features[FEAT_WIDTH] = width;
+    s->fingerprintLen = ComputeFingerprint(mono.data(), (int)mono.size(), rate, s->fingerprint, FP_FRAMES);
+    MeasureLoudness(rawData, numSamples, rate, ch, &s->loudness);
+    AnalyzeRhythm(mono.data(), (int)mono.size(), frames, rate, &s->rhythm);
+    float analysed = (float)mono.size() / (float)rate;
+    s->features[FEAT_ONSETS] = logf(1.0f + s->rhythm.onsets / (analysed > 1.0f ? analysed : 1.0f));
+    s->features[FEAT_LOOP] = s->rhythm.loopability;
+
+    s->numFrames = frames;
+    s->sampleRate = rate; s->channels = ch;
+    s->bitsPerSample = (int)sizeof(T) * 8;
+    s->isFloat = Traits::full == 1.0f;
+    s->duration = (float)frames / (float)rate;
+
+    float t = rawZcr * 3.0f; 
+    if (t > 1.0f) t = 1.0f;
+    int r, g, b;
+    if (t < 0.5f) { float lt = t*2.0f; r=255-(int)(lt*100); g=100+(int)(lt*155); b=100; } 
+    else { float lt = (t-0.5f)*2.0f; r=155-(int)(lt*100); g=255-(int)(lt*100); b=100+(int)(lt*155); }
+    s->color = (unsigned int)((r+255)/2) | ((unsigned int)((g+255)/2) << 8) | ((unsigned int)((b+255)/2) << 16);
+    return true;
+}
+
+bool AnalyzePcm(const short* rawData, int numSamples, int rate, int ch, SampleAnalysis* s) {
+    return AnalyzeSamples(rawData, numSamples, rate, ch, s);
+}
+
+bool AnalyzePcm(const float* rawData, int numSamples, int rate, int ch, SampleAnalysis* s) {
+    return AnalyzeSamples(rawData, numSamples, rate, ch, s);
+}
@@ -0,0 +1,48 @@
+// Per-file audio analysis: feature vector, fingerprint and display data from PCM
+#pragma once
+
+#include "loudness.h"
+#include "rhythm.h"
+#include "thumbs.h"
+
+#define FP_FRAMES 128 // Sub-fingerprints kept per file (~1.5 s)
+
+// Per-file feature vector used by the layout engine
+enum FeatureIndex {
+    FEAT_RMS,           // sqrt(sqrt(mean square))
+    FEAT_ZCR,           // sqrt(zero crossings / sample)
+    FEAT_CREST,         // log10(peak / rms)
+    FEAT_DURATION,      // log(1 + seconds)
+    FEAT_ATTACK,        // Position of the envelope peak (0..1)
+    FEAT_DECAY,         // Share of energy in the second half
+    FEAT_LOWBAND,       // Share of energy below ~200 Hz
+    FEAT_BRIGHTNESS,    // First-difference energy / signal energy
+    FEAT_WIDTH,         // Side energy / (mid + side energy) of the first two channels
+    FEAT_ONSETS,        // log(1 + onsets per second) of the first 30 s, over at least 1 s
+    FEAT_LOOP,          // Rhythm loopability (0..1)
+    FEATURE_DIM
+};
+
+const char* FeatureName(int f);
+
+// Everything the analysis derives from one decoded file
+struct SampleAnalysis {
+    float zcr, rms;                     // Spread map axes (x = zcr, y = rms)
+    float features[FEATURE_DIM];
+    Loudness loudness;                  // Integrated, short-term max and true peak
+    Rhythm rhythm;                      // Onsets, tempo and loop score of the first 30 s
+    unsigned int fingerprint[FP_FRAMES];
+    int fingerprintLen;
+    Envelope envelope;                  // Min/max of the mono downmix in THUMB_MAX_BINS bins
+    int numFrames, sampleRate, channels;
+    int bitsPerSample;                  // Of the analysed buffer; callers overwrite with the source's
+    bool isFloat;
+    float duration;
+    unsigned int color;                 // 0x00BBGGRR (COLORREF layout), from zcr
+};
+
+// Analyse interleaved 16-bit PCM (numSamples counts all channels)
+bool AnalyzePcm(const short* rawData, int numSamples, int rate, int ch, SampleAnalysis* out);
+
+// Same for 32-bit float samples in [-1, 1], for sources above 16 bits
+bool AnalyzePcm(const float* rawData, int numSamples, int rate, int ch, SampleAnalysis* out);
@@ -0,0 +1,279 @@
+#include "fingerprint.h"
+#include "dsp.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static inline int PopCount32(unsigned int v) {
+    v = v - ((v >> 1) & 0x55555555U);
+    v = (v & 0x33333333U) + ((v >> 2) & 0x33333333U);
+    return (int)((((v + (v >> 4)) & 0x0F0F0F0FU) * 0x01010101U) >> 24);
+}
+
+int ComputeFingerprint(const float* mono, int frames, int rate, unsigned int* out, int maxOut) {
+    if (rate <= 0 || frames <= 0) return 0;
+    int win = (int)(rate * 0.0928f + 0.5f), hop = (int)(rate * 0.0116f + 0.5f);
+    int n = 256;
+    while (n < win) n *= 2;
+    if (hop < 1 || frames < win || win > 65536) return 0;
+
+    // Fingerprint the audible span only: hops within 30 dB of the loudest one
+    int hops = (frames - win) / hop + 1;
+    std::vector<float> hopEnergy(hops, 0.0f);
+    float maxEnergy = 0.0f;
+    for (int h = 0; h < hops; h++) {
+        const float* p = mono + (size_t)h * hop;
+        for (int i = 0; i < hop; i++) hopEnergy[h] += p[i] * p[i];
+        if (hopEnergy[h] > maxEnergy) maxEnergy = hopEnergy[h];
+    }
+    if (maxEnergy <= 1e-9f) return 0;
+    int first = 0, last = hops - 1;
+    while (first < hops && hopEnergy[first] < maxEnergy * 1e-3f) first++;
+    while (last > first && hopEnergy[last] < maxEnergy * 1e-3f) last--;
+    if (last - first + 1 > maxOut + 1) last = first + maxOut;
+
+    int bandBin[34];
+    for (int b = 0; b <= 33; b++) {
+        float hz = 300.0f * powf(10.0f, (float)b / 33.0f);
+        bandBin[b] = (int)(hz * n / rate + 0.5f);
+        if (b > 0 && bandBin[b] <= bandBin[b - 1]) bandBin[b] = bandBin[b - 1] + 1;
+    }
+    if (bandBin[33] >= n / 2) return 0;
+
+    // Two real frames per complex FFT (one in re, one in im), separated by symmetry
+    std::vector<float> window(win), re(n), im(n), energy((size_t)(last - first + 1) * 33);
+    for (int i = 0; i < win; i++) window[i] = 0.5f - 0.5f * cosf(6.2831853f * i / (win - 1));
+    for (int h = first; h <= last; h += 2) {
+        bool pair = h + 1 <= last;
+        const float* pa = mono + (size_t)h * hop;
+        const float* pb = pair ? pa + hop : NULL;
+        for (int i = 0; i < win; i++) { re[i] = pa[i] * window[i]; im[i] = pb ? pb[i] * window[i] : 0.0f; }
+        for (int i = win; i < n; i++) re[i] = im[i] = 0.0f;
+        FftRadix2(re.data(), im.data(), n);
+        float* ea = &energy[(size_t)(h - first) * 33];
+        float* eb = pair ? ea + 33 : NULL;
+        for (int b = 0; b < 33; b++) {
+            float sa = 0.0f, sb = 0.0f;
+            for (int k = bandBin[b]; k < bandBin[b + 1]; k++) {
+                float zr = re[k], zi = im[k], cr = re[n - k], ci = -im[n - k];
+                float ar = zr + cr, ai = zi + ci, br = zi - ci, bi = cr - zr;
+                sa += ar * ar + ai * ai; sb += br * br + bi * bi;
+            }
+            ea[b] = sa * 0.25f;
+            if (eb) eb[b] = sb * 0.25f;
+        }
+    }
+
+    int count = 0;
+    for (int h = 1; h <= last - first && count < maxOut; h++) {
+        const float* cur = &energy[(size_t)h * 33];
+        const float* prev = cur - 33;
+        unsigned int bits = 0;
+        for (int b = 0; b < 32; b++)
+            if ((cur[b] - cur[b + 1]) - (prev[b] - prev[b + 1]) > 0.0f) bits |= 1U << b;
+        out[count++] = bits;
+    }
+    return count;
+}
+
+float FingerprintBer(const unsigned int* a, int na, const unsigned int* b, int nb, int shift) {
+    int start = (shift > 0) ? shift : 0;
+    int end = (nb + shift < na) ? nb + shift : na;
+    int overlap = end - start;
+    int shorter = (na < nb) ? na : nb;
+    if (overlap < 8 || overlap * 2 < shorter) return 1.0f;
+    int errors = 0;
+    for (int i = start; i < end; i++) errors += PopCount32(a[i] ^ b[i - shift]);
+    return errors / (32.0f * overlap);
+}
+
+// Shared by Build and Add: (a, b, shift) votes come from buckets of at most this many entries
+static const int kMaxBucket = 32;
+
+static inline bool Informative(unsigned int v) { return v != 0 && v != 0xFFFFFFFFU; }
+
+static inline bool EntryLess(const DuplicateIndex::Entry& a, const DuplicateIndex::Entry& b) {
+    if (a.value != b.value) return a.value < b.value;
+    if (a.file != b.file) return a.file < b.file;
+    return a.pos < b.pos;
+}
+
+// Best-voted shift per pair from sorted (a << 40 | b << 16 | shift + 32768) votes
+static void BestShifts(const std::vector<unsigned long long>& votes, std::vector<DuplicateIndex::Candidate>& cands) {
+    for (size_t s = 0; s < votes.size();) {
+        unsigned long long pair = votes[s] >> 16;
+        int bestShift = 0, bestVotes = 0;
+        while (s < votes.size() && (votes[s] >> 16) == pair) {
+            size_t e = s;
+            while (e < votes.size() && votes[e] == votes[s]) e++;
+            if ((int)(e - s) > bestVotes) { bestVotes = (int)(e - s); bestShift = (int)(votes[s] & 0xFFFF) - 32768; }
+            s = e;
+        }
+        if (bestVotes >= 1) cands.push_back({ (int)(pair >> 24), (int)(pair & 0xFFFFFF), bestShift, false });
+    }
+}
+
+void DuplicateIndex::Verify(std::vector<Candidate>& cands) const {
+    ParallelRanges((int)cands.size(), numThreads, [&](int start, int end) {
+        for (int c = start; c < end; c++) {
+            Candidate& cd = cands[c];
+            float ber = FingerprintBer(&fps[(size_t)cd.a * stride], lens[cd.a], &fps[(size_t)cd.b * stride], lens[cd.b], cd.shift);
+            cd.match = ber <= maxBer;
+        }
+    });
+}
+
+void DuplicateIndex::Link(int a, int b) {
+    matches[a].push_back(b);
+    matches[b].push_back(a);
+}
+
+void DuplicateIndex::Build(const unsigned int* fp, const int* len, int fpStride, int n) {
+    stride = fpStride;
+    fps.assign(fp, fp + (size_t)n * stride);
+    lens.assign(len, len + n);
+    alive.assign(n, 1);
+    gen.assign(n, 0);
+    matches.assign(n, std::vector<int>());
+    recent.clear();
+    dead = 0;
+
+    sorted.clear();
+    for (int i = 0; i < n; i++)
+        for (int p = 0; p < lens[i]; p++) {
+            unsigned int v = fps[(size_t)i * stride + p];
+            if (Informative(v)) sorted.push_back({ v, i, (short)p, 0 });
+        }
+    std::sort(sorted.begin(), sorted.end(), EntryLess);
+
+    // (a, b, shift) votes; buckets shared by many files carry no information
+    std::vector<unsigned long long> votes;
+    for (size_t s = 0; s < sorted.size();) {
+        size_t e = s;
+        while (e < sorted.size() && sorted[e].value == sorted[s].value) e++;
+        if (e - s <= (size_t)kMaxBucket) {
+            for (size_t x = s; x < e; x++)
+                for (size_t y = x + 1; y < e; y++) {
+                    if (sorted[x].file == sorted[y].file) continue;
+                    int shift = sorted[x].pos - sorted[y].pos + 32768;
+                    votes.push_back(((unsigned long long)sorted[x].file << 40) | ((unsigned long long)sorted[y].file << 16) | (unsigned int)shift);
+                }
+        }
+        s = e;
+    }
+    std::sort(votes.begin(), votes.end());
+
+    std::vector<Candidate> cands;
+    BestShifts(votes, cands);
+    Verify(cands);
+    for (const Candidate& cd : cands) if (cd.match) Link(cd.a, cd.b);
+}
+
+void DuplicateIndex::Add(int id, const unsigned int* fp, int len) {
+    if (id < 0 || stride <= 0) return;
+    Remove(id);
+    if (id >= (int)lens.size()) {
+        fps.resize((size_t)(id + 1) * stride, 0);
+        lens.resize(id + 1, 0);
+        alive.resize(id + 1, 0);
+        gen.resize(id + 1, 0);
+        matches.resize(id + 1);
+    }
+    if (len > stride) len = stride;
+    memcpy(&fps[(size_t)id * stride], fp, sizeof(unsigned int) * len);
+    lens[id] = len;
+    alive[id] = 1;
+    gen[id]++;                          // Entries from an earlier life of id are dead
+
+    // Vote against the live entries of each bucket this fingerprint falls into, with
+    // the same pair orientation and size limit as the batch pass
+    std::vector<unsigned long long> votes;
+    std::vector<Entry> bucket;
+    for (int p = 0; p < len; p++) {
+        unsigned int v = fp[p];
+        if (!Informative(v)) continue;
+        bucket.clear();
+        Entry key = { v, -1, 0, 0 };
+        for (auto it = std::lower_bound(sorted.begin(), sorted.end(), key, EntryLess); it != sorted.end() && it->value == v; ++it)
+            if (Live(*it) && it->file != id) bucket.push_back(*it);
+        for (const Entry& e : recent)
+            if (e.value == v && Live(e) && e.file != id) bucket.push_back(e);
+        int own = 0;
+        for (int q = 0; q < len; q++) own += fp[q] == v;
+        if ((int)bucket.size() + own > kMaxBucket) continue;
+        for (const Entry& e : bucket) {
+            int a = id < e.file ? id : e.file, b = id < e.file ? e.file : id;
+            int shift = (id < e.file ? p - e.pos : e.pos - p) + 32768;
+            votes.push_back(((unsigned long long)a << 40) | ((unsigned long long)b << 16) | (unsigned int)shift);
+        }
+    }
+    std::sort(votes.begin(), votes.end());
+    std::vector<Candidate> cands;
+    BestShifts(votes, cands);
+    Verify(cands);
+    for (const Candidate& cd : cands) if (cd.match) Link(cd.a, cd.b);
+
+    for (int p = 0; p < len; p++)
+        if (Informative(fp[p])) recent.push_back({ fp[p], id, (short)p, gen[id] });
+
+    // Fold new entries into the sorted run (dropping removed files) once they add up
+    if (recent.size() > 4096 || dead > sorted.size() / 2) {
+        std::vector<Entry> merged;
+        merged.reserve(sorted.size() + recent.size() - dead);
+        for (const Entry& e : sorted) if (Live(e)) merged.push_back(e);
+        for (const Entry& e : recent) if (Live(e)) merged.push_back(e);
+        std::sort(merged.begin(), merged.end(), EntryLess);
+        sorted.swap(merged);
+        recent.clear();
+        dead = 0;
+    }
+}
+
+void DuplicateIndex::Remove(int id) {
+    if (id < 0 || id >= (int)alive.size() || !alive[id]) return;
+    alive[id] = 0;
+    for (int m : matches[id]) {
+        std::vector<int>& back = matches[m];
+        back.erase(std::remove(back.begin(), back.end(), id), back.end());
+    }
+    matches[id].clear();
+    // Entries in the sorted run stay (dead) until the next merge
+    size_t before = recent.size();
+    recent.erase(std::remove_if(recent.begin(), recent.end(), [id](const Entry& e) { return e.file == id; }), recent.end());
+    if (before == recent.size())
+        for (int p = 0; p < lens[id]; p++) dead += Informative(fps[(size_t)id * stride + p]);
+}
+
+int DuplicateIndex::Groups(int n, int* outGroup) const {
+    std::vector<int> parent(n);
+    for (int i = 0; i < n; i++) parent[i] = i;
+    auto Find = [&](int x) { while (parent[x] != x) { parent[x] = parent[parent[x]]; x = parent[x]; } return x; };
+    for (int a = 0; a < n && a < (int)matches.size(); a++)
+        for (int b : matches[a]) {
+            if (b >= n) continue;
+            int ra = Find(a), rb = Find(b);
+            if (ra == rb) continue;
+            if (ra < rb) parent[rb] = ra; else parent[ra] = rb;
+        }
+
+    std::vector<int> size(n, 0);
+    for (int i = 0; i < n; i++) size[Find(i)]++;
+    int groups = 0;
+    for (int i = 0; i < n; i++) {
+        int r = Find(i);
+        outGroup[i] = (size[r] > 1) ? r : -1;
+        if (size[r] > 1 && r == i) groups++;
+    }
+    return groups;
+}
+
+int GroupDuplicates(const unsigned int* fps, const int* lens, int stride, int n, float maxBer, int* outGroup, int numThreads) {
+    DuplicateIndex index;
+    index.maxBer = maxBer;
+    index.numThreads = numThreads;
+    index.Build(fps, lens, stride, n);
+    return index.Groups(n, outGroup);
+}
@@ -0,0 +1,57 @@
+// Compact audio fingerprints and near-duplicate grouping
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// Haitsma/Kalker-style fingerprint: one 32-bit sub-fingerprint per 11.6 ms hop from
+// the signs of energy differences between 33 log-spaced bands (300-3000 Hz) across
+// adjacent frames. Window, hop and bands are defined in seconds/Hz so copies at
+// different sample rates line up; leading and trailing silence is skipped.
+int ComputeFingerprint(const float* mono, int frames, int rate, unsigned int* out, int maxOut);
+
+// Bit error rate of b against a, with b shifted by `shift` sub-fingerprints.
+// Returns 1 when the overlap is too short to be meaningful.
+float FingerprintBer(const unsigned int* a, int na, const unsigned int* b, int nb, int shift);
+
+// Groups near-identical fingerprints. Candidates come from LSH buckets keyed by exact
+// sub-fingerprint values (re-encodes keep many of them bit-identical); each candidate
+// pair is verified by bit error rate at its most-voted alignment, then merged with
+// union-find. outGroup[i] is the lowest index in i's group, or -1 if it has no copies.
+// fps holds n fingerprints of up to `stride` values; returns the number of groups.
+int GroupDuplicates(const unsigned int* fps, const int* lens, int stride, int n, float maxBer, int* outGroup, int numThreads);
+
+// GroupDuplicates with its state kept, so files can be added and removed without
+// regrouping the library. Build() is the batch pass; Add() votes the new fingerprint
+// against the retained LSH buckets and verifies the candidates the same way. A bucket
+// that outgrows the size limit later keeps the matches it already produced, so a
+// patched index can differ from a rebuild in that corner only.
+class DuplicateIndex {
+public:
+    float maxBer = 0.2f;
+    int numThreads = 0;
+
+    void Build(const unsigned int* fps, const int* lens, int stride, int n);
+    void Add(int id, const unsigned int* fp, int len);  // Replaces id if present; Build first
+    void Remove(int id);
+
+    // Same contract as GroupDuplicates over ids 0..n-1 (removed ids are ungrouped)
+    int Groups(int n, int* outGroup) const;
+
+    struct Entry { unsigned int value; int file; short pos; unsigned short gen; };
+    struct Candidate { int a, b, shift; bool match; };
+
+private:
+    int stride = 0;
+    std::vector<unsigned int> fps;
+    std::vector<int> lens;
+    std::vector<char> alive;
+    std::vector<unsigned short> gen;
+    std::vector<Entry> sorted, recent;  // Bucket entries: sorted by (value, file, pos), plus appended since
+    size_t dead = 0;                    // Dead entries still in sorted
+    std::vector<std::vector<int>> matches;
+
+    bool Live(const Entry& e) const { return alive[e.file] && e.gen == gen[e.file]; }
+    void Verify(std::vector<Candidate>& cands) const;
+    void Link(int a, int b);
+};
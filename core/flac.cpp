@@ -0,0 +1,858 @@
+#include "flac.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// CRC-8 (poly 0x07) guards frame headers, CRC-16 (poly 0x8005) whole frames
+struct CrcTables {
+    unsigned char crc8[256];
+    unsigned short crc16[256];
+    CrcTables() {
+        for (int i = 0; i < 256; i++) {
+            unsigned int c = i, d = i << 8;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 0x80) ? ((c << 1) ^ 0x07) : (c << 1);
+                d = (d & 0x8000) ? ((d << 1) ^ 0x8005) : (d << 1);
+            }
+            crc8[i] = (unsigned char)c;
+            crc16[i] = (unsigned short)d;
+        }
+    }
+};
+
+static const CrcTables& Crc() {
+    static const CrcTables tables;
+    return tables;
+}
+
+static unsigned int Crc8(const unsigned char* p, size_t n) {
+    const CrcTables& t = Crc();
+    unsigned int c = 0;
+    for (size_t i = 0; i < n; i++) c = t.crc8[c ^ p[i]];
+    return c;
+}
+
+static unsigned int Crc16(const unsigned char* p, size_t n) {
+    const CrcTables& t = Crc();
+    unsigned int c = 0;
+    for (size_t i = 0; i < n; i++) c = ((c << 8) ^ t.crc16[(c >> 8) ^ p[i]]) & 0xFFFF;
+    return c;
+}
+
+static inline int Clz64(unsigned long long x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, x);
+    return 63 - (int)idx;
+#elif defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & 0x8000000000000000ULL)) { x <<= 1; n++; }
+    return n;
+#endif
+}
+
+static unsigned long long Be64(const unsigned char* p) {
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+// MSB-first reader with a 64-bit cache. Valid bits sit at the top of the cache;
+// reading past the end yields zeros and is reported by Overrun().
+class BitReader {
+public:
+    BitReader(const unsigned char* begin, const unsigned char* limit) : p(begin), end(limit) {}
+
+    unsigned int Bits(int n) {          // n <= 32
+        if (n == 0) return 0;
+        if (bits < n) Refill();
+        unsigned int v = (unsigned int)(cache >> (64 - n));
+        cache <<= n; bits -= n;
+        return v;
+    }
+
+    int Signed(int n) {
+        if (n == 0) return 0;
+        unsigned int v = Bits(n);
+        return (int)(v << (32 - n)) >> (32 - n);
+    }
+
+    // Count of 0 bits before the next 1
+    unsigned int Unary() {
+        unsigned int q = 0;
+        for (;;) {
+            if (bits == 0) Refill();
+            int z = cache ? Clz64(cache) : 64;
+            if (z < bits) {
+                cache <<= z; cache <<= 1;
+                bits -= z + 1;
+                return q + z;
+            }
+            q += bits;
+            cache = 0; bits = 0;
+            if (Overrun()) return q;
+        }
+    }
+
+    void AlignByte() { int drop = bits & 7; cache <<= drop; bits -= drop; }
+    const unsigned char* BytePos() const { return p + phantom - bits / 8; }
+    bool Overrun() const { return phantom * 8 > bits; }
+
+private:
+    const unsigned char* p;
+    const unsigned char* end;
+    unsigned long long cache = 0;
+    int bits = 0, phantom = 0;
+
+    void Refill() {
+        if (end - p >= 8) {
+            // Bits below the valid region are the true upcoming bits, so OR-ing the
+            // same bytes in again later is harmless
+            cache |= Be64(p) >> bits;
+            int take = (63 - bits) >> 3;
+            p += take; bits += take * 8;
+            return;
+        }
+        while (bits <= 56) {
+            unsigned long long b = 0;
+            if (p < end) b = *p++; else phantom++;
+            cache |= b << (56 - bits);
+            bits += 8;
+        }
+    }
+};
+
+class FlacStream : public AudioStream {
+public:
+    bool Open(const unsigned char* data, size_t size);
+    int Read(short* out, int maxFrames) override { return ReadFrames(out, maxFrames); }
+    int ReadFloat(float* out, int maxFrames) override { return ReadFrames(out, maxFrames); }
+    bool Seek(long long frame) override;
+
+private:
+    struct FrameHeader { int blockSize, sampleRate, channels, assignment, bps, headerBytes; long long firstSample; };
+    struct SeekPoint { long long sample, offset; };
+
+    const unsigned char* end = NULL;
+    const unsigned char* firstFrame = NULL;
+    const unsigned char* pos = NULL;
+    int minBlock = 0, maxBlock = 0;
+    std::vector<SeekPoint> seekTable;
+
+    std::vector<int> block;             // Current frame, planar
+    int blockSize = 0, blockPos = 0, blockBps = 16;
+    long long blockStart = 0;
+    long long expect = 0;               // First sample of the next frame, -1 right after a seek
+
+    bool ParseHeader(const unsigned char* p, FrameHeader* h) const;
+    const unsigned char* NextFrame(const unsigned char* from, FrameHeader* h) const;
+    const unsigned char* Bisect(long long target) const;
+    bool DecodeFrame();
+    template <typename T> int ReadFrames(T* out, int maxFrames);
+    bool DecodeSubframe(BitReader& br, int bps, int n, int* out) const;
+};
+
+bool FlacStream::Open(const unsigned char* data, size_t size) {
+    const unsigned char* p = data;
+    end = data + size;
+    if (size >= 10 && !memcmp(p, "ID3", 3)) {
+        size_t len = ((size_t)(p[6] & 0x7F) << 21) | ((p[7] & 0x7F) << 14) | ((p[8] & 0x7F) << 7) | (p[9] & 0x7F);
+        len += 10 + ((p[5] & 0x10) ? 10 : 0);
+        if (len >= size) return false;
+        p += len;
+    }
+    if (end - p < 8 || memcmp(p, "fLaC", 4)) return false;
+    p += 4;
+
+    bool last = false, haveInfo = false;
+    while (!last) {
+        if (end - p < 4) return false;
+        last = (p[0] & 0x80) != 0;
+        int type = p[0] & 0x7F;
+        size_t len = ((size_t)p[1] << 16) | (p[2] << 8) | p[3];
+        p += 4;
+        if ((size_t)(end - p) < len) return false;
+        if (type == 0 && len >= 34) {
+            minBlock = (p[0] << 8) | p[1];
+            maxBlock = (p[2] << 8) | p[3];
+            sampleRate = (p[10] << 12) | (p[11] << 4) | (p[12] >> 4);
+            channels = ((p[12] >> 1) & 7) + 1;
+            bitsPerSample = (((p[12] & 1) << 4) | (p[13] >> 4)) + 1;
+            frames = ((long long)(p[13] & 15) << 32) | ((unsigned int)p[14] << 24) | (p[15] << 16) | (p[16] << 8) | p[17];
+            haveInfo = true;
+        } else if (type == 3) {
+            for (size_t i = 0; i + 18 <= len; i += 18) {
+                unsigned long long sample = Be64(p + i);
+                if (sample == ~0ULL) continue;  // Placeholder
+                seekTable.push_back({ (long long)sample, (long long)Be64(p + i + 8) });
+            }
+        }
+        p += len;
+    }
+    if (!haveInfo || sampleRate <= 0 || bitsPerSample < 4 || bitsPerSample > 24) return false;
+    // A frame takes at least 8 bytes plus one per channel (constant subframes) and holds
+    // at most maxBlock samples; a longer claimed total is corrupt and treated as unknown
+    long long most = (long long)((end - p) / (8 + channels)) * (maxBlock > 0 ? maxBlock : 65535);
+    if (frames > most) frames = 0;
+    firstFrame = pos = p;
+    codec = "flac";
+    return true;
+}
+
+bool FlacStream::ParseHeader(const unsigned char* p, FrameHeader* h) const {
+    if (end - p < 6 || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8) return false;
+    bool variable = p[1] & 1;
+    int bsCode = p[2] >> 4, srCode = p[2] & 15;
+    int chCode = p[3] >> 4, ssCode = (p[3] >> 1) & 7;
+    if ((p[3] & 1) || bsCode == 0 || srCode == 15 || chCode > 10 || ssCode == 3) return false;
+
+    // Frame or sample number, UTF-8 style
+    const unsigned char* q = p + 4;
+    unsigned int c = *q++;
+    unsigned long long num;
+    int extra;
+    if (c < 0x80) { num = c; extra = 0; }
+    else if ((c & 0xE0) == 0xC0) { num = c & 0x1F; extra = 1; }
+    else if ((c & 0xF0) == 0xE0) { num = c & 0x0F; extra = 2; }
+    else if ((c & 0xF8) == 0xF0) { num = c & 0x07; extra = 3; }
+    else if ((c & 0xFC) == 0xF8) { num = c & 0x03; extra = 4; }
+    else if ((c & 0xFE) == 0xFC) { num = c & 0x01; extra = 5; }
+    else if (c == 0xFE) { num = 0; extra = 6; }
+    else return false;
+    int need = extra + (bsCode == 6 ? 1 : bsCode == 7 ? 2 : 0) + (srCode == 12 ? 1 : srCode >= 13 ? 2 : 0) + 1;
+    if (end - q < need) return false;
+    for (int i = 0; i < extra; i++, q++) {
+        if ((*q & 0xC0) != 0x80) return false;
+        num = (num << 6) | (*q & 0x3F);
+    }
+
+    int bs;
+    if (bsCode == 1) bs = 192;
+    else if (bsCode <= 5) bs = 576 << (bsCode - 2);
+    else if (bsCode == 6) bs = *q++ + 1;
+    else if (bsCode == 7) { bs = ((q[0] << 8) | q[1]) + 1; q += 2; }
+    else bs = 256 << (bsCode - 8);
+
+    static const int rates[] = { 0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000 };
+    int sr;
+    if (srCode == 0) sr = sampleRate;
+    else if (srCode < 12) sr = rates[srCode];
+    else if (srCode == 12) sr = *q++ * 1000;
+    else if (srCode == 13) { sr = (q[0] << 8) | q[1]; q += 2; }
+    else { sr = ((q[0] << 8) | q[1]) * 10; q += 2; }
+
+    if (Crc8(p, q - p) != *q) return false;
+    static const int sizes[] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+    h->bps = ssCode ? sizes[ssCode] : bitsPerSample;
+    h->channels = chCode < 8 ? chCode + 1 : 2;
+    h->assignment = chCode;
+    h->blockSize = bs;
+    h->sampleRate = sr;
+    h->firstSample = variable ? (long long)num : (long long)num * maxBlock;
+    h->headerBytes = (int)(q + 1 - p);
+    return true;
+}
+
+// Next plausible frame at or after from (end if none). Besides the CRC-8 the header
+// must agree with STREAMINFO, which rules out nearly all false syncs in audio data.
+const unsigned char* FlacStream::NextFrame(const unsigned char* from, FrameHeader* h) const {
+    for (const unsigned char* p = from; end - p >= 6; p++) {
+        p = (const unsigned char*)memchr(p, 0xFF, end - p - 1);
+        if (!p) break;
+        if ((p[1] & 0xFE) != 0xF8 || !ParseHeader(p, h)) continue;
+        if (h->channels != channels || h->bps != bitsPerSample || h->sampleRate != sampleRate) continue;
+        if (maxBlock > 0 && h->blockSize > maxBlock) continue;
+        return p;
+    }
+    return end;
+}
+
+bool FlacStream::DecodeSubframe(BitReader& br, int bps, int n, int* out) const {
+    if (br.Bits(1)) return false;
+    int type = (int)br.Bits(6);
+    int wasted = 0;
+    if (br.Bits(1)) wasted = (int)br.Unary() + 1;
+    if (wasted >= bps) return false;
+    bps -= wasted;
+
+    int order = 0;
+    int coef[32], shift = 0;
+    if (type == 0) {
+        int v = br.Signed(bps);
+        for (int i = 0; i < n; i++) out[i] = v;
+    } else if (type == 1) {
+        for (int i = 0; i < n; i++) out[i] = br.Signed(bps);
+    } else if (type >= 8 && type <= 12) {
+        order = type - 8;
+    } else if (type >= 32) {
+        order = (type & 31) + 1;
+    } else {
+        return false;
+    }
+
+    if (type >= 8) {
+        if (order > n) return false;
+        for (int i = 0; i < order; i++) out[i] = br.Signed(bps);
+        if (type >= 32) {
+            int precision = (int)br.Bits(4) + 1;
+            shift = br.Signed(5);
+            if (precision == 16 || shift < 0) return false;
+            for (int i = 0; i < order; i++) coef[i] = br.Signed(precision);
+        }
+
+        // Residual: Rice-coded partitions (4- or 5-bit parameters, all-ones = escape)
+        int method = (int)br.Bits(2);
+        if (method > 1) return false;
+        int paramBits = method ? 5 : 4, escape = method ? 31 : 15;
+        int partOrder = (int)br.Bits(4);
+        int perPart = n >> partOrder;
+        if ((perPart << partOrder) != n || perPart < order) return false;
+        int* r = out + order;
+        for (int part = 0; part < (1 << partOrder); part++) {
+            int count = part ? perPart : perPart - order;
+            int k = (int)br.Bits(paramBits);
+            if (k == escape) {
+                int raw = (int)br.Bits(5);
+                for (int i = 0; i < count; i++) *r++ = br.Signed(raw);
+            } else {
+                for (int i = 0; i < count; i++) {
+                    unsigned int v = (br.Unary() << k) | br.Bits(k);
+                    *r++ = (int)(v >> 1) ^ -(int)(v & 1);
+                }
+            }
+            if (br.Overrun()) return false;
+        }
+
+        // Prediction in 64 bits; a sample outside the subframe's range means damaged input
+        long long lo = -(1LL << (bps - 1)), hi = -lo - 1;
+        bool inRange = true;
+        auto Put = [&](int i, long long prediction) {
+            long long v = out[i] + prediction;
+            inRange &= v >= lo && v <= hi;
+            out[i] = (int)v;
+        };
+        if (type < 32) {
+            switch (order) {
+            case 1: for (int i = 1; i < n; i++) Put(i, out[i - 1]); break;
+            case 2: for (int i = 2; i < n; i++) Put(i, 2LL * out[i - 1] - out[i - 2]); break;
+            case 3: for (int i = 3; i < n; i++) Put(i, 3LL * out[i - 1] - 3LL * out[i - 2] + out[i - 3]); break;
+            case 4: for (int i = 4; i < n; i++) Put(i, 4LL * out[i - 1] - 6LL * out[i - 2] + 4LL * out[i - 3] - out[i - 4]); break;
+            }
+        } else {
+            for (int i = order; i < n; i++) {
+                long long sum = 0;
+                for (int j = 0; j < order; j++) sum += (long long)coef[j] * out[i - 1 - j];
+                Put(i, sum >> shift);
+            }
+        }
+        if (!inRange) return false;
+    }
+    if (wasted)
+        for (int i = 0; i < n; i++) out[i] = (int)((unsigned int)out[i] << wasted);
+    return !br.Overrun();
+}
+
+// Decodes the frame at pos (resyncing past damage). A frame that fails to decode or
+// fails its CRC-16 comes out as silence so positions stay right, and so do frames whose
+// headers were lost before the next good one.
+bool FlacStream::DecodeFrame() {
+    FrameHeader h;
+    if (pos >= end) return false;
+    if (!ParseHeader(pos, &h) || h.channels != channels) {
+        pos = NextFrame(pos + 1, &h);
+        if (pos >= end) return false;
+    }
+    if (expect >= 0 && frames > 0 && expect < h.firstSample && h.firstSample <= frames) {
+        long long gap = h.firstSample - expect, most = maxBlock > 0 ? maxBlock : 4096;
+        int n = (int)(gap < most ? gap : most);
+        block.assign((size_t)channels * n, 0);
+        blockStart = expect;
+        blockSize = n;
+        blockBps = bitsPerSample;
+        blockPos = 0;
+        expect += n;
+        return true;
+    }
+    if (h.bps > 24) return false;
+
+    int n = h.blockSize;
+    block.resize((size_t)channels * n);
+    BitReader br(pos + h.headerBytes, end);
+    bool ok = true;
+    for (int c = 0; c < channels && ok; c++) {
+        bool side = (h.assignment == 8 && c == 1) || (h.assignment == 9 && c == 0) || (h.assignment == 10 && c == 1);
+        ok = DecodeSubframe(br, h.bps + (side ? 1 : 0), n, &block[(size_t)c * n]);
+    }
+    const unsigned char* footer = NULL;
+    if (ok) {
+        br.AlignByte();
+        footer = br.BytePos();
+        ok = end - footer >= 2 && Crc16(pos, footer - pos) == (unsigned int)((footer[0] << 8) | footer[1]);
+    }
+
+    if (ok) {
+        int* a = &block[0];
+        int* b = &block[n];
+        if (h.assignment == 8) for (int i = 0; i < n; i++) b[i] = a[i] - b[i];
+        else if (h.assignment == 9) for (int i = 0; i < n; i++) a[i] += b[i];
+        else if (h.assignment == 10) {
+            for (int i = 0; i < n; i++) {
+                int mid = (int)((unsigned int)a[i] << 1) | (b[i] & 1), side = b[i];
+                a[i] = (mid + side) >> 1;
+                b[i] = (mid - side) >> 1;
+            }
+        }
+        pos = footer + 2;
+    } else {
+        memset(block.data(), 0, block.size() * sizeof(int));
+        FrameHeader next;
+        pos = NextFrame(pos + 1, &next);
+    }
+    blockStart = h.firstSample;
+    blockSize = n;
+    blockBps = h.bps;
+    blockPos = 0;
+    expect = blockStart + n;
+    return true;
+}
+
+// Planar block samples of `bps` bits to one interleaved output channel
+static void ConvertChannel(const int* src, int n, int stride, int bps, short* dst) {
+    int shift = bps - 16;
+    if (shift >= 0) for (int i = 0; i < n; i++) dst[(size_t)i * stride] = (short)(src[i] >> shift);
+    else for (int i = 0; i < n; i++) dst[(size_t)i * stride] = (short)(src[i] * (1 << -shift));
+}
+
+static void ConvertChannel(const int* src, int n, int stride, int bps, float* dst) {
+    float scale = 1.0f / (float)(1 << (bps - 1));
+    for (int i = 0; i < n; i++) dst[(size_t)i * stride] = (float)src[i] * scale;
+}
+
+template <typename T>
+int FlacStream::ReadFrames(T* out, int maxFrames) {
+    int done = 0;
+    while (done < maxFrames) {
+        if (blockPos >= blockSize && !DecodeFrame()) break;
+        int take = blockSize - blockPos;
+        if (take > maxFrames - done) take = maxFrames - done;
+        for (int c = 0; c < channels; c++)
+            ConvertChannel(&block[(size_t)c * blockSize + blockPos], take, channels, blockBps,
+                           out + (size_t)done * channels + c);
+        blockPos += take;
+        done += take;
+    }
+    return done;
+}
+
+// Closest frame start at or before target, narrowed by bisection over byte offsets
+const unsigned char* FlacStream::Bisect(long long target) const {
+    const unsigned char* lo = firstFrame;
+    const unsigned char* hi = end;
+    while (hi - lo > 16384) {
+        const unsigned char* mid = lo + (hi - lo) / 2;
+        FrameHeader h;
+        const unsigned char* f = NextFrame(mid, &h);
+        if (f < hi && h.firstSample <= target) lo = f;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool FlacStream::Seek(long long target) {
+    if (target < 0) target = 0;
+    blockSize = blockPos = 0;
+    expect = -1;
+    if (frames > 0 && target >= frames) { pos = end; return true; }
+
+    pos = firstFrame;
+    if (!seekTable.empty()) {
+        for (const SeekPoint& sp : seekTable)
+            if (sp.sample <= target && sp.offset >= 0 && sp.offset < end - firstFrame) pos = firstFrame + sp.offset;
+    } else {
+        pos = Bisect(target);
+    }
+
+    // Hop over whole frames by header while the next one still starts before target
+    FrameHeader h, next;
+    while (ParseHeader(pos, &h)) {
+        const unsigned char* f = NextFrame(pos + h.headerBytes, &next);
+        if (f >= end || next.firstSample != h.firstSample + h.blockSize || next.firstSample > target) break;
+        pos = f;
+    }
+    while (pos < end && DecodeFrame()) {
+        if (target < blockStart + blockSize) {
+            blockPos = target > blockStart ? (int)(target - blockStart) : 0;
+            return true;
+        }
+    }
+    blockSize = blockPos = 0;
+    return pos >= end;
+}
+
+std::unique_ptr<AudioStream> OpenFlacStream(const unsigned char* data, size_t size) {
+    std::unique_ptr<FlacStream> s(new FlacStream());
+    if (!s->Open(data, size)) return NULL;
+    return s;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& dest) : out(dest) {}
+
+    void Put(unsigned int v, int n) {   // n <= 32
+        if (n == 0) return;
+        acc = (acc << n) | (v & (n == 32 ? 0xFFFFFFFFu : ((1u << n) - 1)));
+        count += n;
+        while (count >= 8) { count -= 8; out.push_back((unsigned char)(acc >> count)); }
+        acc &= (1ULL << count) - 1;
+    }
+    void PutSigned(int v, int n) { Put((unsigned int)v, n); }
+    void PutUnary(unsigned int q) {
+        while (q >= 32) { Put(0, 32); q -= 32; }
+        Put(1, q + 1);
+    }
+    void Align() { if (count) Put(0, 8 - count); }
+
+private:
+    std::vector<unsigned char>& out;
+    unsigned long long acc = 0;
+    int count = 0;
+};
+
+static unsigned int ZigZag(int v) { return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31); }
+
+// Rice parameters and partition order minimising the coded size of res[0..n-order)
+struct RicePlan { int partOrder, bits; int params[256]; bool wide; };
+
+static RicePlan PlanResidual(const int* res, int n, int order) {
+    RicePlan best;
+    best.bits = -1;
+    for (int po = 0; po <= 8; po++) {
+        int per = n >> po;
+        if ((per << po) != n || per < order || (po > 0 && per < 16)) break;
+        RicePlan plan;
+        plan.partOrder = po;
+        plan.bits = 0;
+        plan.wide = false;
+        const int* r = res;
+        for (int part = 0; part < (1 << po); part++) {
+            int count = part ? per : per - order;
+            unsigned long long sum = 0;
+            for (int i = 0; i < count; i++) sum += ZigZag(r[i]);
+            int k = 0;
+            while (k < 30 && ((unsigned long long)count << (k + 1)) < sum) k++;
+            long long bits = 0;
+            for (int i = 0; i < count; i++) bits += (ZigZag(r[i]) >> k) + 1 + k;
+            if (k >= 15) plan.wide = true;
+            plan.params[part] = k;
+            plan.bits += (int)(bits > 0x3FFFFFFF ? 0x3FFFFFFF : bits);
+            r += count;
+        }
+        plan.bits += (plan.wide ? 5 : 4) << po;
+        if (best.bits < 0 || plan.bits < best.bits) best = plan;
+    }
+    return best;
+}
+
+static void WriteResidual(BitWriter& bw, const int* res, int n, int order, const RicePlan& plan) {
+    bw.Put(plan.wide ? 1 : 0, 2);
+    bw.Put(plan.partOrder, 4);
+    int per = n >> plan.partOrder;
+    for (int part = 0; part < (1 << plan.partOrder); part++) {
+        int count = part ? per : per - order;
+        int k = plan.params[part];
+        bw.Put(k, plan.wide ? 5 : 4);
+        for (int i = 0; i < count; i++) {
+            unsigned int v = ZigZag(*res++);
+            bw.PutUnary(v >> k);
+            bw.Put(v, k);
+        }
+    }
+}
+
+// Quantised LPC coefficients (autocorrelation + Levinson-Durbin on a Welch window)
+static bool ComputeLpc(const int* x, int n, int order, int precision, int* coef, int* shiftOut) {
+    std::vector<double> w(n);
+    for (int i = 0; i < n; i++) {
+        double t = (2.0 * i - (n - 1)) / (n + 1);
+        w[i] = x[i] * (1.0 - t * t);
+    }
+    double r[33];
+    for (int lag = 0; lag <= order; lag++) {
+        double s = 0;
+        for (int i = lag; i < n; i++) s += w[i] * w[i - lag];
+        r[lag] = s;
+    }
+    if (r[0] <= 0) return false;
+    r[0] *= 1.0 + 1e-9;
+
+    double a[33] = { 0 }, tmp[33];
+    double err = r[0];
+    for (int i = 1; i <= order; i++) {
+        double acc = r[i];
+        for (int j = 1; j < i; j++) acc -= a[j] * r[i - j];
+        double k = acc / err;
+        memcpy(tmp, a, sizeof(a));
+        a[i] = k;
+        for (int j = 1; j < i; j++) a[j] = tmp[j] - k * tmp[i - j];
+        err *= 1.0 - k * k;
+        if (err <= 0) return false;
+    }
+
+    double cmax = 0;
+    for (int i = 1; i <= order; i++) cmax = fmax(cmax, fabs(a[i]));
+    if (cmax <= 0) return false;
+    int log2cmax;
+    frexp(cmax, &log2cmax);
+    int shift = precision - 1 - log2cmax;
+    if (shift > 15) shift = 15;
+    if (shift < 0) return false;
+    int lim = (1 << (precision - 1)) - 1;
+    double carry = 0;
+    for (int i = 0; i < order; i++) {
+        carry += a[i + 1] * (1 << shift);
+        long q = lround(carry);
+        if (q > lim) q = lim;
+        if (q < -lim - 1) q = -lim - 1;
+        carry -= q;
+        coef[i] = (int)q;
+    }
+    *shiftOut = shift;
+    return true;
+}
+
+// Encoded subframe candidate
+struct Subframe {
+    int type, order, wasted, bps, shift, precision;
+    int coef[32];
+    std::vector<int> res;
+    RicePlan plan;
+    long long bits;
+};
+
+static void FixedResidual(const int* x, int n, int order, std::vector<int>& res) {
+    res.resize(n - order);
+    for (int i = order; i < n; i++) {
+        long long p = 0;
+        switch (order) {
+        case 1: p = x[i - 1]; break;
+        case 2: p = 2LL * x[i - 1] - x[i - 2]; break;
+        case 3: p = 3LL * x[i - 1] - 3LL * x[i - 2] + x[i - 3]; break;
+        case 4: p = 4LL * x[i - 1] - 6LL * x[i - 2] + 4LL * x[i - 3] - x[i - 4]; break;
+        }
+        res[i - order] = (int)(x[i] - p);
+    }
+}
+
+static void PlanSubframe(const int* input, int n, int bps, const FlacEncodeOptions& opt, Subframe& best) {
+    unsigned int all = 0;
+    bool constant = true;
+    for (int i = 0; i < n; i++) { all |= (unsigned int)input[i]; constant &= input[i] == input[0]; }
+    best.wasted = 0;
+    best.bps = bps;
+    best.order = 0;
+    if (constant) { best.type = 0; best.bits = 8 + bps; return; }
+    while (!(all & 1) && best.wasted < bps - 1) { all >>= 1; best.wasted++; }
+    std::vector<int> x(input, input + n);
+    for (int& v : x) v >>= best.wasted;
+    int sbps = bps - best.wasted;
+
+    best.type = 1;
+    best.bits = 8 + (long long)n * sbps;
+    if (opt.verbatim) return;
+
+    Subframe cand;
+    for (int order = 0; order <= 4 && order < n; order++) {
+        FixedResidual(x.data(), n, order, cand.res);
+        cand.plan = PlanResidual(cand.res.data(), n, order);
+        long long bits = 8 + (long long)order * sbps + 6 + cand.plan.bits;
+        if (cand.plan.bits >= 0 && bits < best.bits) {
+            best.type = 8 + order; best.order = order; best.bits = bits;
+            best.res = cand.res; best.plan = cand.plan;
+        }
+    }
+    int order = opt.maxLpcOrder < 32 ? opt.maxLpcOrder : 32;
+    const int precision = 12;
+    if (order > 0 && n > order * 2 && ComputeLpc(x.data(), n, order, precision, cand.coef, &cand.shift)) {
+        cand.res.resize(n - order);
+        bool fits = true;
+        for (int i = order; i < n && fits; i++) {
+            long long sum = 0;
+            for (int j = 0; j < order; j++) sum += (long long)cand.coef[j] * x[i - 1 - j];
+            long long r = x[i] - (sum >> cand.shift);
+            fits = r > -(1LL << 30) && r < (1LL << 30);
+            cand.res[i - order] = (int)r;
+        }
+        if (fits) {
+            cand.plan = PlanResidual(cand.res.data(), n, order);
+            long long bits = 8 + (long long)order * sbps + 4 + 5 + order * precision + 6 + cand.plan.bits;
+            if (cand.plan.bits >= 0 && bits < best.bits) {
+                best.type = 32 + order - 1; best.order = order; best.bits = bits;
+                best.shift = cand.shift; best.precision = precision;
+                memcpy(best.coef, cand.coef, sizeof(int) * order);
+                best.res = cand.res; best.plan = cand.plan;
+            }
+        }
+    }
+}
+
+static void WriteSubframe(BitWriter& bw, const int* input, int n, const Subframe& s) {
+    bw.Put(0, 1);
+    bw.Put(s.type, 6);
+    if (s.wasted) { bw.Put(1, 1); bw.PutUnary(s.wasted - 1); } else bw.Put(0, 1);
+    int sbps = s.bps - s.wasted;
+    if (s.type == 0) { bw.PutSigned(input[0] >> s.wasted, sbps); return; }
+    if (s.type == 1) { for (int i = 0; i < n; i++) bw.PutSigned(input[i] >> s.wasted, sbps); return; }
+    for (int i = 0; i < s.order; i++) bw.PutSigned(input[i] >> s.wasted, sbps);
+    if (s.type >= 32) {
+        bw.Put(s.precision - 1, 4);
+        bw.PutSigned(s.shift, 5);
+        for (int i = 0; i < s.order; i++) bw.PutSigned(s.coef[i], s.precision);
+    }
+    WriteResidual(bw, s.res.data(), n, s.order, s.plan);
+}
+
+static void PutUtf8(BitWriter& bw, unsigned long long v) {
+    if (v < 0x80) { bw.Put((unsigned int)v, 8); return; }
+    int extra = 1;
+    while (extra < 6 && v >= (1ULL << (5 * extra + 6))) extra++;
+    unsigned int lead = (0xFF00u >> (extra + 1)) & 0xFF;
+    bw.Put(lead | (unsigned int)(v >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; i--) bw.Put(0x80 | (unsigned int)((v >> (6 * i)) & 0x3F), 8);
+}
+
+void EncodeFlac(const int* samples, long long frames, int channels, int bitsPerSample, int sampleRate,
+                const FlacEncodeOptions& options, std::vector<unsigned char>& out) {
+    struct FrameInfo { long long sample, offset; int samples; };
+    std::vector<FrameInfo> index;
+    std::vector<unsigned char> body;
+    int minBlock = 65535, maxBlock = 0, minFrame = 0xFFFFFF, maxFrame = 0;
+    std::vector<int> planar, side;
+    std::vector<Subframe> subs(channels + 2);
+
+    long long start = 0;
+    for (int frameNo = 0; start < frames; frameNo++) {
+        int n = options.blockSize;
+        if (options.variableBlocks && (frameNo & 1)) n = options.blockSize / 2 + 17;
+        if (n > frames - start) n = (int)(frames - start);
+        planar.resize((size_t)(channels + 2) * n);
+        for (int c = 0; c < channels; c++)
+            for (int i = 0; i < n; i++) planar[(size_t)c * n + i] = samples[(start + i) * channels + c];
+
+        // Channel assignment: 1 = independent, 8 = left/side, 9 = side/right, 10 = mid/side
+        int assignment = channels - 1;
+        for (int c = 0; c < channels; c++) PlanSubframe(&planar[(size_t)c * n], n, bitsPerSample, options, subs[c]);
+        if (channels == 2 && options.stereo != 1) {
+            int* mid = &planar[(size_t)2 * n];
+            int* sd = &planar[(size_t)3 * n];
+            for (int i = 0; i < n; i++) {
+                int l = planar[i], r = planar[n + i];
+                mid[i] = (l + r) >> 1;
+                sd[i] = l - r;
+            }
+            PlanSubframe(mid, n, bitsPerSample, options, subs[2]);
+            PlanSubframe(sd, n, bitsPerSample + 1, options, subs[3]);
+            long long cost[4] = { subs[0].bits + subs[1].bits, subs[0].bits + subs[3].bits,
+                                  subs[3].bits + subs[1].bits, subs[2].bits + subs[3].bits };
+            int pick = 0;
+            if (options.stereo < 0) { for (int k = 1; k < 4; k++) if (cost[k] < cost[pick]) pick = k; }
+            else pick = options.stereo - 7;
+            assignment = pick ? 7 + pick : 1;
+        }
+
+        size_t frameStart = body.size();
+        BitWriter bw(body);
+        bw.Put(0xFFF8 | (options.variableBlocks ? 1 : 0), 16);
+        int bsCode = 7;
+        for (int k = 8; k <= 15; k++) if (n == 256 << (k - 8)) bsCode = k;
+        for (int k = 2; k <= 5; k++) if (n == 576 << (k - 2)) bsCode = k;
+        if (bsCode == 7 && n <= 256) bsCode = 6;
+        static const int rates[] = { 0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000 };
+        int srCode = 0;
+        for (int k = 1; k < 12; k++) if (sampleRate == rates[k]) srCode = k;
+        int ssCode = bitsPerSample == 8 ? 1 : bitsPerSample == 12 ? 2 : bitsPerSample == 16 ? 4 :
+                     bitsPerSample == 20 ? 5 : bitsPerSample == 24 ? 6 : 0;
+        bw.Put(bsCode, 4);
+        bw.Put(srCode, 4);
+        bw.Put(channels == 2 ? assignment : channels - 1, 4);
+        bw.Put(ssCode, 3);
+        bw.Put(0, 1);
+        PutUtf8(bw, options.variableBlocks ? (unsigned long long)start : (unsigned long long)frameNo);
+        if (bsCode == 6) bw.Put(n - 1, 8);
+        if (bsCode == 7) bw.Put(n - 1, 16);
+        bw.Put(Crc8(&body[frameStart], body.size() - frameStart), 8);
+
+        for (int c = 0; c < channels; c++) {
+            int src = c;
+            if (assignment == 8 && c == 1) src = 3;
+            if (assignment == 9 && c == 0) src = 3;
+            if (assignment == 10) src = c == 0 ? 2 : 3;
+            WriteSubframe(bw, &planar[(size_t)src * n], n, subs[src]);
+        }
+        bw.Align();
+        unsigned int crc = Crc16(&body[frameStart], body.size() - frameStart);
+        bw.Put(crc, 16);
+
+        int size = (int)(body.size() - frameStart);
+        index.push_back({ start, (long long)frameStart, n });
+        if (start + n < frames || frameNo == 0) {
+            if (n < minBlock) minBlock = n;
+            if (n > maxBlock) maxBlock = n;
+        }
+        if (size < minFrame) minFrame = size;
+        if (size > maxFrame) maxFrame = size;
+        start += n;
+    }
+    if (!options.variableBlocks) minBlock = maxBlock = options.blockSize;
+    if (maxBlock == 0) minBlock = maxBlock = options.blockSize;
+
+    out.clear();
+    BitWriter bw(out);
+    for (const char* m = "fLaC"; *m; m++) bw.Put((unsigned char)*m, 8);
+    bool table = options.seekPoints > 0;
+    bw.Put(table ? 0 : 1, 1);
+    bw.Put(0, 7);
+    bw.Put(34, 24);
+    bw.Put(minBlock, 16);
+    bw.Put(maxBlock, 16);
+    bw.Put(index.empty() ? 0 : minFrame, 24);
+    bw.Put(maxFrame, 24);
+    bw.Put(sampleRate, 20);
+    bw.Put(channels - 1, 3);
+    bw.Put(bitsPerSample - 1, 5);
+    bw.Put((unsigned int)(frames >> 32) & 15, 4);
+    bw.Put((unsigned int)frames, 32);
+    for (int i = 0; i < 4; i++) bw.Put(0, 32);     // MD5 unknown
+    if (table) {
+        bw.Put(1, 1);
+        bw.Put(3, 7);
+        bw.Put(options.seekPoints * 18, 24);
+        // Evenly spaced targets snapped to frame starts; unused slots become placeholders at the end
+        std::vector<size_t> points;
+        size_t f = 0;
+        for (int k = 0; k < options.seekPoints && !index.empty(); k++) {
+            long long target = frames * k / options.seekPoints;
+            while (f + 1 < index.size() && index[f + 1].sample <= target) f++;
+            if (points.empty() || points.back() != f) points.push_back(f);
+        }
+        for (size_t f : points) {
+            bw.Put((unsigned int)(index[f].sample >> 32), 32); bw.Put((unsigned int)index[f].sample, 32);
+            bw.Put((unsigned int)(index[f].offset >> 32), 32); bw.Put((unsigned int)index[f].offset, 32);
+            bw.Put(index[f].samples, 16);
+        }
+        for (size_t k = points.size(); k < (size_t)options.seekPoints; k++) {
+            bw.Put(0xFFFFFFFF, 32); bw.Put(0xFFFFFFFF, 32);
+            bw.Put(0, 32); bw.Put(0, 32); bw.Put(0, 16);
+        }
+    }
+    out.insert(out.end(), body.begin(), body.end());
+}
@@ -0,0 +1,25 @@
+// FLAC decoding (and a small encoder for tests and benchmarks)
+#pragma once
+
+#include "decoder.h"
+
+#include <vector>
+
+// Stream over a FLAC image (an ID3v2 tag in front is skipped). Handles 4-24 bit,
+// 1-8 channels, fixed and variable block sizes; frames failing their CRC decode
+// as silence. Seeks through the SEEKTABLE when present, else by bisection.
+std::unique_ptr<AudioStream> OpenFlacStream(const unsigned char* data, size_t size);
+
+// Encoder settings; the defaults give a reasonable file, the rest force code paths
+struct FlacEncodeOptions {
+    int blockSize = 4096;
+    int maxLpcOrder = 8;         // 0 = fixed predictors only
+    bool verbatim = false;       // Store every subframe uncompressed
+    int stereo = -1;             // -1 = best, else channel assignment 1 (independent), 8, 9 or 10
+    int seekPoints = 0;          // SEEKTABLE entries (evenly spaced)
+    bool variableBlocks = false; // Alternate block sizes, coded as sample numbers
+};
+
+// Encodes interleaved integer samples (bitsPerSample 4-24) to a FLAC image
+void EncodeFlac(const int* samples, long long frames, int channels, int bitsPerSample, int sampleRate,
+                const FlacEncodeOptions& options, std::vector<unsigned char>& out);
@@ -0,0 +1,97 @@
+#include "kdtree.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <float.h>
+
+int KdTree::BuildNode(int start, int end) {
+    Node nd = { -1, -1, -1, start, end, 0.0f };
+    int id = (int)nodes.size();
+    nodes.push_back(nd);
+    if (end - start <= 16) return id;
+
+    // Split on the axis with the largest spread
+    int bestAxis = 0; float bestSpread = -1.0f;
+    for (int a = 0; a < dim; a++) {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (int i = start; i < end; i++) {
+            float v = pts[perm[i] * dim + a];
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+        if (hi - lo > bestSpread) { bestSpread = hi - lo; bestAxis = a; }
+    }
+    if (bestSpread <= 0.0f) return id; // All identical, keep as leaf
+
+    int mid = (start + end) / 2;
+    int axis = bestAxis;
+    const float* p = pts;
+    int d = dim;
+    std::nth_element(perm.begin() + start, perm.begin() + mid, perm.begin() + end,
+                     [p, d, axis](int a, int b) { return p[a * d + axis] < p[b * d + axis]; });
+
+    // Read the split before recursing: building the right child reorders perm[mid]
+    float split = pts[perm[mid] * dim + axis];
+    int left = BuildNode(start, mid);
+    int right = BuildNode(mid, end);
+    nodes[id].axis = axis;
+    nodes[id].split = split;
+    nodes[id].left = left;
+    nodes[id].right = right;
+    return id;
+}
+
+void KdTree::Build(const float* points, int n, int dimensions) {
+    pts = points; dim = dimensions;
+    nodes.clear();
+    perm.resize(n);
+    for (int i = 0; i < n; i++) perm[i] = i;
+    nodes.reserve(n / 4 + 16);
+    if (n > 0) BuildNode(0, n);
+}
+
+int KdTree::Query(const float* q, int k, int self, int* outIdx, float* outDist, float maxDist) const {
+    if (nodes.empty() || k <= 0) return 0;
+    int found = 0;
+    int stack[128]; int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const Node& nd = nodes[stack[--sp]];
+        if (nd.axis < 0) {
+            for (int i = nd.start; i < nd.end; i++) {
+                int idx = perm[i];
+                if (idx == self) continue;
+                const float* v = pts + (size_t)idx * dim;
+                float dist = 0.0f;
+                for (int a = 0; a < dim; a++) { float t = v[a] - q[a]; dist += t * t; }
+                if (dist >= (found == k ? outDist[k - 1] : maxDist)) continue;
+                // Sorted insertion
+                int pos = (found < k) ? found++ : k - 1;
+                while (pos > 0 && outDist[pos - 1] > dist) {
+                    outDist[pos] = outDist[pos - 1]; outIdx[pos] = outIdx[pos - 1]; pos--;
+                }
+                outDist[pos] = dist; outIdx[pos] = idx;
+            }
+            continue;
+        }
+        float diff = q[nd.axis] - nd.split;
+        int nearChild = (diff < 0.0f) ? nd.left : nd.right;
+        int farChild = (diff < 0.0f) ? nd.right : nd.left;
+        // Far side first so the near side is popped (and tightens the bound) first
+        if (diff * diff < (found == k ? outDist[k - 1] : maxDist)) stack[sp++] = farChild;
+        stack[sp++] = nearChild;
+    }
+    return found;
+}
+
+void BuildKnnGraph(const float* pts, int n, int dim, int k, int numThreads,
+                   std::vector<int>& outIdx, std::vector<float>& outDist) {
+    KdTree tree;
+    tree.Build(pts, n, dim);
+    outIdx.assign((size_t)n * k, -1);
+    outDist.assign((size_t)n * k, FLT_MAX);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++)
+            tree.Query(pts + (size_t)i * dim, k, i, &outIdx[(size_t)i * k], &outDist[(size_t)i * k]);
+    });
+}
@@ -0,0 +1,28 @@
+// Nearest-neighbour search: KD-tree and exact kNN graph construction
+#pragma once
+
+#include <float.h>
+#include <stddef.h>
+#include <vector>
+
+// KD-tree for exact k-nearest-neighbour queries in low-dimensional feature space
+class KdTree {
+    struct Node { int axis, left, right, start, end; float split; };
+    std::vector<Node> nodes;
+    std::vector<int> perm;
+    const float* pts = NULL;
+    int dim = 0;
+
+    int BuildNode(int start, int end);
+
+public:
+    void Build(const float* points, int n, int dimensions);
+
+    // Nearest k points to q (squared distances, ascending). Skips index 'self' and
+    // points at squared distance maxDist or more. Returns number of neighbours found.
+    int Query(const float* q, int k, int self, int* outIdx, float* outDist, float maxDist = FLT_MAX) const;
+};
+
+// Exact kNN graph over n points (squared distances), parallel over query points
+void BuildKnnGraph(const float* pts, int n, int dim, int k, int numThreads,
+                   std::vector<int>& outIdx, std::vector<float>& outDist);
@@ -0,0 +1,693 @@
+#include "layout.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+const char* LayoutName(int method) {
+    static const char* names[] = { "zcr / rms", "pca", "t-sne", "umap" };
+    return (method >= 0 && method < LAYOUT_COUNT) ? names[method] : "?";
+}
+
+// Sparse symmetric graph in CSR form (row i = rowStart[i] .. rowStart[i+1])
+struct SparseGraph {
+    std::vector<int> rowStart, col;
+    std::vector<float> val;
+};
+
+// Symmetrize a directed kNN weight matrix. fuzzyUnion: w = a + b - ab (UMAP), else w = a + b (t-SNE)
+static void SymmetrizeKnn(int n, int k, const std::vector<int>& idx, const std::vector<float>& w,
+                          bool fuzzyUnion, SparseGraph& out) {
+    std::vector<int> counts(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < k; j++) {
+            int c = idx[(size_t)i * k + j];
+            if (c < 0) continue;
+            counts[i]++; counts[c]++;
+        }
+    }
+    std::vector<int> start(n + 1, 0);
+    for (int i = 0; i < n; i++) start[i + 1] = start[i] + counts[i];
+
+    // Each entry tagged with direction: 0 = forward (a), 1 = transposed (b)
+    struct Entry { int col; float v; int dir; };
+    std::vector<Entry> entries(start[n]);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < k; j++) {
+            int c = idx[(size_t)i * k + j];
+            if (c < 0) continue;
+            float v = w[(size_t)i * k + j];
+            entries[fill[i]++] = { c, v, 0 };
+            entries[fill[c]++] = { i, v, 1 };
+        }
+    }
+
+    out.rowStart.assign(n + 1, 0);
+    out.col.clear(); out.val.clear();
+    out.col.reserve(start[n]); out.val.reserve(start[n]);
+    for (int i = 0; i < n; i++) {
+        std::sort(entries.begin() + start[i], entries.begin() + start[i + 1],
+                  [](const Entry& a, const Entry& b) { return a.col < b.col || (a.col == b.col && a.dir < b.dir); });
+        for (int e = start[i]; e < start[i + 1]; e++) {
+            float a = 0.0f, b = 0.0f;
+            int c = entries[e].col;
+            if (entries[e].dir == 0) a = entries[e].v; else b = entries[e].v;
+            if (e + 1 < start[i + 1] && entries[e + 1].col == c) { b = entries[e + 1].v; e++; }
+            float v = fuzzyUnion ? (a + b - a * b) : (a + b);
+            out.col.push_back(c);
+            out.val.push_back(v);
+        }
+        out.rowStart[i + 1] = (int)out.col.size();
+    }
+}
+
+// Barnes-Hut quadtree over 2D points (rebuilt every t-SNE iteration)
+class QuadTree {
+public:
+    struct Node {
+        float cx, cy, hw;       // Cell center and half width
+        float comX, comY;       // Center of mass
+        int count, point;       // Point index for single-point leaves, else -1
+        int child;              // First of 4 contiguous children, -1 for leaves
+    };
+    std::vector<Node> nodes;
+
+    void Build(const float* y, int n) {
+        nodes.clear();
+        nodes.reserve((size_t)n * 2 + 1);
+        float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+        for (int i = 0; i < n; i++) {
+            if (y[i*2] < minX) minX = y[i*2];
+            if (y[i*2] > maxX) maxX = y[i*2];
+            if (y[i*2+1] < minY) minY = y[i*2+1];
+            if (y[i*2+1] > maxY) maxY = y[i*2+1];
+        }
+        float hw = 0.5f * ((maxX - minX > maxY - minY) ? maxX - minX : maxY - minY) + 1e-5f;
+        nodes.push_back({ (minX + maxX) * 0.5f, (minY + maxY) * 0.5f, hw, 0, 0, 0, -1, -1 });
+        for (int i = 0; i < n; i++) Insert(i, y[i*2], y[i*2+1], y);
+    }
+
+    // Accumulate repulsive force on point i; returns sum of unnormalized q
+    float Repulse(int i, float px, float py, float theta, float* fx, float* fy) const {
+        float sumQ = 0.0f, rx = 0.0f, ry = 0.0f;
+        int stack[4 * 32 + 8]; int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const Node& nd = nodes[stack[--sp]];
+            if (nd.count == 0 || nd.point == i) continue;
+            float dx = px - nd.comX, dy = py - nd.comY;
+            float d2 = dx * dx + dy * dy;
+            float w = 2.0f * nd.hw;
+            if (nd.child < 0 || w * w < theta * theta * d2) {
+                float cnt = (float)nd.count;
+                if (d2 == 0.0f) cnt -= 1.0f; // Exclude self from a coincident cluster
+                float q = 1.0f / (1.0f + d2);
+                float m = cnt * q;
+                sumQ += m;
+                m *= q;
+                rx += m * dx; ry += m * dy;
+            } else {
+                for (int c = 0; c < 4; c++) stack[sp++] = nd.child + c;
+            }
+        }
+        *fx = rx; *fy = ry;
+        return sumQ;
+    }
+
+private:
+    static const int MAX_DEPTH = 32;
+
+    int Quadrant(const Node& nd, float x, float y) const {
+        return (x >= nd.cx ? 1 : 0) + (y >= nd.cy ? 2 : 0);
+    }
+
+    void Split(int node) {
+        int first = (int)nodes.size();
+        Node parent = nodes[node];
+        float h = parent.hw * 0.5f;
+        for (int q = 0; q < 4; q++) {
+            float cx = parent.cx + ((q & 1) ? h : -h);
+            float cy = parent.cy + ((q & 2) ? h : -h);
+            nodes.push_back({ cx, cy, h, 0, 0, 0, -1, -1 });
+        }
+        nodes[node].child = first;
+    }
+
+    void Insert(int idx, float x, float y, const float* ys) {
+        int node = 0;
+        for (int depth = 0; ; depth++) {
+            Node& nd = nodes[node];
+            nd.comX = (nd.comX * nd.count + x) / (nd.count + 1);
+            nd.comY = (nd.comY * nd.count + y) / (nd.count + 1);
+            nd.count++;
+            if (nd.child < 0) {
+                if (nd.count == 1) { nd.point = idx; return; }
+                if (depth >= MAX_DEPTH) { nd.point = -1; return; } // Coincident points
+                // Push the resident point down one level, then keep descending
+                int resident = nd.point;
+                nodes[node].point = -1;
+                Split(node);
+                float rx = ys[resident*2], ry = ys[resident*2+1];
+                Node& child = nodes[nodes[node].child + Quadrant(nodes[node], rx, ry)];
+                child.comX = rx; child.comY = ry; child.count = 1; child.point = resident;
+            }
+            node = nodes[node].child + Quadrant(nodes[node], x, y);
+        }
+    }
+};
+
+void LayoutEngine::Fit(const float* feats, int n, float* outXY) {
+    refFeat.clear(); refPos.clear();
+    if (n <= 0) return;
+    Standardize(feats, n);
+    FitPca(n);
+
+    std::vector<float> y((size_t)n * 2);
+    ProjectPca(refFeat.data(), n, y.data());
+    if (method == LAYOUT_TSNE && n > 3) RunTsne(n, y);
+    else if (method == LAYOUT_UMAP && n > 3) RunUmap(n, y);
+    Normalize(y, n);
+
+    refPos = y;
+    refTree.Build(refFeat.data(), n, FEATURE_DIM);
+    memcpy(outXY, y.data(), sizeof(float) * 2 * n);
+}
+
+void LayoutEngine::Place(const float* feats, int n, float* outXY) {
+    int refCount = (int)(refPos.size() / 2);
+    if (n <= 0) return;
+    if (refCount == 0) { Fit(feats, n, outXY); return; }
+
+    std::vector<float> z((size_t)n * FEATURE_DIM);
+    for (int i = 0; i < n; i++)
+        for (int d = 0; d < FEATURE_DIM; d++)
+            z[(size_t)i*FEATURE_DIM + d] = (feats[(size_t)i*FEATURE_DIM + d] - mean[d]) * invStd[d];
+
+    if (method == LAYOUT_PCA) {
+        ProjectPca(z.data(), n, outXY);
+        for (int i = 0; i < n * 2; i++) outXY[i] = (outXY[i] - outCenter[i & 1]) * outScale;
+    } else {
+        // Kernel-weighted average of the nearest laid-out neighbours
+        const int k = 10;
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            int nIdx[k]; float nDist[k];
+            for (int i = start; i < end; i++) {
+                int found = refTree.Query(&z[(size_t)i*FEATURE_DIM], k, -1, nIdx, nDist);
+                float sigma = (found > 0 && nDist[found / 2] > 1e-12f) ? nDist[found / 2] : 1.0f;
+                float sx = 0, sy = 0, sw = 0;
+                for (int j = 0; j < found; j++) {
+                    float w = expf(-nDist[j] / sigma);
+                    sx += w * refPos[nIdx[j]*2]; sy += w * refPos[nIdx[j]*2+1]; sw += w;
+                }
+                outXY[i*2] = (sw > 0) ? sx / sw : 0.0f;
+                outXY[i*2+1] = (sw > 0) ? sy / sw : 0.0f;
+            }
+        });
+    }
+
+    refFeat.insert(refFeat.end(), z.begin(), z.end());
+    refPos.insert(refPos.end(), outXY, outXY + n * 2);
+    refTree.Build(refFeat.data(), (int)(refPos.size() / 2), FEATURE_DIM);
+}
+
+bool LayoutEngine::Save(FILE* f) const {
+    int header[5] = { 0x594C4D41 /* AMLY */, 1, FEATURE_DIM, method, FittedCount() };
+    return fwrite(header, sizeof(header), 1, f) == 1 &&
+           fwrite(mean, sizeof(mean), 1, f) == 1 && fwrite(invStd, sizeof(invStd), 1, f) == 1 &&
+           fwrite(basis, sizeof(basis), 1, f) == 1 && fwrite(outCenter, sizeof(outCenter), 1, f) == 1 &&
+           fwrite(&outScale, sizeof(outScale), 1, f) == 1 &&
+           fwrite(refFeat.data(), sizeof(float), refFeat.size(), f) == refFeat.size() &&
+           fwrite(refPos.data(), sizeof(float), refPos.size(), f) == refPos.size();
+}
+
+bool LayoutEngine::Load(FILE* f, int maxPoints) {
+    refFeat.clear(); refPos.clear();
+    refTree.Build(NULL, 0, FEATURE_DIM);
+    int header[5];
+    if (fread(header, sizeof(header), 1, f) != 1) return false;
+    if (header[0] != 0x594C4D41 || header[1] != 1 || header[2] != FEATURE_DIM ||
+        header[3] < 0 || header[3] >= LAYOUT_COUNT || header[4] < 0 || header[4] > maxPoints) return false;
+    int n = header[4];
+
+    // The point count comes from the file: check it against the bytes left before allocating
+    long at = ftell(f);
+    if (at < 0 || fseek(f, 0, SEEK_END) != 0) return false;
+    long left = ftell(f) - at;
+    if (fseek(f, at, SEEK_SET) != 0) return false;
+    size_t need = sizeof(mean) + sizeof(invStd) + sizeof(basis) + sizeof(outCenter) + sizeof(outScale) +
+                  (size_t)n * (FEATURE_DIM + 2) * sizeof(float);
+    if (left < 0 || (size_t)left < need) return false;
+    refFeat.resize((size_t)n * FEATURE_DIM);
+    refPos.resize((size_t)n * 2);
+    bool ok = fread(mean, sizeof(mean), 1, f) == 1 && fread(invStd, sizeof(invStd), 1, f) == 1 &&
+              fread(basis, sizeof(basis), 1, f) == 1 && fread(outCenter, sizeof(outCenter), 1, f) == 1 &&
+              fread(&outScale, sizeof(outScale), 1, f) == 1 &&
+              fread(refFeat.data(), sizeof(float), refFeat.size(), f) == refFeat.size() &&
+              fread(refPos.data(), sizeof(float), refPos.size(), f) == refPos.size();
+    if (!ok) { refFeat.clear(); refPos.clear(); return false; }
+    method = header[3];
+    refTree.Build(refFeat.data(), n, FEATURE_DIM);
+    return true;
+}
+
+void LayoutEngine::Standardize(const float* feats, int n) {
+    refFeat.assign(feats, feats + (size_t)n * FEATURE_DIM);
+    for (int d = 0; d < FEATURE_DIM; d++) {
+        double sum = 0, sumSq = 0;
+        for (int i = 0; i < n; i++) {
+            double v = feats[(size_t)i*FEATURE_DIM + d];
+            sum += v; sumSq += v * v;
+        }
+        double m = sum / n;
+        double var = sumSq / n - m * m;
+        mean[d] = (float)m;
+        invStd[d] = (var > 1e-12) ? (float)(1.0 / sqrt(var)) : 0.0f;
+    }
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++)
+            for (int d = 0; d < FEATURE_DIM; d++) {
+                float& v = refFeat[(size_t)i*FEATURE_DIM + d];
+                v = (v - mean[d]) * invStd[d];
+            }
+    });
+}
+
+void LayoutEngine::FitPca(int n) {
+    const int D = FEATURE_DIM;
+    // Covariance sums per fixed chunk of rows, added in chunk order, so the axes come
+    // out bit for bit the same whatever the thread count and timing
+    const int chunk = 4096;
+    int chunks = (n + chunk - 1) / chunk;
+    std::vector<double> partial((size_t)chunks * D * D, 0.0);
+    ParallelRanges(chunks, numThreads, [&](int start, int end) {
+        for (int ch = start; ch < end; ch++) {
+            double* c = &partial[(size_t)ch * D * D];
+            for (int i = ch * chunk; i < n && i < (ch + 1) * chunk; i++) {
+                const float* v = &refFeat[(size_t)i*D];
+                for (int a = 0; a < D; a++)
+                    for (int b = a; b < D; b++) c[a*D + b] += (double)v[a] * v[b];
+            }
+        }
+    });
+    double cov[D][D], vec[D][D];
+    for (int a = 0; a < D; a++)
+        for (int b = 0; b < D; b++) {
+            double s = 0;
+            for (int t = 0; t < chunks; t++) s += partial[(size_t)t*D*D + (a <= b ? a*D + b : b*D + a)];
+            cov[a][b] = s / n;
+            vec[a][b] = (a == b) ? 1.0 : 0.0;
+        }
+
+    for (int sweep = 0; sweep < 50; sweep++) {
+        double off = 0;
+        for (int a = 0; a < D; a++) for (int b = a + 1; b < D; b++) off += cov[a][b] * cov[a][b];
+        if (off < 1e-18) break;
+        for (int p = 0; p < D; p++) {
+            for (int q = p + 1; q < D; q++) {
+                if (fabs(cov[p][q]) < 1e-15) continue;
+                double th = 0.5 * atan2(2.0 * cov[p][q], cov[q][q] - cov[p][p]);
+                double c = cos(th), s = sin(th);
+                for (int r = 0; r < D; r++) {
+                    double rp = cov[r][p], rq = cov[r][q];
+                    cov[r][p] = c * rp - s * rq; cov[r][q] = s * rp + c * rq;
+                }
+                for (int r = 0; r < D; r++) {
+                    double pr = cov[p][r], qr = cov[q][r];
+                    cov[p][r] = c * pr - s * qr; cov[q][r] = s * pr + c * qr;
+                }
+                for (int r = 0; r < D; r++) {
+                    double rp = vec[r][p], rq = vec[r][q];
+                    vec[r][p] = c * rp - s * rq; vec[r][q] = s * rp + c * rq;
+                }
+            }
+        }
+    }
+
+    int order[D];
+    for (int a = 0; a < D; a++) order[a] = a;
+    std::sort(order, order + D, [&](int a, int b) { return cov[a][a] > cov[b][b]; });
+    for (int e = 0; e < 2; e++) {
+        int col = order[e];
+        // Deterministic sign: largest component positive
+        int big = 0;
+        for (int r = 1; r < D; r++) if (fabs(vec[r][col]) > fabs(vec[big][col])) big = r;
+        double sign = (vec[big][col] < 0) ? -1.0 : 1.0;
+        for (int r = 0; r < D; r++) basis[e][r] = (float)(vec[r][col] * sign);
+    }
+}
+
+void LayoutEngine::ProjectPca(const float* z, int n, float* out) const {
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            float px = 0, py = 0;
+            for (int d = 0; d < FEATURE_DIM; d++) {
+                px += z[(size_t)i*FEATURE_DIM + d] * basis[0][d];
+                py += z[(size_t)i*FEATURE_DIM + d] * basis[1][d];
+            }
+            out[i*2] = px; out[i*2+1] = py;
+        }
+    });
+}
+
+void LayoutEngine::Normalize(std::vector<float>& y, int n) {
+    double mx = 0, my = 0;
+    for (int i = 0; i < n; i++) { mx += y[i*2]; my += y[i*2+1]; }
+    mx /= n; my /= n;
+    double var = 0;
+    for (int i = 0; i < n; i++) {
+        double dx = y[i*2] - mx, dy = y[i*2+1] - my;
+        var += dx * dx + dy * dy;
+    }
+    double sd = sqrt(var / (2.0 * n));
+    outScale = (sd > 1e-12) ? (float)(1.0 / sd) : 1.0f;
+    if (method == LAYOUT_PCA) { outCenter[0] = (float)mx; outCenter[1] = (float)my; }
+    for (int i = 0; i < n; i++) {
+        y[i*2] = (float)((y[i*2] - mx) * outScale);
+        y[i*2+1] = (float)((y[i*2+1] - my) * outScale);
+    }
+}
+
+void LayoutEngine::RunTsne(int n, std::vector<float>& y) {
+    int k = (int)(3.0f * perplexity);
+    if (k > n - 1) k = n - 1;
+    std::vector<int> nIdx; std::vector<float> nDist;
+    BuildKnnGraph(refFeat.data(), n, FEATURE_DIM, k, numThreads, nIdx, nDist);
+
+    // Conditional probabilities, binary search on the Gaussian precision
+    std::vector<float> cond((size_t)n * k);
+    float targetH = logf(perplexity < k ? perplexity : (float)k);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            const float* d = &nDist[(size_t)i*k];
+            float* p = &cond[(size_t)i*k];
+            double beta = 1.0, lo = 0.0, hi = DBL_MAX;
+            for (int iter = 0; iter < 100; iter++) {
+                double sum = 0, sumDP = 0;
+                for (int j = 0; j < k; j++) {
+                    double pj = exp(-beta * (d[j] - d[0]));
+                    p[j] = (float)pj; sum += pj; sumDP += d[j] * pj;
+                }
+                double h = log(sum) + beta * (sumDP / sum - d[0]);
+                for (int j = 0; j < k; j++) p[j] = (float)(p[j] / sum);
+                if (fabs(h - targetH) < 1e-5) break;
+                if (h > targetH) { lo = beta; beta = (hi == DBL_MAX) ? beta * 2.0 : (beta + hi) * 0.5; }
+                else { hi = beta; beta = (beta + lo) * 0.5; }
+            }
+        }
+    });
+
+    SparseGraph P;
+    SymmetrizeKnn(n, k, nIdx, cond, false, P);
+    float norm = 1.0f / (2.0f * n);
+    for (auto& v : P.val) v *= norm;
+
+    // Initialise from PCA with a small spread
+    double var = 0;
+    for (int i = 0; i < n * 2; i++) var += y[i] * y[i];
+    float initScale = (var > 0) ? (float)(1e-4 / sqrt(var / (2.0 * n))) : 1.0f;
+    for (int i = 0; i < n * 2; i++) y[i] *= initScale;
+
+    std::vector<float> grad((size_t)n * 2), vel((size_t)n * 2, 0.0f), gains((size_t)n * 2, 1.0f);
+    std::vector<float> rep((size_t)n * 2), sumQ(n);
+    float eta = (n / 12.0f > 200.0f) ? n / 12.0f : 200.0f;
+    int exaggerationIters = tsneIterations / 3;
+    QuadTree tree;
+
+    for (int iter = 0; iter < tsneIterations; iter++) {
+        float exag = (iter < exaggerationIters) ? 12.0f : 1.0f;
+        float momentum = (iter < exaggerationIters) ? 0.5f : 0.8f;
+
+        tree.Build(y.data(), n);
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) {
+                float fx, fy;
+                sumQ[i] = tree.Repulse(i, y[i*2], y[i*2+1], 0.5f, &fx, &fy);
+                rep[i*2] = fx; rep[i*2+1] = fy;
+            }
+        });
+        double Z = 0;
+        for (int i = 0; i < n; i++) Z += sumQ[i];
+        float invZ = (Z > 0) ? (float)(1.0 / Z) : 0.0f;
+
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) {
+                float ax = 0, ay = 0;
+                float xi = y[i*2], yi = y[i*2+1];
+                for (int e = P.rowStart[i]; e < P.rowStart[i + 1]; e++) {
+                    int j = P.col[e];
+                    float dx = xi - y[j*2], dy = yi - y[j*2+1];
+                    float m = P.val[e] * exag / (1.0f + dx * dx + dy * dy);
+                    ax += m * dx; ay += m * dy;
+                }
+                grad[i*2] = 4.0f * (ax - rep[i*2] * invZ);
+                grad[i*2+1] = 4.0f * (ay - rep[i*2+1] * invZ);
+            }
+        });
+
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int t = start * 2; t < end * 2; t++) {
+                bool sameSign = (grad[t] > 0) == (vel[t] > 0);
+                gains[t] = sameSign ? gains[t] * 0.8f : gains[t] + 0.2f;
+                if (gains[t] < 0.01f) gains[t] = 0.01f;
+                vel[t] = momentum * vel[t] - eta * gains[t] * grad[t];
+                y[t] += vel[t];
+            }
+        });
+
+        double cx = 0, cy = 0;
+        for (int i = 0; i < n; i++) { cx += y[i*2]; cy += y[i*2+1]; }
+        cx /= n; cy /= n;
+        for (int i = 0; i < n; i++) { y[i*2] -= (float)cx; y[i*2+1] -= (float)cy; }
+    }
+}
+
+void LayoutEngine::RunUmap(int n, std::vector<float>& y) {
+    int k = umapNeighbors;
+    if (k > n - 1) k = n - 1;
+    std::vector<int> nIdx; std::vector<float> nDist;
+    BuildKnnGraph(refFeat.data(), n, FEATURE_DIM, k, numThreads, nIdx, nDist);
+
+    // Fuzzy simplicial memberships (rho = nearest distance, sigma for log2(k) mass)
+    std::vector<float> memb((size_t)n * k);
+    float target = log2f((float)k);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            float* d = &nDist[(size_t)i*k];
+            for (int j = 0; j < k; j++) d[j] = sqrtf(d[j]);
+            float rho = 0.0f;
+            for (int j = 0; j < k; j++) if (d[j] > 0.0f) { rho = d[j]; break; }
+            float lo = 0.0f, hi = FLT_MAX, sigma = 1.0f;
+            for (int iter = 0; iter < 64; iter++) {
+                float sum = 0;
+                for (int j = 0; j < k; j++) {
+                    float t = d[j] - rho;
+                    sum += (t > 0) ? expf(-t / sigma) : 1.0f;
+                }
+                if (fabsf(sum - target) < 1e-5f) break;
+                if (sum > target) { hi = sigma; sigma = (lo + hi) * 0.5f; }
+                else { lo = sigma; sigma = (hi == FLT_MAX) ? sigma * 2.0f : (lo + hi) * 0.5f; }
+            }
+            for (int j = 0; j < k; j++) {
+                float t = d[j] - rho;
+                memb[(size_t)i*k + j] = (t > 0) ? expf(-t / sigma) : 1.0f;
+            }
+        }
+    });
+
+    SparseGraph G;
+    SymmetrizeKnn(n, k, nIdx, memb, true, G);
+
+    // Initial spread ~10 units, as in the reference implementation
+    float maxAbs = 0;
+    for (int i = 0; i < n * 2; i++) if (fabsf(y[i]) > maxAbs) maxAbs = fabsf(y[i]);
+    if (maxAbs > 0) for (int i = 0; i < n * 2; i++) y[i] *= 10.0f / maxAbs;
+
+    int epochs = umapEpochs > 0 ? umapEpochs : (n > 10000 ? 200 : 500);
+    float wMax = 0;
+    for (float v : G.val) if (v > wMax) wMax = v;
+    size_t numEdges = G.val.size();
+    std::vector<float> epochsPerSample(numEdges), nextEpoch(numEdges);
+    for (size_t e = 0; e < numEdges; e++) {
+        epochsPerSample[e] = (G.val[e] > 0) ? wMax / G.val[e] : FLT_MAX;
+        nextEpoch[e] = epochsPerSample[e];
+    }
+
+    const float a = 1.577f, b = 0.8951f; // min_dist = 0.1, spread = 1
+    const int negSamples = 5;
+    std::vector<float> next(y.size());
+    auto Clip = [](float v) { return v > 4.0f ? 4.0f : (v < -4.0f ? -4.0f : v); };
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        float alpha = 1.0f - (float)epoch / epochs;
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) {
+                float xi = y[i*2], yi = y[i*2+1];
+                float mx = 0, my = 0;
+                for (int e = G.rowStart[i]; e < G.rowStart[i + 1]; e++) {
+                    if (nextEpoch[e] > epoch + 1) continue;
+                    nextEpoch[e] += epochsPerSample[e];
+
+                    int j = G.col[e];
+                    float dx = xi - y[j*2], dy = yi - y[j*2+1];
+                    float d2 = dx * dx + dy * dy;
+                    if (d2 > 0) {
+                        float pw = powf(d2, b - 1.0f);
+                        float coef = (-2.0f * a * b * pw) / (a * pw * d2 + 1.0f);
+                        mx += Clip(coef * dx) * alpha; my += Clip(coef * dy) * alpha;
+                    }
+                    for (int s = 0; s < negSamples; s++) {
+                        unsigned int h = HashU32((unsigned int)e * 2654435761U ^ HashU32(epoch * 16 + s));
+                        int r = (int)(h % (unsigned int)n);
+                        if (r == i) continue;
+                        float rx = xi - y[r*2], ry = yi - y[r*2+1];
+                        float r2 = rx * rx + ry * ry;
+                        float coef = (2.0f * b) / ((0.001f + r2) * (a * powf(r2, b) + 1.0f));
+                        mx += (r2 > 0 ? Clip(coef * rx) : 4.0f) * alpha;
+                        my += (r2 > 0 ? Clip(coef * ry) : 4.0f) * alpha;
+                    }
+                }
+                next[i*2] = xi + mx; next[i*2+1] = yi + my;
+            }
+        });
+        y.swap(next);
+    }
+}
+
+void RelaxOverlaps(float* xy, const unsigned int* keys, int n, float minDist, int iterations, int numThreads) {
+    if (n < 2 || minDist <= 0.0f) return;
+    std::vector<float> next((size_t)n * 2);
+    std::vector<int> cellStart, cellOf(n), order(n);
+    float minD2 = minDist * minDist;
+
+    for (int iter = 0; iter < iterations; iter++) {
+        float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+        for (int i = 0; i < n; i++) {
+            if (xy[i*2] < x0) x0 = xy[i*2];
+            if (xy[i*2] > x1) x1 = xy[i*2];
+            if (xy[i*2+1] < y0) y0 = xy[i*2+1];
+            if (xy[i*2+1] > y1) y1 = xy[i*2+1];
+        }
+        // Grow cells if the grid would be much larger than the point count
+        float cell = minDist;
+        while ((double)((x1 - x0) / cell + 1) * ((y1 - y0) / cell + 1) > 4.0 * n + 64) cell *= 2.0f;
+        int gw = (int)((x1 - x0) / cell) + 1, gh = (int)((y1 - y0) / cell) + 1;
+        float inv = 1.0f / cell;
+
+        // Counting sort by cell; ascending index within a cell keeps the order stable
+        cellStart.assign((size_t)gw * gh + 1, 0);
+        for (int i = 0; i < n; i++) {
+            int cx = (int)((xy[i*2] - x0) * inv), cy = (int)((xy[i*2+1] - y0) * inv);
+            if (cx > gw - 1) cx = gw - 1;
+            if (cy > gh - 1) cy = gh - 1;
+            cellOf[i] = cy * gw + cx;
+            cellStart[cellOf[i] + 1]++;
+        }
+        for (int c = 0; c < gw * gh; c++) cellStart[c + 1] += cellStart[c];
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < n; i++) order[fill[cellOf[i]]++] = i;
+
+        std::vector<int> moved(n, 0);
+        ParallelRanges(n, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) {
+                float xi = xy[i*2], yi = xy[i*2+1];
+                int cx = cellOf[i] % gw, cy = cellOf[i] / gw;
+                int gx0 = (cx > 0) ? cx - 1 : 0, gx1 = (cx < gw - 1) ? cx + 1 : gw - 1;
+                int gy0 = (cy > 0) ? cy - 1 : 0, gy1 = (cy < gh - 1) ? cy + 1 : gh - 1;
+                float dx = 0, dy = 0;
+                for (int gy = gy0; gy <= gy1; gy++) {
+                    for (int gx = gx0; gx <= gx1; gx++) {
+                        int c = gy * gw + gx;
+                        for (int o = cellStart[c]; o < cellStart[c + 1]; o++) {
+                            int j = order[o];
+                            if (j == i) continue;
+                            float rx = xi - xy[j*2], ry = yi - xy[j*2+1];
+                            float d2 = rx * rx + ry * ry;
+                            if (d2 >= minD2) continue;
+                            float d = sqrtf(d2);
+                            if (d < minDist * 1e-3f) {
+                                // Coincident: the pair shares an angle, the lower key takes the opposite side
+                                unsigned int ka = keys[i], kb = keys[j];
+                                bool flip = (ka != kb) ? (ka < kb) : (i < j);
+                                unsigned int lo = (ka < kb) ? ka : kb, hi = (ka < kb) ? kb : ka;
+                                unsigned int h = HashU32(lo * 2654435761U ^ hi);
+                                float a = (float)(h & 0xFFFF) * (6.2831853f / 65536.0f);
+                                rx = cosf(a); ry = sinf(a);
+                                if (flip) { rx = -rx; ry = -ry; }
+                                d = 0.0f;
+                            } else {
+                                rx /= d; ry /= d;
+                            }
+                            float push = (minDist - d) * 0.5f;
+                            dx += rx * push; dy += ry * push;
+                        }
+                    }
+                }
+                // Damped so crowded points do not overshoot
+                float len = sqrtf(dx * dx + dy * dy);
+                if (len > minDist) { dx *= minDist / len; dy *= minDist / len; }
+                next[i*2] = xi + dx * 0.5f; next[i*2+1] = yi + dy * 0.5f;
+                moved[i] = len > minDist * 0.01f;
+            }
+        });
+        memcpy(xy, next.data(), sizeof(float) * 2 * n);
+        bool any = false;
+        for (int i = 0; i < n && !any; i++) any = moved[i] != 0;
+        if (!any) break;
+    }
+}
+
+MapBounds ComputeMapBounds(const float* xy, const float* rms, int n) {
+    // Phase 1: Determine noise floor from max volume
+    float maxRms = 0.0f;
+    for (int i = 0; i < n; i++) {
+        if (rms[i] > maxRms) maxRms = rms[i];
+    }
+    
+    // Ignore samples below 10% of peak volume (silence/outliers)
+    // unless the peak is too low (all files are silent)
+    float threshold = (maxRms > 0.5f) ? maxRms * 0.1f : -1.0f;
+
+    MapBounds b = { FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX };
+    int validCount = 0;
+    for (int i = 0; i < n; i++) {
+        // Skip silence to prevent empty space in minimap/viewport
+        if (rms[i] < threshold) continue;
+
+        if (xy[i*2] < b.minX) b.minX = xy[i*2]; 
+        if (xy[i*2] > b.maxX) b.maxX = xy[i*2];
+        if (xy[i*2+1] < b.minY) b.minY = xy[i*2+1]; 
+        if (xy[i*2+1] > b.maxY) b.maxY = xy[i*2+1];
+        validCount++;
+    }
+    
+    // Fallback if filtering removed everything
+    if (validCount == 0) {
+        b.minX = 0; b.maxX = 1; b.minY = 0; b.maxY = 1; // Default safety
+        for (int i = 0; i < n; i++) {
+             if (xy[i*2] < b.minX) b.minX = xy[i*2]; 
+             if (xy[i*2] > b.maxX) b.maxX = xy[i*2];
+             if (xy[i*2+1] < b.minY) b.minY = xy[i*2+1]; 
+             if (xy[i*2+1] > b.maxY) b.maxY = xy[i*2+1];
+        }
+    }
+    
+    // 10% padding for comfortable panning
+    float rangeX = b.maxX - b.minX;
+    float rangeY = b.maxY - b.minY;
+    if (rangeX < 0.1f) rangeX = 0.1f;
+    if (rangeY < 0.1f) rangeY = 0.1f;
+    
+    b.minX -= rangeX * 0.1f;
+    b.maxX += rangeX * 0.1f;
+    b.minY -= rangeY * 0.1f;
+    b.maxY += rangeY * 0.1f;
+    return b;
+}
+
+void SortIndicesByKey(const unsigned int* keys, int n, int* order) {
+    for (int i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order, order + n, [keys](int a, int b) { return keys[a] < keys[b]; });
+}
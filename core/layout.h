@@ -0,0 +1,75 @@
+// 2D map layouts of feature vectors (axes, PCA, t-SNE, UMAP) and map geometry helpers
+#pragma once
+
+#include "features.h"
+#include "kdtree.h"
+
+#include <stdio.h>
+#include <vector>
+
+enum LayoutMethod { LAYOUT_AXES, LAYOUT_PCA, LAYOUT_TSNE, LAYOUT_UMAP, LAYOUT_COUNT };
+
+const char* LayoutName(int method);
+
+// Projects feature vectors to 2D. Keeps the fitted model so new points can be
+// placed against an existing layout without re-running the optimisation.
+class LayoutEngine {
+public:
+    int method = LAYOUT_PCA;
+    int numThreads = 0;          // 0 = hardware concurrency
+    float perplexity = 30.0f;    // t-SNE
+    int tsneIterations = 500;
+    int umapNeighbors = 15;
+    int umapEpochs = 0;          // 0 = pick from n
+
+    // Fit a fresh layout for n points; outXY receives n (x, y) pairs with unit spread
+    void Fit(const float* feats, int n, float* outXY);
+
+    // Place n new points against the fitted layout; they become part of the reference set
+    void Place(const float* feats, int n, float* outXY);
+
+    int FittedCount() const { return (int)(refPos.size() / 2); }
+
+    // Persist the fitted model (method, standardization, PCA axes, reference points) so
+    // Place works after a restart without fitting again. Load fails on a model written
+    // for another feature layout, or one claiming more than maxPoints points or more
+    // data than the file holds, and leaves the engine unfitted.
+    bool Save(FILE* f) const;
+    bool Load(FILE* f, int maxPoints);
+
+private:
+    float mean[FEATURE_DIM], invStd[FEATURE_DIM];
+    float basis[2][FEATURE_DIM];
+    float outCenter[2], outScale;
+    std::vector<float> refFeat, refPos;  // Standardized features / layout of fitted points
+    KdTree refTree;
+
+    void Standardize(const float* feats, int n);
+
+    // Top two principal axes via Jacobi eigen-decomposition of the covariance matrix
+    void FitPca(int n);
+    void ProjectPca(const float* z, int n, float* out) const;
+
+    // Center and scale to unit RMS radius per axis (aspect preserved)
+    void Normalize(std::vector<float>& y, int n);
+
+    // Barnes-Hut t-SNE (van der Maaten 2014) on a sparse perplexity-calibrated kNN graph
+    void RunTsne(int n, std::vector<float>& y);
+
+    // UMAP-style layout: fuzzy kNN graph + deterministic epoch-synchronous SGD
+    void RunUmap(int n, std::vector<float>& y);
+};
+
+// Deterministic de-overlap: pushes apart points closer than minDist using a uniform
+// grid with cell size >= minDist. Each pass reads only the previous positions
+// (Jacobi), so the result does not depend on thread count or scheduling; coincident
+// points are split along a direction derived from their keys.
+void RelaxOverlaps(float* xy, const unsigned int* keys, int n, float minDist, int iterations, int numThreads);
+
+// World-space extent of the map. Points quieter than 10% of the loudest rms are
+// ignored (unless that leaves nothing) and 10% padding is added on every side.
+struct MapBounds { float minX, maxX, minY, maxY; };
+MapBounds ComputeMapBounds(const float* xy, const float* rms, int n);
+
+// order[] = indices 0..n-1 sorted by ascending key (ties keep index order)
+void SortIndicesByKey(const unsigned int* keys, int n, int* order);
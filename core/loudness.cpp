@@ -0,0 +1,293 @@
+#include "loudness.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOUDNESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Filter constants from BS.1770-4 at 48 kHz, re-derived for other rates (as libebur128)
+KWeighting::KWeighting(int rate) {
+    const double pi = 3.14159265358979323846;
+    double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+    double k = tan(pi * f0 / rate);
+    double vh = pow(10.0, gain / 20.0), vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    b[0][0] = (float)((vh + vb * k / q + k * k) / a0);
+    b[0][1] = (float)(2.0 * (k * k - vh) / a0);
+    b[0][2] = (float)((vh - vb * k / q + k * k) / a0);
+    a[0][0] = (float)(2.0 * (k * k - 1.0) / a0);
+    a[0][1] = (float)((1.0 - k / q + k * k) / a0);
+
+    f0 = 38.13547087602444; q = 0.5003270373238773;
+    k = tan(pi * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+    b[1][0] = 1.0f; b[1][1] = -2.0f; b[1][2] = 1.0f;
+    a[1][0] = (float)(2.0 * (k * k - 1.0) / a0);
+    a[1][1] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+// Transposed direct form II, in the same operation order as the vector lanes
+static inline float Biquad(const float* b, const float* a, float x, float* z1, float* z2) {
+    float y = b[0] * x + *z1;
+    *z1 = b[1] * x - a[0] * y + *z2;
+    *z2 = b[2] * x - a[1] * y;
+    return y;
+}
+
+void KWeightEnergyScalar(const KWeighting& k, KWeightState* st, const float* left, const float* right, int n, float sumSq[2]) {
+    const float* in[2] = { left, right };
+    sumSq[1] = 0;
+    for (int c = 0; c < (right ? 2 : 1); c++) {
+        float sum = 0;
+        for (int i = 0; i < n; i++) {
+            float y = Biquad(k.b[0], k.a[0], in[c][i], &st->z1[c], &st->z2[c]);
+            y = Biquad(k.b[1], k.a[1], y, &st->z1[2 + c], &st->z2[2 + c]);
+            sum += y * y;
+        }
+        sumSq[c] = sum;
+    }
+}
+
+// Polyphase taps at quarter-sample offsets 1..3 (row 0 unused): Lanczos-6 windowed
+// sinc over the 12 samples around the point, each row normalised to unit DC gain
+struct PeakTaps {
+    float h[4][12];
+    PeakTaps() {
+        const double pi = 3.14159265358979323846;
+        memset(h, 0, sizeof(h));
+        for (int q = 1; q < 4; q++) {
+            double sum = 0;
+            for (int m = 0; m < 12; m++) {
+                double t = q / 4.0 - (m - 5), pt = pi * t;
+                h[q][m] = (float)(sin(pt) / pt * sin(pt / 6.0) / (pt / 6.0));
+                sum += h[q][m];
+            }
+            for (int m = 0; m < 12; m++) h[q][m] = (float)(h[q][m] / sum);
+        }
+    }
+};
+
+static const PeakTaps& Taps() {
+    static const PeakTaps taps;
+    return taps;
+}
+
+static float PeakRange(const float* x, int start, int n, int factor, float peak) {
+    const PeakTaps& taps = Taps();
+    int step = 4 / factor;
+    for (int j = start; j < n; j++) {
+        float v = fabsf(x[j]);
+        if (v > peak) peak = v;
+        for (int q = step; q < 4; q += step) {
+            const float* h = taps.h[q];
+            const float* s = x + j - 5;
+            float acc = 0;
+            for (int m = 0; m < 12; m++) acc = acc + h[m] * s[m];
+            v = fabsf(acc);
+            if (v > peak) peak = v;
+        }
+    }
+    return peak;
+}
+
+float OversampledPeakScalar(const float* x, int n, int factor) {
+    if (factor != 2 && factor != 4) factor = 1;
+    return PeakRange(x, 0, n, factor, 0.0f);
+}
+
+#ifdef LOUDNESS_SSE2
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+void KWeightEnergy(const KWeighting& k, KWeightState* st, const float* left, const float* right, int n, float sumSq[2]) {
+    sumSq[0] = sumSq[1] = 0;
+    if (n <= 0) return;
+    if (!right) right = left;
+    // Flush denormals: silent tails would otherwise decay through them very slowly
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040);
+
+    // Lanes: left and right through the shelf, then left and right through the high-pass
+    const __m128 b0 = _mm_setr_ps(k.b[0][0], k.b[0][0], k.b[1][0], k.b[1][0]);
+    const __m128 b1 = _mm_setr_ps(k.b[0][1], k.b[0][1], k.b[1][1], k.b[1][1]);
+    const __m128 b2 = _mm_setr_ps(k.b[0][2], k.b[0][2], k.b[1][2], k.b[1][2]);
+    const __m128 a1 = _mm_setr_ps(k.a[0][0], k.a[0][0], k.a[1][0], k.a[1][0]);
+    const __m128 a2 = _mm_setr_ps(k.a[0][1], k.a[0][1], k.a[1][1], k.a[1][1]);
+    const __m128 shelfLanes = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, 0, 0));
+    __m128 z1 = _mm_loadu_ps(st->z1), z2 = _mm_loadu_ps(st->z2), acc = _mm_setzero_ps();
+    auto Step = [&](__m128 x) {
+        __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+        z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+        z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+        return y;
+    };
+    auto Frame = [&](int i) { return _mm_unpacklo_ps(_mm_load_ss(left + i), _mm_load_ss(right + i)); };
+
+    // The shelf alone takes frame 0; the high-pass keeps its state
+    __m128 keep1 = z1, keep2 = z2;
+    __m128 y = Step(Frame(0));
+    z1 = Select(shelfLanes, z1, keep1); z2 = Select(shelfLanes, z2, keep2);
+    for (int i = 1; i < n; i++) {
+        y = Step(_mm_movelh_ps(Frame(i), y));
+        acc = _mm_add_ps(acc, _mm_mul_ps(y, y));
+    }
+    // The high-pass alone takes the last frame
+    keep1 = z1; keep2 = z2;
+    y = Step(_mm_movelh_ps(_mm_setzero_ps(), y));
+    z1 = Select(shelfLanes, keep1, z1); z2 = Select(shelfLanes, keep2, z2);
+    acc = _mm_add_ps(acc, _mm_mul_ps(y, y));
+
+    _mm_storeu_ps(st->z1, z1);
+    _mm_storeu_ps(st->z2, z2);
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sumSq[0] = lanes[2];
+    sumSq[1] = right != left ? lanes[3] : 0;
+    _mm_setcsr(csr);
+}
+
+// Four neighbouring samples per vector; each lane sums its taps in the scalar order
+float OversampledPeak(const float* x, int n, int factor) {
+    if (factor != 2 && factor != 4) factor = 1;
+    const PeakTaps& taps = Taps();
+    int step = 4 / factor, j = 0;
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    for (; j + 4 <= n; j += 4) {
+        peak = _mm_max_ps(peak, _mm_and_ps(absMask, _mm_loadu_ps(x + j)));
+        for (int q = step; q < 4; q += step) {
+            const float* h = taps.h[q];
+            const float* s = x + j - 5;
+            __m128 acc = _mm_setzero_ps();
+            for (int m = 0; m < 12; m++) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(h[m]), _mm_loadu_ps(s + m)));
+            peak = _mm_max_ps(peak, _mm_and_ps(absMask, acc));
+        }
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, peak);
+    float best = lanes[0];
+    for (int i = 1; i < 4; i++) if (lanes[i] > best) best = lanes[i];
+    return PeakRange(x, j, n, factor, best);
+}
+#else
+void KWeightEnergy(const KWeighting& k, KWeightState* st, const float* left, const float* right, int n, float sumSq[2]) {
+    KWeightEnergyScalar(k, st, left, right, n, sumSq);
+}
+
+float OversampledPeak(const float* x, int n, int factor) {
+    return OversampledPeakScalar(x, n, factor);
+}
+#endif
+
+static inline float Sample(short v) { return v * (1.0f / 32768.0f); }
+static inline float Sample(float v) { return v; }
+
+static float ChannelWeight(int c, int ch) {
+    if (ch == 6) return c == 3 ? 0.0f : (c >= 4 ? 1.41f : 1.0f);
+    return 1.0f;
+}
+
+static float Lufs(double meanSq) {
+    float l = meanSq > 0 ? (float)(-0.691 + 10.0 * log10(meanSq)) : LOUDNESS_FLOOR;
+    return l > LOUDNESS_FLOOR ? l : LOUDNESS_FLOOR;
+}
+
+// Works through the file in 100 ms steps: each channel is converted once, K-weighted in
+// pairs and scanned for peaks, which trail TRUE_PEAK_PAD samples behind so every
+// interpolated point sees the samples after it
+template <typename T>
+static bool Measure(const T* raw, int numSamples, int rate, int ch, Loudness* out) {
+    if (!raw || numSamples <= 0 || rate <= 0) return false;
+    if (ch < 1) ch = 1;
+    int frames = numSamples / ch;
+    if (frames <= 0) return false;
+    int block = rate / 10 > 0 ? rate / 10 : 1;
+    int factor = rate < 96000 ? 4 : (rate < 192000 ? 2 : 1);
+    const int pad = TRUE_PEAK_PAD;
+    bool weighted = rate >= LOUDNESS_MIN_RATE;      // Lower, the filters would be past Nyquist
+    KWeighting k(weighted ? rate : LOUDNESS_MIN_RATE);
+    std::vector<KWeightState> state((ch + 1) / 2);
+    int stride = block + 3 * pad;                   // Per channel: 2 * pad of history, then the step
+    std::vector<float> buf((size_t)ch * stride, 0.0f);
+    std::vector<double> steps;                      // Weighted mean square per complete step
+    steps.reserve(frames / block + 1);
+    double total = 0;
+    float peak = 0;
+    for (int start = 0; start < frames; start += block) {
+        int len = frames - start < block ? frames - start : block;
+        for (int c = 0; c < ch; c++) {
+            float* x = &buf[(size_t)c * stride + 2 * pad];
+            const T* src = raw + (size_t)start * ch + c;
+            for (int i = 0; i < len; i++) x[i] = Sample(src[(size_t)i * ch]);
+        }
+        double energy = 0;
+        for (int c = 0; c < ch && weighted; c += 2) {
+            const float* l = &buf[(size_t)c * stride + 2 * pad];
+            const float* r = c + 1 < ch ? l + stride : NULL;
+            float sq[2];
+            KWeightEnergy(k, &state[c / 2], l, r, len, sq);
+            energy += ChannelWeight(c, ch) * sq[0] + (r ? ChannelWeight(c + 1, ch) * sq[1] : 0.0f);
+        }
+        total += energy;
+        if (len == block) steps.push_back(energy / block);
+        for (int c = 0; c < ch; c++) {
+            float* h = &buf[(size_t)c * stride];
+            float v = OversampledPeak(h + pad, len, factor);
+            if (v > peak) peak = v;
+            memmove(h, h + len, 2 * pad * sizeof(float));
+        }
+    }
+    // The last samples, with silence after them
+    for (int c = 0; c < ch; c++) {
+        float* h = &buf[(size_t)c * stride];
+        memset(h + 2 * pad, 0, pad * sizeof(float));
+        float v = OversampledPeak(h + pad, pad, factor);
+        if (v > peak) peak = v;
+    }
+
+    // 400 ms blocks are four consecutive steps; gate at -70 LUFS, then 10 LU below
+    // the mean of what passed
+    int numSteps = (int)steps.size();
+    std::vector<double> blocks;
+    for (int i = 0; i + 4 <= numSteps; i++) blocks.push_back((steps[i] + steps[i + 1] + steps[i + 2] + steps[i + 3]) * 0.25);
+    if (blocks.empty()) blocks.push_back(total / frames);
+    double absGate = pow(10.0, (LOUDNESS_FLOOR + 0.691) / 10.0), sum = 0, integrated = 0;
+    int kept = 0;
+    for (double z : blocks) if (z > absGate) { sum += z; kept++; }
+    if (kept) {
+        double relGate = sum / kept * 0.1;
+        sum = 0; kept = 0;
+        for (double z : blocks) if (z > absGate && z > relGate) { sum += z; kept++; }
+        integrated = sum / kept;
+    }
+
+    double shortMax = 0;
+    if (numSteps < 30) shortMax = total / frames;
+    else {
+        double window = 0;
+        for (int i = 0; i < numSteps; i++) {
+            window += steps[i];
+            if (i >= 30) window -= steps[i - 30];
+            if (i >= 29 && window / 30 > shortMax) shortMax = window / 30;
+        }
+    }
+
+    out->integrated = Lufs(integrated);
+    out->shortTermMax = Lufs(shortMax);
+    out->truePeak = peak > 0 ? 20.0f * log10f(peak) : TRUE_PEAK_FLOOR;
+    if (out->truePeak < TRUE_PEAK_FLOOR) out->truePeak = TRUE_PEAK_FLOOR;
+    return true;
+}
+
+bool MeasureLoudness(const short* rawData, int numSamples, int rate, int ch, Loudness* out) {
+    return Measure(rawData, numSamples, rate, ch, out);
+}
+
+bool MeasureLoudness(const float* rawData, int numSamples, int rate, int ch, Loudness* out) {
+    return Measure(rawData, numSamples, rate, ch, out);
+}
@@ -0,0 +1,46 @@
+// Loudness and true peak per ITU-R BS.1770-4 / EBU R128
+#pragma once
+
+#define LOUDNESS_FLOOR (-70.0f)     // LUFS when nothing passes the absolute gate
+#define TRUE_PEAK_FLOOR (-120.0f)   // dBTP of digital silence
+#define TRUE_PEAK_PAD 6             // Samples OversampledPeak reads on either side
+#define LOUDNESS_MIN_RATE 3400      // Lowest rate K-weighting works at (its shelf is at 1682 Hz)
+
+struct Loudness {
+    float integrated;       // LUFS over 400 ms blocks (75% overlap), absolute and relative gates
+    float shortTermMax;     // LUFS of the loudest 3 s window (100 ms steps)
+    float truePeak;         // dBTP, 4x oversampled below 96 kHz, 2x below 192 kHz
+};
+
+// Measures interleaved PCM (numSamples counts all channels; 16-bit or float in [-1, 1]).
+// Channels weigh 1 except in 5.1 (WAV order): the LFE is skipped and the surrounds
+// weigh 1.41. Files shorter than one block are measured as one block, and files
+// shorter than 3 s as one short-term window. Below LOUDNESS_MIN_RATE loudness reads
+// LOUDNESS_FLOOR, as for silence; the true peak is still measured.
+bool MeasureLoudness(const short* rawData, int numSamples, int rate, int ch, Loudness* out);
+bool MeasureLoudness(const float* rawData, int numSamples, int rate, int ch, Loudness* out);
+
+// K-weighting for one sample rate: the high-shelf pre-filter, then the RLB high-pass
+struct KWeighting {
+    float b[2][3], a[2][2];     // Per stage, a0 normalised to 1
+    explicit KWeighting(int rate);
+};
+
+// Biquad state of a channel pair, lane stage * 2 + channel
+struct KWeightState {
+    float z1[4] = {}, z2[4] = {};
+};
+
+// Sums of squares of n K-weighted samples of two channels (right may be NULL for one),
+// continuing from st. Uses SSE2 where the target has it: both channels and both stages
+// run as the four lanes of one vector, the second stage a sample behind the first.
+void KWeightEnergy(const KWeighting& k, KWeightState* st, const float* left, const float* right, int n, float sumSq[2]);
+
+// One sample and stage at a time; same results (reference for tests and non-SSE2 targets)
+void KWeightEnergyScalar(const KWeighting& k, KWeightState* st, const float* left, const float* right, int n, float sumSq[2]);
+
+// Largest magnitude of x[0..n) and of the signal between those samples, interpolated at
+// factor - 1 points each (windowed-sinc polyphase, 12 taps per phase). Reads
+// TRUE_PEAK_PAD samples before x[0] and after x[n - 1]. Uses SSE2 where available.
+float OversampledPeak(const float* x, int n, int factor);
+float OversampledPeakScalar(const float* x, int n, int factor);
@@ -0,0 +1,137 @@
+#include "metadata.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <bitset>
+
+void MetadataIndex::Build(const float* values, int count, int columns) {
+    // Remember the active filters to re-apply them to the new values
+    std::vector<Column> old;
+    if ((int)cols.size() == columns) old.swap(cols);
+    cols.assign(columns, Column());
+    n = count > 0 ? count : 0;
+    size_t words = ((size_t)n + 63) / 64;
+
+    ParallelRanges(columns, numThreads, [&](int start, int end) {
+        for (int ci = start; ci < end; ci++) BuildColumn(cols[ci], values + (size_t)ci * n);
+    });
+    combined.assign(words, 0);
+    activeCount = 0;
+    Combine();
+    for (int ci = 0; ci < (int)old.size(); ci++)
+        if (old[ci].active) SetRange(ci, old[ci].lo, old[ci].hi);
+}
+
+void MetadataIndex::BuildColumn(Column& c, const float* v) {
+    // Sorting (value, sample) pairs keeps the comparisons in cache; NaN sorts last
+    c.values.assign(v, v + n);
+    std::vector<std::pair<float, int>> pairs(n);
+    for (int i = 0; i < n; i++) pairs[i] = { v[i], i };
+    std::sort(pairs.begin(), pairs.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        bool na = a.first != a.first, nb = b.first != b.first;
+        if (na != nb) return nb;
+        if (na) return a.second < b.second;
+        return a.first < b.first || (a.first == b.first && a.second < b.second);
+    });
+    c.order.resize(n);
+    c.sorted.resize(n);
+    c.valid = 0;
+    for (int k = 0; k < n; k++) {
+        c.order[k] = pairs[k].second;
+        c.sorted[k] = pairs[k].first;
+        if (c.sorted[k] == c.sorted[k]) c.valid++;
+    }
+    c.min = c.valid ? c.sorted[0] : 0.0f;
+    c.max = c.valid ? c.sorted[c.valid - 1] : 0.0f;
+
+    memset(c.all, 0, sizeof(c.all));
+    c.bin.assign(n, 0);
+    float span = c.max - c.min;
+    for (int i = 0; i < n; i++) {
+        int b = 0;
+        if (span > 0 && v[i] == v[i]) b = (int)((v[i] - c.min) / span * META_HIST_BINS);
+        if (b >= META_HIST_BINS) b = META_HIST_BINS - 1;
+        c.bin[i] = (unsigned char)b;
+        if (v[i] == v[i]) c.all[b]++;
+    }
+    c.bits.assign(((size_t)n + 63) / 64, 0);
+}
+
+void MetadataIndex::Flip(Column& c, int from, int to) {
+    if (from > to) std::swap(from, to);
+    for (int k = from; k < to; k++) {
+        int id = c.order[k];
+        c.bits[id >> 6] ^= 1ULL << (id & 63);
+    }
+}
+
+void MetadataIndex::SetRange(int column, float lo, float hi) {
+    Column& c = cols[column];
+    if (lo > hi) std::swap(lo, hi);
+    const float* s = c.sorted.data();
+    int first = (int)(std::lower_bound(s, s + c.valid, lo) - s);
+    int last = (int)(std::upper_bound(s, s + c.valid, hi) - s);
+    if (!c.active) { c.active = true; activeCount++; }
+    // [first, last) XOR [c.first, c.last) is [c.first, first) XOR [c.last, last)
+    Flip(c, c.first, first);
+    Flip(c, c.last, last);
+    c.first = first; c.last = last;
+    c.lo = lo; c.hi = hi;
+    Combine();
+}
+
+void MetadataIndex::ClearRange(int column) {
+    Column& c = cols[column];
+    if (!c.active) return;
+    c.active = false;                   // Its bitmap stays, so toggling back costs nothing
+    activeCount--;
+    Combine();
+}
+
+void MetadataIndex::ClearAll() {
+    for (int ci = 0; ci < (int)cols.size(); ci++)
+        cols[ci].active = false;
+    activeCount = 0;
+    Combine();
+}
+
+int MetadataIndex::Kept(int column) const {
+    const Column& c = cols[column];
+    return c.active ? c.last - c.first : n;
+}
+
+void MetadataIndex::Combine() {
+    size_t words = combined.size();
+    std::fill(combined.begin(), combined.end(), ~0ULL);
+    if (n & 63) combined[words - 1] = (1ULL << (n & 63)) - 1;
+    for (const Column& c : cols) {
+        if (!c.active) continue;
+        for (size_t w = 0; w < words; w++) combined[w] &= c.bits[w];
+    }
+    matches = 0;
+    for (size_t w = 0; w < words; w++) matches += (int)std::bitset<64>(combined[w]).count();
+}
+
+void MetadataIndex::Histogram(int column, bool matchingOnly, int* counts) const {
+    const Column& c = cols[column];
+    if (!matchingOnly || activeCount == 0) {
+        memcpy(counts, c.all, sizeof(c.all));
+        return;
+    }
+    memset(counts, 0, sizeof(int) * META_HIST_BINS);
+    for (size_t w = 0; w < combined.size(); w++) {
+        unsigned long long bits = combined[w];
+        while (bits) {
+            int id = (int)(w * 64) + (int)std::bitset<64>((bits & (0 - bits)) - 1).count();
+            bits &= bits - 1;
+            if (c.values[id] == c.values[id]) counts[c.bin[id]]++;
+        }
+    }
+}
+
+float MetadataIndex::BinLo(int column, int b) const {
+    const Column& c = cols[column];
+    return c.min + (c.max - c.min) * b / META_HIST_BINS;
+}
@@ -0,0 +1,69 @@
+// Columnar per-sample metadata with range filters
+#pragma once
+
+#include <vector>
+
+#define META_HIST_BINS 32
+
+// One float column per property (duration, rate, features, ...), each with its sample
+// order sorted by value, so a range filter is two binary searches and its result a
+// bitmap. Moving a filter's bounds flips only the samples between the old and the new
+// bounds, and filters combine as a word-wise AND, so dragging a range stays in the
+// microseconds even for very large libraries. Histograms use per-sample bins
+// precomputed over each column's [Min, Max].
+class MetadataIndex {
+public:
+    int numThreads = 0;                 // Columns build in parallel
+
+    // values: columns * n floats, column-major (column c at values + c * n). Active
+    // filters are re-applied to the new values when the column count is unchanged.
+    void Build(const float* values, int n, int columns);
+
+    int Size() const { return n; }
+    int Columns() const { return (int)cols.size(); }
+    float Min(int column) const { return cols[column].min; }
+    float Max(int column) const { return cols[column].max; }
+    float Value(int column, int id) const { return cols[column].values[id]; }
+
+    // Keep samples with lo <= value <= hi (inclusive; NaN values never match)
+    void SetRange(int column, float lo, float hi);
+    void ClearRange(int column);
+    void ClearAll();
+    bool Active(int column) const { return cols[column].active; }
+    bool AnyActive() const { return activeCount > 0; }
+    float RangeLo(int column) const { return cols[column].lo; }
+    float RangeHi(int column) const { return cols[column].hi; }
+    int Kept(int column) const;         // Samples this filter alone keeps
+
+    // Combined result of every active filter (every sample when none is active)
+    int Matches() const { return matches; }
+    bool Match(int id) const { return (combined[id >> 6] >> (id & 63)) & 1; }
+    const std::vector<unsigned long long>& Mask() const { return combined; }
+
+    // Samples per bin of the column's [Min, Max] range: all, or only the matching ones
+    void Histogram(int column, bool matchingOnly, int* counts) const;
+    // Value range of histogram bin b
+    float BinLo(int column, int b) const;
+
+private:
+    struct Column {
+        std::vector<float> values;              // By sample
+        std::vector<int> order;                 // Samples by ascending value (NaN last)
+        std::vector<float> sorted;              // values[order[k]]
+        std::vector<unsigned char> bin;         // Histogram bin by sample
+        int all[META_HIST_BINS];
+        float min = 0, max = 0;
+        int valid = 0;                          // Samples with a value (not NaN)
+        bool active = false;
+        float lo = 0, hi = 0;
+        int first = 0, last = 0;                // Kept positions [first, last) in order
+        std::vector<unsigned long long> bits;   // This filter's own result
+    };
+    std::vector<Column> cols;
+    std::vector<unsigned long long> combined;
+    int n = 0, matches = 0, activeCount = 0;
+
+    void BuildColumn(Column& c, const float* v);
+    void Flip(Column& c, int from, int to);
+    void Combine();
+};
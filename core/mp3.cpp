@@ -0,0 +1,1026 @@
+#include "mp3.h"
+
+#include <math.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Tables from ISO/IEC 11172-3 and 13818-3
+
+static const short kBitrates[2][15] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },     // MPEG-1
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } };       // MPEG-2 and 2.5
+static const int kRates[3] = { 44100, 48000, 32000 };
+
+// Scalefactor band boundaries in lines, long and short blocks
+struct Bands { short l[23], s[14]; };
+static const Bands kBands[7] = {
+    { { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576 },
+      { 0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192 } },                  // 44100
+    { { 0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576 },
+      { 0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192 } },                  // 48000
+    { { 0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576 },
+      { 0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192 } },                 // 32000
+    { { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+      { 0, 4, 8, 12, 18, 24, 32, 42, 56, 74, 100, 132, 174, 192 } },                 // 22050
+    { { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 114, 136, 162, 194, 232, 278, 332, 394, 464, 540, 576 },
+      { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 136, 180, 192 } },                 // 24000
+    { { 0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576 },
+      { 0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192 } },                 // 16000, 12000, 11025
+    { { 0, 12, 24, 36, 48, 60, 72, 88, 108, 132, 160, 192, 232, 280, 336, 400, 476, 566, 568, 570, 572, 574, 576 },
+      { 0, 8, 16, 24, 36, 52, 72, 96, 124, 160, 162, 164, 166, 192 } } };            // 8000
+
+// MPEG-1 scalefactor bit counts per scalefac_compress, and the preemphasis table
+static const unsigned char kSlen[2][16] = {
+    { 0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4 },
+    { 0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3, 2, 3 } };
+static const unsigned char kPretab[22] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0 };
+
+// MPEG-2 scalefactors per group: [scalefac_compress range][long, short, mixed][group]
+static const unsigned char kLsfCounts[6][3][4] = {
+    { { 6, 5, 5, 5 }, { 9, 9, 9, 9 }, { 6, 9, 9, 9 } },
+    { { 6, 5, 7, 3 }, { 9, 9, 12, 6 }, { 6, 9, 12, 6 } },
+    { { 11, 10, 0, 0 }, { 18, 18, 0, 0 }, { 15, 18, 0, 0 } },
+    { { 7, 7, 7, 0 }, { 12, 12, 12, 0 }, { 6, 15, 12, 0 } },
+    { { 6, 6, 6, 3 }, { 12, 9, 9, 6 }, { 6, 12, 9, 6 } },
+    { { 8, 8, 5, 0 }, { 15, 12, 9, 0 }, { 6, 18, 9, 0 } } };
+
+// Huffman codes (Annex B): tables 1-3, 5-13, 15, 16 and 24 in x * size + y order, then
+// the count1 tables A and B in vwxy order
+static const unsigned char kHuffLen[] = {
+    // table 1
+    1, 3, 2, 3,
+    // table 2
+    1, 3, 6, 3, 3, 5, 5, 5, 6,
+    // table 3
+    2, 2, 6, 3, 2, 5, 5, 5, 6,
+    // table 5
+    1, 3, 6, 7, 3, 3, 6, 7, 6, 6, 7, 8, 7, 6, 7, 8,
+    // table 6
+    3, 3, 5, 7, 3, 2, 4, 5, 4, 4, 5, 6, 6, 5, 6, 7,
+    // table 7
+    1, 3, 6, 8, 8, 9, 3, 4, 6, 7, 7, 8, 6, 5, 7, 8, 8, 9, 7, 7, 8, 9, 9, 9, 7, 7, 8, 9, 9, 10, 8, 8,
+    9, 10, 10, 10,
+    // table 8
+    2, 3, 6, 8, 8, 9, 3, 2, 4, 8, 8, 8, 6, 4, 6, 8, 8, 9, 8, 8, 8, 9, 9, 10, 8, 7, 8, 9, 10, 10, 9, 8,
+    9, 9, 11, 11,
+    // table 9
+    3, 3, 5, 6, 8, 9, 3, 3, 4, 5, 6, 8, 4, 4, 5, 6, 7, 8, 6, 5, 6, 7, 7, 8, 7, 6, 7, 7, 8, 9, 8, 7,
+    8, 8, 9, 9,
+    // table 10
+    1, 3, 6, 8, 9, 9, 9, 10, 3, 4, 6, 7, 8, 9, 8, 8, 6, 6, 7, 8, 9, 10, 9, 9, 7, 7, 8, 9, 10, 10, 9, 10,
+    8, 8, 9, 10, 10, 10, 10, 10, 9, 9, 10, 10, 11, 11, 10, 11, 8, 8, 9, 10, 10, 10, 11, 11, 9, 8, 9, 10, 10, 11, 11, 11,
+    // table 11
+    2, 3, 5, 7, 8, 9, 8, 9, 3, 3, 4, 6, 8, 8, 7, 8, 5, 5, 6, 7, 8, 9, 8, 8, 7, 6, 7, 9, 8, 10, 8, 9,
+    8, 8, 8, 9, 9, 10, 9, 10, 8, 8, 9, 10, 10, 11, 10, 11, 8, 7, 7, 8, 9, 10, 10, 10, 8, 7, 8, 9, 10, 10, 10, 10,
+    // table 12
+    4, 3, 5, 7, 8, 9, 9, 9, 3, 3, 4, 5, 7, 7, 8, 8, 5, 4, 5, 6, 7, 8, 7, 8, 6, 5, 6, 6, 7, 8, 8, 8,
+    7, 6, 7, 7, 8, 8, 8, 9, 8, 7, 8, 8, 8, 9, 8, 9, 8, 7, 7, 8, 8, 9, 9, 10, 9, 8, 8, 9, 9, 9, 9, 10,
+    // table 13
+    1, 4, 6, 7, 8, 9, 9, 10, 9, 10, 11, 11, 12, 12, 13, 13, 3, 4, 6, 7, 8, 8, 9, 9, 9, 9, 10, 10, 11, 12, 12, 12,
+    6, 6, 7, 8, 9, 9, 10, 10, 9, 10, 10, 11, 11, 12, 13, 13, 7, 7, 8, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 13,
+    8, 7, 9, 9, 10, 10, 11, 11, 10, 11, 11, 12, 12, 13, 13, 14, 9, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 11, 13, 13, 14, 14,
+    9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 12, 12, 13, 13, 14, 14, 10, 9, 10, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 14, 16, 16,
+    9, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 14, 15, 15, 10, 9, 10, 10, 11, 11, 11, 13, 12, 13, 13, 14, 14, 14, 16, 15,
+    10, 10, 10, 11, 11, 12, 12, 13, 12, 13, 14, 13, 14, 15, 16, 17, 11, 10, 10, 11, 12, 12, 12, 12, 13, 13, 13, 14, 15, 15, 15, 16,
+    11, 11, 11, 12, 12, 13, 12, 13, 14, 14, 15, 15, 15, 16, 16, 16, 12, 11, 12, 13, 13, 13, 14, 14, 14, 14, 14, 15, 16, 15, 16, 16,
+    13, 12, 12, 13, 13, 13, 15, 14, 14, 17, 15, 15, 15, 17, 16, 16, 12, 12, 13, 14, 14, 14, 15, 14, 15, 15, 16, 16, 19, 18, 19, 16,
+    // table 15
+    3, 4, 5, 7, 7, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12, 13, 4, 3, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11,
+    5, 5, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 11, 11, 11, 6, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11,
+    7, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 8, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+    9, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 12, 12, 9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 12,
+    9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 12, 12, 12, 9, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12,
+    10, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 12, 10, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 13,
+    11, 10, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 12, 12, 13, 13, 11, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13,
+    12, 11, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 12, 13, 12, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13,
+    // table 16
+    1, 4, 6, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 9, 3, 4, 6, 7, 8, 9, 9, 9, 10, 10, 10, 11, 12, 11, 12, 8,
+    6, 6, 7, 8, 9, 9, 10, 10, 11, 10, 11, 11, 11, 12, 12, 9, 8, 7, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 12, 13, 13, 10,
+    9, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 9, 9, 8, 9, 9, 10, 11, 11, 12, 11, 12, 12, 13, 13, 13, 14, 10,
+    10, 9, 9, 10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 14, 10, 10, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 15, 15, 10,
+    10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 14, 14, 14, 10, 11, 10, 10, 11, 11, 12, 12, 13, 13, 13, 13, 14, 13, 14, 13, 11,
+    11, 11, 10, 11, 12, 12, 12, 12, 13, 14, 14, 14, 15, 15, 14, 10, 12, 11, 11, 11, 12, 12, 13, 14, 14, 14, 14, 14, 14, 13, 14, 11,
+    12, 12, 12, 12, 12, 13, 13, 13, 13, 15, 14, 14, 14, 14, 16, 11, 14, 12, 12, 12, 13, 13, 14, 14, 14, 16, 15, 15, 15, 17, 15, 11,
+    13, 13, 11, 12, 14, 14, 13, 14, 14, 15, 16, 15, 17, 15, 14, 11, 9, 8, 8, 9, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8,
+    // table 24
+    4, 4, 6, 7, 8, 9, 9, 10, 10, 11, 11, 11, 11, 11, 12, 9, 4, 4, 5, 6, 7, 8, 8, 9, 9, 9, 10, 10, 10, 10, 10, 8,
+    6, 5, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 7, 7, 6, 7, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 7,
+    8, 7, 7, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10, 11, 7, 9, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 7,
+    9, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 7, 10, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 8,
+    10, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 8, 10, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 8,
+    11, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8, 11, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8,
+    11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 8, 11, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8,
+    12, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 8, 8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 4,
+    // count1 A
+    1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6, 6, 6,
+    // count1 B
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+};
+static const unsigned short kHuffCode[] = {
+    1, 1, 1, 0,
+    1, 2, 1, 3, 1, 1, 3, 2, 0,
+    3, 2, 1, 1, 1, 1, 3, 2, 0,
+    1, 2, 6, 5, 3, 1, 4, 4, 7, 5, 7, 1, 6, 1, 1, 0,
+    7, 3, 5, 1, 6, 2, 3, 2, 5, 4, 4, 1, 3, 3, 2, 0,
+    1, 2, 10, 19, 16, 10, 3, 3, 7, 10, 5, 3, 11, 4, 13, 17,
+    8, 4, 12, 11, 18, 15, 11, 2, 7, 6, 9, 14, 3, 1, 6, 4,
+    5, 3, 2, 0,
+    3, 4, 6, 18, 12, 5, 5, 1, 2, 16, 9, 3, 7, 3, 5, 14,
+    7, 3, 19, 17, 15, 13, 10, 4, 13, 5, 8, 11, 5, 1, 12, 4,
+    4, 1, 1, 0,
+    7, 5, 9, 14, 15, 7, 6, 4, 5, 5, 6, 7, 7, 6, 8, 8,
+    8, 5, 15, 6, 9, 10, 5, 1, 11, 7, 9, 6, 4, 1, 14, 4,
+    6, 2, 6, 0,
+    1, 2, 10, 23, 35, 30, 12, 17, 3, 3, 8, 12, 18, 21, 12, 7,
+    11, 9, 15, 21, 32, 40, 19, 6, 14, 13, 22, 34, 46, 23, 18, 7,
+    20, 19, 33, 47, 27, 22, 9, 3, 31, 22, 41, 26, 21, 20, 5, 3,
+    14, 13, 10, 11, 16, 6, 5, 1, 9, 8, 7, 8, 4, 4, 2, 0,
+    3, 4, 10, 24, 34, 33, 21, 15, 5, 3, 4, 10, 32, 17, 11, 10,
+    11, 7, 13, 18, 30, 31, 20, 5, 25, 11, 19, 59, 27, 18, 12, 5,
+    35, 33, 31, 58, 30, 16, 7, 5, 28, 26, 32, 19, 17, 15, 8, 14,
+    14, 12, 9, 13, 14, 9, 4, 1, 11, 4, 6, 6, 6, 3, 2, 0,
+    9, 6, 16, 33, 41, 39, 38, 26, 7, 5, 6, 9, 23, 16, 26, 11,
+    17, 7, 11, 14, 21, 30, 10, 7, 17, 10, 15, 12, 18, 28, 14, 5,
+    32, 13, 22, 19, 18, 16, 9, 5, 40, 17, 31, 29, 17, 13, 4, 2,
+    27, 12, 11, 15, 10, 7, 4, 1, 27, 12, 8, 12, 6, 3, 1, 0,
+    1, 5, 14, 21, 34, 51, 46, 71, 42, 52, 68, 52, 67, 44, 43, 19,
+    3, 4, 12, 19, 31, 26, 44, 33, 31, 24, 32, 24, 31, 35, 22, 14,
+    15, 13, 23, 36, 59, 49, 77, 65, 29, 40, 30, 40, 27, 33, 42, 16,
+    22, 20, 37, 61, 56, 79, 73, 64, 43, 76, 56, 37, 26, 31, 25, 14,
+    35, 16, 60, 57, 97, 75, 114, 91, 54, 73, 55, 41, 48, 53, 23, 24,
+    58, 27, 50, 96, 76, 70, 93, 84, 77, 58, 79, 29, 74, 49, 41, 17,
+    47, 45, 78, 74, 115, 94, 90, 79, 69, 83, 71, 50, 59, 38, 36, 15,
+    72, 34, 56, 95, 92, 85, 91, 90, 86, 73, 77, 65, 51, 44, 43, 42,
+    43, 20, 30, 44, 55, 78, 72, 87, 78, 61, 46, 54, 37, 30, 20, 16,
+    53, 25, 41, 37, 44, 59, 54, 81, 66, 76, 57, 54, 37, 18, 39, 11,
+    35, 33, 31, 57, 42, 82, 72, 80, 47, 58, 55, 21, 22, 26, 38, 22,
+    53, 25, 23, 38, 70, 60, 51, 36, 55, 26, 34, 23, 27, 14, 9, 7,
+    34, 32, 28, 39, 49, 75, 30, 52, 48, 40, 52, 28, 18, 17, 9, 5,
+    45, 21, 34, 64, 56, 50, 49, 45, 31, 19, 12, 15, 10, 7, 6, 3,
+    48, 23, 20, 39, 36, 35, 53, 21, 16, 23, 13, 10, 6, 1, 4, 2,
+    16, 15, 17, 27, 25, 20, 29, 11, 17, 12, 16, 8, 1, 1, 0, 1,
+    7, 12, 18, 53, 47, 76, 124, 108, 89, 123, 108, 119, 107, 81, 122, 63,
+    13, 5, 16, 27, 46, 36, 61, 51, 42, 70, 52, 83, 65, 41, 59, 36,
+    19, 17, 15, 24, 41, 34, 59, 48, 40, 64, 50, 78, 62, 80, 56, 33,
+    29, 28, 25, 43, 39, 63, 55, 93, 76, 59, 93, 72, 54, 75, 50, 29,
+    52, 22, 42, 40, 67, 57, 95, 79, 72, 57, 89, 69, 49, 66, 46, 27,
+    77, 37, 35, 66, 58, 52, 91, 74, 62, 48, 79, 63, 90, 62, 40, 38,
+    125, 32, 60, 56, 50, 92, 78, 65, 55, 87, 71, 51, 73, 51, 70, 30,
+    109, 53, 49, 94, 88, 75, 66, 122, 91, 73, 56, 42, 64, 44, 21, 25,
+    90, 43, 41, 77, 73, 63, 56, 92, 77, 66, 47, 67, 48, 53, 36, 20,
+    71, 34, 67, 60, 58, 49, 88, 76, 67, 106, 71, 54, 38, 39, 23, 15,
+    109, 53, 51, 47, 90, 82, 58, 57, 48, 72, 57, 41, 23, 27, 62, 9,
+    86, 42, 40, 37, 70, 64, 52, 43, 70, 55, 42, 25, 29, 18, 11, 11,
+    118, 68, 30, 55, 50, 46, 74, 65, 49, 39, 24, 16, 22, 13, 14, 7,
+    91, 44, 39, 38, 34, 63, 52, 45, 31, 52, 28, 19, 14, 8, 9, 3,
+    123, 60, 58, 53, 47, 43, 32, 22, 37, 24, 17, 12, 15, 10, 2, 1,
+    71, 37, 34, 30, 28, 20, 17, 26, 21, 16, 10, 6, 8, 6, 2, 0,
+    1, 5, 14, 44, 74, 63, 110, 93, 172, 149, 138, 242, 225, 195, 376, 17,
+    3, 4, 12, 20, 35, 62, 53, 47, 83, 75, 68, 119, 201, 107, 207, 9,
+    15, 13, 23, 38, 67, 58, 103, 90, 161, 72, 127, 117, 110, 209, 206, 16,
+    45, 21, 39, 69, 64, 114, 99, 87, 158, 140, 252, 212, 199, 387, 365, 26,
+    75, 36, 68, 65, 115, 101, 179, 164, 155, 264, 246, 226, 395, 382, 362, 9,
+    66, 30, 59, 56, 102, 185, 173, 265, 142, 253, 232, 400, 388, 378, 445, 16,
+    111, 54, 52, 100, 184, 178, 160, 133, 257, 244, 228, 217, 385, 366, 715, 10,
+    98, 48, 91, 88, 165, 157, 148, 261, 248, 407, 397, 372, 380, 889, 884, 8,
+    85, 84, 81, 159, 156, 143, 260, 249, 427, 401, 392, 383, 727, 713, 708, 7,
+    154, 76, 73, 141, 131, 256, 245, 426, 406, 394, 384, 735, 359, 710, 352, 11,
+    139, 129, 67, 125, 247, 233, 229, 219, 393, 743, 737, 720, 885, 882, 439, 4,
+    243, 120, 118, 115, 227, 223, 396, 746, 742, 736, 721, 712, 706, 223, 436, 6,
+    202, 224, 222, 218, 216, 389, 386, 381, 364, 888, 443, 707, 440, 437, 1728, 4,
+    747, 211, 210, 208, 370, 379, 734, 723, 714, 1735, 883, 877, 876, 3459, 865, 2,
+    377, 369, 102, 187, 726, 722, 358, 711, 709, 866, 1734, 871, 3458, 870, 434, 0,
+    12, 10, 7, 11, 10, 17, 11, 9, 13, 12, 10, 7, 5, 3, 1, 3,
+    15, 13, 46, 80, 146, 262, 248, 434, 426, 669, 653, 649, 621, 517, 1032, 88,
+    14, 12, 21, 38, 71, 130, 122, 216, 209, 198, 327, 345, 319, 297, 279, 42,
+    47, 22, 41, 74, 68, 128, 120, 221, 207, 194, 182, 340, 315, 295, 541, 18,
+    81, 39, 75, 70, 134, 125, 116, 220, 204, 190, 178, 325, 311, 293, 271, 16,
+    147, 72, 69, 135, 127, 118, 112, 210, 200, 188, 352, 323, 306, 285, 540, 14,
+    263, 66, 129, 126, 119, 114, 214, 202, 192, 180, 341, 317, 301, 281, 262, 12,
+    249, 123, 121, 117, 113, 215, 206, 195, 185, 347, 330, 308, 291, 272, 520, 10,
+    435, 115, 111, 109, 211, 203, 196, 187, 353, 332, 313, 298, 283, 531, 381, 17,
+    427, 212, 208, 205, 201, 193, 186, 177, 169, 320, 303, 286, 268, 514, 377, 16,
+    335, 199, 197, 191, 189, 181, 174, 333, 321, 305, 289, 275, 521, 379, 371, 11,
+    668, 184, 183, 179, 175, 344, 331, 314, 304, 290, 277, 530, 383, 373, 366, 10,
+    652, 346, 171, 168, 164, 318, 309, 299, 287, 276, 263, 513, 375, 368, 362, 6,
+    648, 322, 316, 312, 307, 302, 292, 284, 269, 261, 512, 376, 370, 364, 359, 4,
+    620, 300, 296, 294, 288, 282, 273, 266, 515, 380, 374, 369, 365, 361, 357, 2,
+    1033, 280, 278, 274, 267, 264, 259, 382, 378, 372, 367, 363, 360, 358, 356, 0,
+    43, 20, 19, 17, 15, 13, 11, 9, 7, 6, 4, 7, 5, 3, 1, 3,
+    1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2, 3, 1,
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+};
+struct HuffSpec { int size, offset; };
+static const HuffSpec kHuffSpecs[17] = {
+    { 2, 0 }, { 3, 4 }, { 3, 13 }, { 4, 22 }, { 4, 38 }, { 6, 54 }, { 6, 90 }, { 6, 126 }, { 8, 162 },
+    { 8, 226 }, { 8, 290 }, { 16, 354 }, { 16, 610 }, { 16, 866 }, { 16, 1122 }, { 0, 1378 }, { 0, 1394 } };
+
+// table_select to code table (-1 = all zero) and escape bits
+static const signed char kTreeOf[32] = { -1, 0, 1, 2, -1, 3, 4, 5, 6, 7, 8, 9, 10, 11, -1, 12,
+                                         13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14 };
+static const unsigned char kLinbits[32] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13 };
+
+// Synthesis window: |D[i]| * 65536 for i = 0..256, D[512 - i] has the same magnitude and
+// the sign flips in every odd block of 64
+static const int kWindow[257] = {
+    0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3, -3, -4, -4, -5,
+    -5, -6, -7, -7, -8, -9, -10, -11, -13, -14, -16, -17, -19, -21, -24, -26,
+    -29, -31, -35, -38, -41, -45, -49, -53, -58, -63, -68, -73, -79, -85, -91, -97,
+    -104, -111, -117, -125, -132, -139, -147, -154, -161, -169, -176, -183, -190, -196, -202, -208,
+    -213, -218, -222, -225, -227, -228, -228, -227, -224, -221, -215, -208, -200, -189, -177, -163,
+    -146, -127, -106, -83, -57, -29, 2, 36, 72, 111, 153, 197, 244, 294, 347, 401,
+    459, 519, 581, 645, 711, 779, 848, 919, 991, 1064, 1137, 1210, 1283, 1356, 1428, 1498,
+    1567, 1634, 1698, 1759, 1817, 1870, 1919, 1962, 2001, 2032, 2057, 2075, 2085, 2087, 2080, 2063,
+    2037, 2000, 1952, 1893, 1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605, 402, 185,
+    -45, -288, -545, -814, -1095, -1388, -1692, -2006, -2330, -2663, -3004, -3351, -3705, -4063, -4425, -4788,
+    -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597, -7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585,
+    -9727, -9838, -9916, -9959, -9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092, -7640, -7134,
+    -6574, -5959, -5288, -4561, -3776, -2935, -2037, -1082, -70, 998, 2122, 3300, 4533, 5818, 7154, 8540,
+    9975, 11455, 12980, 14548, 16155, 17799, 19478, 21189, 22929, 24694, 26482, 28289, 30112, 31947, 33791, 35640,
+    37489, 39336, 41176, 43006, 44821, 46617, 48390, 50137, 51853, 53534, 55178, 56778, 58333, 59838, 61289, 62684,
+    64019, 65290, 66494, 67629, 68692, 69679, 70590, 71420, 72169, 72835, 73415, 73908, 74313, 74630, 74856, 74992,
+    75038,
+};
+
+// Everything derived from the tables above, built once
+struct Mp3Tables {
+    // Huffman lookup: 8-bit first level, codes longer than 8 bits through a second level.
+    // Leaves hold length << 8 | value, links 0x80000000 | width << 24 | offset.
+    std::vector<unsigned int> huff;
+    int huffStart[17];
+    float pow43[8207];
+    float imdct36[18][36], imdct12[12][6];      // imdct36 by input line, so output runs inner
+    float window[4][36], shortWindow[12];
+    float cs[8], ca[8];
+    float dct[32][16];
+    float synth[512];
+    float isRatio[7][2];
+
+    Mp3Tables() {
+        for (int t = 0; t < 17; t++) {
+            const HuffSpec& spec = kHuffSpecs[t];
+            int count = spec.size ? spec.size * spec.size : 16;
+            int start = huffStart[t] = (int)huff.size();
+            huff.resize(huff.size() + 256, 0);
+            int width[256] = { 0 };
+            for (int i = 0; i < count; i++) {
+                int len = kHuffLen[spec.offset + i];
+                if (len > 8) {
+                    int prefix = kHuffCode[spec.offset + i] >> (len - 8);
+                    if (len - 8 > width[prefix]) width[prefix] = len - 8;
+                }
+            }
+            for (int prefix = 0; prefix < 256; prefix++) {
+                if (!width[prefix]) continue;
+                huff[start + prefix] = 0x80000000u | (unsigned int)width[prefix] << 24 | (unsigned int)huff.size();
+                huff.resize(huff.size() + ((size_t)1 << width[prefix]), 0);
+            }
+            for (int i = 0; i < count; i++) {
+                int len = kHuffLen[spec.offset + i];
+                unsigned int code = kHuffCode[spec.offset + i];
+                unsigned int value = spec.size ? (unsigned int)((i / spec.size) << 4 | (i % spec.size)) : (unsigned int)i;
+                unsigned int leaf = (unsigned int)len << 8 | value;
+                if (len <= 8) {
+                    for (unsigned int k = 0; k < (1u << (8 - len)); k++) huff[start + (code << (8 - len)) + k] = leaf;
+                } else {
+                    unsigned int link = huff[start + (code >> (len - 8))];
+                    int w = (link >> 24) & 0x7F, rest = len - 8;
+                    unsigned int base = (link & 0xFFFFFF) + ((code & ((1u << rest) - 1)) << (w - rest));
+                    for (unsigned int k = 0; k < (1u << (w - rest)); k++) huff[base + k] = leaf;
+                }
+            }
+        }
+
+        for (int i = 0; i < 8207; i++) pow43[i] = (float)pow((double)i, 4.0 / 3.0);
+        const double pi = 3.14159265358979323846;
+        for (int i = 0; i < 36; i++)
+            for (int k = 0; k < 18; k++) imdct36[k][i] = (float)cos(pi / 72 * (2 * i + 19) * (2 * k + 1));
+        for (int i = 0; i < 12; i++)
+            for (int k = 0; k < 6; k++) imdct12[i][k] = (float)cos(pi / 24 * (2 * i + 7) * (2 * k + 1));
+        for (int i = 0; i < 36; i++) {
+            float sine = (float)sin(pi / 36 * (i + 0.5));
+            window[0][i] = window[2][i] = sine;
+            window[1][i] = i < 18 ? sine : i < 24 ? 1.0f : i < 30 ? (float)sin(pi / 12 * (i - 18 + 0.5)) : 0.0f;
+            window[3][i] = i < 6 ? 0.0f : i < 12 ? (float)sin(pi / 12 * (i - 6 + 0.5)) : i < 18 ? 1.0f : sine;
+        }
+        for (int i = 0; i < 12; i++) shortWindow[i] = (float)sin(pi / 12 * (i + 0.5));
+        static const double c[8] = { -0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037 };
+        for (int i = 0; i < 8; i++) {
+            cs[i] = (float)(1.0 / sqrt(1.0 + c[i] * c[i]));
+            ca[i] = (float)(c[i] / sqrt(1.0 + c[i] * c[i]));
+        }
+        for (int m = 0; m < 32; m++)
+            for (int k = 0; k < 16; k++) dct[m][k] = (float)cos(pi / 64 * m * (2 * k + 1));
+        for (int i = 0; i < 512; i++) {
+            int v = i <= 256 ? kWindow[i] : kWindow[512 - i];
+            synth[i] = (float)(((i >> 6) & 1 ? -v : v) / 65536.0);
+        }
+        for (int p = 0; p < 7; p++) {
+            double t = tan(p * pi / 12);
+            isRatio[p][0] = p == 6 ? 1.0f : (float)(t / (1 + t));
+            isRatio[p][1] = p == 6 ? 0.0f : (float)(1 / (1 + t));
+        }
+    }
+};
+
+static const Mp3Tables& Tables() {
+    static const Mp3Tables tables;
+    return tables;
+}
+
+// ---------------------------------------------------------------------------
+// Bitstream
+
+struct FrameHeader { int version, rateIndex, sampleRate, channels, mode, modeExt, crc, bytes, samples, sideBytes; };
+
+// Layer III header at p (4 bytes); free format, other layers and reserved values fail
+static bool ParseHeader(const unsigned char* p, FrameHeader* h) {
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+    int ver = (p[1] >> 3) & 3, layer = (p[1] >> 1) & 3, br = p[2] >> 4, sr = (p[2] >> 2) & 3;
+    if (ver == 1 || layer != 1 || br == 0 || br == 15 || sr == 3 || (p[3] & 3) == 2) return false;
+    h->version = ver == 3 ? 0 : ver == 2 ? 1 : 2;
+    h->rateIndex = sr;
+    h->sampleRate = kRates[sr] >> h->version;
+    h->mode = p[3] >> 6;
+    h->modeExt = (p[3] >> 4) & 3;
+    h->channels = h->mode == 3 ? 1 : 2;
+    h->crc = (p[1] & 1) ? 0 : 2;
+    h->samples = h->version ? 576 : 1152;
+    h->bytes = h->samples / 8 * kBitrates[h->version ? 1 : 0][br] * 1000 / h->sampleRate + ((p[2] >> 1) & 1);
+    h->sideBytes = h->version ? (h->channels == 1 ? 9 : 17) : (h->channels == 1 ? 17 : 32);
+    return true;
+}
+
+// MSB-first reader; callers keep it within the data plus 16 bytes of zero slack
+struct BitCursor {
+    const unsigned char* data;
+    int pos = 0;
+
+    explicit BitCursor(const unsigned char* p) : data(p) {}
+
+    unsigned int Peek() const {          // Next 32 bits
+        const unsigned char* q = data + (pos >> 3);
+        unsigned int v = (unsigned int)q[0] << 24 | q[1] << 16 | q[2] << 8 | q[3];
+        int s = pos & 7;
+        return s ? (v << s) | (q[4] >> (8 - s)) : v;
+    }
+    unsigned int Bits(int n) {           // n <= 24
+        if (n == 0) return 0;
+        unsigned int v = Peek() >> (32 - n);
+        pos += n;
+        return v;
+    }
+};
+
+struct Granule {
+    int part23, bigValues, globalGain, sfCompress, blockType, mixed;
+    int table[3], subGain[3], region1, region2;
+    int preflag, sfScale, count1Table;
+};
+
+struct Scalefactors {
+    int l[22], s[13][3];
+    int limitL[22], limitS[13][3];      // MPEG-2 intensity stereo: the illegal position
+};
+
+// ---------------------------------------------------------------------------
+// Stream
+
+class Mp3Stream : public AudioStream {
+public:
+    bool Open(const unsigned char* data, size_t size);
+    int Read(short* out, int maxFrames) override { return ReadFrames(out, maxFrames); }
+    int ReadFloat(float* out, int maxFrames) override { return ReadFrames(out, maxFrames); }
+    bool Seek(long long frame) override;
+
+private:
+    const unsigned char* base = NULL;
+    const unsigned char* end = NULL;
+    FrameHeader first;
+    std::vector<size_t> frameAt;        // Audio frames (the Xing/Info frame excluded)
+    long long skip = 0;                 // Decoder output dropped in front (encoder + decoder delay)
+    size_t next = 0;
+
+    // Decoder state
+    unsigned char resv[2048];           // Bit reservoir: earlier main data, then this frame's
+    int resvBytes = 0;
+    Scalefactors scale[2];
+    float overlap[2][576];
+    float fifo[2][1024];                // Synthesis V vectors, newest at fifoPos
+    int fifoPos[2] = { 0, 0 };
+
+    std::vector<float> block;           // Current frame, interleaved
+    int blockSize = 0, blockPos = 0;
+    long long blockStart = 0;
+
+    bool Same(const FrameHeader& h) const {
+        return h.version == first.version && h.rateIndex == first.rateIndex && h.channels == first.channels;
+    }
+    bool Chained(const unsigned char* p, const FrameHeader& h) const;
+    const unsigned char* Resync(const unsigned char* from, const unsigned char* limit) const;
+    int MainBytes(size_t frame, int* mainBegin) const;
+    void Reset();
+    bool DecodeFrame();
+    void ReadScalefactors(BitCursor& br, const FrameHeader& h, const Granule& g, int gr, int ch,
+                          const int* scfsi, int* preflag);
+    void JointStereo(const FrameHeader& h, const Granule& right, const Bands& bands, float (*xr)[576], int* nonzero);
+    void Synthesize(int ch, const float* samples, float* out);
+    template <typename T> int ReadFrames(T* out, int maxFrames);
+};
+
+// A frame at p counts when the next one follows it directly (or the data ends there)
+bool Mp3Stream::Chained(const unsigned char* p, const FrameHeader& h) const {
+    const unsigned char* q = p + h.bytes;
+    if (q == end) return true;
+    FrameHeader n;
+    return end - q >= 4 && ParseHeader(q, &n) && n.version == h.version && n.rateIndex == h.rateIndex &&
+           n.channels == h.channels;
+}
+
+// Next frame start at or after from (before limit) that belongs to this stream
+const unsigned char* Mp3Stream::Resync(const unsigned char* from, const unsigned char* limit) const {
+    for (const unsigned char* p = from; limit - p >= 4; p++) {
+        p = (const unsigned char*)memchr(p, 0xFF, limit - p - 3);
+        if (!p) break;
+        FrameHeader h;
+        if (ParseHeader(p, &h) && Same(h) && h.bytes <= end - p && Chained(p, h)) return p;
+    }
+    return end;
+}
+
+bool Mp3Stream::Open(const unsigned char* data, size_t size) {
+    base = data;
+    end = data + size;
+    const unsigned char* p = data;
+    while (end - p >= 10 && !memcmp(p, "ID3", 3)) {
+        size_t len = ((size_t)(p[6] & 0x7F) << 21) | ((p[7] & 0x7F) << 14) | ((p[8] & 0x7F) << 7) | (p[9] & 0x7F);
+        len += 10 + ((p[5] & 0x10) ? 10 : 0);
+        if (len >= (size_t)(end - p)) return false;
+        p += len;
+    }
+
+    // First frame within 64 KB, confirmed by the two after it so other formats are
+    // not mistaken for mp3
+    const unsigned char* limit = end - p > 65536 ? p + 65536 : end;
+    for (;; p++) {
+        p = limit - p >= 4 ? (const unsigned char*)memchr(p, 0xFF, limit - p - 3) : NULL;
+        if (!p) return false;
+        if (!ParseHeader(p, &first) || first.bytes > end - p || !Chained(p, first)) continue;
+        const unsigned char* q = p + first.bytes;
+        FrameHeader h;
+        if (q == end || (ParseHeader(q, &h) && h.bytes <= end - q && Chained(q, h))) break;
+    }
+
+    // Xing/Info frame: no audio; a LAME tag after it has the encoder delay and padding
+    long long tagFrames = -1;
+    int delay = -1, padding = 0;
+    const unsigned char* x = p + 4 + first.crc + first.sideBytes;
+    if (end - x >= 8 && (!memcmp(x, "Xing", 4) || !memcmp(x, "Info", 4))) {
+        unsigned int flags = (unsigned int)x[4] << 24 | x[5] << 16 | x[6] << 8 | x[7];
+        const unsigned char* q = x + 8;
+        if ((flags & 1) && end - q >= 4) { tagFrames = (unsigned int)q[0] << 24 | q[1] << 16 | q[2] << 8 | q[3]; q += 4; }
+        if (flags & 2) q += 4;
+        if (flags & 4) q += 100;
+        if (flags & 8) q += 4;
+        if (q + 24 <= p + first.bytes && (!memcmp(q, "LAME", 4) || !memcmp(q, "Lavf", 4) || !memcmp(q, "Lavc", 4))) {
+            delay = q[21] << 4 | q[22] >> 4;
+            padding = (q[22] & 15) << 8 | q[23];
+        }
+        p += first.bytes;
+    } else if (p + 40 <= end && !memcmp(p + 36, "VBRI", 4)) {
+        p += first.bytes;
+    }
+
+    // Frame index: one pass over the headers, far cheaper than decoding, and it gives
+    // exact lengths and seeks for VBR files as well
+    while (end - p >= 4) {
+        FrameHeader h;
+        if (ParseHeader(p, &h) && Same(h)) {
+            if (h.bytes > end - p) break;
+            frameAt.push_back(p - base);
+            p += h.bytes;
+        } else {
+            p = Resync(p + 1, end);
+        }
+    }
+    if (frameAt.empty()) return false;
+
+    long long count = (long long)frameAt.size(), decoded = count * first.samples;
+    if (delay >= 0) {
+        // 529 samples of decoder delay on top of the encoder's, as counted by LAME
+        // When the file is cut short, the padding no longer applies
+        skip = delay + 529;
+        frames = decoded - delay - (tagFrames == count ? padding : 0);
+        if (frames > decoded - skip) frames = decoded - skip;
+        if (frames < 0) frames = 0;
+    } else {
+        frames = decoded;
+    }
+    sampleRate = first.sampleRate;
+    channels = first.channels;
+    bitsPerSample = 0;
+    codec = "mp3";
+    Reset();
+    return true;
+}
+
+void Mp3Stream::Reset() {
+    next = 0;
+    resvBytes = 0;
+    memset(scale, 0, sizeof(scale));
+    memset(overlap, 0, sizeof(overlap));
+    memset(fifo, 0, sizeof(fifo));
+    fifoPos[0] = fifoPos[1] = 0;
+    blockSize = blockPos = 0;
+    blockStart = -skip;
+}
+
+// Main data bytes carried by a frame, and its main_data_begin (bytes it takes from earlier frames)
+int Mp3Stream::MainBytes(size_t frame, int* mainBegin) const {
+    const unsigned char* p = base + frameAt[frame];
+    FrameHeader h;
+    *mainBegin = 0;
+    if (!ParseHeader(p, &h)) return 0;
+    const unsigned char* side = p + 4 + h.crc;
+    *mainBegin = h.version ? side[0] : (side[0] << 1 | side[1] >> 7);
+    return h.bytes - 4 - h.crc - h.sideBytes;
+}
+
+void Mp3Stream::ReadScalefactors(BitCursor& br, const FrameHeader& h, const Granule& g, int gr, int ch,
+                                 const int* scfsi, int* preflag) {
+    Scalefactors& sf = scale[ch];
+    bool isShort = g.blockType == 2;
+    if (h.version == 0) {
+        int slen1 = kSlen[0][g.sfCompress], slen2 = kSlen[1][g.sfCompress];
+        if (isShort) {
+            int sfb = 0;
+            if (g.mixed) {
+                for (; sfb < 8; sfb++) sf.l[sfb] = (int)br.Bits(slen1);
+                sfb = 3;
+            }
+            for (; sfb < 12; sfb++)
+                for (int w = 0; w < 3; w++) sf.s[sfb][w] = (int)br.Bits(sfb < 6 ? slen1 : slen2);
+            for (int w = 0; w < 3; w++) sf.s[12][w] = 0;
+        } else {
+            static const int groups[5] = { 0, 6, 11, 16, 21 };
+            for (int k = 0; k < 4; k++) {
+                if (gr == 1 && scfsi[k]) continue;      // Shared with granule 0
+                for (int sfb = groups[k]; sfb < groups[k + 1]; sfb++) sf.l[sfb] = (int)br.Bits(k < 2 ? slen1 : slen2);
+            }
+            sf.l[21] = 0;
+        }
+        for (int i = 0; i < 22; i++) sf.limitL[i] = 7;
+        for (int i = 0; i < 13; i++) for (int w = 0; w < 3; w++) sf.limitS[i][w] = 7;
+        return;
+    }
+
+    // MPEG-2: bit counts and group sizes both come from scalefac_compress
+    int sfc = g.sfCompress, slen[4], table;
+    *preflag = 0;
+    if (ch == 1 && h.mode == 1 && (h.modeExt & 1)) {
+        int isc = sfc >> 1;
+        if (isc < 180) { slen[0] = isc / 36; slen[1] = isc % 36 / 6; slen[2] = isc % 6; slen[3] = 0; table = 3; }
+        else if (isc < 244) { isc -= 180; slen[0] = (isc & 63) >> 4; slen[1] = (isc & 15) >> 2; slen[2] = isc & 3; slen[3] = 0; table = 4; }
+        else { isc -= 244; slen[0] = isc / 3; slen[1] = isc % 3; slen[2] = slen[3] = 0; table = 5; }
+    } else {
+        if (sfc < 400) { slen[0] = (sfc >> 4) / 5; slen[1] = (sfc >> 4) % 5; slen[2] = (sfc & 15) >> 2; slen[3] = sfc & 3; table = 0; }
+        else if (sfc < 500) { sfc -= 400; slen[0] = (sfc >> 2) / 5; slen[1] = (sfc >> 2) % 5; slen[2] = sfc & 3; slen[3] = 0; table = 1; }
+        else { sfc -= 500; slen[0] = sfc / 3; slen[1] = sfc % 3; slen[2] = slen[3] = 0; table = 2; *preflag = 1; }
+    }
+    int values[39], limits[39], n = 0;
+    const unsigned char* counts = kLsfCounts[table][isShort ? (g.mixed ? 2 : 1) : 0];
+    for (int k = 0; k < 4; k++)
+        for (int i = 0; i < counts[k]; i++, n++) {
+            values[n] = (int)br.Bits(slen[k]);
+            limits[n] = (1 << slen[k]) - 1;
+        }
+    for (; n < 39; n++) values[n] = limits[n] = 0;
+    n = 0;
+    int sfb = 0;
+    if (!isShort || g.mixed) {
+        for (; sfb < (isShort ? 6 : 21); sfb++, n++) { sf.l[sfb] = values[n]; sf.limitL[sfb] = limits[n]; }
+        sf.l[21] = 0;
+        sf.limitL[21] = sf.limitL[20];
+        sfb = 3;
+    }
+    if (isShort) {
+        for (; sfb < 12; sfb++)
+            for (int w = 0; w < 3; w++, n++) { sf.s[sfb][w] = values[n]; sf.limitS[sfb][w] = limits[n]; }
+        for (int w = 0; w < 3; w++) { sf.s[12][w] = 0; sf.limitS[12][w] = sf.limitS[11][w]; }
+    }
+}
+
+// Huffman-coded spectrum of one granule channel, up to bit endBit; returns the lines
+// decoded (the rest are zero)
+static int ReadSpectrum(BitCursor& br, int endBit, const Granule& g, int* is) {
+    const Mp3Tables& T = Tables();
+    int big = g.bigValues * 2, i = 0;
+    for (int r = 0; r < 3 && i < big; r++) {
+        int stop = r == 0 ? g.region1 : r == 1 ? g.region2 : big;
+        if (stop > big) stop = big;
+        int tree = kTreeOf[g.table[r]], linbits = kLinbits[g.table[r]];
+        if (tree < 0) {
+            for (; i < stop; i++) is[i] = 0;
+            continue;
+        }
+        const unsigned int* lut = &T.huff[T.huffStart[tree]];
+        for (; i < stop; i += 2) {
+            unsigned int peek = br.Peek(), e = lut[peek >> 24];
+            if (e & 0x80000000u) e = T.huff[(e & 0xFFFFFF) + ((peek << 8) >> (32 - ((e >> 24) & 0x7F)))];
+            br.pos += (e >> 8) & 31;
+            int x = (e >> 4) & 15, y = e & 15;
+            if (x == 15 && linbits) x += (int)br.Bits(linbits);
+            if (x && br.Bits(1)) x = -x;
+            if (y == 15 && linbits) y += (int)br.Bits(linbits);
+            if (y && br.Bits(1)) y = -y;
+            is[i] = x; is[i + 1] = y;
+            if (br.pos > endBit) return i;      // Damaged: the granule claims fewer bits
+        }
+    }
+
+    // count1 region: quads of -1/0/1 until the granule's bits run out
+    const unsigned int* lut = &T.huff[T.huffStart[g.count1Table ? 16 : 15]];
+    while (i <= 572 && br.pos < endBit) {
+        unsigned int e = lut[br.Peek() >> 24];
+        br.pos += (e >> 8) & 31;
+        int q[4];
+        for (int k = 0; k < 4; k++) {
+            q[k] = (e >> (3 - k)) & 1;
+            if (q[k] && br.Bits(1)) q[k] = -1;
+        }
+        if (br.pos > endBit) break;             // The last quad ran past the end: dropped
+        memcpy(is + i, q, sizeof(q));
+        i += 4;
+    }
+    return i;
+}
+
+static void MidSide(float* l, float* r, int start, int n) {
+    const float k = 0.70710678f;
+    for (int i = start; i < start + n; i++) {
+        float m = l[i], s = r[i];
+        l[i] = (m + s) * k;
+        r[i] = (m - s) * k;
+    }
+}
+
+// Undoes joint stereo coding in place. With intensity stereo, the bands above the right
+// channel's last nonzero line carry the left channel plus a position per band; bands
+// below it, or with an illegal position, are mid/side coded when that is on too.
+void Mp3Stream::JointStereo(const FrameHeader& h, const Granule& right, const Bands& bands, float (*xr)[576],
+                            int* nonzero) {
+    const Mp3Tables& T = Tables();
+    bool ms = (h.modeExt & 2) != 0;
+    float* l = xr[0];
+    float* r = xr[1];
+    if (!(h.modeExt & 1)) {
+        int n = nonzero[0] > nonzero[1] ? nonzero[0] : nonzero[1];
+        if (ms) MidSide(l, r, 0, n);
+        nonzero[0] = nonzero[1] = n;
+        return;
+    }
+
+    const Scalefactors& sf = scale[1];
+    float io = (right.sfCompress & 1) ? 0.70710678f : 0.84089642f;
+    auto Band = [&](int start, int n, bool coded, int pos, int limit) {
+        if (!coded || (h.version ? pos == limit : pos >= 7)) {
+            if (ms) MidSide(l, r, start, n);
+            return;
+        }
+        float kl, kr;
+        if (h.version == 0) { kl = T.isRatio[pos][0]; kr = T.isRatio[pos][1]; }
+        else if (pos & 1) { kl = powf(io, (float)((pos + 1) / 2)); kr = 1.0f; }
+        else { kl = 1.0f; kr = powf(io, (float)(pos / 2)); }
+        for (int i = start; i < start + n; i++) {
+            r[i] = l[i] * kr;
+            l[i] *= kl;
+        }
+    };
+    auto Zero = [&](int start, int n) {
+        for (int i = start; i < start + n; i++) if (r[i] != 0.0f) return false;
+        return true;
+    };
+
+    int longBands = 22, shortFrom = 13;
+    if (right.blockType == 2) {
+        longBands = 0;
+        shortFrom = 0;
+        if (right.mixed) {
+            while (bands.l[longBands] < 36) longBands++;
+            while (bands.s[shortFrom] * 3 < 36) shortFrom++;
+        }
+    }
+    bool shortNonzero = false;
+    for (int w = 0; w < 3; w++) {
+        // Per window: intensity coding starts above the highest band with a nonzero line
+        int firstCoded = shortFrom;
+        for (int sfb = 12; sfb >= shortFrom; sfb--) {
+            int width = bands.s[sfb + 1] - bands.s[sfb];
+            if (!Zero(3 * bands.s[sfb] + w * width, width)) { firstCoded = sfb + 1; shortNonzero = true; break; }
+        }
+        for (int sfb = shortFrom; sfb < 13; sfb++) {
+            int width = bands.s[sfb + 1] - bands.s[sfb], b = sfb < 12 ? sfb : 11;
+            Band(3 * bands.s[sfb] + w * width, width, sfb >= firstCoded, sf.s[b][w], sf.limitS[b][w]);
+        }
+    }
+    int firstCoded = longBands;
+    if (!shortNonzero) {
+        firstCoded = 0;
+        for (int sfb = longBands - 1; sfb >= 0; sfb--)
+            if (!Zero(bands.l[sfb], bands.l[sfb + 1] - bands.l[sfb])) { firstCoded = sfb + 1; break; }
+    }
+    for (int sfb = 0; sfb < longBands; sfb++) {
+        int b = sfb < 21 ? sfb : 20;
+        Band(bands.l[sfb], bands.l[sfb + 1] - bands.l[sfb], sfb >= firstCoded, sf.l[b], sf.limitL[b]);
+    }
+    nonzero[0] = nonzero[1] = 576;
+}
+
+// Decodes frameAt[next] into block. A frame whose reservoir data is missing (right
+// after a seek) or that is damaged comes out as silence.
+bool Mp3Stream::DecodeFrame() {
+    const Mp3Tables& T = Tables();
+    const unsigned char* p = base + frameAt[next];
+    FrameHeader h;
+    blockStart = (long long)next * first.samples - skip;
+    next++;
+    if (!ParseHeader(p, &h)) return false;      // Indexed frames always parse
+
+    // Side information, copied out since the smallest frames end right after it
+    unsigned char sideData[32 + 16] = { 0 };
+    memcpy(sideData, p + 4 + h.crc, h.sideBytes);
+    BitCursor side(sideData);
+    int lsf = h.version != 0, nch = h.channels, grans = lsf ? 1 : 2;
+    int mainBegin = (int)side.Bits(lsf ? 8 : 9);
+    side.Bits(lsf ? (nch == 1 ? 1 : 2) : (nch == 1 ? 5 : 3));
+    int scfsi[2][4] = { { 0 } };
+    if (!lsf)
+        for (int ch = 0; ch < nch; ch++)
+            for (int k = 0; k < 4; k++) scfsi[ch][k] = (int)side.Bits(1);
+    Granule gi[2][2];
+    const Bands& bands = kBands[h.version == 0 ? h.rateIndex : h.version == 1 ? 3 + h.rateIndex : (h.rateIndex == 2 ? 6 : 5)];
+    bool ok = true;
+    for (int gr = 0; gr < grans; gr++) {
+        for (int ch = 0; ch < nch; ch++) {
+            Granule& g = gi[gr][ch];
+            g.part23 = (int)side.Bits(12);
+            g.bigValues = (int)side.Bits(9);
+            g.globalGain = (int)side.Bits(8);
+            g.sfCompress = (int)side.Bits(lsf ? 9 : 4);
+            ok &= g.bigValues <= 288;
+            if (side.Bits(1)) {
+                g.blockType = (int)side.Bits(2);
+                g.mixed = (int)side.Bits(1);
+                g.table[0] = (int)side.Bits(5);
+                g.table[1] = (int)side.Bits(5);
+                g.table[2] = 0;
+                for (int w = 0; w < 3; w++) g.subGain[w] = (int)side.Bits(3);
+                ok &= g.blockType != 0;
+                if (g.blockType == 2 && !g.mixed) g.region1 = bands.s[3] * 3;
+                else g.region1 = bands.l[8];
+                g.region2 = 576;
+            } else {
+                g.blockType = g.mixed = 0;
+                for (int r = 0; r < 3; r++) g.table[r] = (int)side.Bits(5);
+                g.subGain[0] = g.subGain[1] = g.subGain[2] = 0;
+                int r0 = (int)side.Bits(4), r1 = (int)side.Bits(3);
+                g.region1 = bands.l[r0 + 1];
+                g.region2 = bands.l[r0 + r1 + 2 < 22 ? r0 + r1 + 2 : 22];
+            }
+            g.preflag = lsf ? 0 : (int)side.Bits(1);
+            g.sfScale = (int)side.Bits(1);
+            g.count1Table = (int)side.Bits(1);
+        }
+    }
+
+    // Bit reservoir: keep the last 511 bytes (the most main_data_begin can reach back),
+    // then append this frame's main data
+    const unsigned char* main = p + 4 + h.crc + h.sideBytes;
+    int mainLen = h.bytes - 4 - h.crc - h.sideBytes;
+    if (mainLen < 0) { mainLen = 0; ok = false; }
+    int keep = resvBytes < 511 ? resvBytes : 511;
+    memmove(resv, resv + resvBytes - keep, keep);
+    memcpy(resv + keep, main, mainLen);
+    resvBytes = keep + mainLen;
+    memset(resv + resvBytes, 0, 16);
+    ok &= mainBegin <= keep;
+    BitCursor br(resv);
+    br.pos = (keep - mainBegin) * 8;
+    int totalBits = resvBytes * 8;
+
+    blockSize = h.samples;
+    blockPos = blockStart < 0 ? (int)(-blockStart < blockSize ? -blockStart : blockSize) : 0;
+    block.resize((size_t)blockSize * channels);
+
+    for (int gr = 0; gr < grans; gr++) {
+        float xr[2][576];
+        int nonzero[2] = { 0, 0 };
+        for (int ch = 0; ch < nch; ch++) {
+            const Granule& g = gi[gr][ch];
+            int is[576];
+            int part2 = br.pos, endBit = part2 + g.part23, preflag = g.preflag;
+            if (ok && endBit <= totalBits) {
+                ReadScalefactors(br, h, g, gr, ch, scfsi[ch], &preflag);
+                nonzero[ch] = br.pos <= endBit ? ReadSpectrum(br, endBit, g, is) : 0;
+            }
+            br.pos = endBit;
+
+            // Requantisation: |is|^(4/3) * 2^((global_gain - 210) / 4), less the band's scalefactor
+            const Scalefactors& sf = scale[ch];
+            float mult = g.sfScale ? 1.0f : 0.5f;
+            int i = 0, n = nonzero[ch];
+            bool isShort = g.blockType == 2;
+            int longEnd = isShort ? (g.mixed ? 36 : 0) : 576;
+            for (int sfb = 0; i < longEnd && i < n; sfb++) {
+                float step = exp2f(0.25f * (g.globalGain - 210) - mult * (sf.l[sfb] + (preflag ? kPretab[sfb] : 0)));
+                for (int stop = bands.l[sfb + 1] < n ? bands.l[sfb + 1] : n; i < stop; i++)
+                    xr[ch][i] = is[i] < 0 ? -T.pow43[-is[i]] * step : T.pow43[is[i]] * step;
+            }
+            if (isShort) {
+                int sfb = 0;
+                while (bands.s[sfb] * 3 < i) sfb++;
+                for (; sfb < 13 && i < n; sfb++) {
+                    int width = bands.s[sfb + 1] - bands.s[sfb];
+                    for (int w = 0; w < 3; w++) {
+                        float step = exp2f(0.25f * (g.globalGain - 210 - 8 * g.subGain[w]) - mult * sf.s[sfb][w]);
+                        for (int k = 0; k < width && i < n; k++, i++)
+                            xr[ch][i] = is[i] < 0 ? -T.pow43[-is[i]] * step : T.pow43[is[i]] * step;
+                    }
+                }
+            }
+            for (; i < 576; i++) xr[ch][i] = 0.0f;
+        }
+
+        if (nch == 2 && h.mode == 1) JointStereo(h, gi[gr][1], bands, xr, nonzero);
+
+        for (int ch = 0; ch < nch; ch++) {
+            const Granule& g = gi[gr][ch];
+            float* x = xr[ch];
+            int n = nonzero[ch];
+
+            // Short blocks arrive band by band, window by window: interleave the windows
+            // so each subband holds its 3 x 6 lines
+            if (g.blockType == 2) {
+                float tmp[576];
+                int sfb = g.mixed ? 3 : 0;
+                if (g.mixed) while (bands.s[sfb] * 3 < 36) sfb++;
+                for (; sfb < 13 && bands.s[sfb] * 3 < n; sfb++) {
+                    int start = bands.s[sfb] * 3, width = bands.s[sfb + 1] - bands.s[sfb];
+                    for (int w = 0; w < 3; w++)
+                        for (int k = 0; k < width; k++) tmp[start + 3 * k + w] = x[start + w * width + k];
+                    memcpy(x + start, tmp + start, sizeof(float) * 3 * width);
+                }
+                if (n < 576) n = (bands.s[sfb] * 3 < 576) ? bands.s[sfb] * 3 : 576;
+            }
+
+            // Alias reduction between long-block subbands
+            int sbs = (n + 17) / 18;
+            int aliasTo = g.blockType == 2 ? (g.mixed ? 2 : 0) : (sbs + 1 < 32 ? sbs + 1 : 32);
+            for (int sb = 1; sb < aliasTo; sb++)
+                for (int k = 0; k < 8; k++) {
+                    float lo = x[18 * sb - 1 - k], hi = x[18 * sb + k];
+                    x[18 * sb - 1 - k] = lo * T.cs[k] - hi * T.ca[k];
+                    x[18 * sb + k] = hi * T.cs[k] + lo * T.ca[k];
+                }
+            if (aliasTo > sbs) sbs = aliasTo;
+
+            // IMDCT with overlap-add, then frequency inversion of the odd subbands
+            float slots[18][32];
+            for (int sb = 0; sb < 32; sb++) {
+                float* ov = &overlap[ch][sb * 18];
+                float y[36];
+                int type = (g.blockType == 2 && g.mixed && sb < 2) ? 0 : g.blockType;
+                if (sb >= sbs) {
+                    memset(y, 0, sizeof(y));
+                } else if (type != 2) {
+                    const float* in = x + sb * 18;
+                    memset(y, 0, sizeof(y));
+                    for (int k = 0; k < 18; k++)
+                        for (int i = 0; i < 36; i++) y[i] += in[k] * T.imdct36[k][i];
+                    for (int i = 0; i < 36; i++) y[i] *= T.window[type][i];
+                } else {
+                    memset(y, 0, sizeof(y));
+                    for (int w = 0; w < 3; w++) {
+                        const float* in = x + sb * 18 + w;
+                        for (int i = 0; i < 12; i++) {
+                            float s = 0.0f;
+                            for (int k = 0; k < 6; k++) s += in[3 * k] * T.imdct12[i][k];
+                            y[6 + 6 * w + i] += s * T.shortWindow[i];
+                        }
+                    }
+                }
+                for (int i = 0; i < 18; i++) {
+                    float v = y[i] + ov[i];
+                    slots[i][sb] = (sb & i & 1) ? -v : v;
+                    ov[i] = y[18 + i];
+                }
+            }
+
+            float* out = &block[(size_t)gr * 576 * channels + ch];
+            for (int t = 0; t < 18; t++) Synthesize(ch, slots[t], out + (size_t)t * 32 * channels);
+        }
+    }
+    return true;
+}
+
+// Polyphase synthesis of 32 subband samples into 32 output samples (stride = channels).
+// V[i] = sum_k cos((16 + i)(2k + 1)pi/64) S[k] is a 32-point DCT whose symmetries give
+// all 64 values from X[0..31]; X itself folds S[k] with S[31 - k], since row m of the
+// DCT is even or odd about the middle as m is.
+void Mp3Stream::Synthesize(int ch, const float* s, float* out) {
+    const Mp3Tables& T = Tables();
+    float* v = fifo[ch];
+    int at = fifoPos[ch] = (fifoPos[ch] - 64) & 1023;
+    float even[16], odd[16], X[32];
+    for (int k = 0; k < 16; k++) {
+        even[k] = s[k] + s[31 - k];
+        odd[k] = s[k] - s[31 - k];
+    }
+    for (int m = 0; m < 32; m++) {
+        const float* in = m & 1 ? odd : even;
+        float sum = 0.0f;
+        for (int k = 0; k < 16; k++) sum += in[k] * T.dct[m][k];
+        X[m] = sum;
+    }
+    // at is a multiple of 64, so none of the blocks below wraps
+    for (int i = 0; i < 16; i++) v[at + i] = X[i + 16];
+    v[at + 16] = 0.0f;
+    for (int i = 17; i < 48; i++) v[at + i] = -X[48 - i];
+    v[at + 48] = -X[0];
+    for (int i = 49; i < 64; i++) v[at + i] = -X[i - 48];
+
+    float sum[32] = { 0 };
+    for (int i = 0; i < 8; i++) {
+        const float* a = v + ((at + 128 * i) & 1023);
+        const float* b = v + ((at + 128 * i + 96) & 1023);
+        const float* w = T.synth + 64 * i;
+        for (int j = 0; j < 32; j++) {
+            sum[j] += a[j] * w[j];
+            sum[j] += b[j] * w[32 + j];
+        }
+    }
+    for (int j = 0; j < 32; j++) out[(size_t)j * channels] = sum[j];
+}
+
+static void ConvertSamples(const float* src, int n, short* dst) {
+    for (int i = 0; i < n; i++) {
+        float v = src[i] * 32768.0f;
+        dst[i] = v >= 32767.0f ? (short)32767 : v <= -32768.0f ? (short)-32768 : (short)lrintf(v);
+    }
+}
+
+static void ConvertSamples(const float* src, int n, float* dst) { memcpy(dst, src, sizeof(float) * n); }
+
+template <typename T>
+int Mp3Stream::ReadFrames(T* out, int maxFrames) {
+    int done = 0;
+    while (done < maxFrames) {
+        if (blockPos >= blockSize) {
+            if (next >= frameAt.size() || !DecodeFrame()) break;
+            continue;
+        }
+        long long left = frames - (blockStart + blockPos);     // Encoder padding at the end is dropped
+        if (left <= 0) { next = frameAt.size(); blockPos = blockSize; break; }
+        int take = blockSize - blockPos;
+        if (take > maxFrames - done) take = maxFrames - done;
+        if (take > left) take = (int)left;
+        ConvertSamples(&block[(size_t)blockPos * channels], take * channels, out + (size_t)done * channels);
+        blockPos += take;
+        done += take;
+    }
+    return done;
+}
+
+bool Mp3Stream::Seek(long long target) {
+    if (target < 0) target = 0;
+    if (target >= frames) {
+        next = frameAt.size();
+        blockSize = blockPos = 0;
+        return true;
+    }
+    long long at = target + skip;
+    size_t frame = (size_t)(at / first.samples);
+
+    // Output depends on the two granules before it (IMDCT overlap, synthesis window), and
+    // those on main data up to main_data_begin bytes back
+    size_t from = first.version ? 2 : 1;
+    from = frame >= from ? frame - from : 0;
+    int need, have = 0;
+    MainBytes(from, &need);
+    while (from > 0 && have < need) {
+        int unused;
+        have += MainBytes(--from, &unused);
+    }
+    Reset();
+    next = from;
+    while (next <= frame) DecodeFrame();
+    blockPos = (int)(at - (long long)frame * first.samples);
+    return true;
+}
+
+std::unique_ptr<AudioStream> OpenMp3Stream(const unsigned char* data, size_t size) {
+    std::unique_ptr<Mp3Stream> s(new Mp3Stream());
+    if (!s->Open(data, size)) return NULL;
+    return s;
+}
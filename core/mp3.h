@@ -0,0 +1,10 @@
+// MPEG audio Layer III (mp3) decoding
+#pragma once
+
+#include "decoder.h"
+
+// Stream over an mp3 image: MPEG-1, 2 and 2.5 Layer III, mono or stereo (joint stereo
+// included), CBR or VBR. An ID3v2 tag in front is skipped. The encoder delay and
+// padding from a LAME tag are trimmed, as gapless players do. Seeks are exact:
+// decoding restarts far enough back to refill the bit reservoir and filter state.
+std::unique_ptr<AudioStream> OpenMp3Stream(const unsigned char* data, size_t size);
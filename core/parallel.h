@@ -0,0 +1,93 @@
+// Threading and hashing helpers shared by the analysis core
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run fn(start, end) over [0, count) split into contiguous ranges, one per thread
+template <typename F>
+void ParallelRanges(int count, int numThreads, F fn) {
+    if (count <= 0) return;
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 2;
+    if (numThreads > count) numThreads = count;
+    if (numThreads == 1) { fn(0, count); return; }
+
+    int perThread = count / numThreads;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        int start = i * perThread;
+        int end = (i == numThreads - 1) ? count : (start + perThread);
+        threads.emplace_back(fn, start, end);
+    }
+    for (auto& t : threads) t.join();
+}
+
+// Lock-free publishing for parallel producers: Reserve hands out slots of preallocated
+// storage from an atomic counter, each tagged with the input item it will hold, and
+// Order (after the producers finish) lists the slots by input so results can be put
+// back in input order whatever the thread timing. Which items get in once capacity
+// runs out still depends on timing.
+class SlotReservation {
+public:
+    explicit SlotReservation(int capacity) : capacity(capacity > 0 ? capacity : 0), next(0), keys(this->capacity) {}
+
+    // Slot for the item with this input key, or -1 once capacity is used up
+    int Reserve(int key) {
+        if (Full()) return -1;
+        int slot = next.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= capacity) return -1;
+        keys[slot] = key;
+        return slot;
+    }
+    bool Full() const { return next.load(std::memory_order_relaxed) >= capacity; }
+    int Count() const { int n = next.load(); return n < capacity ? n : capacity; }
+
+    // Slots sorted by key (producers must have finished)
+    std::vector<int> Order() const {
+        std::vector<int> order(Count());
+        for (int i = 0; i < (int)order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+        return order;
+    }
+
+private:
+    int capacity;
+    std::atomic<int> next;
+    std::vector<int> keys;
+};
+
+// items[i] = (old) items[order[i]] for a permutation, in place with one temporary
+template <typename T>
+void PermuteInPlace(T* items, std::vector<int> order) {
+    for (int i = 0; i < (int)order.size(); i++) {
+        if (order[i] == i) continue;
+        T first = items[i];
+        int j = i;
+        for (;;) {
+            int k = order[j];
+            order[j] = j;
+            if (k == i) { items[j] = first; break; }
+            items[j] = items[k];
+            j = k;
+        }
+    }
+}
+
+// Stateless integer hash (deterministic pseudo-random numbers)
+static inline unsigned int HashU32(unsigned int x) {
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// FNV-1a over raw bytes (cache keys, checksums)
+static inline unsigned long long HashBytes(const void* data, size_t len, unsigned long long h = 1469598103934665603ULL) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) { h ^= p[i]; h *= 1099511628211ULL; }
+    return h;
+}
@@ -0,0 +1,315 @@
+#include "pcmfile.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::Open(const wchar_t* path) {
+    Close();
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER len;
+    HANDLE map = NULL;
+    if (GetFileSizeEx(file, &len) && len.QuadPart > 0 && (unsigned long long)len.QuadPart <= (size_t)-1)
+        map = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!map) return false;
+    // The view keeps the mapping alive after its handle is closed
+    void* view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(map);
+    if (!view) return false;
+    data = (const unsigned char*)view;
+    size = (size_t)len.QuadPart;
+    return true;
+}
+
+bool MappedFile::Open(const char* path) {
+    wchar_t wide[MAX_PATH];
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wide, MAX_PATH)) return false;
+    return Open(wide);
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    data = NULL; size = 0;
+}
+#else
+bool MappedFile::Open(const char* path) {
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+    madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+    data = (const unsigned char*)view;
+    size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) munmap((void*)data, size);
+    data = NULL; size = 0;
+}
+#endif
+
+static unsigned int Le32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+static unsigned int Be32(const unsigned char* p) { return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static unsigned int Le16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static unsigned int Be16(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+
+// Fills frames/data from a data chunk; the chunk may claim more bytes than the file
+// holds (streaming writers leave 0xFFFFFFFF) so it is clamped to what is present
+static bool SetSampleData(const unsigned char* start, size_t available, unsigned long long claimed, PcmFormat* fmt) {
+    if (fmt->channels < 1 || fmt->sampleRate <= 0 || fmt->sampleRate > PCM_MAX_RATE) return false;
+    int b = fmt->bytesPerSample;
+    if (fmt->isFloat ? (b != 4 && b != 8) : (b < 1 || b > 4)) return false;
+    if (claimed > available) claimed = available;
+    long long frames = (long long)(claimed / ((unsigned long long)b * fmt->channels));
+    long long maxFrames = INT_MAX / fmt->channels;
+    fmt->data = start;
+    fmt->frames = frames < maxFrames ? frames : maxFrames;
+    return fmt->frames > 0;
+}
+
+static bool ParseWav(const unsigned char* file, size_t size, PcmFormat* fmt) {
+    bool rifx = !memcmp(file, "RIFX", 4), rf64 = !memcmp(file, "RF64", 4);
+    if ((memcmp(file, "RIFF", 4) && !rifx && !rf64) || memcmp(file + 8, "WAVE", 4)) return false;
+    auto U32 = [rifx](const unsigned char* p) { return rifx ? Be32(p) : Le32(p); };
+    auto U16 = [rifx](const unsigned char* p) { return rifx ? Be16(p) : Le16(p); };
+    fmt->bigEndian = rifx;
+    fmt->container = "wav";
+
+    bool haveFmt = false;
+    unsigned long long rf64Data = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* ck = file + pos;
+        unsigned long long len = U32(ck + 4);
+        const unsigned char* body = ck + 8;
+        size_t avail = size - pos - 8;
+        if (!memcmp(ck, "ds64", 4) && len >= 16 && avail >= 16) {
+            rf64Data = Le32(body + 8) | ((unsigned long long)Le32(body + 12) << 32);
+        } else if (!memcmp(ck, "fmt ", 4)) {
+            if (len < 16 || avail < 16) return false;
+            unsigned int tag = U16(body);
+            fmt->channels = (int)U16(body + 2);
+            unsigned int rate = U32(body + 4);
+            fmt->sampleRate = rate <= PCM_MAX_RATE ? (int)rate : 0;
+            unsigned int blockAlign = U16(body + 12);
+            fmt->bitsPerSample = (int)U16(body + 14);
+            if (tag == 0xFFFE) {
+                // WAVE_FORMAT_EXTENSIBLE: valid bits and the real tag (first GUID word)
+                if (len < 40 || avail < 40) return false;
+                unsigned int valid = U16(body + 18);
+                if (valid > 0 && (int)valid <= fmt->bitsPerSample) fmt->bitsPerSample = (int)valid;
+                tag = U16(body + 24);
+            }
+            if (tag != 1 && tag != 3) return false;
+            fmt->isFloat = tag == 3;
+            fmt->bytesPerSample = fmt->channels > 0 ? (int)(blockAlign / fmt->channels) : 0;
+            if (fmt->bytesPerSample <= 0) fmt->bytesPerSample = (fmt->bitsPerSample + 7) / 8;
+            fmt->unsigned8 = fmt->bytesPerSample == 1;
+            haveFmt = true;
+        } else if (!memcmp(ck, "data", 4)) {
+            if (!haveFmt) return false;
+            if (rf64 && len == 0xFFFFFFFFULL) len = rf64Data;
+            return SetSampleData(body, avail, len, fmt);
+        }
+        if (len > avail) return false;
+        pos += 8 + (size_t)len + (len & 1);
+    }
+    return false;
+}
+
+// 80-bit IEEE 754 extended (AIFF sample rate)
+static double Extended80(const unsigned char* p) {
+    int expon = ((p[0] & 0x7F) << 8) | p[1];
+    unsigned long long mant = ((unsigned long long)Be32(p + 2) << 32) | Be32(p + 6);
+    if (expon == 0 && mant == 0) return 0.0;
+    double v = ldexp((double)mant, expon - 16383 - 63);
+    return (p[0] & 0x80) ? -v : v;
+}
+
+static bool ParseAiff(const unsigned char* file, size_t size, PcmFormat* fmt) {
+    bool aifc = !memcmp(file + 8, "AIFC", 4);
+    if (memcmp(file, "FORM", 4) || (memcmp(file + 8, "AIFF", 4) && !aifc)) return false;
+    fmt->bigEndian = true;
+    fmt->container = "aiff";
+
+    bool haveComm = false;
+    unsigned long long frames = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* ck = file + pos;
+        unsigned long long len = Be32(ck + 4);
+        const unsigned char* body = ck + 8;
+        size_t avail = size - pos - 8;
+        if (!memcmp(ck, "COMM", 4)) {
+            if (len < 18 || avail < 18) return false;
+            fmt->channels = (int)Be16(body);
+            frames = Be32(body + 2);
+            fmt->bitsPerSample = (int)Be16(body + 6);
+            double rate = Extended80(body + 8);
+            fmt->sampleRate = rate >= 1.0 && rate <= PCM_MAX_RATE ? (int)(rate + 0.5) : 0;
+            fmt->bytesPerSample = (fmt->bitsPerSample + 7) / 8;
+            fmt->isFloat = false;
+            if (aifc) {
+                if (len < 22 || avail < 22) return false;
+                const unsigned char* c = body + 18;
+                if (!memcmp(c, "sowt", 4)) fmt->bigEndian = false;
+                else if (!memcmp(c, "fl32", 4) || !memcmp(c, "FL32", 4)) { fmt->isFloat = true; fmt->bytesPerSample = 4; }
+                else if (!memcmp(c, "fl64", 4) || !memcmp(c, "FL64", 4)) { fmt->isFloat = true; fmt->bytesPerSample = 8; }
+                else if (memcmp(c, "NONE", 4) && memcmp(c, "twos", 4)) return false;
+            }
+            fmt->unsigned8 = false;
+            haveComm = true;
+        } else if (!memcmp(ck, "SSND", 4)) {
+            if (!haveComm || len < 8 || avail < 8) return false;
+            unsigned int offset = Be32(body);
+            if (offset > len - 8 || offset > avail - 8) return false;
+            unsigned long long bytes = frames * (unsigned long long)fmt->bytesPerSample * (fmt->channels > 0 ? fmt->channels : 1);
+            unsigned long long inChunk = len - 8 - offset;
+            return SetSampleData(body + 8 + offset, avail - 8 - offset, bytes < inChunk ? bytes : inChunk, fmt);
+        }
+        if (len > avail) return false;
+        pos += 8 + (size_t)len + (len & 1);
+    }
+    return false;
+}
+
+bool ParsePcmFile(const unsigned char* file, size_t size, PcmFormat* fmt) {
+    memset(fmt, 0, sizeof(*fmt));
+    if (!file || size < 12) return false;
+    return ParseWav(file, size, fmt) || ParseAiff(file, size, fmt);
+}
+
+static bool HostIsLittleEndian() {
+    const unsigned short probe = 1;
+    return *(const unsigned char*)&probe == 1;
+}
+
+static short FloatToInt16(double v) {
+    v *= 32768.0;
+    if (v >= 32767.0) return 32767;
+    if (v <= -32768.0) return -32768;
+    return (short)lrint(v);
+}
+
+void PcmToInt16(const PcmFormat& fmt, long long firstFrame, int frames, short* out) {
+    int b = fmt.bytesPerSample;
+    size_t count = (size_t)frames * fmt.channels;
+    const unsigned char* p = fmt.data + (size_t)firstFrame * fmt.channels * b;
+    // Integer containers keep the sample left-justified, so the top two bytes are
+    // the 16-bit value whatever the valid bit count
+    int hi = fmt.bigEndian ? 0 : b - 1, lo = fmt.bigEndian ? 1 : b - 2;
+    if (fmt.isFloat) {
+        bool swap = fmt.bigEndian == HostIsLittleEndian();
+        for (size_t i = 0; i < count; i++, p += b) {
+            unsigned char tmp[8];
+            for (int k = 0; k < b; k++) tmp[k] = swap ? p[b - 1 - k] : p[k];
+            if (b == 4) { float v; memcpy(&v, tmp, 4); out[i] = FloatToInt16(v); }
+            else { double v; memcpy(&v, tmp, 8); out[i] = FloatToInt16(v); }
+        }
+    } else if (b == 1) {
+        int bias = fmt.unsigned8 ? 128 : 0;
+        for (size_t i = 0; i < count; i++)
+            out[i] = (short)((((fmt.unsigned8 ? (int)p[i] : (int)(signed char)p[i]) - bias)) * 256);
+    } else {
+        for (size_t i = 0; i < count; i++, p += b)
+            out[i] = (short)(unsigned short)((p[hi] << 8) | p[lo]);
+    }
+}
+
+const short* PcmAsInt16(const PcmFormat& fmt, std::vector<short>& scratch) {
+    const unsigned char* p = fmt.data;
+    if (fmt.bytesPerSample == 2 && !fmt.isFloat && !fmt.bigEndian && HostIsLittleEndian() &&
+        ((size_t)p & 1) == 0)
+        return (const short*)p;
+
+    scratch.resize((size_t)fmt.frames * fmt.channels);
+    PcmToInt16(fmt, 0, (int)fmt.frames, scratch.data());
+    return scratch.data();
+}
+
+// Integer kernels, one per container size and byte order: the sample is assembled
+// left-justified in 32 bits, so one scale fits every valid bit count
+template <int B, bool BE>
+static void IntToFloat(const unsigned char* p, size_t count, float* out) {
+    const float scale = 1.0f / 2147483648.0f;
+    for (size_t i = 0; i < count; i++, p += B) {
+        unsigned int v = 0;
+        for (int k = 0; k < B; k++) v |= (unsigned int)p[BE ? k : B - 1 - k] << (24 - 8 * k);
+        out[i] = (float)(int)v * scale;
+    }
+}
+
+template <typename F, bool Swap>
+static void FloatToFloat(const unsigned char* p, size_t count, float* out) {
+    for (size_t i = 0; i < count; i++, p += sizeof(F)) {
+        unsigned char tmp[sizeof(F)];
+        for (size_t k = 0; k < sizeof(F); k++) tmp[k] = p[Swap ? sizeof(F) - 1 - k : k];
+        F v;
+        memcpy(&v, tmp, sizeof(F));
+        out[i] = (float)v;
+    }
+}
+
+void PcmToFloat(const PcmFormat& fmt, long long firstFrame, int frames, float* out) {
+    int b = fmt.bytesPerSample;
+    size_t count = (size_t)frames * fmt.channels;
+    const unsigned char* p = fmt.data + (size_t)firstFrame * fmt.channels * b;
+    bool be = fmt.bigEndian;
+    if (fmt.isFloat) {
+        bool swap = be == HostIsLittleEndian();
+        if (b == 4) (swap ? FloatToFloat<float, true> : FloatToFloat<float, false>)(p, count, out);
+        else (swap ? FloatToFloat<double, true> : FloatToFloat<double, false>)(p, count, out);
+    } else if (b == 1) {
+        int bias = fmt.unsigned8 ? 128 : 0;
+        for (size_t i = 0; i < count; i++)
+            out[i] = ((fmt.unsigned8 ? (int)p[i] : (int)(signed char)p[i]) - bias) * (1.0f / 128.0f);
+    } else if (b == 2) {
+        (be ? IntToFloat<2, true> : IntToFloat<2, false>)(p, count, out);
+    } else if (b == 3) {
+        (be ? IntToFloat<3, true> : IntToFloat<3, false>)(p, count, out);
+    } else {
+        (be ? IntToFloat<4, true> : IntToFloat<4, false>)(p, count, out);
+    }
+}
+
+const float* PcmAsFloat(const PcmFormat& fmt, std::vector<float>& scratch) {
+    const unsigned char* p = fmt.data;
+    if (fmt.bytesPerSample == 4 && fmt.isFloat && !fmt.bigEndian && HostIsLittleEndian() &&
+        ((size_t)p & 3) == 0)
+        return (const float*)p;
+
+    scratch.resize((size_t)fmt.frames * fmt.channels);
+    PcmToFloat(fmt, 0, (int)fmt.frames, scratch.data());
+    return scratch.data();
+}
+
+bool ReadPcmFile(const char* path, std::vector<short>& out, int* rate, int* channels) {
+    MappedFile file;
+    PcmFormat fmt;
+    if (!file.Open(path) || !ParsePcmFile(file.Data(), file.Size(), &fmt)) return false;
+    std::vector<short> scratch;
+    const short* pcm = PcmAsInt16(fmt, scratch);
+    out.assign(pcm, pcm + (size_t)fmt.frames * fmt.channels);
+    *rate = fmt.sampleRate; *channels = fmt.channels;
+    return true;
+}
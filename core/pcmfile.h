@@ -0,0 +1,61 @@
+// Uncompressed WAV/AIFF files read straight from a memory mapping
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// Read-only mapping of a whole file (unmapped on Close or destruction)
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);        // UTF-8
+#ifdef _WIN32
+    bool Open(const wchar_t* path);
+#endif
+    void Close();
+
+    const unsigned char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const unsigned char* data = NULL;
+    size_t size = 0;
+};
+
+#define PCM_MAX_RATE 768000         // Higher sample rates are taken as a corrupt header
+
+// Layout of the sample data inside a parsed file
+struct PcmFormat {
+    const unsigned char* data;          // First byte of interleaved sample data
+    long long frames;
+    int sampleRate, channels;
+    int bitsPerSample;                  // Valid bits (e.g. 24 in a 32-bit container)
+    int bytesPerSample;                 // Container size: 1, 2, 3, 4 or 8
+    bool isFloat, bigEndian;
+    bool unsigned8;                     // 8-bit WAV is offset binary, 8-bit AIFF is signed
+    const char* container;              // "wav" or "aiff"
+};
+
+// Locate format and sample data in a RIFF/RIFX/RF64 WAVE or AIFF/AIFC image.
+// Returns false for compressed encodings and malformed headers (use a general decoder).
+bool ParsePcmFile(const unsigned char* file, size_t size, PcmFormat* fmt);
+
+// Interleaved 16-bit samples for the analysis. Returns the mapped bytes themselves
+// when they already are 16-bit little-endian on a little-endian host (zero copy),
+// otherwise converts into scratch. Count is fmt.frames * fmt.channels.
+const short* PcmAsInt16(const PcmFormat& fmt, std::vector<short>& scratch);
+
+// Converts frames [firstFrame, firstFrame + frames) to interleaved 16-bit samples
+void PcmToInt16(const PcmFormat& fmt, long long firstFrame, int frames, short* out);
+
+// Float counterparts in [-1, 1] keeping the full source resolution (zero copy for
+// 32-bit float little-endian data)
+const float* PcmAsFloat(const PcmFormat& fmt, std::vector<float>& scratch);
+void PcmToFloat(const PcmFormat& fmt, long long firstFrame, int frames, float* out);
+
+// Map, parse and copy out 16-bit samples in one call (tests and tools)
+bool ReadPcmFile(const char* path, std::vector<short>& out, int* rate, int* channels);
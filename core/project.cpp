@@ -0,0 +1,104 @@
+#include "project.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROJECT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const float kClamp = 1e9f;
+
+static inline int ToScreen(float offset, float world, float scale) {
+    float v = offset + world * scale;
+    if (!(v > -kClamp)) v = -kClamp;    // Also catches NaN, as the vector max does
+    if (v > kClamp) v = kClamp;
+    return (int)v;
+}
+
+// Compaction without branches: always store, advance only when kept
+static inline int Keep(int* visible, int count, int index, bool keep) {
+    visible[count] = index;
+    return count + (keep ? 1 : 0);
+}
+
+static inline bool Inside(const CullBox& b, int x, int y) {
+    return x >= b.left && x <= b.right && y >= b.top && y <= b.bottom;
+}
+
+static int ProjectRange(const float* x, const float* y, const unsigned char* hidden, int start, int n,
+                        const MapTransform& t, const CullBox& view, const CullBox& hole,
+                        int* screenX, int* screenY, int* visible, int count) {
+    for (int i = start; i < n; i++) {
+        bool h = hidden && hidden[i];
+        int sx = h ? PROJECT_PARKED : ToScreen(t.offsetX, x[i], t.scaleX);
+        int sy = h ? PROJECT_PARKED : ToScreen(t.offsetY, y[i], t.scaleY);
+        screenX[i] = sx;
+        screenY[i] = sy;
+        count = Keep(visible, count, i, !h && Inside(view, sx, sy) && !Inside(hole, sx, sy));
+    }
+    return count;
+}
+
+int ProjectAndCullScalar(const float* x, const float* y, const unsigned char* hidden, int n, const MapTransform& t,
+                         const CullBox& view, const CullBox& hole, int* screenX, int* screenY, int* visible) {
+    return ProjectRange(x, y, hidden, 0, n, t, view, hole, screenX, screenY, visible, 0);
+}
+
+#ifdef PROJECT_SSE2
+// a < v < b for inclusive [a + 1, b - 1] bounds, as a lane mask
+static inline __m128i Between(__m128i v, __m128i below, __m128i above) {
+    return _mm_and_si128(_mm_cmpgt_epi32(v, below), _mm_cmplt_epi32(v, above));
+}
+
+int ProjectAndCull(const float* x, const float* y, const unsigned char* hidden, int n, const MapTransform& t,
+                   const CullBox& view, const CullBox& hole, int* screenX, int* screenY, int* visible) {
+    const __m128 offX = _mm_set1_ps(t.offsetX), scaleX = _mm_set1_ps(t.scaleX);
+    const __m128 offY = _mm_set1_ps(t.offsetY), scaleY = _mm_set1_ps(t.scaleY);
+    const __m128 lo = _mm_set1_ps(-kClamp), hi = _mm_set1_ps(kClamp);
+    const __m128i zero = _mm_setzero_si128(), parked = _mm_set1_epi32(PROJECT_PARKED);
+    const __m128i viewL = _mm_set1_epi32(view.left - 1), viewR = _mm_set1_epi32(view.right + 1);
+    const __m128i viewT = _mm_set1_epi32(view.top - 1), viewB = _mm_set1_epi32(view.bottom + 1);
+    const __m128i holeL = _mm_set1_epi32(hole.left - 1), holeR = _mm_set1_epi32(hole.right + 1);
+    const __m128i holeT = _mm_set1_epi32(hole.top - 1), holeB = _mm_set1_epi32(hole.bottom + 1);
+    // Boxes at the int limits would overflow the +-1 above; leave those to the scalar path
+    bool safe = view.left > -2147483647 && view.top > -2147483647 && view.right < 2147483647 &&
+                view.bottom < 2147483647 && hole.left > -2147483647 && hole.top > -2147483647 &&
+                hole.right < 2147483647 && hole.bottom < 2147483647;
+
+    int count = 0, i = 0;
+    for (; safe && i + 4 <= n; i += 4) {
+        // max(lo, v) first so NaN lanes clamp to -1e9 like the scalar path
+        __m128 fx = _mm_min_ps(_mm_max_ps(_mm_add_ps(offX, _mm_mul_ps(_mm_loadu_ps(x + i), scaleX)), lo), hi);
+        __m128 fy = _mm_min_ps(_mm_max_ps(_mm_add_ps(offY, _mm_mul_ps(_mm_loadu_ps(y + i), scaleY)), lo), hi);
+        __m128i sx = _mm_cvttps_epi32(fx), sy = _mm_cvttps_epi32(fy);
+
+        __m128i hid = zero;
+        if (hidden) {
+            int bytes;
+            memcpy(&bytes, hidden + i, 4);
+            __m128i h = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+            hid = _mm_cmpgt_epi32(h, zero);
+            sx = _mm_or_si128(_mm_and_si128(hid, parked), _mm_andnot_si128(hid, sx));
+            sy = _mm_or_si128(_mm_and_si128(hid, parked), _mm_andnot_si128(hid, sy));
+        }
+        _mm_storeu_si128((__m128i*)(screenX + i), sx);
+        _mm_storeu_si128((__m128i*)(screenY + i), sy);
+
+        __m128i inView = _mm_and_si128(Between(sx, viewL, viewR), Between(sy, viewT, viewB));
+        __m128i inHole = _mm_and_si128(Between(sx, holeL, holeR), Between(sy, holeT, holeB));
+        __m128i keep = _mm_andnot_si128(_mm_or_si128(inHole, hid), inView);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(keep));
+        count = Keep(visible, count, i, (mask & 1) != 0);
+        count = Keep(visible, count, i + 1, (mask & 2) != 0);
+        count = Keep(visible, count, i + 2, (mask & 4) != 0);
+        count = Keep(visible, count, i + 3, (mask & 8) != 0);
+    }
+    return ProjectRange(x, y, hidden, i, n, t, view, hole, screenX, screenY, visible, count);
+}
+#else
+int ProjectAndCull(const float* x, const float* y, const unsigned char* hidden, int n, const MapTransform& t,
+                   const CullBox& view, const CullBox& hole, int* screenX, int* screenY, int* visible) {
+    return ProjectAndCullScalar(x, y, hidden, n, t, view, hole, screenX, screenY, visible);
+}
+#endif
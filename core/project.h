@@ -0,0 +1,28 @@
+// World-to-screen projection and view culling for the map, over flat position arrays
+#pragma once
+
+// Screen coordinate = offset + world * scale, per axis (a negative scale flips the axis)
+struct MapTransform {
+    float offsetX, scaleX;
+    float offsetY, scaleY;
+};
+
+// Inclusive pixel box; left > right makes it empty
+struct CullBox {
+    int left, top, right, bottom;
+};
+
+// Coordinate given to hidden points, far outside any view
+#define PROJECT_PARKED (-100000)
+
+// Projects n positions to integer screen coordinates (truncated towards zero, clamped
+// to +-1e9) and lists, in index order, the points inside view but outside hole (an
+// overlay such as the minimap) whose hidden flag is zero. Hidden points (may be NULL)
+// are parked at PROJECT_PARKED. screenX/screenY receive n entries and visible up to n.
+// Returns the number of visible points. Uses SSE2 where the target has it.
+int ProjectAndCull(const float* x, const float* y, const unsigned char* hidden, int n, const MapTransform& t,
+                   const CullBox& view, const CullBox& hole, int* screenX, int* screenY, int* visible);
+
+// One point at a time; same results (reference for tests and non-SSE2 targets)
+int ProjectAndCullScalar(const float* x, const float* y, const unsigned char* hidden, int n, const MapTransform& t,
+                         const CullBox& view, const CullBox& hole, int* screenX, int* screenY, int* visible);
@@ -0,0 +1,255 @@
+#include "raster.h"
+
+#include <math.h>
+
+enum { SHAPE_DISC, SHAPE_RING, SHAPE_SEGMENT, SHAPE_GLOW };
+
+TileRasterizer::TileRasterizer(int numThreads, int tileSize) : tileSize(tileSize > 8 ? tileSize : 8) {
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    for (int i = 1; i < numThreads; i++) workers.emplace_back(&TileRasterizer::WorkerLoop, this);
+}
+
+TileRasterizer::~TileRasterizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void TileRasterizer::Push(Shape s, float pad) {
+    if (!(s.color >> 24) && !(s.color1 >> 24)) return;
+    s.left = (int)floorf((s.x0 < s.x1 ? s.x0 : s.x1) - pad);
+    s.right = (int)ceilf((s.x0 > s.x1 ? s.x0 : s.x1) + pad);
+    s.top = (int)floorf((s.y0 < s.y1 ? s.y0 : s.y1) - pad);
+    s.bottom = (int)ceilf((s.y0 > s.y1 ? s.y0 : s.y1) + pad);
+    shapes.push_back(s);
+}
+
+void TileRasterizer::Disc(float x, float y, float radius, unsigned int argb) {
+    if (radius <= 0) return;
+    Shape s = { SHAPE_DISC, x, y, x, y, radius, 0, argb, argb, 0, 0, 0, 0 };
+    Push(s, radius + 1.0f);
+}
+
+void TileRasterizer::Ring(float x, float y, float radius, float width, unsigned int argb) {
+    if (radius <= 0 || width <= 0) return;
+    Shape s = { SHAPE_RING, x, y, x, y, radius, width, argb, argb, 0, 0, 0, 0 };
+    Push(s, radius + width * 0.5f + 1.0f);
+}
+
+void TileRasterizer::Segment(float x0, float y0, float x1, float y1, float width, unsigned int from, unsigned int to) {
+    float dx = x1 - x0, dy = y1 - y0;
+    if (width <= 0 || dx * dx + dy * dy < 0.25f) return;
+    Shape s = { SHAPE_SEGMENT, x0, y0, x1, y1, 0, width, from, to, 0, 0, 0, 0 };
+    Push(s, width * 0.5f + 1.0f);
+}
+
+void TileRasterizer::Glow(float x, float y, float radius, unsigned int argb) {
+    if (radius <= 0) return;
+    Shape s = { SHAPE_GLOW, x, y, x, y, radius, 0, argb, argb, 0, 0, 0, 0 };
+    Push(s, radius);
+}
+
+void TileRasterizer::Render(const RasterTarget& t, unsigned int bg, unsigned int gridColor, int step) {
+    if (!t.pixels || t.width <= 0 || t.height <= 0) { shapes.clear(); return; }
+    target = t;
+    background = bg;
+    grid = gridColor;
+    gridStep = step;
+    tilesX = (t.width + tileSize - 1) / tileSize;
+    int tilesY = (t.height + tileSize - 1) / tileSize;
+    tileCount = tilesX * tilesY;
+
+    // Bin in paint order; bins keep their capacity across frames
+    if ((int)bins.size() < tileCount) bins.resize(tileCount);
+    for (int i = 0; i < tileCount; i++) bins[i].clear();
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        const Shape& s = shapes[i];
+        int tx0 = s.left / tileSize, tx1 = s.right / tileSize;
+        int ty0 = s.top / tileSize, ty1 = s.bottom / tileSize;
+        if (s.right < 0 || s.bottom < 0 || tx0 >= tilesX || ty0 >= tilesY) continue;
+        if (tx0 < 0) tx0 = 0;
+        if (ty0 < 0) ty0 = 0;
+        if (tx1 >= tilesX) tx1 = tilesX - 1;
+        if (ty1 >= tilesY) ty1 = tilesY - 1;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++) bins[ty * tilesX + tx].push_back(i);
+    }
+
+    // Every worker joins each job and reports back before Render returns, so none
+    // can still be reading this frame's state when the next one is set up
+    nextTile.store(0);
+    if (!workers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+            idleWorkers = 0;
+        }
+        wake.notify_all();
+    }
+    DrawTiles();
+    if (!workers.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return idleWorkers == (int)workers.size(); });
+    }
+    shapes.clear();
+}
+
+void TileRasterizer::WorkerLoop() {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+        }
+        DrawTiles();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++idleWorkers == (int)workers.size()) finished.notify_all();
+    }
+}
+
+void TileRasterizer::DrawTiles() {
+    for (;;) {
+        int tile = nextTile.fetch_add(1);
+        if (tile >= tileCount) return;
+        DrawTile(tile);
+    }
+}
+
+// Source-over with coverage in [0, 1]; the destination stays opaque
+static inline void Blend(unsigned int* p, unsigned int argb, float coverage) {
+    int a = (int)((argb >> 24) * coverage + 0.5f);
+    if (a <= 0) return;
+    unsigned int d = *p;
+    int dr = (d >> 16) & 255, dg = (d >> 8) & 255, db = d & 255;
+    int sr = (argb >> 16) & 255, sg = (argb >> 8) & 255, sb = argb & 255;
+    dr += ((sr - dr) * a) / 255;
+    dg += ((sg - dg) * a) / 255;
+    db += ((sb - db) * a) / 255;
+    *p = ((unsigned int)dr << 16) | ((unsigned int)dg << 8) | (unsigned int)db;
+}
+
+static inline unsigned int LerpColor(unsigned int a, unsigned int b, float t) {
+    unsigned int out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        float ca = (float)((a >> shift) & 255), cb = (float)((b >> shift) & 255);
+        out |= (unsigned int)(ca + (cb - ca) * t + 0.5f) << shift;
+    }
+    return out;
+}
+
+static inline float Clamp01(float v) { return v < 0 ? 0 : (v > 1 ? 1 : v); }
+
+// Each helper paints one shape clipped to the pixel box [l, r] x [t, b]
+
+// Per row, only the span inside radius + 0.5 is visited and its interior (radius
+// - 0.5) is filled without a square root
+void TileRasterizer::FillDisc(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b) {
+    float inner = s.radius - 0.5f, outer = s.radius + 0.5f;
+    float inner2 = inner > 0 ? inner * inner : 0, outer2 = outer * outer;
+    bool opaque = (s.color >> 24) == 255;
+    unsigned int solid = s.color & 0xffffff;
+    for (int y = t; y <= b; y++) {
+        float py = (float)y - s.y0, dy2 = py * py;
+        if (dy2 >= outer2) continue;
+        float reach = sqrtf(outer2 - dy2), core = dy2 < inner2 ? sqrtf(inner2 - dy2) : -1.0f;
+        int xa = (int)ceilf(s.x0 - reach), xb = (int)floorf(s.x0 + reach);
+        if (xa < l) xa = l;
+        if (xb > r) xb = r;
+        // Fully covered run [ia, ib] (empty: all edge), antialiased edges either side
+        int ia = xb + 1, ib = xb;
+        if (core >= 0) {
+            int ca = (int)ceilf(s.x0 - core), cb = (int)floorf(s.x0 + core);
+            if (ca < xa) ca = xa;
+            if (cb > xb) cb = xb;
+            if (ca <= cb) { ia = ca; ib = cb; }
+        }
+        unsigned int* row = dst.pixels + (size_t)y * dst.stride;
+        auto Edge = [&](int x) {
+            float px = (float)x - s.x0, d2 = px * px + dy2;
+            if (d2 < outer2) Blend(&row[x], s.color, d2 <= inner2 ? 1.0f : Clamp01(outer - sqrtf(d2)));
+        };
+        for (int x = xa; x < ia; x++) Edge(x);
+        if (opaque) for (int x = ia; x <= ib; x++) row[x] = solid;
+        else for (int x = ia; x <= ib; x++) Blend(&row[x], s.color, 1.0f);
+        for (int x = ib + 1; x <= xb; x++) Edge(x);
+    }
+}
+
+void TileRasterizer::StrokeRing(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b) {
+    float half = s.width * 0.5f, outer = s.radius + half + 0.5f, hole = s.radius - half - 0.5f;
+    float outer2 = outer * outer, hole2 = hole > 0 ? hole * hole : -1.0f;
+    for (int y = t; y <= b; y++) {
+        unsigned int* row = dst.pixels + (size_t)y * dst.stride;
+        float py = (float)y - s.y0, dy2 = py * py;
+        if (dy2 >= outer2) continue;
+        for (int x = l; x <= r; x++) {
+            float px = (float)x - s.x0, d2 = px * px + dy2;
+            if (d2 >= outer2 || d2 <= hole2) continue;
+            float d = fabsf(sqrtf(d2) - s.radius) - half;
+            Blend(&row[x], s.color, Clamp01(0.5f - d));
+        }
+    }
+}
+
+void TileRasterizer::FillSegment(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b) {
+    float ux = s.x1 - s.x0, uy = s.y1 - s.y0, len = sqrtf(ux * ux + uy * uy), half = s.width * 0.5f;
+    ux /= len; uy /= len;
+    for (int y = t; y <= b; y++) {
+        unsigned int* row = dst.pixels + (size_t)y * dst.stride;
+        float py = (float)y - s.y0;
+        for (int x = l; x <= r; x++) {
+            float px = (float)x - s.x0;
+            float along = px * ux + py * uy, across = fabsf(py * ux - px * uy);
+            float dSide = across - half, dEnd = along < 0 ? -along : along - len;
+            float d = dSide > dEnd ? dSide : dEnd;
+            if (d >= 0.5f) continue;
+            Blend(&row[x], LerpColor(s.color, s.color1, Clamp01(along / len)), Clamp01(0.5f - d));
+        }
+    }
+}
+
+void TileRasterizer::FillGlow(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b) {
+    float r2 = s.radius * s.radius;
+    for (int y = t; y <= b; y++) {
+        unsigned int* row = dst.pixels + (size_t)y * dst.stride;
+        float py = (float)y - s.y0;
+        for (int x = l; x <= r; x++) {
+            float px = (float)x - s.x0, d2 = px * px + py * py;
+            if (d2 < r2) Blend(&row[x], s.color, 1.0f - sqrtf(d2) / s.radius);
+        }
+    }
+}
+
+void TileRasterizer::DrawTile(int tile) {
+    int x0 = (tile % tilesX) * tileSize, y0 = (tile / tilesX) * tileSize;
+    int x1 = x0 + tileSize, y1 = y0 + tileSize;
+    if (x1 > target.width) x1 = target.width;
+    if (y1 > target.height) y1 = target.height;
+
+    unsigned int bg = background & 0xffffff, line = grid & 0xffffff;
+    int firstColumn = gridStep > 0 ? (x0 + gridStep - 1) / gridStep * gridStep : x1;
+    for (int y = y0; y < y1; y++) {
+        unsigned int* row = target.pixels + (size_t)y * target.stride;
+        unsigned int fill = (gridStep > 0 && y % gridStep == 0) ? line : bg;
+        for (int x = x0; x < x1; x++) row[x] = fill;
+        for (int x = firstColumn; x < x1; x += gridStep) row[x] = line;
+    }
+
+    for (int index : bins[tile]) {
+        const Shape& s = shapes[index];
+        int l = s.left > x0 ? s.left : x0, r = s.right < x1 - 1 ? s.right : x1 - 1;
+        int t = s.top > y0 ? s.top : y0, b = s.bottom < y1 - 1 ? s.bottom : y1 - 1;
+        switch (s.kind) {
+        case SHAPE_DISC: FillDisc(target, s, l, t, r, b); break;
+        case SHAPE_RING: StrokeRing(target, s, l, t, r, b); break;
+        case SHAPE_SEGMENT: FillSegment(target, s, l, t, r, b); break;
+        case SHAPE_GLOW: FillGlow(target, s, l, t, r, b); break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// Tiled software rasteriser for the map layer (background, grid, dots, rings, lines)
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A 32-bit top-down pixel buffer (0x00RRGGBB, i.e. a BI_RGB DIB section)
+struct RasterTarget {
+    unsigned int* pixels;
+    int width, height;
+    int stride;                         // In pixels
+};
+
+// Shapes are queued in paint order, binned into square screen tiles and composited by
+// a persistent worker pool, one tile per task, so no two threads touch the same pixel
+// and the output is identical for any thread count. Colours are 0xAARRGGBB; edges are
+// antialiased over one pixel. Queueing and Render belong to one thread.
+class TileRasterizer {
+public:
+    explicit TileRasterizer(int numThreads = 0, int tileSize = 64);   // 0: one thread per core
+    ~TileRasterizer();
+    TileRasterizer(const TileRasterizer&) = delete;
+    TileRasterizer& operator=(const TileRasterizer&) = delete;
+
+    void Disc(float x, float y, float radius, unsigned int argb);
+    void Ring(float x, float y, float radius, float width, unsigned int argb);
+    // Flat-capped line shaded from one colour to the other along its length
+    void Segment(float x0, float y0, float x1, float y1, float width, unsigned int from, unsigned int to);
+    // Radial fade from argb at the centre to transparent at radius
+    void Glow(float x, float y, float radius, unsigned int argb);
+
+    // Fills target with background (and grid lines every gridStep pixels when gridStep
+    // > 0), composites the queued shapes on top and empties the queue
+    void Render(const RasterTarget& target, unsigned int background, unsigned int grid, int gridStep);
+
+    int Threads() const { return (int)workers.size() + 1; }     // Including the caller
+    int TileSize() const { return tileSize; }
+    int Queued() const { return (int)shapes.size(); }
+
+private:
+    struct Shape {
+        unsigned char kind;
+        float x0, y0, x1, y1;           // Centre, or segment endpoints
+        float radius, width;
+        unsigned int color, color1;
+        int left, top, right, bottom;   // Pixel bounds (inclusive)
+    };
+
+    int tileSize;
+    std::vector<Shape> shapes;
+    std::vector<std::vector<int>> bins;  // Shape indices per tile, in paint order
+
+    // Current job, set before the generation is bumped
+    RasterTarget target = {};
+    unsigned int background = 0, grid = 0;
+    int gridStep = 0, tilesX = 0, tileCount = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    unsigned generation = 0;
+    int idleWorkers = 0;                // Workers done with the current generation
+    bool quit = false;
+    std::atomic<int> nextTile{ 0 };
+
+    void Push(Shape s, float pad);     // Fills the bounds: the endpoints grown by pad
+    void WorkerLoop();
+    void DrawTiles();
+    void DrawTile(int tile);
+    static void FillDisc(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b);
+    static void StrokeRing(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b);
+    static void FillSegment(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b);
+    static void FillGlow(const RasterTarget& dst, const Shape& s, int l, int t, int r, int b);
+};
@@ -0,0 +1,164 @@
+#include "rhythm.h"
+#include "dsp.h"
+
+#include <math.h>
+#include <vector>
+
+float OnsetEnvelope(const float* mono, int frames, int rate, std::vector<float>& flux) {
+    flux.clear();
+    if (!mono || rate <= 0 || frames <= 0) return 0.0f;
+    // Onsets need no top octave: 32 kHz and up is averaged down to half the rate, which
+    // halves the transform (the FFT is nearly all of the cost)
+    std::vector<float> half;
+    if (rate >= 32000) {
+        half.resize(frames / 2);
+        for (int i = 0; i < frames / 2; i++) half[i] = 0.5f * (mono[2 * i] + mono[2 * i + 1]);
+        mono = half.data(); frames /= 2; rate /= 2;
+    }
+    int win = (int)(rate * 0.0232f + 0.5f), hop = (int)(rate * 0.0116f + 0.5f);
+    int n = 64;
+    while (n < win) n *= 2;
+    if (hop < 1 || frames < win || win > 65536) return 0.0f;
+    int hops = (frames - win) / hop + 1;
+    flux.assign(hops, 0.0f);
+
+    // 40 log-spaced bands from 40 Hz to 16 kHz (or near Nyquist), at least a bin each
+    const int bands = 40;
+    int bandBin[bands + 1];
+    float top = rate * 0.45f < 16000.0f ? rate * 0.45f : 16000.0f;
+    for (int b = 0; b <= bands; b++) {
+        bandBin[b] = (int)(40.0f * powf(top / 40.0f, (float)b / bands) * n / rate + 0.5f);
+        if (b > 0 && bandBin[b] <= bandBin[b - 1]) bandBin[b] = bandBin[b - 1] + 1;
+    }
+    if (bandBin[bands] > n / 2) return 0.0f;
+
+    // Band power scaled so a full-scale sine peaks near 1, compressed as log(1 + 1e4 p)
+    float scale = 1e4f * 16.0f / ((float)win * win) * 0.25f;
+    std::vector<float> window(win), re(n), im(n), prev(bands, 0.0f);
+    for (int i = 0; i < win; i++) window[i] = 0.5f - 0.5f * cosf(6.2831853f * i / (win - 1));
+
+    // Two real frames per complex FFT (one in re, one in im), separated by symmetry
+    for (int h = 0; h < hops; h += 2) {
+        bool pair = h + 1 < hops;
+        const float* pa = mono + (size_t)h * hop;
+        const float* pb = pair ? pa + hop : NULL;
+        for (int i = 0; i < win; i++) { re[i] = pa[i] * window[i]; im[i] = pb ? pb[i] * window[i] : 0.0f; }
+        for (int i = win; i < n; i++) re[i] = im[i] = 0.0f;
+        FftRadix2(re.data(), im.data(), n);
+        float fa = 0.0f, fb = 0.0f;
+        for (int b = 0; b < bands; b++) {
+            float sa = 0.0f, sb = 0.0f;
+            for (int k = bandBin[b]; k < bandBin[b + 1]; k++) {
+                float zr = re[k], zi = im[k], cr = re[n - k], ci = -im[n - k];
+                float ar = zr + cr, ai = zi + ci, br = zi - ci, bi = cr - zr;
+                sa += ar * ar + ai * ai; sb += br * br + bi * bi;
+            }
+            float la = logf(1.0f + scale * sa), lb = logf(1.0f + scale * sb);
+            float da = la - prev[b], db = lb - la;
+            fa += da > 0.0f ? da : 0.0f;
+            fb += db > 0.0f ? db : 0.0f;
+            prev[b] = pair ? lb : la;
+        }
+        flux[h] = fa;
+        if (pair) flux[h + 1] = fb;
+    }
+    return (float)rate / hop;
+}
+
+bool AnalyzeRhythm(const float* mono, int frames, int totalFrames, int rate, Rhythm* out) {
+    out->onsets = 0; out->tempo = 0.0f; out->loopability = 0.0f;
+    std::vector<float> flux;
+    float fps = OnsetEnvelope(mono, frames, rate, flux);
+    int hops = (int)flux.size();
+    if (fps <= 0.0f) return false;
+    float peak = 0.0f;
+    for (float f : flux) peak = f > peak ? f : peak;
+    if (peak <= 0.0f) return true;
+
+    // Onsets, and the novelty (flux above its neighbourhood mean) the tempo is read from
+    int w = (int)(0.1f * fps + 0.5f), m = (int)(0.03f * fps + 0.5f), gap = (int)(0.05f * fps + 0.5f);
+    std::vector<double> prefix(hops + 1, 0.0);
+    for (int t = 0; t < hops; t++) prefix[t + 1] = prefix[t] + flux[t];
+    std::vector<float> novelty(hops);
+    int last = -gap - 1;
+    for (int t = 0; t < hops; t++) {
+        int lo = t - w > 0 ? t - w : 0, hi = t + w + 1 < hops ? t + w + 1 : hops;
+        float mean = (float)((prefix[hi] - prefix[lo]) / (hi - lo));
+        novelty[t] = flux[t] > mean ? flux[t] - mean : 0.0f;
+        if (flux[t] < 0.1f * peak || flux[t] < mean + 0.05f * peak || t - last < gap) continue;
+        bool isMax = true;  // Ties go to the first frame
+        for (int u = t - m; u <= t + m && isMax; u++)
+            if (u >= 0 && u < hops && u != t && (flux[u] > flux[t] || (flux[u] == flux[t] && u < t))) isMax = false;
+        if (isMax) { out->onsets++; last = t; }
+    }
+
+    // Autocorrelation (per overlapping hop, relative to lag 0) of the novelty, smoothed
+    // over five hops so beats between two lags keep their peak, at the candidate beat
+    // lags; the range needs two beats of envelope
+    int minLag = (int)(fps * 60.0f / 200.0f), maxLag = (int)ceilf(fps * 60.0f / 60.0f);
+    if (minLag < 2) minLag = 2;
+    if (maxLag > hops / 2) maxLag = hops / 2;
+    std::vector<float> smooth(hops);
+    double mean = 0.0, r0 = 0.0;
+    for (int t = 0; t < hops; t++) {
+        float sum = 0.0f, weight = 0.0f;
+        for (int d = -2; d <= 2; d++) {
+            if (t + d < 0 || t + d >= hops) continue;
+            float k = 3.0f - (d < 0 ? -d : d);
+            sum += k * novelty[t + d]; weight += k;
+        }
+        smooth[t] = sum / weight;
+        mean += smooth[t];
+    }
+    mean /= hops;
+    for (int t = 0; t < hops; t++) { smooth[t] -= (float)mean; r0 += (double)smooth[t] * smooth[t]; }
+    r0 /= hops;
+    if (r0 <= 0.0 || maxLag < minLag + 2) return true;
+    std::vector<float> acf(maxLag + 2, 0.0f);
+    for (int lag = minLag - 1; lag <= maxLag + 1; lag++) {
+        double s = 0.0;
+        for (int t = 0; t + lag < hops; t++) s += (double)smooth[t] * smooth[t + lag];
+        acf[lag] = (float)(s / (hops - lag) / r0);
+    }
+
+    // Each peak, refined between lags, is weighted towards 120 BPM. Trimmed loops hold a
+    // whole number of beats (1, 2, 3 or whole 4/4 bars): a peak within 2% of one snaps
+    // to it, and in a whole file one that does not counts half.
+    bool whole = totalFrames <= frames, snapped = false;
+    double seconds = (double)frames / rate;
+    float tempo = 0.0f, pulse = 0.0f, bestScore = 0.0f;
+    for (int lag = minLag; lag <= maxLag; lag++) {
+        if (acf[lag] < 0.25f || acf[lag] < acf[lag - 1] || acf[lag] < acf[lag + 1]) continue;
+        float curve = acf[lag - 1] - 2.0f * acf[lag] + acf[lag + 1];
+        float shift = curve < 0.0f ? 0.5f * (acf[lag - 1] - acf[lag + 1]) / curve : 0.0f;
+        if (shift > 0.5f) shift = 0.5f;
+        if (shift < -0.5f) shift = -0.5f;
+        float bpm = 60.0f * fps / (lag + shift), nearest = 0.0f, err = 0.02f;
+        for (int beats = 1; whole && beats <= 512; beats = beats < 4 ? beats + 1 : beats + 4) {
+            float fit = (float)(60.0 * beats / seconds), e = fabsf(fit - bpm) / bpm;
+            if (e <= err) { err = e; nearest = fit; }
+        }
+        float octaves = log2f(bpm / 120.0f);
+        float score = acf[lag] * expf(-0.5f * octaves * octaves) * (whole && nearest == 0.0f ? 0.5f : 1.0f);
+        if (score <= bestScore) continue;
+        bestScore = score;
+        pulse = acf[lag] < 1.0f ? acf[lag] : 1.0f;
+        snapped = nearest > 0.0f;
+        tempo = snapped ? nearest : bpm;
+    }
+    if (tempo <= 0.0f) return true;
+    out->tempo = tempo;
+
+    // A loop's last beat sounds like its first; a one-shot has decayed by then
+    int beat = (int)(60.0f / tempo * rate);
+    if (beat > frames / 4) beat = frames / 4;
+    if (!whole || beat < 1) return true;
+    double first = 0.0, end = 0.0;
+    for (int i = 0; i < beat; i++) {
+        first += (double)mono[i] * mono[i];
+        end += (double)mono[frames - beat + i] * mono[frames - beat + i];
+    }
+    float match = (first > 0.0 && end > 0.0) ? (float)sqrt((first < end ? first : end) / (first > end ? first : end)) : 0.0f;
+    out->loopability = pulse * match * (snapped ? 1.0f : 0.5f);
+    return true;
+}
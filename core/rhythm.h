@@ -0,0 +1,26 @@
+// Rhythm analysis: spectral-flux onsets, tempo and a loop score
+#pragma once
+
+#include <vector>
+
+struct Rhythm {
+    int onsets;             // Detected hits/notes
+    float tempo;            // BPM in 60-200, 0 without a steady pulse
+    float loopability;      // 0..1, see AnalyzeRhythm
+};
+
+// Onset strength per 11.6 ms hop: the summed rise in log-compressed power of 40
+// log-spaced bands (40 Hz to 0.45 of the analysed rate) of a 23 ms Hann frame over the
+// frame before (spectral flux; the first frame rises from silence). Rates from 32 kHz
+// are analysed at half rate. Returns hops per second, 0 if the input is shorter than
+// one frame.
+float OnsetEnvelope(const float* mono, int frames, int rate, std::vector<float>& flux);
+
+// Onsets are flux peaks standing above their 100 ms neighbourhood, at least 50 ms
+// apart. The tempo is the autocorrelation peak of the flux above that neighbourhood
+// between 60 and 200 BPM, weighted towards 120, and snaps to a whole number of beats
+// over the file (1-3 or a multiple of 4) when one is within 2%. Loopability is the
+// pulse strength (the autocorrelation at the beat) times how closely the level of the
+// last beat matches the first, halved unless the length snapped. mono may hold only
+// the start of a longer file (totalFrames); those are never scored as loops.
+bool AnalyzeRhythm(const float* mono, int frames, int totalFrames, int rate, Rhythm* out);
@@ -0,0 +1,161 @@
+#include "selection.h"
+
+#include <math.h>
+#include <algorithm>
+#include <bitset>
+
+// Ray-to-+x crossing of edge (i, j); shared so the grid and the reference agree exactly
+static inline bool Crosses(float x, float y, float xi, float yi, float xj, float yj) {
+    return (yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi;
+}
+
+bool PointInPolygon(float x, float y, const float* px, const float* py, int m) {
+    if (m < 3) return false;
+    bool inside = false;
+    float minX = px[0], maxX = px[0];
+    for (int i = 0, j = m - 1; i < m; j = i++) {
+        if (Crosses(x, y, px[i], py[i], px[j], py[j])) inside = !inside;
+        minX = std::min(minX, px[i]);
+        maxX = std::max(maxX, px[i]);
+    }
+    // Rounding in the crossing can reach past the outline; the bounding box is exact
+    return inside && x >= minX && x <= maxX;
+}
+
+// Puts a query result in index order: a sort when it is small, else a pass over a bitmap
+// of all points (linear in the result, so large selections stay cheap)
+void PointGrid::SortIds(std::vector<int>& out) const {
+    if (out.size() * 64 < (size_t)n) { std::sort(out.begin(), out.end()); return; }
+    std::vector<unsigned long long> marks(((size_t)n + 63) / 64, 0);
+    for (int id : out) marks[id >> 6] |= 1ULL << (id & 63);
+    size_t k = 0;
+    for (size_t w = 0; w < marks.size(); w++)
+        for (unsigned long long bits = marks[w]; bits; bits &= bits - 1)
+            out[k++] = (int)(w * 64) + (int)std::bitset<64>((bits & (0 - bits)) - 1).count();
+}
+
+int PointGrid::Column(float x) const {
+    float f = (x - originX) * invCellW;
+    if (!(f > 0.0f)) return 0;
+    if (f >= (float)cellsX) return cellsX - 1;
+    return (int)f;
+}
+
+int PointGrid::Row(float y) const {
+    float f = (y - originY) * invCellH;
+    if (!(f > 0.0f)) return 0;
+    if (f >= (float)cellsY) return cellsY - 1;
+    return (int)f;
+}
+
+void PointGrid::Build(const float* x, const float* y, int count) {
+    n = count > 0 ? count : 0;
+    float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+    int finite = 0;
+    for (int i = 0; i < n; i++) {
+        if (!isfinite(x[i]) || !isfinite(y[i])) continue;
+        minX = std::min(minX, x[i]); maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]); maxY = std::max(maxY, y[i]);
+        finite++;
+    }
+    if (finite == 0) minX = maxX = minY = maxY = 0.0f;
+
+    // About two points per cell, shaped to the bounds
+    double target = finite > 2 ? finite / 2.0 : 1.0;
+    double w = (double)maxX - minX, h = (double)maxY - minY, cx = 1, cy = 1;
+    if (w > 0 && h > 0) { cx = sqrt(target * w / h); cy = target / cx; }
+    else if (w > 0) cx = target;
+    else if (h > 0) cy = target;
+    cellsX = (int)std::min(std::max(cx, 1.0), 2048.0);
+    cellsY = (int)std::min(std::max(cy, 1.0), 2048.0);
+    originX = minX; originY = minY;
+    invCellW = w > 0 ? (float)(cellsX / w) : 0.0f;
+    invCellH = h > 0 ? (float)(cellsY / h) : 0.0f;
+
+    // Counting sort by cell, keeping index order inside each cell
+    std::vector<int> cellOf(n);
+    cellStart.assign((size_t)cellsX * cellsY + 1, 0);
+    for (int i = 0; i < n; i++) {
+        cellOf[i] = (isfinite(x[i]) && isfinite(y[i])) ? Row(y[i]) * cellsX + Column(x[i]) : -1;
+        if (cellOf[i] >= 0) cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+    ids.resize(finite);
+    cellX.resize(finite);
+    cellY.resize(finite);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < n; i++) {
+        if (cellOf[i] < 0) continue;
+        int k = fill[cellOf[i]]++;
+        ids[k] = i; cellX[k] = x[i]; cellY[k] = y[i];
+    }
+}
+
+void PointGrid::QueryRect(float minX, float minY, float maxX, float maxY, std::vector<int>& out) const {
+    out.clear();
+    if (ids.empty() || minX != minX || minY != minY || maxX != maxX || maxY != maxY) return;
+    if (minX > maxX) std::swap(minX, maxX);
+    if (minY > maxY) std::swap(minY, maxY);
+    // The cell mapping is monotonic, so cells strictly between the corner cells hold
+    // only points inside the rectangle
+    int c0 = Column(minX), c1 = Column(maxX), r0 = Row(minY), r1 = Row(maxY);
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            int cell = r * cellsX + c, begin = cellStart[cell], end = cellStart[cell + 1];
+            if (c > c0 && c < c1 && r > r0 && r < r1) {
+                out.insert(out.end(), ids.begin() + begin, ids.begin() + end);
+                continue;
+            }
+            for (int k = begin; k < end; k++)
+                if (cellX[k] >= minX && cellX[k] <= maxX && cellY[k] >= minY && cellY[k] <= maxY) out.push_back(ids[k]);
+        }
+    }
+    SortIds(out);
+}
+
+void PointGrid::QueryLasso(const float* px, const float* py, int m, std::vector<int>& out) const {
+    out.clear();
+    if (ids.empty() || m < 3) return;
+    float minX = px[0], maxX = px[0], minY = py[0], maxY = py[0];
+    for (int i = 1; i < m; i++) {
+        minX = std::min(minX, px[i]); maxX = std::max(maxX, px[i]);
+        minY = std::min(minY, py[i]); maxY = std::max(maxY, py[i]);
+    }
+    if (minX != minX || minY != minY) return;
+    int c0 = Column(minX), c1 = Column(maxX), r0 = Row(minY), r1 = Row(maxY), rows = r1 - r0 + 1;
+
+    // Bucket the edges by the grid rows their y-span covers; an edge can only be
+    // crossed by points of those rows
+    std::vector<int> rowStart(rows + 1, 0), rowEdges;
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<int> fill(rowStart.begin(), rowStart.end() - 1);
+        for (int i = 0, j = m - 1; i < m; j = i++) {
+            int e0 = Row(std::min(py[i], py[j])) - r0, e1 = Row(std::max(py[i], py[j])) - r0;
+            for (int r = e0; r <= e1; r++) {
+                if (pass == 0) rowStart[r + 1]++;
+                else rowEdges[fill[r]++] = i;
+            }
+        }
+        if (pass == 0) {
+            for (int r = 0; r < rows; r++) rowStart[r + 1] += rowStart[r];
+            rowEdges.resize(rowStart[rows]);
+        }
+    }
+
+    for (int r = r0; r <= r1; r++) {
+        const int* edges = rowEdges.data() + rowStart[r - r0];
+        int edgeCount = rowStart[r - r0 + 1] - rowStart[r - r0];
+        if (edgeCount == 0) continue;
+        for (int k = cellStart[r * cellsX + c0]; k < cellStart[r * cellsX + c1 + 1]; k++) {
+            float x = cellX[k], y = cellY[k];
+            if (x < minX || x > maxX) continue;
+            bool inside = false;
+            for (int e = 0; e < edgeCount; e++) {
+                int i = edges[e], j = i ? i - 1 : m - 1;
+                if (Crosses(x, y, px[i], py[i], px[j], py[j])) inside = !inside;
+            }
+            if (inside) out.push_back(ids[k]);
+        }
+    }
+    SortIds(out);
+}
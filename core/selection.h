@@ -0,0 +1,35 @@
+// Map selection: rectangle and lasso queries over 2D points
+#pragma once
+
+#include <vector>
+
+// Even-odd test of (x, y) against the closed polygon px/py (m vertices)
+bool PointInPolygon(float x, float y, const float* px, const float* py, int m);
+
+// Uniform grid over 2D points (about two per cell) with each cell's points stored
+// contiguously. Queries visit only the cells a shape overlaps: cells wholly inside a
+// rectangle are taken without per-point tests, and a lasso tests each point only
+// against the polygon edges that cross its grid row. Points with a NaN or infinite
+// coordinate are never selected.
+class PointGrid {
+public:
+    void Build(const float* x, const float* y, int n);
+    int Size() const { return n; }
+
+    // Points with minX <= x <= maxX and minY <= y <= maxY (bounds in either order),
+    // in ascending index order
+    void QueryRect(float minX, float minY, float maxX, float maxY, std::vector<int>& out) const;
+    // Points PointInPolygon accepts, in ascending index order
+    void QueryLasso(const float* px, const float* py, int m, std::vector<int>& out) const;
+
+private:
+    int n = 0, cellsX = 0, cellsY = 0;
+    float originX = 0, originY = 0, invCellW = 0, invCellH = 0;
+    std::vector<int> cellStart;         // cellsX * cellsY + 1 offsets into the arrays below
+    std::vector<int> ids;               // Point indices by cell
+    std::vector<float> cellX, cellY;    // Their coordinates, in the same order
+
+    int Column(float x) const;
+    int Row(float y) const;
+    void SortIds(std::vector<int>& out) const;
+};
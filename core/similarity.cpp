@@ -0,0 +1,245 @@
+#include "similarity.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+void SimilarityIndex::Build(const float* feats, int n) {
+    Clear();
+    if (n <= 0) return;
+    ComputeScaling(feats, n);
+
+    std::vector<float> z((size_t)n * FEATURE_DIM);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) Normalize(feats + (size_t)i * FEATURE_DIM, &z[(size_t)i * FEATURE_DIM]);
+    });
+
+    nlist = (int)sqrtf((float)n);
+    if (nlist < 1) nlist = 1;
+    if (nlist > 4096) nlist = 4096;
+    Train(z.data(), n);
+
+    std::vector<int> assign(n);
+    ParallelRanges(n, numThreads, [&](int start, int end) {
+        for (int i = start; i < end; i++) assign[i] = NearestList(&z[(size_t)i * FEATURE_DIM]);
+    });
+    lists.assign(nlist, List());
+    listOf.assign(n, -1);
+    slotOf.assign(n, -1);
+    for (int i = 0; i < n; i++) Insert(i, &z[(size_t)i * FEATURE_DIM], assign[i]);
+}
+
+void SimilarityIndex::Add(int id, const float* feat) {
+    if (nlist == 0) return;
+    float z[FEATURE_DIM];
+    Normalize(feat, z);
+    if (id >= (int)listOf.size()) { listOf.resize(id + 1, -1); slotOf.resize(id + 1, -1); }
+    if (listOf[id] >= 0) Remove(id);
+    Insert(id, z, NearestList(z));
+}
+
+void SimilarityIndex::Remove(int id) {
+    if (id < 0 || id >= (int)listOf.size() || listOf[id] < 0) return;
+    List& l = lists[listOf[id]];
+    int slot = slotOf[id], last = (int)l.ids.size() - 1;
+    if (slot != last) {
+        l.ids[slot] = l.ids[last];
+        memcpy(&l.vecs[(size_t)slot * FEATURE_DIM], &l.vecs[(size_t)last * FEATURE_DIM], sizeof(float) * FEATURE_DIM);
+        slotOf[l.ids[slot]] = slot;
+    }
+    l.ids.pop_back();
+    l.vecs.resize((size_t)last * FEATURE_DIM);
+    listOf[id] = -1; slotOf[id] = -1;
+}
+
+int SimilarityIndex::Query(const float* feat, int k, int exclude, int* outIds, float* outDist) const {
+    if (nlist == 0 || k <= 0) return 0;
+    float z[FEATURE_DIM];
+    Normalize(feat, z);
+    return Search(z, k, exclude, outIds, outDist);
+}
+
+int SimilarityIndex::QueryId(int id, int k, int* outIds, float* outDist) const {
+    if (id < 0 || id >= (int)listOf.size() || listOf[id] < 0) return 0;
+    const float* z = &lists[listOf[id]].vecs[(size_t)slotOf[id] * FEATURE_DIM];
+    return Search(z, k, id, outIds, outDist);
+}
+
+int SimilarityIndex::Size() const {
+    int total = 0;
+    for (const List& l : lists) total += (int)l.ids.size();
+    return total;
+}
+
+bool SimilarityIndex::Save(FILE* f, const unsigned long long* keys, const float* feats, int n) const {
+    int header[4] = { 0x58495641 /* AVIX */, 1, FEATURE_DIM, nlist };
+    if (fwrite(header, sizeof(header), 1, f) != 1 ||
+        fwrite(mean, sizeof(mean), 1, f) != 1 || fwrite(invStd, sizeof(invStd), 1, f) != 1 ||
+        fwrite(centroids.data(), sizeof(float), centroids.size(), f) != centroids.size() ||
+        fwrite(&n, sizeof(n), 1, f) != 1) return false;
+    for (int i = 0; i < n; i++) {
+        Entry e = { keys[i], FeatureHash(feats + (size_t)i * FEATURE_DIM), (i < (int)listOf.size()) ? listOf[i] : -1 };
+        if (fwrite(&e, sizeof(e), 1, f) != 1) return false;
+    }
+    return true;
+}
+
+bool SimilarityIndex::Load(FILE* f, const unsigned long long* keys, const float* feats, int n) {
+    Clear();
+    int header[4];
+    if (fread(header, sizeof(header), 1, f) != 1) return false;
+    if (header[0] != 0x58495641 || header[1] != 1 || header[2] != FEATURE_DIM || header[3] <= 0) return false;
+
+    // List and entry counts come from the file: check them against the bytes left
+    // before allocating
+    long at = ftell(f);
+    if (at < 0 || fseek(f, 0, SEEK_END) != 0) return false;
+    long left = ftell(f) - at;
+    if (fseek(f, at, SEEK_SET) != 0 || left < 0) return false;
+    size_t fixed = sizeof(mean) + sizeof(invStd) + sizeof(int);
+    if ((size_t)left < fixed || (size_t)header[3] > ((size_t)left - fixed) / (sizeof(float) * FEATURE_DIM)) return false;
+    nlist = header[3];
+    centroids.resize((size_t)nlist * FEATURE_DIM);
+    int count = 0;
+    if (fread(mean, sizeof(mean), 1, f) != 1 || fread(invStd, sizeof(invStd), 1, f) != 1 ||
+        fread(centroids.data(), sizeof(float), centroids.size(), f) != centroids.size() ||
+        fread(&count, sizeof(count), 1, f) != 1 || count < 0 ||
+        (size_t)count > ((size_t)left - fixed - centroids.size() * sizeof(float)) / sizeof(Entry)) { Clear(); return false; }
+
+    std::vector<Entry> saved(count);
+    if (count > 0 && fread(saved.data(), sizeof(Entry), count, f) != (size_t)count) { Clear(); return false; }
+    std::sort(saved.begin(), saved.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    lists.assign(nlist, List());
+    listOf.assign(n, -1);
+    slotOf.assign(n, -1);
+    int stale = 0;
+    for (int i = 0; i < n; i++) {
+        float z[FEATURE_DIM];
+        const float* feat = feats + (size_t)i * FEATURE_DIM;
+        Normalize(feat, z);
+        Entry probe = { keys[i], 0, 0 };
+        auto it = std::lower_bound(saved.begin(), saved.end(), probe,
+                                   [](const Entry& a, const Entry& b) { return a.key < b.key; });
+        int list = -1;
+        if (it != saved.end() && it->key == keys[i] && it->featHash == FeatureHash(feat) &&
+            it->list >= 0 && it->list < nlist) list = it->list;
+        if (list < 0) { list = NearestList(z); stale++; }
+        Insert(i, z, list);
+    }
+    // Too much drift: the quantizer should be retrained
+    if (n > 0 && stale * 4 > n) { Clear(); return false; }
+    return true;
+}
+
+unsigned int SimilarityIndex::FeatureHash(const float* feat) {
+    return (unsigned int)HashBytes(feat, sizeof(float) * FEATURE_DIM);
+}
+
+void SimilarityIndex::ComputeScaling(const float* feats, int n) {
+    for (int d = 0; d < FEATURE_DIM; d++) {
+        double sum = 0, sumSq = 0;
+        for (int i = 0; i < n; i++) { double v = feats[(size_t)i * FEATURE_DIM + d]; sum += v; sumSq += v * v; }
+        double m = sum / n, var = sumSq / n - m * m;
+        mean[d] = (float)m;
+        invStd[d] = (var > 1e-12) ? (float)(1.0 / sqrt(var)) : 0.0f;
+    }
+}
+
+void SimilarityIndex::Normalize(const float* in, float* out) const {
+    for (int d = 0; d < FEATURE_DIM; d++) out[d] = (in[d] - mean[d]) * invStd[d];
+}
+
+float SimilarityIndex::Dist(const float* a, const float* b) {
+    float s = 0;
+    for (int d = 0; d < FEATURE_DIM; d++) { float t = a[d] - b[d]; s += t * t; }
+    return s;
+}
+
+int SimilarityIndex::NearestList(const float* z) const {
+    int best = 0; float bestD = FLT_MAX;
+    for (int c = 0; c < nlist; c++) {
+        float d = Dist(z, &centroids[(size_t)c * FEATURE_DIM]);
+        if (d < bestD) { bestD = d; best = c; }
+    }
+    return best;
+}
+
+void SimilarityIndex::Insert(int id, const float* z, int list) {
+    List& l = lists[list];
+    listOf[id] = list;
+    slotOf[id] = (int)l.ids.size();
+    l.ids.push_back(id);
+    l.vecs.insert(l.vecs.end(), z, z + FEATURE_DIM);
+}
+
+void SimilarityIndex::Train(const float* z, int n) {
+    int m = nlist * 64;
+    if (m > n) m = n;
+    std::vector<float> train((size_t)m * FEATURE_DIM);
+    for (int i = 0; i < m; i++)
+        memcpy(&train[(size_t)i * FEATURE_DIM], z + (size_t)((long long)i * n / m) * FEATURE_DIM, sizeof(float) * FEATURE_DIM);
+
+    centroids.resize((size_t)nlist * FEATURE_DIM);
+    for (int c = 0; c < nlist; c++)
+        memcpy(&centroids[(size_t)c * FEATURE_DIM], &train[(size_t)((long long)c * m / nlist) * FEATURE_DIM], sizeof(float) * FEATURE_DIM);
+
+    std::vector<int> assign(m);
+    std::vector<double> sums((size_t)nlist * FEATURE_DIM);
+    std::vector<int> counts(nlist);
+    for (int iter = 0; iter < 20; iter++) {
+        ParallelRanges(m, numThreads, [&](int start, int end) {
+            for (int i = start; i < end; i++) assign[i] = NearestList(&train[(size_t)i * FEATURE_DIM]);
+        });
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (int i = 0; i < m; i++) {
+            counts[assign[i]]++;
+            for (int d = 0; d < FEATURE_DIM; d++) sums[(size_t)assign[i] * FEATURE_DIM + d] += train[(size_t)i * FEATURE_DIM + d];
+        }
+        for (int c = 0; c < nlist; c++) {
+            float* cen = &centroids[(size_t)c * FEATURE_DIM];
+            if (counts[c] == 0) {
+                // Reseed empty cells from a pseudo-random training point
+                int pick = (int)(HashU32(c * 7919 + iter) % (unsigned int)m);
+                memcpy(cen, &train[(size_t)pick * FEATURE_DIM], sizeof(float) * FEATURE_DIM);
+                continue;
+            }
+            for (int d = 0; d < FEATURE_DIM; d++) cen[d] = (float)(sums[(size_t)c * FEATURE_DIM + d] / counts[c]);
+        }
+    }
+}
+
+int SimilarityIndex::Search(const float* z, int k, int exclude, int* outIds, float* outDist) const {
+    if (k > MAX_SIMILAR) k = MAX_SIMILAR;
+    int probes = nprobe < nlist ? nprobe : nlist;
+    if (probes > MAX_SIMILAR) probes = MAX_SIMILAR;
+
+    // Closest cells (sorted insertion into a small fixed array)
+    int cell[MAX_SIMILAR]; float cellD[MAX_SIMILAR]; int numCells = 0;
+    for (int c = 0; c < nlist; c++) {
+        float d = Dist(z, &centroids[(size_t)c * FEATURE_DIM]);
+        if (numCells == probes && d >= cellD[probes - 1]) continue;
+        int pos = (numCells < probes) ? numCells++ : probes - 1;
+        while (pos > 0 && cellD[pos - 1] > d) { cellD[pos] = cellD[pos - 1]; cell[pos] = cell[pos - 1]; pos--; }
+        cellD[pos] = d; cell[pos] = c;
+    }
+
+    int found = 0;
+    for (int p = 0; p < numCells; p++) {
+        const List& l = lists[cell[p]];
+        const float* v = l.vecs.data();
+        for (size_t j = 0; j < l.ids.size(); j++, v += FEATURE_DIM) {
+            int id = l.ids[j];
+            if (id == exclude) continue;
+            float d = Dist(z, v);
+            if (found == k && d >= outDist[k - 1]) continue;
+            int pos = (found < k) ? found++ : k - 1;
+            while (pos > 0 && outDist[pos - 1] > d) { outDist[pos] = outDist[pos - 1]; outIds[pos] = outIds[pos - 1]; pos--; }
+            outDist[pos] = d; outIds[pos] = id;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,60 @@
+// Approximate nearest-neighbour search over feature vectors
+#pragma once
+
+#include "features.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define MAX_SIMILAR 64
+
+// Inverted-file (IVF) approximate nearest-neighbour index over feature vectors.
+// A k-means coarse quantizer splits feature space into ~sqrt(n) cells; a query
+// only scans the vectors stored in its nprobe closest cells.
+class SimilarityIndex {
+public:
+    int nprobe = 12;
+    int numThreads = 0;
+
+    void Build(const float* feats, int n);
+
+    // Incremental maintenance (ids are sample indices)
+    void Add(int id, const float* feat);
+    void Remove(int id);
+
+    // k nearest (squared distance in standardized space, ascending), skipping 'exclude'
+    int Query(const float* feat, int k, int exclude, int* outIds, float* outDist) const;
+    int QueryId(int id, int k, int* outIds, float* outDist) const;
+    int Size() const;
+
+    // Persist the quantizer and each entry's cell, keyed by the caller (e.g. path hash);
+    // false when a write fails, leaving the file for the caller to remove
+    bool Save(FILE* f, const unsigned long long* keys, const float* feats, int n) const;
+
+    // Rebuild lists for the current sample set from a saved index. Entries whose key or
+    // features changed are reassigned; fails if the saved quantizer no longer fits.
+    bool Load(FILE* f, const unsigned long long* keys, const float* feats, int n);
+
+private:
+    struct List { std::vector<int> ids; std::vector<float> vecs; };
+    struct Entry { unsigned long long key; unsigned int featHash; int list; };
+
+    float mean[FEATURE_DIM], invStd[FEATURE_DIM];
+    int nlist = 0;
+    std::vector<float> centroids;
+    std::vector<List> lists;
+    std::vector<int> listOf, slotOf;
+
+    void Clear() { nlist = 0; centroids.clear(); lists.clear(); listOf.clear(); slotOf.clear(); }
+
+    static unsigned int FeatureHash(const float* feat);
+    void ComputeScaling(const float* feats, int n);
+    void Normalize(const float* in, float* out) const;
+    static float Dist(const float* a, const float* b);
+    int NearestList(const float* z) const;
+    void Insert(int id, const float* z, int list);
+
+    // Lloyd's k-means on a strided training sample (deterministic)
+    void Train(const float* z, int n);
+    int Search(const float* z, int k, int exclude, int* outIds, float* outDist) const;
+};
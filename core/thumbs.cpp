@@ -0,0 +1,85 @@
+#include "thumbs.h"
+
+#include <string.h>
+
+void ResampleEnvelope(const signed char* src, int srcBins, signed char* dst, int dstBins) {
+    for (int b = 0; b < dstBins; b++) {
+        int s0 = (int)((long long)b * srcBins / dstBins);
+        int s1 = (int)(((long long)(b + 1) * srcBins + dstBins - 1) / dstBins);
+        if (s1 <= s0) s1 = s0 + 1;
+        signed char lo = src[s0 * 2], hi = src[s0 * 2 + 1];
+        for (int s = s0 + 1; s < s1; s++) {
+            if (src[s * 2] < lo) lo = src[s * 2];
+            if (src[s * 2 + 1] > hi) hi = src[s * 2 + 1];
+        }
+        dst[b * 2] = lo;
+        dst[b * 2 + 1] = hi;
+    }
+}
+
+static int ClampBins(int bins) {
+    return bins < THUMB_MIN_BINS ? THUMB_MIN_BINS : (bins > THUMB_MAX_BINS ? THUMB_MAX_BINS : bins);
+}
+
+ThumbnailStore::ThumbnailStore(int capacity, int bins) {
+    Reset(capacity, bins);
+}
+
+void ThumbnailStore::Reset(int newCapacity, int newBins) {
+    capacity = newCapacity > 0 ? newCapacity : 0;
+    bins = ClampBins(newBins);
+    arena.assign((size_t)capacity * bins * 2, 0);
+}
+
+void ThumbnailStore::Reserve(int newCapacity) {
+    if (newCapacity <= capacity) return;
+    capacity = newCapacity;
+    arena.resize((size_t)capacity * bins * 2, 0);
+}
+
+void ThumbnailStore::SetBins(int newBins) {
+    newBins = ClampBins(newBins);
+    if (newBins == bins) return;
+    std::vector<signed char> resized((size_t)capacity * newBins * 2);
+    for (int i = 0; i < capacity; i++)
+        ResampleEnvelope(&arena[(size_t)i * bins * 2], bins, &resized[(size_t)i * newBins * 2], newBins);
+    arena.swap(resized);
+    bins = newBins;
+}
+
+void ThumbnailStore::Store(int index, const Envelope& e) {
+    signed char* dst = &arena[(size_t)index * bins * 2];
+    if (e.bins == bins) memcpy(dst, e.minMax, (size_t)bins * 2);
+    else if (e.bins > 0) ResampleEnvelope(e.minMax, e.bins, dst, bins);
+    else memset(dst, 0, (size_t)bins * 2);
+}
+
+void ThumbnailStore::Load(int index, Envelope* e) const {
+    memset(e, 0, sizeof(*e));
+    e->bins = bins;
+    memcpy(e->minMax, Get(index), (size_t)bins * 2);
+}
+
+void ThumbnailStore::Move(int from, int to) {
+    if (from != to) memcpy(&arena[(size_t)to * bins * 2], Get(from), (size_t)bins * 2);
+}
+
+void ThumbnailStore::Permute(int first, const std::vector<int>& order) {
+    if (order.empty()) return;
+    std::vector<int> left = order;
+    std::vector<signed char> held((size_t)bins * 2);
+    size_t stride = (size_t)bins * 2;
+    signed char* base = &arena[(size_t)first * stride];
+    for (int i = 0; i < (int)left.size(); i++) {
+        if (left[i] == i) continue;
+        memcpy(held.data(), base + i * stride, stride);
+        int j = i;
+        for (;;) {
+            int k = left[j];
+            left[j] = j;
+            if (k == i) { memcpy(base + j * stride, held.data(), stride); break; }
+            memcpy(base + j * stride, base + k * stride, stride);
+            j = k;
+        }
+    }
+}
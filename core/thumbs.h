@@ -0,0 +1,63 @@
+// Hover waveform thumbnails: quantised min/max envelopes kept in one arena
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#define THUMB_MIN_BINS 8
+#define THUMB_DEFAULT_BINS 64
+#define THUMB_MAX_BINS 256  // Resolution of the analysis envelope; stores reduce from it
+
+// Per-bin min/max pairs (min first) with sample values scaled to [-127, 127]; mins are
+// rounded down and maxes up, so the envelope always covers the peaks it came from
+struct Envelope {
+    int bins;
+    signed char minMax[THUMB_MAX_BINS * 2];
+};
+
+static inline signed char QuantizeMin(float v) {
+    float q = v * 127.0f;
+    int i = (int)q;
+    if ((float)i > q) i--;
+    return (signed char)(i < -127 ? -127 : (i > 127 ? 127 : i));
+}
+
+static inline signed char QuantizeMax(float v) {
+    float q = v * 127.0f;
+    int i = (int)q;
+    if ((float)i < q) i++;
+    return (signed char)(i < -127 ? -127 : (i > 127 ? 127 : i));
+}
+
+static inline float ThumbValue(signed char q) { return q / 127.0f; }
+
+// Each output bin takes the min/max over the input bins it overlaps, so reducing is
+// exact and enlarging repeats bins
+void ResampleEnvelope(const signed char* src, int srcBins, signed char* dst, int dstBins);
+
+// Thumbnails of one library at its chosen resolution. Slot i belongs to sample i, so
+// samples own no thumbnail memory and moving a sample means moving its slot too.
+// Distinct slots may be written from different threads.
+class ThumbnailStore {
+public:
+    explicit ThumbnailStore(int capacity = 0, int bins = THUMB_DEFAULT_BINS);
+
+    void Reset(int capacity, int bins);             // Clears; bins clamp to [THUMB_MIN_BINS, THUMB_MAX_BINS]
+    void Reserve(int capacity);                     // Grows, keeping the stored slots (not while writers run)
+    void SetBins(int bins);                         // Resamples the stored thumbnails
+    int Bins() const { return bins; }
+    int Capacity() const { return capacity; }
+    size_t Bytes() const { return arena.size(); }
+
+    // bins min/max pairs
+    const signed char* Get(int index) const { return &arena[(size_t)index * bins * 2]; }
+    void Store(int index, const Envelope& e);
+    void Load(int index, Envelope* e) const;
+    void Move(int from, int to);
+    // Slot first + i takes slot first + order[i], as PermuteInPlace does for samples
+    void Permute(int first, const std::vector<int>& order);
+
+private:
+    int capacity = 0, bins = 0;
+    std::vector<signed char> arena;
+};
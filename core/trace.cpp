@@ -0,0 +1,239 @@
+#include "trace.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+Tracer g_tracer;
+
+static long long ClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::Start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.clear();
+    generation++;
+    origin = ClockUs();
+    stopUs = -1;
+    active = true;
+}
+
+void Tracer::Stop() {
+    if (!active) return;
+    stopUs = NowUs();
+    active = false;
+}
+
+long long Tracer::NowUs() const { return ClockUs() - origin; }
+
+double Tracer::WallMs() const { return ((stopUs >= 0) ? stopUs : NowUs()) / 1000.0; }
+
+Tracer::Buffer* Tracer::Local() {
+    // Cached per thread; a new generation (Start) or another tracer re-registers
+    thread_local Buffer* buffer = NULL;
+    thread_local const Tracer* owner = NULL;
+    thread_local unsigned gen = 0;
+    unsigned current = generation.load();
+    if (!buffer || owner != this || gen != current) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.emplace_back(new Buffer());
+        buffer = buffers.back().get();
+        buffer->tid = (int)buffers.size();
+        owner = this;
+        gen = current;
+    }
+    return buffer;
+}
+
+void Tracer::Complete(const char* name, long long startUs, long long durUs, const char* detail) {
+    if (!Active()) return;
+    Buffer* b = Local();
+    int d = -1;
+    if (detail) { d = (int)b->details.size(); b->details.push_back(detail); }
+    b->events.push_back({ name, startUs, durUs, 0, d });
+}
+
+void Tracer::Add(const char* name, long long delta) {
+    if (!Active()) return;
+    Buffer* b = Local();
+    for (auto& t : b->totals)
+        if (t.first == name) { t.second += delta; return; }
+    b->totals.push_back({ name, delta });
+}
+
+void Tracer::Sample(const char* name, long long value) {
+    if (!Active()) return;
+    Local()->events.push_back({ name, NowUs(), -1, value, -1 });
+}
+
+long long Tracer::Total(const char* name) const {
+    long long sum = 0;
+    for (auto& b : buffers)
+        for (auto& t : b->totals)
+            if (!strcmp(t.first, name)) sum += t.second;
+    return sum;
+}
+
+std::vector<Tracer::StageStats> Tracer::Summarize() const {
+    // Group by name (pointers of equal literals may differ across translation units)
+    std::vector<const char*> names;
+    std::vector<std::vector<long long>> durs;
+    std::vector<std::pair<long long, size_t>> first;    // (first start, name index)
+    for (auto& b : buffers)
+        for (const Event& e : b->events) {
+            if (e.dur < 0) continue;
+            size_t k = 0;
+            while (k < names.size() && strcmp(names[k], e.name) != 0) k++;
+            if (k == names.size()) { names.push_back(e.name); durs.emplace_back(); first.push_back({ e.start, k }); }
+            durs[k].push_back(e.dur);
+            if (e.start < first[k].first) first[k].first = e.start;
+        }
+    std::sort(first.begin(), first.end());
+
+    std::vector<StageStats> out;
+    for (auto& f : first) {
+        std::vector<long long>& d = durs[f.second];
+        std::sort(d.begin(), d.end());
+        long long sum = 0;
+        for (long long v : d) sum += v;
+        StageStats s;
+        s.name = names[f.second];
+        s.count = (int)d.size();
+        s.totalMs = sum / 1000.0;
+        s.meanUs = (double)sum / d.size();
+        s.p50Us = (double)d[(d.size() - 1) / 2];
+        s.p99Us = (double)d[(d.size() - 1) * 99 / 100];
+        s.maxUs = (double)d.back();
+        out.push_back(s);
+    }
+    return out;
+}
+
+static void WriteJsonString(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') { fputc('\\', f); fputc(c, f); }
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+bool Tracer::WriteChromeTrace(FILE* f) const {
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool firstEvent = true;
+    auto Sep = [&]() { if (!firstEvent) fprintf(f, ",\n"); firstEvent = false; };
+    for (auto& b : buffers) {
+        Sep();
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                b->tid, b->tid);
+        for (const Event& e : b->events) {
+            Sep();
+            if (e.dur < 0) {
+                fprintf(f, "{\"name\":");
+                WriteJsonString(f, e.name);
+                fprintf(f, ",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}", e.start, b->tid, e.value);
+            } else {
+                fprintf(f, "{\"name\":");
+                WriteJsonString(f, e.name);
+                fprintf(f, ",\"cat\":\"import\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d", e.start, e.dur, b->tid);
+                if (e.detail >= 0) {
+                    fprintf(f, ",\"args\":{\"detail\":");
+                    WriteJsonString(f, b->details[e.detail].c_str());
+                    fprintf(f, "}");
+                }
+                fprintf(f, "}");
+            }
+        }
+    }
+    fprintf(f, "\n]}\n");
+    return !ferror(f);
+}
+
+void Tracer::WriteSummary(FILE* f) const {
+    double wall = WallMs();
+    fprintf(f, "%-16s %8s %11s %6s %10s %10s %10s %10s\n", "stage", "count", "total ms", "share", "mean us", "p50 us", "p99 us", "max us");
+    for (const StageStats& s : Summarize())
+        fprintf(f, "%-16s %8d %11.1f %5.1f%% %10.1f %10.0f %10.0f %10.0f\n", s.name, s.count, s.totalMs,
+                wall > 0 ? 100.0 * s.totalMs / wall : 0.0, s.meanUs, s.p50Us, s.p99Us, s.maxUs);
+
+    std::vector<const char*> names;
+    for (auto& b : buffers)
+        for (auto& t : b->totals)
+            if (std::none_of(names.begin(), names.end(), [&](const char* n) { return !strcmp(n, t.first); }))
+                names.push_back(t.first);
+    for (const char* n : names) fprintf(f, "%-16s %lld\n", n, Total(n));
+    fprintf(f, "wall %.1f ms (stage totals sum over threads, so shares can exceed 100%%)\n", wall);
+}
+
+FrameProfiler::FrameProfiler(const char* const* names, int sections, int window)
+    : names(names), sections(sections), window(window > 0 ? window : 1) {
+    Reset();
+}
+
+void FrameProfiler::Reset() {
+    next = filled = 0;
+    frameNumber = 0;
+    current.assign(sections, 0.0);
+    history.assign((size_t)window * (sections + 1), 0.0);
+    allocs.assign(window, 0.0);
+    objects.assign(window, 0.0);
+    numbers.assign(window, 0);
+}
+
+void FrameProfiler::Add(int section, double us) {
+    if (section >= 0 && section < sections) current[section] += us;
+}
+
+void FrameProfiler::EndFrame(long long allocations, long long objectCount) {
+    double* row = &history[(size_t)next * (sections + 1)];
+    double sum = 0;
+    for (int s = 0; s < sections; s++) { row[s] = current[s]; sum += current[s]; current[s] = 0; }
+    row[sections] = sum;
+    allocs[next] = (double)allocations;
+    objects[next] = (double)objectCount;
+    numbers[next] = frameNumber++;
+    next = (next + 1) % window;
+    if (filled < window) filled++;
+}
+
+FrameProfiler::Stats FrameProfiler::Column(const double* base, int stride) const {
+    Stats st = { 0, 0, 0 };
+    if (filled == 0) return st;
+    int lastRow = (next + window - 1) % window;
+    st.last = base[(size_t)lastRow * stride];
+    std::vector<double> v(filled);
+    for (int i = 0; i < filled; i++) v[i] = base[(size_t)i * stride];
+    size_t p50 = (filled - 1) / 2, p99 = (size_t)(filled - 1) * 99 / 100;
+    std::nth_element(v.begin(), v.begin() + p50, v.end()); st.p50 = v[p50];
+    std::nth_element(v.begin(), v.begin() + p99, v.end()); st.p99 = v[p99];
+    return st;
+}
+
+FrameProfiler::Stats FrameProfiler::Section(int section) const {
+    return Column(&history[section], sections + 1);
+}
+
+FrameProfiler::Stats FrameProfiler::Allocations() const {
+    return Column(allocs.data(), 1);
+}
+
+FrameProfiler::Stats FrameProfiler::Objects() const {
+    return Column(objects.data(), 1);
+}
+
+bool FrameProfiler::WriteCsv(FILE* f) const {
+    fprintf(f, "frame");
+    for (int s = 0; s < sections; s++) fprintf(f, ",%s_us", names[s]);
+    fprintf(f, ",total_us,allocations,objects\n");
+    for (int i = 0; i < filled; i++) {
+        int row = (next - filled + i + window) % window;
+        const double* r = &history[(size_t)row * (sections + 1)];
+        fprintf(f, "%lld", numbers[row]);
+        for (int s = 0; s <= sections; s++) fprintf(f, ",%.1f", r[s]);
+        fprintf(f, ",%.0f,%.0f\n", allocs[row], objects[row]);
+    }
+    return !ferror(f);
+}
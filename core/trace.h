@@ -0,0 +1,115 @@
+// Instrumentation: import stage timings and counters (exported as Chrome trace JSON)
+// and rolling per-section frame timings
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records timed stages and counters from any thread. Each thread appends to its own
+// buffer, so recording takes no lock; Start, the writers and Summarize must not run
+// while other threads record. Names must be string literals (stored by pointer).
+// When inactive every call is a single relaxed load.
+class Tracer {
+public:
+    void Start();                       // Discard previous events and begin recording
+    void Stop();
+    bool Active() const { return active.load(std::memory_order_relaxed); }
+
+    long long NowUs() const;            // Microseconds since Start
+
+    // A finished stage on the calling thread; detail (e.g. a file path) is copied
+    void Complete(const char* name, long long startUs, long long durUs, const char* detail = NULL);
+    // Add to a running total (bytes read, audio decoded, ...)
+    void Add(const char* name, long long delta);
+    // Record a value over time (e.g. files still queued)
+    void Sample(const char* name, long long value);
+
+    struct StageStats {
+        const char* name;
+        int count;
+        double totalMs, meanUs, p50Us, p99Us, maxUs;
+    };
+    std::vector<StageStats> Summarize() const;   // In order of first appearance
+    long long Total(const char* name) const;
+    double WallMs() const;                       // Start to Stop (or now)
+
+    bool WriteChromeTrace(FILE* f) const;        // {"traceEvents": [...]} for chrome://tracing
+    void WriteSummary(FILE* f) const;            // Stage table and counter totals
+
+private:
+    struct Event {
+        const char* name;
+        long long start, dur;           // dur < 0 marks a counter sample
+        long long value;
+        int detail;                     // Index into Buffer::details, -1 if none
+    };
+    struct Buffer {
+        int tid;
+        std::vector<Event> events;
+        std::vector<std::string> details;
+        std::vector<std::pair<const char*, long long>> totals;
+    };
+
+    std::atomic<bool> active{ false };
+    std::atomic<unsigned> generation{ 0 };
+    long long origin = 0, stopUs = -1;
+    mutable std::mutex mutex;           // Guards buffers (registration only)
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer* Local();
+};
+
+extern Tracer g_tracer;
+
+// Times the enclosing scope as one stage of g_tracer
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* detail = NULL)
+        : name(name), detail(detail), start(g_tracer.Active() ? g_tracer.NowUs() : -1) {}
+    ~TraceScope() { if (start >= 0) g_tracer.Complete(name, start, g_tracer.NowUs() - start, detail); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* detail;
+    long long start;
+};
+
+// Per-section frame timings over the last `window` frames. Sections are filled with
+// Add during a frame and committed by EndFrame along with the frame's heap allocation
+// and graphics object counts (both should settle at zero for a steady-state frame).
+class FrameProfiler {
+public:
+    FrameProfiler(const char* const* names, int sections, int window = 240);
+
+    void Add(int section, double us);
+    void EndFrame(long long allocations, long long objects = 0);
+    void Reset();
+
+    struct Stats { double last, p50, p99; };
+    int Sections() const { return sections; }
+    const char* Name(int section) const { return names[section]; }
+    int Frames() const { return filled; }
+    Stats Section(int section) const;   // section == Sections(): the whole frame (sum)
+    Stats Allocations() const;
+    Stats Objects() const;
+
+    bool WriteCsv(FILE* f) const;       // One row per frame in the window, oldest first
+
+private:
+    const char* const* names;
+    int sections, window;
+    int next = 0, filled = 0;
+    long long frameNumber = 0;
+    std::vector<double> current;        // sections
+    std::vector<double> history;        // window x (sections + 1), last column = frame sum
+    std::vector<double> allocs, objects;
+    std::vector<long long> numbers;
+
+    Stats Column(const double* base, int stride) const;
+};
@@ -0,0 +1,167 @@
+#include "watch.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+static_assert(sizeof(OVERLAPPED) <= 64, "FolderWatcher::overlapped too small");
+
+static std::string ToUtf8(const wchar_t* s, int len) {
+    int n = WideCharToMultiByte(CP_UTF8, 0, s, len, NULL, 0, NULL, NULL);
+    std::string out(n > 0 ? n : 0, '\0');
+    if (n > 0) WideCharToMultiByte(CP_UTF8, 0, s, len, &out[0], n, NULL, NULL);
+    return out;
+}
+
+bool FolderWatcher::Start(const char* path) {
+    Stop();
+    wchar_t wide[MAX_PATH];
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wide, MAX_PATH)) return false;
+    HANDLE h = CreateFileW(wide, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                           OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    dir = h;
+    memset(overlapped, 0, sizeof(overlapped));
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    root = path;
+    while (!root.empty() && (root.back() == '\\' || root.back() == '/')) root.pop_back();
+    if (!event || !Issue()) { Stop(); return false; }
+    return true;
+}
+
+bool FolderWatcher::Issue() {
+    OVERLAPPED* ov = (OVERLAPPED*)overlapped;
+    memset(ov, 0, sizeof(OVERLAPPED));
+    ov->hEvent = (HANDLE)event;
+    return ReadDirectoryChangesW((HANDLE)dir, buffer, sizeof(buffer), TRUE,
+                                 FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                 FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                 NULL, ov, NULL) != 0;
+}
+
+void FolderWatcher::Stop() {
+    if (dir != INVALID_HANDLE_VALUE) {
+        CancelIo((HANDLE)dir);
+        DWORD ignored;
+        GetOverlappedResult((HANDLE)dir, (OVERLAPPED*)overlapped, &ignored, TRUE);
+        CloseHandle((HANDLE)dir);
+    }
+    if (event) CloseHandle((HANDLE)event);
+    dir = INVALID_HANDLE_VALUE;
+    event = NULL;
+    root.clear();
+}
+
+bool FolderWatcher::Active() const { return dir != INVALID_HANDLE_VALUE; }
+
+void FolderWatcher::Poll(std::vector<std::string>& changed, bool* overflow) {
+    *overflow = false;
+    if (dir == INVALID_HANDLE_VALUE) return;
+    DWORD bytes = 0;
+    if (!GetOverlappedResult((HANDLE)dir, (OVERLAPPED*)overlapped, &bytes, FALSE)) {
+        if (GetLastError() == ERROR_IO_INCOMPLETE) return;
+        *overflow = true;
+    } else if (bytes == 0) {
+        *overflow = true;               // Buffer overflowed: the change list was dropped
+    } else {
+        const unsigned char* p = buffer;
+        for (;;) {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)p;
+            changed.push_back(root + "\\" + ToUtf8(info->FileName, (int)(info->FileNameLength / sizeof(wchar_t))));
+            if (!info->NextEntryOffset) break;
+            p += info->NextEntryOffset;
+        }
+    }
+    if (!Issue()) *overflow = true;
+}
+
+#elif defined(__linux__)
+#include <dirent.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const unsigned int kWatchMask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_FROM |
+                                       IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+
+void FolderWatcher::AddTree(const std::string& path) {
+    int wd = inotify_add_watch(fd, path.c_str(), kWatchMask);
+    if (wd < 0) return;
+    bool known = false;
+    for (auto& d : dirs) if (d.first == wd) { d.second = path; known = true; }
+    if (!known) dirs.push_back({ wd, path });
+
+    DIR* dp = opendir(path.c_str());
+    if (!dp) return;
+    while (struct dirent* e = readdir(dp)) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        std::string child = path + "/" + e->d_name;
+        struct stat st;
+        if (lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) AddTree(child);
+    }
+    closedir(dp);
+}
+
+bool FolderWatcher::Start(const char* path) {
+    Stop();
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+    root = path;
+    while (root.size() > 1 && root.back() == '/') root.pop_back();
+    AddTree(root);
+    if (dirs.empty()) { Stop(); return false; }
+    return true;
+}
+
+void FolderWatcher::Stop() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+    dirs.clear();
+    root.clear();
+}
+
+bool FolderWatcher::Active() const { return fd >= 0; }
+
+void FolderWatcher::Poll(std::vector<std::string>& changed, bool* overflow) {
+    *overflow = false;
+    if (fd < 0) return;
+    alignas(struct inotify_event) char buf[16 * 1024];
+    for (;;) {
+        ssize_t got = read(fd, buf, sizeof(buf));
+        if (got <= 0) {
+            if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK) *overflow = true;
+            return;
+        }
+        for (ssize_t off = 0; off < got;) {
+            const struct inotify_event* ev = (const struct inotify_event*)(buf + off);
+            off += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) { *overflow = true; continue; }
+            const std::string* parent = NULL;
+            for (auto& d : dirs) if (d.first == ev->wd) parent = &d.second;
+            if (!parent) continue;
+            if (ev->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                std::string gone = *parent;
+                dirs.erase(std::remove_if(dirs.begin(), dirs.end(), [&](const std::pair<int, std::string>& d) { return d.first == ev->wd; }), dirs.end());
+                changed.push_back(gone);
+                continue;
+            }
+            if (!ev->len) continue;
+            std::string path = *parent + "/" + ev->name;
+            // New directories need their own watches; files created in them before the
+            // watch existed are covered by reporting the directory itself
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) AddTree(path);
+            changed.push_back(path);
+        }
+    }
+}
+
+#else
+bool FolderWatcher::Start(const char*) { return false; }
+void FolderWatcher::Stop() { root.clear(); }
+bool FolderWatcher::Active() const { return false; }
+void FolderWatcher::Poll(std::vector<std::string>&, bool* overflow) { *overflow = false; }
+#endif
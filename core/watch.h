@@ -0,0 +1,40 @@
+// Change notifications for a library folder (ReadDirectoryChangesW / inotify)
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Watches a folder tree and reports the paths touched since the last Poll. Paths are
+// UTF-8 and absolute (root + relative name); a created, renamed or deleted directory
+// is reported as the directory itself, so the caller re-lists or drops everything
+// under it. Poll never blocks.
+class FolderWatcher {
+public:
+    FolderWatcher() {}
+    ~FolderWatcher() { Stop(); }
+    FolderWatcher(const FolderWatcher&) = delete;
+    FolderWatcher& operator=(const FolderWatcher&) = delete;
+
+    bool Start(const char* root);       // False where no backend exists (e.g. macOS)
+    void Stop();
+    bool Active() const;
+    const std::string& Root() const { return root; }
+
+    // Appends changed paths (duplicates possible). Sets *overflow when events were
+    // lost, in which case the caller should re-list the whole tree.
+    void Poll(std::vector<std::string>& changed, bool* overflow);
+
+private:
+    std::string root;
+#ifdef _WIN32
+    void* dir = (void*)-1;              // Directory handle, INVALID_HANDLE_VALUE when idle
+    void* event = NULL;
+    alignas(8) unsigned char overlapped[64]; // OVERLAPPED, kept opaque to stay out of windows.h
+    alignas(8) unsigned char buffer[64 * 1024];
+    bool Issue();
+#else
+    int fd = -1;
+    std::vector<std::pair<int, std::string>> dirs; // inotify watch descriptor -> directory
+    void AddTree(const std::string& dir);
+#endif
+};
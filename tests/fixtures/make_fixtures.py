@@ -0,0 +1,48 @@
+# Regenerates the WAV fixtures used by audiomap_tests (deterministic, stdlib only).
+import math, os, struct, wave
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def lcg(state):
+    return (state * 1664525 + 1013904223) & 0xFFFFFFFF
+
+def sound(seed, rate, secs, f1, f2, decay):
+    n = int(rate * secs)
+    st, lp, out = seed, 0.0, []
+    for i in range(n):
+        t = i / rate
+        st = lcg(st)
+        lp += 0.2 * (((st >> 16) / 32768.0 - 1.0) - lp)
+        harm = sum(math.sin(2 * math.pi * f1 * k * t * (1 + 0.3 * t)) / k for k in range(1, 9))
+        out.append(math.exp(-decay * t) * (0.3 * harm + 0.3 * math.sin(2 * math.pi * f2 * t) + 0.4 * lp))
+    return out
+
+def resample(s, src, dst):
+    n = int(len(s) * dst / src)
+    out = []
+    for i in range(n):
+        p = i * src / dst
+        k = int(p)
+        f = p - k
+        out.append(s[k] * (1 - f) + s[k + 1] * f if k + 1 < len(s) else s[k])
+    return out
+
+def write(name, rate, channels):
+    frames = len(channels[0])
+    data = bytearray()
+    for i in range(frames):
+        for c in channels:
+            v = max(-1.0, min(1.0, c[i] * 0.5))
+            data += struct.pack('<h', int(round(v * 32767)))
+    with wave.open(os.path.join(HERE, name), 'wb') as w:
+        w.setnchannels(len(channels))
+        w.setsampwidth(2)
+        w.setframerate(rate)
+        w.writeframes(bytes(data))
+
+tone = sound(1, 44100, 1.0, 220.0, 1400.0, 3.0)
+write('tone_44k_mono.wav', 44100, [tone])
+write('tone_48k_mono.wav', 48000, [resample(tone, 44100, 48000)])
+left = sound(2, 44100, 0.5, 90.0, 2600.0, 6.0)
+right = sound(3, 44100, 0.5, 90.0, 2600.0, 6.0)
+write('hit_44k_stereo.wav', 44100, [left, right])
@@ -0,0 +1,90 @@
+# Regenerates the FLAC fixtures used by audiomap_tests with the reference encoder
+# (libFLAC, through the soundfile/libsndfile Python bindings). The decoder tests check
+# these files against the MD5 of the source samples stored in STREAMINFO, so the
+# generator only needs to be rerun when fixtures are added.
+import math, os, struct
+import soundfile as sf
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def lcg(state):
+    return (state * 1664525 + 1013904223) & 0xFFFFFFFF
+
+def signal(rate, secs, stereo):
+    # Four stretches whose channel relations favour independent, left/side,
+    # right/side and mid/side coding in turn
+    n = int(rate * secs)
+    st, lp, left, right = 7, 0.0, [], []
+    for i in range(n):
+        t = i / rate
+        st = lcg(st)
+        lp += 0.3 * (((st >> 16) / 32768.0 - 1.0) - lp)
+        x = 0.5 * math.sin(2 * math.pi * 330.0 * t) + 0.2 * math.sin(2 * math.pi * 2750.0 * t)
+        y = 0.4 * math.sin(2 * math.pi * 523.0 * t + 1.0)
+        part = 4 * i // n
+        if part == 0: l, r = x, y
+        elif part == 1: l, r = x, 0.5 * x
+        elif part == 2: l, r = 0.5 * x, x
+        else: l, r = x + 0.2 * lp, x - 0.2 * lp
+        left.append(0.9 * l)
+        right.append(0.9 * r)
+    return [[a, b] for a, b in zip(left, right)] if stereo else left
+
+def crc8(data):
+    c = 0
+    for b in data:
+        c ^= b
+        for _ in range(8):
+            c = ((c << 1) ^ 0x07) & 0xFF if c & 0x80 else (c << 1) & 0xFF
+    return c
+
+def frame_starts(b, first):
+    # Fixed block size streams: sync code, then a header whose CRC-8 checks out.
+    # Frame numbers are UTF-8 coded; return (offset, frame number) pairs.
+    out = []
+    for p in range(first, len(b) - 16):
+        if b[p] != 0xFF or b[p + 1] != 0xF8: continue
+        q, lead = p + 4, b[p + 4]
+        extra = 0
+        while extra < 6 and lead & (0x80 >> extra): extra += 1
+        if extra == 1 or extra > 6: continue
+        num = lead & (0x7F >> extra) if extra else lead
+        for k in range(1, extra): num = (num << 6) | (b[q + k] & 0x3F)
+        q += max(extra, 1)
+        bs, sr = b[p + 2] >> 4, b[p + 2] & 15
+        q += 1 if bs == 6 else 2 if bs == 7 else 0
+        q += 1 if sr == 12 else 2 if sr in (13, 14) else 0
+        if crc8(b[p:q]) == b[q]: out.append((p, num))
+    return out
+
+def add_seek_table(path, every):
+    b = open(path, 'rb').read()
+    p, blocks = 4, []
+    while True:
+        last, kind, n = b[p] & 0x80, b[p] & 0x7F, int.from_bytes(b[p + 1:p + 4], 'big')
+        blocks.append((kind, b[p + 4:p + 4 + n]))
+        p += 4 + n
+        if last: break
+    block = struct.unpack('>H', blocks[0][1][2:4])[0]
+    frames = frame_starts(b, p)
+    points = b''.join(struct.pack('>QQH', num * block, off - p, block)
+                      for off, num in frames[::every])
+    blocks.insert(1, (3, points))
+    out = bytearray(b'fLaC')
+    for i, (kind, body) in enumerate(blocks):
+        out += bytes([kind | (0x80 if i == len(blocks) - 1 else 0)]) + len(body).to_bytes(3, 'big') + body
+    open(path, 'wb').write(bytes(out + b[p:]))
+
+def write(name, rate, secs, stereo, subtype, level, seek_every=0):
+    path = os.path.join(HERE, name)
+    sf.write(path, signal(rate, secs, stereo), rate, subtype=subtype, format='FLAC',
+             compression_level=level / 8.0)
+    if seek_every: add_seek_table(path, seek_every)
+
+# Block size 1152 with independent channels (-0) and exhaustive stereo search (-2)
+write('flac16_stereo_l0.flac', 44100, 0.4, True, 'PCM_16', 0)
+write('flac16_stereo_l2.flac', 44100, 0.4, True, 'PCM_16', 2)
+# Block size 4096, LPC up to order 12, a seek table every other frame (-8)
+write('flac24_stereo_l8.flac', 48000, 0.4, True, 'PCM_24', 8, 2)
+# 8-bit mono, block size 4096 without stereo coding (-3)
+write('flac8_mono_l3.flac', 22050, 0.5, False, 'PCM_S8', 3)
@@ -0,0 +1,55 @@
+# Regenerates the mp3 fixtures used by audiomap_tests with the LAME encoder, and next to
+# each one the mpg123 decode of it as 24-bit FLAC (both through the soundfile/libsndfile
+# Python bindings). mpg123 trims the encoder delay and padding like the built-in decoder,
+# so the tests compare the two sample for sample.
+import math, os
+import soundfile as sf
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def lcg(state):
+    return (state * 1664525 + 1013904223) & 0xFFFFFFFF
+
+def signal(rate, secs, stereo, hits):
+    # Two tones, the right channel a delayed copy plus noise so joint stereo has work;
+    # with hits, decaying noise bursts every 90 ms push the encoder into short blocks
+    n = int(rate * secs)
+    st, left, right, burst = 5, [], [], 0.0
+    for i in range(n):
+        t = i / rate
+        st = lcg(st)
+        noise = (st >> 16) / 32768.0 - 1.0
+        if hits and i % int(rate * 0.09) == int(rate * 0.03): burst = 0.5
+        burst *= math.exp(-1.0 / (rate * 0.004))
+        x = 0.3 * math.sin(2 * math.pi * 440.0 * t) + 0.1 * math.sin(2 * math.pi * 3100.0 * t)
+        y = 0.25 * math.sin(2 * math.pi * 440.0 * (t - 0.001)) + 0.05 * noise
+        left.append(x + burst * noise)
+        right.append(y + burst * noise)
+    return [[a, b] for a, b in zip(left, right)] if stereo else left
+
+def add_id3(path):
+    # ID3v2.4 tag with a title frame; the decoder has to skip it to find the first frame
+    title = b'\x03fixture'
+    frame = b'TIT2' + len(title).to_bytes(4, 'big') + b'\x00\x00' + title
+    size = len(frame)
+    syncsafe = bytes([(size >> 21) & 0x7F, (size >> 14) & 0x7F, (size >> 7) & 0x7F, size & 0x7F])
+    b = open(path, 'rb').read()
+    open(path, 'wb').write(b'ID3\x04\x00\x00' + syncsafe + frame + b)
+
+def write(name, rate, secs, stereo, hits, mode, level, id3=False):
+    path = os.path.join(HERE, name + '.mp3')
+    sf.write(path, signal(rate, secs, stereo, hits), rate, format='MP3', subtype='MPEG_LAYER_III',
+             bitrate_mode=mode, compression_level=level)
+    ref, _ = sf.read(path, dtype='float64')
+    assert abs(ref).max() < 1.0
+    sf.write(os.path.join(HERE, name + '_ref.flac'), ref, rate, format='FLAC', subtype='PCM_24')
+    if id3: add_id3(path)
+
+# MPEG-1 joint stereo CBR behind an ID3v2 tag
+write('mp3_44k_joint_cbr', 44100, 0.4, True, False, 'CONSTANT', 0.5, True)
+# MPEG-1 VBR with transients (short blocks)
+write('mp3_48k_vbr_hits', 48000, 0.4, True, True, 'VARIABLE', 0.3)
+# MPEG-2 (LSF) mono
+write('mp3_22k_mono', 22050, 0.5, False, False, 'CONSTANT', 0.5)
+# MPEG-2.5 mono with transients
+write('mp3_8k_hits', 8000, 0.8, False, True, 'CONSTANT', 0.5)
@@ -0,0 +1,1710 @@
+// Regression tests for the analysis core
+//
+//   audiomap_tests <fixture dir>
+
+#include "core/cluster.h"
+#include "core/decoder.h"
+#include "core/features.h"
+#include "core/fingerprint.h"
+#include "core/flac.h"
+#include "core/kdtree.h"
+#include "core/layout.h"
+#include "core/loudness.h"
+#include "core/metadata.h"
+#include "core/parallel.h"
+#include "core/pcmfile.h"
+#include "core/project.h"
+#include "core/raster.h"
+#include "core/selection.h"
+#include "core/similarity.h"
+#include "core/thumbs.h"
+#include "core/trace.h"
+#include "core/watch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int g_failures = 0, g_checks = 0;
+static std::string g_fixtures = "tests/fixtures";
+
+#define CHECK(cond) do { g_checks++; if (!(cond)) { g_failures++; \
+    fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); } } while (0)
+#define CHECK_NEAR(a, b, tol) do { g_checks++; double va_ = (a), vb_ = (b); \
+    if (!(fabs(va_ - vb_) <= (tol))) { g_failures++; \
+    fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s = %.6g, expected %.6g\n", __FILE__, __LINE__, #a, va_, vb_); } } while (0)
+
+static std::vector<short> Sine(float freq, float amp, int rate, float secs, int ch = 1) {
+    int frames = (int)(rate * secs);
+    std::vector<short> out((size_t)frames * ch);
+    for (int f = 0; f < frames; f++)
+        for (int c = 0; c < ch; c++)
+            out[(size_t)f * ch + c] = (short)lrintf(amp * 32767.0f * sinf(6.2831853f * freq * (f + 0.25f) / rate));
+    return out;
+}
+
+static bool LoadFixture(const char* name, std::vector<short>& pcm, int* rate, int* ch) {
+    std::string path = g_fixtures + "/" + name;
+    if (ReadPcmFile(path.c_str(), pcm, rate, ch)) return true;
+    fprintf(stderr, "cannot read fixture %s\n", path.c_str());
+    return false;
+}
+
+// In-memory WAV/AIFF images encoding ref (16-bit values) in the given sample layout
+enum TestEncoding { ENC_U8, ENC_S8, ENC_INT16, ENC_INT24, ENC_INT32, ENC_FLOAT32, ENC_FLOAT64 };
+
+static void PutU16(std::vector<unsigned char>& b, unsigned int v, bool be) {
+    if (be) { b.push_back((unsigned char)(v >> 8)); b.push_back((unsigned char)v); }
+    else { b.push_back((unsigned char)v); b.push_back((unsigned char)(v >> 8)); }
+}
+static void PutU32(std::vector<unsigned char>& b, unsigned int v, bool be) {
+    if (be) { PutU16(b, v >> 16, true); PutU16(b, v & 0xFFFF, true); }
+    else { PutU16(b, v & 0xFFFF, false); PutU16(b, v >> 16, false); }
+}
+static void PutTag(std::vector<unsigned char>& b, const char* tag) {
+    for (int k = 0; k < 4; k++) b.push_back((unsigned char)tag[k]);
+}
+static int EncodingBytes(TestEncoding e) {
+    static const int bytes[] = { 1, 1, 2, 3, 4, 4, 8 };
+    return bytes[e];
+}
+static void PutSample(std::vector<unsigned char>& b, short v, TestEncoding e, bool be) {
+    unsigned char raw[8];
+    int n = EncodingBytes(e);
+    if (e == ENC_U8) raw[0] = (unsigned char)((v >> 8) + 128);
+    else if (e == ENC_S8) raw[0] = (unsigned char)(v >> 8);
+    else if (e == ENC_FLOAT32) { float f = v / 32768.0f; memcpy(raw, &f, 4); }
+    else if (e == ENC_FLOAT64) { double d = v / 32768.0; memcpy(raw, &d, 8); }
+    else {
+        unsigned int u = (unsigned int)(int)v << (8 * (n - 2));
+        for (int k = 0; k < n; k++) raw[k] = (unsigned char)(u >> (8 * k));
+    }
+    const unsigned short probe = 1;
+    bool hostLe = *(const unsigned char*)&probe == 1;
+    bool swap = (e == ENC_FLOAT32 || e == ENC_FLOAT64) ? (be == hostLe) : be;
+    for (int k = 0; k < n; k++) b.push_back(swap ? raw[n - 1 - k] : raw[k]);
+}
+
+static std::vector<unsigned char> MakeWav(const std::vector<short>& ref, int ch, TestEncoding e, bool rifx, bool extensible) {
+    int bytes = EncodingBytes(e);
+    bool isFloat = e == ENC_FLOAT32 || e == ENC_FLOAT64;
+    std::vector<unsigned char> b;
+    PutTag(b, rifx ? "RIFX" : "RIFF");
+    PutU32(b, 0, rifx);
+    PutTag(b, "WAVE");
+    PutTag(b, "fmt ");
+    PutU32(b, extensible ? 40 : 16, rifx);
+    PutU16(b, extensible ? 0xFFFE : (isFloat ? 3 : 1), rifx);
+    PutU16(b, ch, rifx);
+    PutU32(b, 44100, rifx);
+    PutU32(b, 44100 * ch * bytes, rifx);
+    PutU16(b, ch * bytes, rifx);
+    PutU16(b, bytes * 8, rifx);
+    if (extensible) {
+        PutU16(b, 22, rifx);
+        PutU16(b, e == ENC_INT32 ? 24 : bytes * 8, rifx);   // Valid bits
+        PutU32(b, 0, rifx);                                 // Channel mask
+        PutU16(b, isFloat ? 3 : 1, rifx);
+        for (int k = 0; k < 14; k++) b.push_back(0);
+    }
+    PutTag(b, "LIST");                  // Unknown chunk with odd size
+    PutU32(b, 3, rifx);
+    b.insert(b.end(), { 'a', 'b', 'c', 0 });
+    PutTag(b, "data");
+    PutU32(b, (unsigned int)(ref.size() * bytes), rifx);
+    for (short v : ref) PutSample(b, v, e, rifx);
+    return b;
+}
+
+static std::vector<unsigned char> MakeAiff(const std::vector<short>& ref, int ch, TestEncoding e, const char* compression) {
+    bool le = compression && !memcmp(compression, "sowt", 4);
+    int bytes = EncodingBytes(e);
+    std::vector<unsigned char> b;
+    PutTag(b, "FORM");
+    PutU32(b, 0, true);
+    PutTag(b, compression ? "AIFC" : "AIFF");
+    PutTag(b, "COMM");
+    PutU32(b, compression ? 22 : 18, true);
+    PutU16(b, ch, true);
+    PutU32(b, (unsigned int)(ref.size() / ch), true);
+    PutU16(b, bytes * 8, true);
+    // 44100 as 80-bit extended
+    b.insert(b.end(), { 0x40, 0x0E, 0xAC, 0x44, 0, 0, 0, 0, 0, 0 });
+    if (compression) PutTag(b, compression);
+    PutTag(b, "SSND");
+    PutU32(b, (unsigned int)(8 + 4 + ref.size() * bytes), true);
+    PutU32(b, 4, true);                                     // Offset
+    PutU32(b, 0, true);
+    b.insert(b.end(), 4, 0xEE);
+    for (short v : ref) PutSample(b, v, e, !le);
+    return b;
+}
+
+static void CheckDecodes(const std::vector<unsigned char>& img, const std::vector<short>& ref, int ch,
+                         int bits, bool quantized8, const char* what) {
+    PcmFormat fmt;
+    bool ok = ParsePcmFile(img.data(), img.size(), &fmt);
+    if (!ok) fprintf(stderr, "  %s: not parsed\n", what);
+    CHECK(ok);
+    if (!ok) return;
+    CHECK(fmt.sampleRate == 44100 && fmt.channels == ch && fmt.bitsPerSample == bits);
+    CHECK(fmt.frames * ch == (long long)ref.size());
+    std::vector<short> scratch;
+    const short* pcm = PcmAsInt16(fmt, scratch);
+    int bad = 0;
+    for (size_t i = 0; i < ref.size(); i++) bad += pcm[i] != (quantized8 ? (short)(ref[i] & ~0xFF) : ref[i]);
+    if (bad) fprintf(stderr, "  %s: %d samples differ\n", what, bad);
+    CHECK(bad == 0);
+
+    // Float conversion is exact for values that fit 16 bits
+    std::vector<float> fscratch;
+    const float* f = PcmAsFloat(fmt, fscratch);
+    bad = 0;
+    for (size_t i = 0; i < ref.size(); i++) bad += f[i] != (quantized8 ? (short)(ref[i] & ~0xFF) : ref[i]) / 32768.0f;
+    if (bad) fprintf(stderr, "  %s: %d float samples differ\n", what, bad);
+    CHECK(bad == 0);
+}
+
+static void TestPcmReader() {
+    std::vector<short> ref;
+    for (int i = 0; i < 6 * 300; i++) ref.push_back((short)((int)(HashU32(i) % 65536) - 32768));
+    ref[0] = -32768; ref[1] = 32767;
+
+    for (int ch : { 1, 2, 6 }) {
+        CheckDecodes(MakeWav(ref, ch, ENC_U8, false, false), ref, ch, 8, true, "wav u8");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT16, false, false), ref, ch, 16, false, "wav s16");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT24, false, false), ref, ch, 24, false, "wav s24");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT32, false, false), ref, ch, 32, false, "wav s32");
+        CheckDecodes(MakeWav(ref, ch, ENC_FLOAT32, false, false), ref, ch, 32, false, "wav f32");
+        CheckDecodes(MakeWav(ref, ch, ENC_FLOAT64, false, false), ref, ch, 64, false, "wav f64");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT32, false, true), ref, ch, 24, false, "wav extensible 24-in-32");
+        CheckDecodes(MakeWav(ref, ch, ENC_FLOAT32, false, true), ref, ch, 32, false, "wav extensible f32");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT16, true, false), ref, ch, 16, false, "rifx s16");
+        CheckDecodes(MakeWav(ref, ch, ENC_INT24, true, false), ref, ch, 24, false, "rifx s24");
+        CheckDecodes(MakeAiff(ref, ch, ENC_S8, NULL), ref, ch, 8, true, "aiff s8");
+        CheckDecodes(MakeAiff(ref, ch, ENC_INT16, NULL), ref, ch, 16, false, "aiff s16");
+        CheckDecodes(MakeAiff(ref, ch, ENC_INT24, NULL), ref, ch, 24, false, "aiff s24");
+        CheckDecodes(MakeAiff(ref, ch, ENC_INT32, NULL), ref, ch, 32, false, "aiff s32");
+        CheckDecodes(MakeAiff(ref, ch, ENC_INT16, "sowt"), ref, ch, 16, false, "aifc sowt");
+        CheckDecodes(MakeAiff(ref, ch, ENC_FLOAT32, "fl32"), ref, ch, 32, false, "aifc fl32");
+    }
+
+    // 16-bit little-endian data is used in place
+    std::vector<unsigned char> wav = MakeWav(ref, 2, ENC_INT16, false, false);
+    PcmFormat fmt;
+    std::vector<short> scratch;
+    CHECK(ParsePcmFile(wav.data(), wav.size(), &fmt));
+    const unsigned short probe = 1;
+    if (*(const unsigned char*)&probe == 1) CHECK((const unsigned char*)PcmAsInt16(fmt, scratch) == fmt.data && scratch.empty());
+
+    // Streaming writers leave the data size unset: clamp to the bytes present
+    std::vector<unsigned char> open = wav;
+    size_t dataSize = open.size() - ref.size() * 2 - 4;
+    memset(&open[dataSize], 0xFF, 4);
+    open.resize(open.size() - 3);
+    CHECK(ParsePcmFile(open.data(), open.size(), &fmt) && fmt.frames == (long long)ref.size() / 2 - 1);
+
+    // Compressed and malformed files are left to the general decoder
+    std::vector<unsigned char> adpcm = wav;
+    adpcm[20] = 2;
+    CHECK(!ParsePcmFile(adpcm.data(), adpcm.size(), &fmt));
+    std::vector<unsigned char> ima = MakeAiff(ref, 1, ENC_INT16, "ima4");
+    CHECK(!ParsePcmFile(ima.data(), ima.size(), &fmt));
+    CHECK(!ParsePcmFile(wav.data(), 40, &fmt));
+    CHECK(!ParsePcmFile(NULL, 0, &fmt));
+    std::vector<unsigned char> noChannels = wav;
+    noChannels[22] = 0;
+    CHECK(!ParsePcmFile(noChannels.data(), noChannels.size(), &fmt));
+    // Corrupt sample rates: 0x7FFFFFFF (WAV) and an AIFF exponent far past any real rate
+    std::vector<unsigned char> fast = wav;
+    fast[24] = fast[25] = fast[26] = 0xFF; fast[27] = 0x7F;
+    CHECK(!ParsePcmFile(fast.data(), fast.size(), &fmt));
+    std::vector<unsigned char> aiffFast = MakeAiff(ref, 1, ENC_INT16, NULL);
+    aiffFast[28] = 0x40; aiffFast[29] = 0x40;
+    CHECK(!ParsePcmFile(aiffFast.data(), aiffFast.size(), &fmt));
+
+    // Mapped read of a fixture matches a plain read
+    std::string path = g_fixtures + "/hit_44k_stereo.wav";
+    MappedFile file;
+    CHECK(file.Open(path.c_str()) && file.Size() == 88244);
+    CHECK(!MappedFile().Open((g_fixtures + "/missing.wav").c_str()));
+}
+
+// Test signal using the full range of `bits`: tones, noise, a silent stretch and a
+// stretch with the low bits clear (wasted bits)
+static std::vector<int> FlacSignal(long long frames, int channels, int bits) {
+    std::vector<int> x((size_t)frames * channels);
+    double amp = (double)((1 << (bits - 1)) - 1);
+    for (long long f = 0; f < frames; f++) {
+        for (int c = 0; c < channels; c++) {
+            double t = (double)f / 44100.0;
+            double v = 0.5 * sin(6.2831853 * (220.0 + 110.0 * c) * t) + 0.2 * sin(6.2831853 * 3150.0 * t);
+            v += 0.25 * ((double)(HashU32((unsigned int)(f * channels + c)) % 20001) / 10000.0 - 1.0);
+            long long q = llround(v * amp * 0.9);
+            if (f >= 5000 && f < 9000) q = 0;
+            if (f >= 12000 && f < 16000 && bits > 8) q &= ~7LL;
+            x[(size_t)f * channels + c] = (int)q;
+        }
+    }
+    return x;
+}
+
+static short ToInt16(int v, int bits) {
+    return bits >= 16 ? (short)(v >> (bits - 16)) : (short)(v * (1 << (16 - bits)));
+}
+
+static bool MatchesFlac(AudioStream& s, const std::vector<int>& ref, int bits, long long first, long long count) {
+    std::vector<short> out;
+    DecodeStream(s, out, count);
+    int ch = s.channels;
+    if ((long long)out.size() != count * ch) {
+        fprintf(stderr, "  got %d frames, expected %lld\n", (int)(out.size() / ch), count);
+        return false;
+    }
+    for (size_t i = 0; i < out.size(); i++)
+        if (out[i] != ToInt16(ref[(size_t)first * ch + i], bits)) {
+            fprintf(stderr, "  sample %lld ch %d: %d vs %d\n", first + (long long)(i / ch), (int)(i % ch), out[i], ToInt16(ref[(size_t)first * ch + i], bits));
+            return false;
+        }
+    return true;
+}
+
+static void TestFlac() {
+    struct Case { int channels, bits, rate; long long frames; FlacEncodeOptions opt; const char* what; };
+    std::vector<Case> cases;
+    FlacEncodeOptions def;
+    cases.push_back({ 2, 16, 44100, 44100, def, "stereo 16-bit defaults" });
+    for (int mode : { 1, 8, 9, 10 }) {
+        FlacEncodeOptions o; o.stereo = mode;
+        cases.push_back({ 2, 16, 44100, 20000, o, "forced stereo mode" });
+    }
+    for (int bits : { 8, 12, 20, 24 }) cases.push_back({ 2, bits, 48000, 20000, def, "bit depth" });
+    { FlacEncodeOptions o; o.verbatim = true; cases.push_back({ 1, 16, 44100, 20000, o, "verbatim" }); }
+    { FlacEncodeOptions o; o.maxLpcOrder = 0; cases.push_back({ 6, 24, 96000, 20000, o, "fixed predictors, 6 channels" }); }
+    { FlacEncodeOptions o; o.maxLpcOrder = 32; cases.push_back({ 1, 24, 44100, 20000, o, "lpc order 32" }); }
+    { FlacEncodeOptions o; o.variableBlocks = true; cases.push_back({ 2, 16, 44100, 30000, o, "variable block size" }); }
+    for (int bs : { 192, 100, 1000, 4608 }) {
+        FlacEncodeOptions o; o.blockSize = bs;
+        cases.push_back({ 2, 16, 22050, 20000, o, "block size" });
+    }
+    { FlacEncodeOptions o; cases.push_back({ 1, 4, 12345, 5000, o, "4-bit at an odd rate" }); }
+    { FlacEncodeOptions o; cases.push_back({ 1, 16, 44100, 10, o, "ten frames" }); }
+
+    for (const Case& c : cases) {
+        std::vector<int> ref = FlacSignal(c.frames, c.channels, c.bits);
+        std::vector<unsigned char> img;
+        EncodeFlac(ref.data(), c.frames, c.channels, c.bits, c.rate, c.opt, img);
+        std::unique_ptr<AudioStream> s = OpenAudioStream(img.data(), img.size());
+        CHECK(s != NULL);
+        if (!s) continue;
+        CHECK(!strcmp(s->codec, "flac") && s->channels == c.channels && s->bitsPerSample == c.bits);
+        CHECK(s->sampleRate == c.rate && s->frames == c.frames);
+        bool same = MatchesFlac(*s, ref, c.bits, 0, c.frames);
+        if (!same) fprintf(stderr, "  flac case failed: %s (%d ch, %d bit)\n", c.what, c.channels, c.bits);
+        CHECK(same);
+        short extra;
+        CHECK(s->Read(&extra, 1) == 0);
+    }
+
+    // Compression actually happens
+    std::vector<int> ref = FlacSignal(88200, 2, 16);
+    std::vector<unsigned char> img, plain;
+    EncodeFlac(ref.data(), 88200, 2, 16, 44100, FlacEncodeOptions(), img);
+    FlacEncodeOptions verbatim; verbatim.verbatim = true;
+    EncodeFlac(ref.data(), 88200, 2, 16, 44100, verbatim, plain);
+    CHECK(img.size() * 10 < plain.size() * 9);
+
+    // Seeking with and without a seek table, and with variable block sizes
+    for (int variant = 0; variant < 3; variant++) {
+        FlacEncodeOptions o;
+        if (variant == 1) o.seekPoints = 10;
+        if (variant == 2) o.variableBlocks = true;
+        std::vector<unsigned char> enc;
+        EncodeFlac(ref.data(), 88200, 2, 16, 44100, o, enc);
+        std::unique_ptr<AudioStream> s = OpenAudioStream(enc.data(), enc.size());
+        if (!s) { CHECK(false); continue; }
+        for (int q = 0; q < 20; q++) {
+            long long at = (long long)(HashU32(q + variant * 100) % 88200);
+            long long count = at + 3000 <= 88200 ? 3000 : 88200 - at;
+            CHECK(s->Seek(at));
+            bool same = MatchesFlac(*s, ref, 16, at, count);
+            if (!same) fprintf(stderr, "  seek to %lld failed (variant %d)\n", at, variant);
+            CHECK(same);
+        }
+        CHECK(s->Seek(0) && MatchesFlac(*s, ref, 16, 0, 100));
+        CHECK(s->Seek(88200));
+        short one[2];
+        CHECK(s->Read(one, 1) == 0);
+    }
+
+    // A damaged frame decodes as silence; the rest of the file is intact
+    {
+        FlacEncodeOptions o;
+        o.blockSize = 4096;
+        std::vector<unsigned char> enc;
+        EncodeFlac(ref.data(), 88200, 2, 16, 44100, o, enc);
+        std::vector<unsigned char> bad = enc;
+        bad[bad.size() / 2] ^= 0x55;
+        std::unique_ptr<AudioStream> s = OpenAudioStream(bad.data(), bad.size());
+        std::vector<short> out;
+        CHECK(s && DecodeStream(*s, out));
+        CHECK(out.size() == ref.size());
+        int wrong = 0, silentWrong = 0;
+        for (size_t i = 0; i < out.size() && i < ref.size(); i++) {
+            if (out[i] != ref[i]) { wrong++; silentWrong += out[i] == 0; }
+        }
+        CHECK(wrong > 0 && wrong <= 2 * 4096 * 2 && silentWrong == wrong);
+
+        // Truncated: decodes what is there
+        std::unique_ptr<AudioStream> t = OpenAudioStream(enc.data(), enc.size() / 3);
+        out.clear();
+        CHECK(t && DecodeStream(*t, out));
+        CHECK(out.size() > 0 && out.size() < ref.size());
+        for (size_t i = 0; i + 4096 * 2 < out.size(); i++) if (out[i] != ref[i]) { CHECK(false); break; }
+
+        // ID3v2 tag in front
+        std::vector<unsigned char> tagged = { 'I', 'D', '3', 3, 0, 0, 0, 0, 0, 20 };
+        tagged.insert(tagged.end(), 20, 0);
+        tagged.insert(tagged.end(), enc.begin(), enc.end());
+        std::unique_ptr<AudioStream> id3 = OpenAudioStream(tagged.data(), tagged.size());
+        CHECK(id3 && MatchesFlac(*id3, ref, 16, 0, 88200));
+
+        // A total far beyond what the frames could hold is ignored, not reserved
+        std::vector<unsigned char> huge = enc;
+        huge[8 + 13] |= 0x0F;
+        for (int i = 8 + 14; i < 8 + 18; i++) huge[i] = 0xFF;
+        std::unique_ptr<AudioStream> h = OpenAudioStream(huge.data(), huge.size());
+        out.clear();
+        CHECK(h && h->frames == 0 && DecodeStream(*h, out) && out.size() == ref.size());
+    }
+
+    // Not audio the built-in decoders understand
+    const unsigned char junk[64] = { 'I', 'D', '3', 3, 0, 0, 0, 0, 0, 1 };
+    CHECK(OpenAudioStream(junk, sizeof(junk)) == NULL);
+    CHECK(OpenAudioStream(img.data(), 20) == NULL);
+}
+
+// MD5 (RFC 1321), for the digest of the source samples in FLAC's STREAMINFO
+static void Md5(const unsigned char* msg, size_t len, unsigned char digest[16]) {
+    static const unsigned int K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+    static const int R[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+    std::vector<unsigned char> m(msg, msg + len);
+    m.push_back(0x80);
+    while (m.size() % 64 != 56) m.push_back(0);
+    for (int i = 0; i < 8; i++) m.push_back((unsigned char)((unsigned long long)len * 8 >> (8 * i)));
+    unsigned int h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    for (size_t at = 0; at < m.size(); at += 64) {
+        unsigned int w[16], a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 16; i++)
+            w[i] = m[at + 4 * i] | m[at + 4 * i + 1] << 8 | m[at + 4 * i + 2] << 16 | (unsigned int)m[at + 4 * i + 3] << 24;
+        for (int i = 0; i < 64; i++) {
+            unsigned int f; int g;
+            if (i < 16) { f = (b & c) | (~b & d); g = i; }
+            else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+            else if (i < 48) { f = b ^ c ^ d; g = (3 * i + 5) % 16; }
+            else { f = c ^ (b | ~d); g = (7 * i) % 16; }
+            unsigned int t = a + f + K[i] + w[g];
+            int s = R[(i / 16) * 4 + i % 4];
+            a = d; d = c; c = b;
+            b += (t << s) | (t >> (32 - s));
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    }
+    for (int i = 0; i < 16; i++) digest[i] = (unsigned char)(h[i / 4] >> (8 * (i % 4)));
+}
+
+// Files from the reference encoder (tests/fixtures/make_flac_fixtures.py): decoded
+// samples must hash to the MD5 the encoder stored in STREAMINFO
+static void TestFlacFixtures() {
+    unsigned char digest[16];
+    Md5((const unsigned char*)"abc", 3, digest);
+    const unsigned char abc[16] = { 0x90, 0x01, 0x50, 0x98, 0x3c, 0xd2, 0x4f, 0xb0, 0xd6, 0x96, 0x3f, 0x7d, 0x28, 0xe1, 0x7f, 0x72 };
+    CHECK(!memcmp(digest, abc, 16));
+
+    struct Fixture { const char* name; int channels, bits, rate, block; long long frames; };
+    const Fixture fixtures[] = {
+        { "flac16_stereo_l0.flac", 2, 16, 44100, 1152, 17640 },   // Independent channels
+        { "flac16_stereo_l2.flac", 2, 16, 44100, 1152, 17640 },   // All four stereo modes
+        { "flac24_stereo_l8.flac", 2, 24, 48000, 4096, 19200 },   // LPC order 12, seek table
+        { "flac8_mono_l3.flac", 1, 8, 22050, 4096, 11025 },       // 8-bit
+    };
+    for (const Fixture& fx : fixtures) {
+        MappedFile file;
+        if (!file.Open((g_fixtures + "/" + fx.name).c_str())) {
+            fprintf(stderr, "cannot read fixture %s\n", fx.name);
+            CHECK(false);
+            continue;
+        }
+        std::unique_ptr<AudioStream> s = OpenAudioStream(file.Data(), file.Size());
+        CHECK(s != NULL);
+        if (!s) continue;
+        CHECK(!strcmp(s->codec, "flac") && s->channels == fx.channels && s->bitsPerSample == fx.bits);
+        CHECK(s->sampleRate == fx.rate && s->frames == fx.frames);
+
+        std::vector<float> out;
+        CHECK(DecodeStream(*s, out) && (long long)out.size() == fx.frames * fx.channels);
+        int bytes = (fx.bits + 7) / 8;
+        std::vector<unsigned char> le;
+        for (float v : out) {
+            long long q = llround(v * (double)(1 << (fx.bits - 1)));
+            for (int k = 0; k < bytes; k++) le.push_back((unsigned char)(q >> (8 * k)));
+        }
+        Md5(le.data(), le.size(), digest);
+        bool same = !memcmp(digest, file.Data() + 8 + 18, 16);
+        if (!same) fprintf(stderr, "  %s: MD5 mismatch\n", fx.name);
+        CHECK(same);
+
+        // Seeks land on the same samples as the straight decode
+        for (int q = 0; q < 12; q++) {
+            long long at = (long long)(HashU32(q + 17) % (unsigned int)fx.frames);
+            long long count = at + 1000 <= fx.frames ? 1000 : fx.frames - at;
+            std::vector<float> part;
+            CHECK(s->Seek(at) && DecodeStream(*s, part, count));
+            CHECK(part.size() == (size_t)count * fx.channels &&
+                  std::equal(part.begin(), part.end(), out.begin() + at * fx.channels));
+        }
+
+        // Damaged frames come out as silence and leave the others intact
+        for (int q = 0; q < 16; q++) {
+            std::vector<unsigned char> bad(file.Data(), file.Data() + file.Size());
+            size_t at = 100 + HashU32(q + 41) % (unsigned int)(bad.size() - 200);
+            for (size_t i = at; i < at + 48; i++) bad[i] = (unsigned char)HashU32((unsigned int)(q * 977 + i));
+            std::unique_ptr<AudioStream> d = OpenAudioStream(bad.data(), bad.size());
+            std::vector<float> got;
+            if (!d) continue;           // Hit the metadata
+            CHECK(DecodeStream(*d, got) && got.size() == out.size());
+            bool blocksOk = true;
+            for (size_t b = 0; b < got.size() && got.size() == out.size(); b += (size_t)fx.block * fx.channels) {
+                size_t len = std::min(got.size() - b, (size_t)fx.block * fx.channels);
+                bool same = std::equal(got.begin() + b, got.begin() + b + len, out.begin() + b);
+                bool silent = std::all_of(got.begin() + b, got.begin() + b + len, [](float v) { return v == 0.0f; });
+                blocksOk &= same || silent;
+            }
+            CHECK(blocksOk);
+        }
+    }
+}
+
+// Files from LAME (tests/fixtures/make_mp3_fixtures.py) against mpg123's decode of them,
+// stored as 24-bit FLAC: same length after the gapless trim, same samples to within
+// float rounding
+static void TestMp3Fixtures() {
+    struct Fixture { const char* name; int channels, rate; long long frames; };
+    const Fixture fixtures[] = {
+        { "mp3_44k_joint_cbr", 2, 44100, 17640 },       // MPEG-1 joint stereo, ID3v2 tag
+        { "mp3_48k_vbr_hits", 2, 48000, 19200 },        // MPEG-1 VBR, short blocks
+        { "mp3_22k_mono", 1, 22050, 11025 },            // MPEG-2
+        { "mp3_8k_hits", 1, 8000, 6400 },               // MPEG-2.5
+    };
+    for (const Fixture& fx : fixtures) {
+        MappedFile file, refFile;
+        std::string name = g_fixtures + "/" + fx.name;
+        if (!file.Open((name + ".mp3").c_str()) || !refFile.Open((name + "_ref.flac").c_str())) {
+            fprintf(stderr, "cannot read fixture %s\n", fx.name);
+            CHECK(false);
+            continue;
+        }
+        std::unique_ptr<AudioStream> s = OpenAudioStream(file.Data(), file.Size());
+        std::unique_ptr<AudioStream> r = OpenAudioStream(refFile.Data(), refFile.Size());
+        CHECK(s != NULL && r != NULL);
+        if (!s || !r) continue;
+        CHECK(!strcmp(s->codec, "mp3") && s->channels == fx.channels && s->bitsPerSample == 0);
+        CHECK(s->sampleRate == fx.rate && s->frames == fx.frames);
+
+        std::vector<float> out, ref;
+        CHECK(DecodeStream(*s, out) && DecodeStream(*r, ref));
+        CHECK((long long)out.size() == fx.frames * fx.channels && out.size() == ref.size());
+        float maxDiff = 0.0f;
+        for (size_t i = 0; i < out.size() && i < ref.size(); i++) maxDiff = std::max(maxDiff, fabsf(out[i] - ref[i]));
+        if (maxDiff > 1e-5f) fprintf(stderr, "  %s: off by %g from the reference decode\n", fx.name, maxDiff);
+        CHECK(maxDiff <= 1e-5f);
+
+        // Seeks land on the same samples as the straight decode
+        for (int q = 0; q < 12; q++) {
+            long long at = (long long)(HashU32(q + 29) % (unsigned int)fx.frames);
+            long long count = at + 1000 <= fx.frames ? 1000 : fx.frames - at;
+            std::vector<float> part;
+            CHECK(s->Seek(at) && DecodeStream(*s, part, count));
+            CHECK(part.size() == (size_t)count * fx.channels &&
+                  std::equal(part.begin(), part.end(), out.begin() + at * fx.channels));
+        }
+
+        // A cut-off file keeps the frames that are whole; the 16-bit path agrees with the float one
+        std::unique_ptr<AudioStream> cut = OpenAudioStream(file.Data(), file.Size() / 2);
+        std::vector<short> pcm;
+        CHECK(cut && cut->frames > 0 && cut->frames < fx.frames && DecodeStream(*cut, pcm));
+        CHECK(cut && (long long)pcm.size() == cut->frames * fx.channels);
+        bool close = true;
+        for (size_t i = 0; i < pcm.size(); i++) close &= fabsf(pcm[i] / 32768.0f - out[i]) <= 1.0f / 32768.0f;
+        CHECK(close);
+    }
+
+    // Frame sync bytes alone are not enough to pass for mp3
+    std::vector<unsigned char> noise(4096);
+    for (size_t i = 0; i < noise.size(); i++) noise[i] = i % 5 ? (unsigned char)HashU32((unsigned)i) : 0xFF;
+    CHECK(OpenAudioStream(noise.data(), noise.size()) == NULL);
+}
+
+static void TestHighRes() {
+    // Float analysis of 16-bit material matches the 16-bit path
+    std::vector<short> st = Sine(440.0f, 0.5f, 44100, 1.0f, 2);
+    for (size_t i = 0; i < st.size(); i += 2) st[i + 1] = (short)(st[i + 1] / 3 + (int)(HashU32((unsigned)i) % 2001) - 1000);
+    std::vector<float> fl(st.size());
+    for (size_t i = 0; i < st.size(); i++) fl[i] = st[i] / 32768.0f;
+    SampleAnalysis a16, a32;
+    CHECK(AnalyzePcm(st.data(), (int)st.size(), 44100, 2, &a16) && AnalyzePcm(fl.data(), (int)fl.size(), 44100, 2, &a32));
+    for (int d = 0; d < FEATURE_DIM; d++) CHECK_NEAR(a16.features[d], a32.features[d], 1e-5f);
+    CHECK(a16.fingerprintLen == a32.fingerprintLen && !memcmp(a16.fingerprint, a32.fingerprint, sizeof(a16.fingerprint)));
+    CHECK(a16.bitsPerSample == 16 && !a16.isFloat && a32.bitsPerSample == 32 && a32.isFloat);
+
+    // A 24-bit tone below the 16-bit LSB survives only on the float path
+    const int frames = 44100;
+    std::vector<unsigned char> wav = MakeWav(std::vector<short>(frames, 0), 1, ENC_INT24, false, false);
+    unsigned char* data = &wav[wav.size() - frames * 3];
+    for (int f = 0; f < frames; f++) {
+        int v = (int)lrintf(100.0f * sinf(6.2831853f * 1000.0f * f / 44100.0f));
+        for (int k = 0; k < 3; k++) data[f * 3 + k] = (unsigned char)(v >> (8 * k));
+    }
+    SampleAnalysis a;
+    CHECK(AnalyzeAudioImage(wav.data(), wav.size(), &a));
+    CHECK(a.bitsPerSample == 24 && !a.isFloat && a.numFrames == frames);
+    CHECK(a.features[FEAT_RMS] > 0.001f && a.features[FEAT_ZCR] > 0.1f);
+    PcmFormat fmt;
+    std::vector<short> scratch;
+    CHECK(ParsePcmFile(wav.data(), wav.size(), &fmt));
+    const short* q = PcmAsInt16(fmt, scratch);
+    CHECK(AnalyzePcm(q, frames, 44100, 1, &a16) && a16.features[FEAT_ZCR] == 0.0f);   // Truncated to 0 / -1
+
+    // Reported source formats
+    std::vector<short> tone = Sine(440.0f, 0.5f, 44100, 0.2f);
+    CHECK(AnalyzeAudioImage(MakeWav(tone, 1, ENC_INT16, false, false).data(), MakeWav(tone, 1, ENC_INT16, false, false).size(), &a));
+    CHECK(a.bitsPerSample == 16 && !a.isFloat);
+    std::vector<unsigned char> img = MakeWav(tone, 1, ENC_FLOAT32, false, false);
+    CHECK(AnalyzeAudioImage(img.data(), img.size(), &a) && a.bitsPerSample == 32 && a.isFloat);
+    img = MakeAiff(tone, 1, ENC_S8, NULL);
+    CHECK(AnalyzeAudioImage(img.data(), img.size(), &a) && a.bitsPerSample == 8 && !a.isFloat);
+    for (int bits : { 16, 24 }) {
+        std::vector<int> ref = FlacSignal(20000, 2, bits);
+        EncodeFlac(ref.data(), 20000, 2, bits, 48000, FlacEncodeOptions(), img);
+        CHECK(AnalyzeAudioImage(img.data(), img.size(), &a) && a.bitsPerSample == bits && a.sampleRate == 48000);
+        std::unique_ptr<AudioStream> s = OpenAudioStream(img.data(), img.size());
+        std::vector<float> out;
+        CHECK(s && DecodeStream(*s, out) && out.size() == ref.size());
+        int bad = 0;
+        for (size_t i = 0; i < out.size() && i < ref.size(); i++) bad += out[i] != ref[i] / (float)(1 << (bits - 1));
+        CHECK(bad == 0);
+    }
+    const unsigned char junk[64] = { 0 };
+    CHECK(!AnalyzeAudioImage(junk, sizeof(junk), &a));
+}
+
+// Change notifications for a temporary tree (skipped where the platform has no backend)
+static void TestWatcher() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path root = fs::temp_directory_path(ec) /
+        ("audiomap_watch_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(root / "a", ec);
+    FolderWatcher w;
+    if (ec || !w.Start(root.string().c_str())) { fs::remove_all(root, ec); return; }
+    CHECK(w.Active());
+
+    std::vector<std::string> seen;
+    bool lost = false;
+    auto Saw = [&](const fs::path& p) {
+        for (int tries = 0; tries < 200; tries++) {
+            bool overflow;
+            w.Poll(seen, &overflow);
+            lost |= overflow;
+            if (std::find(seen.begin(), seen.end(), p.string()) != seen.end()) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        fprintf(stderr, "  no event for %s\n", p.string().c_str());
+        return false;
+    };
+    auto Touch = [](const fs::path& p) { FILE* f = fopen(p.string().c_str(), "wb"); if (f) { fputs("RIFF", f); fclose(f); } };
+
+    Touch(root / "a" / "x.wav");
+    CHECK(Saw(root / "a" / "x.wav"));
+    seen.clear();
+    fs::create_directories(root / "b" / "c", ec);
+    CHECK(Saw(root / "b"));
+    Touch(root / "b" / "c" / "y.wav");          // Inside a directory created after Start
+    CHECK(Saw(root / "b" / "c" / "y.wav"));
+    seen.clear();
+    fs::rename(root / "a" / "x.wav", root / "b" / "z.wav", ec);
+    CHECK(Saw(root / "a" / "x.wav") && Saw(root / "b" / "z.wav"));
+    seen.clear();
+    fs::remove_all(root / "b", ec);
+    CHECK(Saw(root / "b"));
+    CHECK(!lost);
+
+    w.Stop();
+    CHECK(!w.Active());
+    bool overflow = true;
+    seen.clear();
+    w.Poll(seen, &overflow);
+    CHECK(seen.empty() && !overflow);
+    fs::remove_all(root, ec);
+}
+
+static void TestTrace() {
+    // Inactive: nothing is recorded
+    { TraceScope t("idle"); }
+    g_tracer.Add("idle", 1);
+    CHECK(g_tracer.Summarize().empty());
+
+    g_tracer.Start();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++)
+        threads.emplace_back([t]() {
+            for (int i = 0; i < 100; i++) {
+                TraceScope s("work", t == 0 && i == 0 ? "C:\\lib\\\"q\".wav" : NULL);
+                g_tracer.Add("items", 2);
+            }
+            g_tracer.Sample("queued", t);
+        });
+    for (auto& t : threads) t.join();
+
+    // Stages recorded inside the core decode path
+    std::vector<int> ref = FlacSignal(4410, 1, 16);
+    std::vector<unsigned char> img;
+    EncodeFlac(ref.data(), 4410, 1, 16, 44100, FlacEncodeOptions(), img);
+    SampleAnalysis a;
+    CHECK(AnalyzeAudioImage(img.data(), img.size(), &a));
+    g_tracer.Stop();
+    { TraceScope late("late"); }
+
+    std::vector<Tracer::StageStats> stages = g_tracer.Summarize();
+    CHECK(stages.size() == 3);
+    if (stages.size() == 3) {
+        CHECK(!strcmp(stages[0].name, "work") && stages[0].count == 300);
+        CHECK(!strcmp(stages[1].name, "decode") && stages[1].count == 1);
+        CHECK(!strcmp(stages[2].name, "analyse") && stages[2].count == 1);
+        CHECK(stages[0].p50Us <= stages[0].p99Us && stages[0].p99Us <= stages[0].maxUs);
+    }
+    CHECK(g_tracer.Total("items") == 600);
+    CHECK(g_tracer.Total("idle") == 0);
+
+    FILE* f = tmpfile();
+    CHECK(f && g_tracer.WriteChromeTrace(f));
+    if (!f) return;
+    std::string json;
+    rewind(f);
+    for (int c; (c = fgetc(f)) != EOF;) json += (char)c;
+    fclose(f);
+    auto Count = [&](const char* needle) {
+        int n = 0;
+        for (size_t at = json.find(needle); at != std::string::npos; at = json.find(needle, at + 1)) n++;
+        return n;
+    };
+    CHECK(json.compare(0, 17, "{\"displayTimeUnit") == 0);
+    CHECK(Count("\"ph\":\"X\"") == 302);
+    CHECK(Count("\"ph\":\"C\"") == 3);
+    CHECK(Count("\"thread_name\"") == 4);
+    CHECK(Count("\"detail\":\"C:\\\\lib\\\\\\\"q\\\".wav\"") == 1);
+    CHECK(json.size() > 3 && json.compare(json.size() - 3, 3, "]}\n") == 0);
+}
+
+static void TestFrameProfiler() {
+    static const char* const names[] = { "grid", "dots" };
+    FrameProfiler prof(names, 2, 4);
+    CHECK(prof.Frames() == 0 && prof.Section(0).p99 == 0);
+    for (int frame = 1; frame <= 6; frame++) {
+        prof.Add(0, 10.0 * frame);
+        prof.Add(1, 1.0);
+        prof.Add(1, 2.0);
+        prof.EndFrame(frame, frame > 4 ? 0 : 2);
+    }
+    // Window holds frames 3..6
+    CHECK(prof.Frames() == 4);
+    CHECK_NEAR(prof.Section(0).last, 60.0, 1e-9);
+    CHECK_NEAR(prof.Section(0).p50, 40.0, 1e-9);
+    CHECK_NEAR(prof.Section(0).p99, 50.0, 1e-9);
+    CHECK_NEAR(prof.Section(1).p99, 3.0, 1e-9);
+    CHECK_NEAR(prof.Section(2).last, 63.0, 1e-9);
+    CHECK_NEAR(prof.Allocations().p50, 4.0, 1e-9);
+    CHECK(prof.Objects().last == 0 && prof.Objects().p99 == 2);
+
+    FILE* f = tmpfile();
+    CHECK(f && prof.WriteCsv(f));
+    if (!f) return;
+    std::string csv;
+    rewind(f);
+    for (int c; (c = fgetc(f)) != EOF;) csv += (char)c;
+    fclose(f);
+    CHECK(csv == "frame,grid_us,dots_us,total_us,allocations,objects\n"
+                 "2,30.0,3.0,33.0,3,2\n3,40.0,3.0,43.0,4,2\n4,50.0,3.0,53.0,5,0\n5,60.0,3.0,63.0,6,0\n");
+
+    prof.Reset();
+    CHECK(prof.Frames() == 0);
+}
+
+static void TestSlotReservation() {
+    // Producers publish every third item into reserved slots; Order restores input order
+    const int n = 5000;
+    std::vector<int> storage(n, -1);
+    SlotReservation slots(n);
+    ParallelRanges(n, 4, [&](int start, int end) {
+        for (int i = start; i < end; i++) {
+            if (i % 3) continue;
+            int slot = slots.Reserve(i);
+            if (slot >= 0) storage[slot] = i;
+        }
+    });
+    int kept = slots.Count();
+    CHECK(kept == (n + 2) / 3 && !slots.Full());
+    PermuteInPlace(storage.data(), slots.Order());
+    bool ordered = true;
+    for (int k = 0; k < kept; k++) ordered &= storage[k] == k * 3;
+    CHECK(ordered && storage[kept] == -1);
+
+    // Capacity caps the total however many threads race for the last slots
+    SlotReservation small(100);
+    std::atomic<int> granted(0), refused(0);
+    ParallelRanges(1000, 4, [&](int start, int end) {
+        for (int i = start; i < end; i++) (small.Reserve(i) >= 0 ? granted : refused)++;
+    });
+    CHECK(granted == 100 && refused == 900 && small.Count() == 100 && small.Full());
+    std::vector<int> order = small.Order();
+    CHECK(order.size() == 100);
+    CHECK(SlotReservation(0).Reserve(1) == -1);
+}
+
+static void TestMetadataFilters() {
+    // Three columns: a continuous value, a few discrete rates and one NaN
+    const int n = 1000;
+    std::vector<float> v((size_t)n * 3);
+    const float rates[] = { 22050, 44100, 48000, 96000 };
+    for (int i = 0; i < n; i++) {
+        v[i] = (float)(HashU32(i) % 10000) / 1000.0f;
+        v[n + i] = rates[HashU32(i + 77) % 4];
+        v[2 * n + i] = (float)(i % 2 + 1);
+    }
+    v[5] = NAN;
+    MetadataIndex meta;
+    meta.Build(v.data(), n, 3);
+    CHECK(meta.Size() == n && meta.Columns() == 3 && meta.Matches() == n && !meta.AnyActive());
+    CHECK(meta.Min(1) == 22050 && meta.Max(1) == 96000 && meta.Max(0) <= 10.0f);
+
+    auto Expected = [&](float lo0, float hi0, bool rate48) {
+        int count = 0;
+        bool same = true;
+        for (int i = 0; i < n; i++) {
+            bool keep = v[i] >= lo0 && v[i] <= hi0 && (!rate48 || v[n + i] == 48000);
+            count += keep;
+            same &= meta.Match(i) == keep;
+        }
+        return same && count == meta.Matches();
+    };
+    // Slider drags: widen, shift, shrink, jump past the old range, then a second filter
+    meta.SetRange(0, 2.0f, 4.0f);
+    CHECK(Expected(2.0f, 4.0f, false) && meta.Active(0) && meta.AnyActive());
+    meta.SetRange(0, 1.5f, 6.0f);
+    CHECK(Expected(1.5f, 6.0f, false));
+    meta.SetRange(0, 3.0f, 5.0f);
+    CHECK(Expected(3.0f, 5.0f, false));
+    meta.SetRange(0, 8.0f, 7.0f);       // Bounds in either order, disjoint from the last range
+    CHECK(Expected(7.0f, 8.0f, false) && meta.RangeLo(0) == 7.0f);
+    meta.SetRange(1, 48000, 48000);
+    CHECK(Expected(7.0f, 8.0f, true));
+    int kept = 0;
+    for (int i = 0; i < n; i++) kept += v[n + i] == 48000;
+    CHECK(meta.Kept(1) == kept);
+
+    // Histograms: all samples, and only the matching ones
+    int all[META_HIST_BINS], matching[META_HIST_BINS], sumAll = 0, sumMatch = 0;
+    meta.Histogram(1, false, all);
+    meta.Histogram(1, true, matching);
+    for (int b = 0; b < META_HIST_BINS; b++) { sumAll += all[b]; sumMatch += matching[b]; }
+    CHECK(sumAll == n && sumMatch == meta.Matches());
+    int bin48 = (int)((48000.0f - 22050.0f) / (96000.0f - 22050.0f) * META_HIST_BINS);
+    CHECK(matching[bin48] == meta.Matches() && meta.BinLo(1, 0) == 22050.0f);
+    meta.Histogram(0, false, all);
+    sumAll = 0;
+    for (int b = 0; b < META_HIST_BINS; b++) sumAll += all[b];
+    CHECK(sumAll == n - 1);             // The NaN is in no bin
+
+    // Rebuilding keeps the active filters; clearing restores every sample
+    v[n + 0] = 48000; v[0] = 7.5f;
+    meta.Build(v.data(), n, 3);
+    CHECK(meta.Active(0) && meta.Active(1) && Expected(7.0f, 8.0f, true) && meta.Match(0));
+    meta.ClearRange(1);
+    CHECK(Expected(7.0f, 8.0f, false) && !meta.Active(1));
+    meta.SetRange(1, 48000, 48000);     // Toggling back on, then moving a cleared filter
+    CHECK(Expected(7.0f, 8.0f, true));
+    meta.ClearRange(0);
+    meta.SetRange(0, 1.0f, 3.0f);
+    CHECK(Expected(1.0f, 3.0f, true));
+    meta.ClearAll();
+    CHECK(meta.Matches() == n && !meta.AnyActive() && meta.Match(999));
+    meta.SetRange(2, 5, 6);
+    CHECK(meta.Matches() == 0 && !meta.Match(0));
+}
+
+static void TestTileRaster() {
+    const int w = 203, h = 149;
+    auto Draw = [&](int threads, int tileSize, std::vector<unsigned int>& px) {
+        TileRasterizer tiles(threads, tileSize);
+        px.assign((size_t)w * h, 0xdeadbeef);
+        for (int i = 0; i < 300; i++)
+            tiles.Disc((float)(HashU32(i) % 240) - 20, (float)(HashU32(i + 999) % 180) - 15, 2.0f + i % 9,
+                       0x80000000u | (HashU32(i * 7) & 0xffffff));
+        tiles.Segment(10, 100, 190, 20, 2.5f, 0xffffffff, 0xff0000ff);
+        tiles.Ring(100, 75, 30, 1.5f, 0x80ffffff);
+        tiles.Glow(-3, -3, 12, 0xc8ffffff);
+        tiles.Disc(150, 120, 6, 0xff00ff00);
+        CHECK(tiles.Queued() == 304);
+        tiles.Render({ px.data(), w, h, w }, 0x141419, 0x232328, 50);
+        CHECK(tiles.Queued() == 0);
+    };
+    // Tiles must not paint outside their own bounds, whatever their size or thread
+    std::vector<unsigned int> one, many, coarse;
+    Draw(1, 16, one);
+    Draw(4, 16, many);
+    Draw(1, 64, coarse);
+    CHECK(one == many);
+    CHECK(one == coarse);
+
+    // Background, grid and an opaque disc over them
+    TileRasterizer tiles(3, 32);
+    std::vector<unsigned int> px((size_t)w * h);
+    RasterTarget target = { px.data(), w, h, w };
+    tiles.Disc(120, 70, 5, 0xff00ff00);
+    tiles.Segment(10, 20, 40, 20, 3, 0xffffffff, 0xff0000ff);
+    tiles.Glow(180, 130, 10, 0xffffffff);
+    tiles.Disc(-50, -50, 5, 0xffff0000);    // Entirely off-target
+    tiles.Render(target, 0x141419, 0x232328, 50);
+    CHECK(px[(size_t)7 * w + 7] == 0x141419);
+    CHECK(px[(size_t)7 * w + 50] == 0x232328 && px[(size_t)100 * w + 7] == 0x232328);
+    CHECK(px[(size_t)70 * w + 120] == 0x00ff00 && px[(size_t)70 * w + 124] == 0x00ff00);
+    CHECK(px[(size_t)70 * w + 127] == 0x141419);
+    unsigned int edge = px[(size_t)70 * w + 125];
+    CHECK(edge != 0x00ff00 && edge != 0x141419);
+    // The segment runs white to blue, the glow fades outwards
+    CHECK(((px[(size_t)20 * w + 11] >> 16) & 255) > 200 && (px[(size_t)20 * w + 11] & 255) > 200);
+    CHECK(((px[(size_t)20 * w + 39] >> 16) & 255) < 40 && (px[(size_t)20 * w + 39] & 255) > 200);
+    CHECK(px[(size_t)19 * w + 25] != 0x141419 && px[(size_t)24 * w + 25] == 0x141419);
+    unsigned int core = px[(size_t)130 * w + 180], rim = px[(size_t)130 * w + 188];
+    CHECK((core & 255) > (rim & 255) && (rim & 255) > 0x19);
+
+    // Resized targets re-bin from scratch
+    std::vector<unsigned int> small(64 * 40);
+    tiles.Disc(10, 10, 3, 0xffffffff);
+    tiles.Render({ small.data(), 64, 40, 64 }, 0, 0, 0);
+    CHECK(small[10 * 64 + 10] == 0xffffff && small[39 * 64 + 63] == 0);
+}
+
+static void TestProjection() {
+    // Quarter-unit positions and a power-of-two scale keep every product exact, so the
+    // vector and scalar paths must agree bit for bit; an odd count exercises the tail
+    const int n = 1003;
+    std::vector<float> x(n), y(n);
+    std::vector<unsigned char> hidden(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = (float)((int)(HashU32(i) % 1600) - 800) * 0.25f;
+        y[i] = (float)((int)(HashU32(i + 5000) % 1200) - 600) * 0.25f;
+        hidden[i] = (i % 7 == 3) ? 1 : 0;
+    }
+    x[8] = 1e30f; y[9] = -1e30f; x[11] = NAN;    // Clamped
+    MapTransform t = { 320.0f, 2.0f, 240.0f, -1.0f };
+    CullBox view = { -20, -20, 660, 500 }, hole = { 460, 350, 625, 465 };
+
+    std::vector<int> sx(n), sy(n), vis(n), sx1(n), sy1(n), vis1(n);
+    int count = ProjectAndCull(x.data(), y.data(), hidden.data(), n, t, view, hole, sx.data(), sy.data(), vis.data());
+    int count1 = ProjectAndCullScalar(x.data(), y.data(), hidden.data(), n, t, view, hole, sx1.data(), sy1.data(), vis1.data());
+    CHECK(count == count1 && count > 100 && count < n);
+    CHECK(sx == sx1 && sy == sy1);
+    CHECK(std::equal(vis.begin(), vis.begin() + count, vis1.begin()));
+
+    // Against the per-point definition
+    int expected = 0;
+    bool listed = true;
+    for (int i = 0; i < n; i++) {
+        if (hidden[i]) { listed &= sx[i] == PROJECT_PARKED && sy[i] == PROJECT_PARKED; continue; }
+        if (i == 8 || i == 9 || i == 11) continue;
+        listed &= sx[i] == (int)(320.0f + x[i] * 2.0f) && sy[i] == (int)(240.0f - y[i]);
+        bool in = sx[i] >= -20 && sx[i] <= 660 && sy[i] >= -20 && sy[i] <= 500 &&
+                  !(sx[i] >= 460 && sx[i] <= 625 && sy[i] >= 350 && sy[i] <= 465);
+        if (in) listed &= expected < count && vis[expected++] == i;
+    }
+    CHECK(listed && expected == count);
+    CHECK(sx[8] == 1000000000 && sy[9] == 1000000000 && sx[11] == -1000000000);
+
+    // No hidden flags, empty hole, tiny counts
+    count = ProjectAndCull(x.data(), y.data(), NULL, 3, t, view, { 1, 1, 0, 0 }, sx.data(), sy.data(), vis.data());
+    count1 = ProjectAndCullScalar(x.data(), y.data(), NULL, 3, t, view, { 1, 1, 0, 0 }, sx1.data(), sy1.data(), vis1.data());
+    CHECK(count == count1 && std::equal(sx.begin(), sx.begin() + 3, sx1.begin()));
+    CHECK(ProjectAndCull(x.data(), y.data(), NULL, 0, t, view, hole, sx.data(), sy.data(), vis.data()) == 0);
+}
+
+static void TestSelection() {
+    // Clustered points with exact duplicates, a point on the rectangle's edge and
+    // non-finite coordinates, against a scan of every point
+    const int n = 4000;
+    std::vector<float> x(n), y(n);
+    for (int i = 0; i < n; i++) {
+        float cx = (float)(HashU32(i % 7) % 100), cy = (float)(HashU32(i % 7 + 50) % 60);
+        x[i] = cx + (float)(HashU32(i) % 2000) / 100.0f - 10.0f;
+        y[i] = cy + (float)(HashU32(i + 9999) % 2000) / 100.0f - 10.0f;
+    }
+    x[10] = x[11]; y[10] = y[11];
+    x[12] = 20.0f; y[12] = 30.0f;
+    x[13] = NAN; y[14] = INFINITY;
+    PointGrid grid;
+    grid.Build(x.data(), y.data(), n);
+    CHECK(grid.Size() == n);
+
+    std::vector<int> got, want;
+    auto Rect = [&](float x0, float y0, float x1, float y1) {
+        grid.QueryRect(x0, y0, x1, y1, got);
+        want.clear();
+        for (int i = 0; i < n; i++)
+            if (x[i] >= std::min(x0, x1) && x[i] <= std::max(x0, x1) && y[i] >= std::min(y0, y1) && y[i] <= std::max(y0, y1))
+                want.push_back(i);
+        return got == want;
+    };
+    CHECK(Rect(20.0f, 10.0f, 60.0f, 30.0f) && std::count(got.begin(), got.end(), 12) == 1);
+    CHECK(Rect(80.0f, 55.0f, -5.0f, -20.0f) && got.size() > 1000);     // Corners in any order
+    CHECK(Rect(-1e30f, -1e30f, 1e30f, 1e30f) && (int)got.size() == n - 2);
+    CHECK(Rect(500.0f, 500.0f, 600.0f, 600.0f) && got.empty());
+
+    // Concave star lasso (and its reversed winding); a triangle holding the duplicates
+    std::vector<float> px, py;
+    for (int k = 0; k < 40; k++) {
+        float a = 6.2831853f * k / 40, r = (k & 1) ? 12.0f : 40.0f;
+        px.push_back(50.0f + r * cosf(a));
+        py.push_back(30.0f + r * sinf(a));
+    }
+    auto Lasso = [&]() {
+        grid.QueryLasso(px.data(), py.data(), (int)px.size(), got);
+        want.clear();
+        for (int i = 0; i < n; i++)
+            if (PointInPolygon(x[i], y[i], px.data(), py.data(), (int)px.size())) want.push_back(i);
+        return got == want;
+    };
+    CHECK(Lasso() && got.size() > 200 && got.size() < (size_t)n / 2);
+    std::reverse(px.begin(), px.end());
+    std::reverse(py.begin(), py.end());
+    CHECK(Lasso());
+    px = { x[11] - 1.0f, x[11] + 1.0f, x[11] };
+    py = { y[11] - 1.0f, y[11] - 1.0f, y[11] + 1.0f };
+    CHECK(Lasso() && std::count(got.begin(), got.end(), 10) == 1 && std::count(got.begin(), got.end(), 11) == 1);
+
+    CHECK(PointInPolygon(0.5f, 0.5f, px.data(), py.data(), 2) == false);
+    grid.Build(x.data(), y.data(), 0);
+    grid.QueryRect(-1e30f, -1e30f, 1e30f, 1e30f, got);
+    CHECK(got.empty() && grid.Size() == 0);
+    std::vector<float> same(5, 3.0f);
+    grid.Build(same.data(), same.data(), 5);
+    grid.QueryRect(3.0f, 3.0f, 3.0f, 3.0f, got);
+    CHECK(got.size() == 5);
+}
+
+static void TestThumbnails() {
+    CHECK(QuantizeMin(0.5f) == 63 && QuantizeMax(0.5f) == 64 && QuantizeMin(-0.5f) == -64 && QuantizeMax(-0.5f) == -63);
+    CHECK(QuantizeMin(-2.0f) == -127 && QuantizeMax(2.0f) == 127 && QuantizeMax(0.0f) == 0);
+
+    // A click in bin 37 of 256 lands in bin 37 / 4 of a 64-bin store; enlarging repeats bins
+    Envelope e = { THUMB_MAX_BINS, {} };
+    for (int b = 0; b < THUMB_MAX_BINS; b++) { e.minMax[b * 2] = -10; e.minMax[b * 2 + 1] = 10; }
+    e.minMax[37 * 2] = -120; e.minMax[37 * 2 + 1] = 127;
+    ThumbnailStore store(4, 64);
+    CHECK(store.Bins() == 64 && store.Bytes() == 4 * 64 * 2);
+    store.Store(2, e);
+    const signed char* t = store.Get(2);
+    CHECK(t[9 * 2] == -120 && t[9 * 2 + 1] == 127 && t[8 * 2] == -10 && t[10 * 2 + 1] == 10);
+    CHECK(store.Get(1)[0] == 0);
+    signed char wide[128 * 2];
+    ResampleEnvelope(t, 64, wide, 128);
+    CHECK(wide[18 * 2 + 1] == 127 && wide[19 * 2 + 1] == 127 && wide[20 * 2 + 1] == 10);
+
+    // Moves and permutations carry the slot with its sample
+    Envelope flat = { 1, {} };
+    flat.minMax[0] = -1; flat.minMax[1] = 1;
+    store.Store(0, flat);
+    store.Move(2, 3);
+    CHECK(store.Get(3)[9 * 2 + 1] == 127 && store.Get(0)[63 * 2] == -1);
+    store.Permute(1, { 2, 0, 1 });      // Slots 1..3 take 3, 1, 2
+    CHECK(store.Get(1)[9 * 2 + 1] == 127 && store.Get(2)[0] == 0 && store.Get(3)[9 * 2 + 1] == 127);
+
+    Envelope back;
+    store.SetBins(16);
+    store.Load(1, &back);
+    CHECK(back.bins == 16 && back.minMax[2 * 2] == -120 && back.minMax[2 * 2 + 1] == 127 && store.Bytes() == 4 * 16 * 2);
+    store.Reserve(6);
+    CHECK(store.Capacity() == 6 && store.Get(1)[2 * 2 + 1] == 127 && store.Get(5)[1] == 0);
+    store.SetBins(1000);
+    CHECK(store.Bins() == THUMB_MAX_BINS);
+}
+
+static void TestSine() {
+    std::vector<short> pcm = Sine(441.0f, 0.5f, 44100, 1.0f);
+    SampleAnalysis a;
+    CHECK(AnalyzePcm(pcm.data(), (int)pcm.size(), 44100, 1, &a));
+    CHECK_NEAR(a.features[FEAT_RMS], sqrt(0.5 / sqrt(2.0)), 1e-3);
+    CHECK_NEAR(a.features[FEAT_ZCR], sqrt(2.0 * 441.0 / 44100.0), 1e-3);
+    CHECK_NEAR(a.features[FEAT_CREST], log10(sqrt(2.0)), 1e-3);
+    CHECK_NEAR(a.features[FEAT_DURATION], log(2.0), 1e-4);
+    CHECK_NEAR(a.features[FEAT_DECAY], 0.5, 1e-2);
+    CHECK_NEAR(a.duration, 1.0, 1e-6);
+    CHECK(a.numFrames == 44100 && a.channels == 1 && a.sampleRate == 44100);
+
+    // Identical channels: stereo features match mono
+    std::vector<short> st = Sine(441.0f, 0.5f, 44100, 1.0f, 2);
+    SampleAnalysis b;
+    CHECK(AnalyzePcm(st.data(), (int)st.size(), 44100, 2, &b));
+    CHECK(b.numFrames == 44100 && b.channels == 2);
+    for (int d = 0; d < FEATURE_DIM; d++) CHECK_NEAR(b.features[d], a.features[d], 1e-3);
+    CHECK(b.features[FEAT_WIDTH] == 0.0f && a.features[FEAT_WIDTH] == 0.0f);
+    CHECK(memcmp(&b.envelope, &a.envelope, sizeof(Envelope)) == 0);
+
+    // Every envelope bin spans several periods, so it holds both peaks (+-0.5 * 127)
+    bool peaks = a.envelope.bins == THUMB_MAX_BINS;
+    for (int i = 0; i < THUMB_MAX_BINS; i++)
+        peaks &= a.envelope.minMax[i * 2] == -64 && a.envelope.minMax[i * 2 + 1] == 64;
+    CHECK(peaks);
+
+    // Opposite polarity: left/right of one frame have opposite signs, which must not
+    // read as crossings; the side channel carries everything
+    for (size_t i = 0; i < st.size(); i += 2) st[i + 1] = (short)-st[i];
+    CHECK(AnalyzePcm(st.data(), (int)st.size(), 44100, 2, &b));
+    CHECK_NEAR(b.features[FEAT_ZCR], a.features[FEAT_ZCR], 1e-3);
+    CHECK_NEAR(b.features[FEAT_RMS], a.features[FEAT_RMS], 1e-3);
+    CHECK_NEAR(b.features[FEAT_WIDTH], 1.0, 1e-6);
+
+    // Unrelated channels sit in between; only the first two channels count
+    std::vector<short> wide((size_t)44100 * 3);
+    for (int f = 0; f < 44100; f++) {
+        wide[(size_t)f * 3] = pcm[f];
+        wide[(size_t)f * 3 + 1] = (short)((int)(HashU32(f) % 20001) - 10000);
+        wide[(size_t)f * 3 + 2] = pcm[f];
+    }
+    CHECK(AnalyzePcm(wide.data(), (int)wide.size(), 44100, 3, &b));
+    CHECK_NEAR(b.features[FEAT_WIDTH], 0.5, 0.02);
+}
+
+static void TestLoudness() {
+    // EBU Tech 3341 case 1: 1 kHz stereo sine at -23 dBFS reads -23 LUFS
+    Loudness l;
+    std::vector<short> tone = Sine(1000.0f, powf(10.0f, -23.0f / 20.0f), 48000, 5.0f, 2);
+    CHECK(MeasureLoudness(tone.data(), (int)tone.size(), 48000, 2, &l));
+    CHECK_NEAR(l.integrated, -23.0, 0.05);
+    CHECK_NEAR(l.shortTermMax, -23.0, 0.05);
+    CHECK_NEAR(l.truePeak, -23.0, 0.05);
+    // One channel carries half the power; the K-weighting adjusts for 44.1 kHz
+    tone = Sine(1000.0f, powf(10.0f, -23.0f / 20.0f), 44100, 5.0f);
+    CHECK(MeasureLoudness(tone.data(), (int)tone.size(), 44100, 1, &l));
+    CHECK_NEAR(l.integrated, -26.01, 0.05);
+
+    // Relative gate (Tech 3341 case 3, shortened): quiet passes 13 LU down barely pull
+    // the result; only blocks straddling the steps count (ungated: ~-23.8)
+    std::vector<short> gated = Sine(1000.0f, powf(10.0f, -36.0f / 20.0f), 48000, 2.0f, 2);
+    std::vector<short> loud = Sine(1000.0f, powf(10.0f, -23.0f / 20.0f), 48000, 20.0f, 2);
+    std::vector<short> quiet = gated;
+    gated.insert(gated.end(), loud.begin(), loud.end());
+    gated.insert(gated.end(), quiet.begin(), quiet.end());
+    CHECK(MeasureLoudness(gated.data(), (int)gated.size(), 48000, 2, &l));
+    CHECK_NEAR(l.integrated, -23.0, 0.1);
+    CHECK_NEAR(l.shortTermMax, -23.0, 0.05);
+
+    // True peak: a quarter-rate sine sampled 45 degrees off its crests peaks 3 dB
+    // above its samples
+    std::vector<float> quarter(48000);
+    for (int i = 0; i < 48000; i++) quarter[i] = 0.5f * sinf(1.5707963f * i + 0.7853982f);
+    CHECK(MeasureLoudness(quarter.data(), (int)quarter.size(), 48000, 1, &l));
+    CHECK_NEAR(l.truePeak, -6.02, 0.15);
+
+    // Silence, and a file shorter than one 400 ms block (measured whole)
+    std::vector<short> silence(4800 * 2, 0);
+    CHECK(MeasureLoudness(silence.data(), (int)silence.size(), 48000, 2, &l));
+    CHECK(l.integrated == LOUDNESS_FLOOR && l.shortTermMax == LOUDNESS_FLOOR && l.truePeak == TRUE_PEAK_FLOOR);
+    tone = Sine(1000.0f, powf(10.0f, -23.0f / 20.0f), 48000, 0.2f, 2);
+    CHECK(MeasureLoudness(tone.data(), (int)tone.size(), 48000, 2, &l));
+    CHECK_NEAR(l.integrated, -23.0, 0.1);
+    CHECK(!MeasureLoudness(tone.data(), 0, 48000, 2, &l));
+
+    // Rates too low for K-weighting: loudness unmeasured, the peak still read; 8 kHz is fine
+    tone = Sine(300.0f, 0.5f, 2000, 2.0f, 1);
+    CHECK(MeasureLoudness(tone.data(), (int)tone.size(), 2000, 1, &l));
+    CHECK(l.integrated == LOUDNESS_FLOOR && l.shortTermMax == LOUDNESS_FLOOR);
+    CHECK_NEAR(l.truePeak, -6.02, 0.2);
+    tone = Sine(1000.0f, powf(10.0f, -23.0f / 20.0f), 8000, 2.0f, 2);
+    CHECK(MeasureLoudness(tone.data(), (int)tone.size(), 8000, 2, &l));
+    CHECK_NEAR(l.integrated, -23.0, 0.5);
+
+    // The import analysis carries the same measurement
+    SampleAnalysis a;
+    CHECK(AnalyzePcm(loud.data(), (int)loud.size(), 48000, 2, &a));
+    CHECK_NEAR(a.loudness.integrated, -23.0, 0.05);
+
+    // Vector paths against the scalar references, over two calls (state carries over)
+    // and with an odd length for the peak tail
+    const int n = 3001;
+    std::vector<float> left(n + 2 * TRUE_PEAK_PAD), right(n);
+    unsigned int st = 7;
+    for (int i = 0; i < n; i++) {
+        st = HashU32(st);
+        left[TRUE_PEAK_PAD + i] = (float)(st & 0xffff) / 65536.0f - 0.5f;
+        right[i] = 0.8f * sinf(0.05f * i) + 0.1f * left[TRUE_PEAK_PAD + i];
+    }
+    const float* x = &left[TRUE_PEAK_PAD];
+    KWeighting k(44100);
+    KWeightState vs, ss, vm, sm;
+    bool same = true;
+    for (int part = 0; part < 2; part++) {
+        float v[2], r[2];
+        KWeightEnergy(k, &vs, x + part * 1500, &right[part * 1500], 1500, v);
+        KWeightEnergyScalar(k, &ss, x + part * 1500, &right[part * 1500], 1500, r);
+        same &= fabsf(v[0] - r[0]) <= 1e-5f * r[0] && fabsf(v[1] - r[1]) <= 1e-5f * r[1] && r[0] > 0 && r[1] > 0;
+        KWeightEnergy(k, &vm, x + part * 1500, NULL, 1500, v);
+        KWeightEnergyScalar(k, &sm, x + part * 1500, NULL, 1500, r);
+        same &= fabsf(v[0] - r[0]) <= 1e-5f * r[0] && v[1] == 0 && r[1] == 0;
+    }
+    CHECK(same);
+    for (int factor : { 1, 2, 4 }) CHECK(OversampledPeak(x, n, factor) == OversampledPeakScalar(x, n, factor));
+    CHECK(OversampledPeak(x, n, 4) >= OversampledPeak(x, n, 1));
+}
+
+// Noise bursts decaying over 15 ms, one per beat
+static std::vector<float> Clicks(float bpm, float secs, int rate) {
+    std::vector<float> x((size_t)(secs * rate));
+    unsigned int st = 11;
+    for (double t = 0.0; t < secs; t += 60.0 / bpm) {
+        size_t s = (size_t)(t * rate);
+        for (int i = 0; i < rate / 10 && s + i < x.size(); i++) {
+            st = HashU32(st);
+            x[s + i] += ((float)(st & 0xffff) / 32768.0f - 1.0f) * 0.5f * expf(-i / (rate * 0.015f));
+        }
+    }
+    return x;
+}
+
+static void TestRhythm() {
+    // A trimmed two-bar loop: every click an onset, the length snaps the tempo exactly
+    Rhythm r;
+    std::vector<float> loop = Clicks(120.0f, 4.0f, 44100);
+    CHECK(AnalyzeRhythm(loop.data(), (int)loop.size(), (int)loop.size(), 44100, &r));
+    CHECK(r.onsets == 8 && r.tempo == 120.0f);
+    CHECK(r.loopability > 0.6f);
+    // The same pulse cut from a longer file keeps its tempo but is no loop
+    CHECK(AnalyzeRhythm(loop.data(), (int)loop.size(), (int)loop.size() * 4, 44100, &r));
+    CHECK_NEAR(r.tempo, 120.0, 1.5);
+    CHECK(r.loopability == 0.0f);
+
+    // A length that is no whole number of beats leaves the autocorrelation estimate
+    std::vector<float> odd = Clicks(126.0f, 8.3f, 48000);
+    CHECK(AnalyzeRhythm(odd.data(), (int)odd.size(), (int)odd.size(), 48000, &r));
+    CHECK(r.onsets == 18);
+    CHECK_NEAR(r.tempo, 126.0, 1.0);
+    CHECK(r.loopability < 0.6f);
+
+    // A one-shot and a steady tone: a single onset, no pulse
+    std::vector<float> hit = Clicks(40.0f, 1.5f, 44100);
+    CHECK(AnalyzeRhythm(hit.data(), (int)hit.size(), (int)hit.size(), 44100, &r));
+    CHECK(r.onsets == 1 && r.tempo == 0.0f && r.loopability == 0.0f);
+    std::vector<short> tone = Sine(220.0f, 0.5f, 44100, 3.0f);
+    SampleAnalysis a;
+    CHECK(AnalyzePcm(tone.data(), (int)tone.size(), 44100, 1, &a));
+    CHECK(a.rhythm.onsets == 1 && a.rhythm.tempo == 0.0f && a.features[FEAT_LOOP] == 0.0f);
+
+    // Shorter than one frame: nothing to analyse
+    CHECK(!AnalyzeRhythm(loop.data(), 100, 100, 44100, &r));
+    CHECK(r.onsets == 0 && r.tempo == 0.0f);
+
+    // The import analysis carries the result; two onsets per second
+    std::vector<float> stereo(loop.size() * 2);
+    for (size_t i = 0; i < loop.size(); i++) stereo[i * 2] = stereo[i * 2 + 1] = loop[i];
+    CHECK(AnalyzePcm(stereo.data(), (int)stereo.size(), 44100, 2, &a));
+    CHECK(a.rhythm.onsets == 8 && a.rhythm.tempo == 120.0f);
+    CHECK_NEAR(a.features[FEAT_ONSETS], log(3.0), 1e-3);
+    CHECK(a.features[FEAT_LOOP] > 0.6f);
+}
+
+static void TestDegenerate() {
+    SampleAnalysis a;
+    std::vector<short> silence(44100, 0);
+    CHECK(AnalyzePcm(silence.data(), (int)silence.size(), 44100, 1, &a));
+    CHECK(a.features[FEAT_RMS] == 0.0f && a.features[FEAT_ZCR] == 0.0f);
+    for (int d = 0; d < FEATURE_DIM; d++) CHECK(std::isfinite(a.features[d]));
+    CHECK(a.fingerprintLen == 0);
+
+    CHECK(!AnalyzePcm(silence.data(), 0, 44100, 1, &a));
+    CHECK(!AnalyzePcm(silence.data(), 100, 0, 1, &a));
+    CHECK(!AnalyzePcm((const short*)NULL, 100, 44100, 1, &a));
+    CHECK(!AnalyzePcm((const float*)NULL, 100, 44100, 1, &a));
+
+    short one = 1000;
+    CHECK(AnalyzePcm(&one, 1, 44100, 1, &a));
+    for (int d = 0; d < FEATURE_DIM; d++) CHECK(std::isfinite(a.features[d]));
+
+    // Rates so low the fingerprint hop rounds to zero
+    std::vector<float> slow(220);
+    for (size_t i = 0; i < slow.size(); i++) slow[i] = sinf(0.5f * i);
+    unsigned int fp[FP_FRAMES];
+    CHECK(ComputeFingerprint(slow.data(), (int)slow.size(), 22, fp, FP_FRAMES) == 0);
+}
+
+// Golden values for the checked-in fixtures; update deliberately when the analysis changes
+static void TestFixtures() {
+    struct Golden { const char* name; int rate, ch, frames; float features[FEATURE_DIM]; };
+    static const Golden golden[] = {
+        { "tone_44k_mono.wav", 44100, 1, 44100, { 0.266812f, 0.250442f, 0.807564f, 0.693147f, 0.0312479f, 0.0467269f, 0.187158f, 0.00952832f, 0.0f, 0.693147f, 0.0f } },
+        { "tone_48k_mono.wav", 48000, 1, 48000, { 0.266383f, 0.229174f, 0.80371f, 0.693147f, 0.0312507f, 0.0467027f, 0.188242f, 0.00666661f, 0.0f, 0.693147f, 0.0f } },
+        { "hit_44k_stereo.wav", 44100, 2, 22050, { 0.265675f, 0.2952f, 0.750679f, 0.405465f, 0.000997778f, 0.0468207f, 0.401055f, 0.0157747f, 0.0242781f, 0.693147f, 0.0f } },
+    };
+    for (const Golden& g : golden) {
+        std::vector<short> pcm;
+        int rate = 0, ch = 0;
+        if (!LoadFixture(g.name, pcm, &rate, &ch)) { CHECK(false); continue; }
+        CHECK(rate == g.rate && ch == g.ch && (int)pcm.size() == g.frames * g.ch);
+        SampleAnalysis a;
+        CHECK(AnalyzePcm(pcm.data(), (int)pcm.size(), rate, ch, &a));
+        for (int d = 0; d < FEATURE_DIM; d++) {
+            if (fabsf(a.features[d] - g.features[d]) > 1e-3f * (1.0f + fabsf(g.features[d])))
+                fprintf(stderr, "  %s %s\n", g.name, FeatureName(d));
+            CHECK_NEAR(a.features[d], g.features[d], 1e-3 * (1.0 + fabs(g.features[d])));
+        }
+    }
+}
+
+// The same recording at 44.1 and 48 kHz groups together; a different sound does not join
+static void TestDuplicates() {
+    const char* names[] = { "tone_44k_mono.wav", "hit_44k_stereo.wav", "tone_48k_mono.wav" };
+    std::vector<unsigned int> fps(3 * FP_FRAMES);
+    int lens[3], group[3];
+    for (int i = 0; i < 3; i++) {
+        std::vector<short> pcm;
+        int rate, ch;
+        if (!LoadFixture(names[i], pcm, &rate, &ch)) { CHECK(false); return; }
+        SampleAnalysis a;
+        AnalyzePcm(pcm.data(), (int)pcm.size(), rate, ch, &a);
+        memcpy(&fps[i * FP_FRAMES], a.fingerprint, sizeof(a.fingerprint));
+        lens[i] = a.fingerprintLen;
+        CHECK(lens[i] > 16);
+    }
+    CHECK(FingerprintBer(&fps[0], lens[0], &fps[0], lens[0], 0) == 0.0f);
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        int groups = GroupDuplicates(fps.data(), lens, FP_FRAMES, 3, 0.2f, group, threads);
+        CHECK(groups == 1);
+        CHECK(group[0] == 0 && group[2] == 0 && group[1] == -1);
+    }
+}
+
+// Patched duplicate index agrees with regrouping from scratch
+static void TestDuplicateIndex() {
+    const int sounds = 20, n = sounds * 3;
+    std::vector<unsigned int> fps((size_t)n * FP_FRAMES);
+    std::vector<int> lens(n);
+    std::vector<float> mono(22050);
+    for (int i = 0; i < n; i++) {
+        int sound = i % sounds;
+        float gain = 1.0f - 0.1f * (i / sounds), f1 = 150.0f + 37.0f * sound, lp = 0.0f;
+        for (int t = 0; t < 22050; t++) {
+            float noise = (float)(HashU32(sound * 100003 + t) % 2001) / 1000.0f - 1.0f;
+            lp += 0.3f * (noise - lp);
+            float env = expf(-3.0f * t / 22050.0f);
+            mono[t] = gain * env * (0.4f * sinf(6.2831853f * f1 * t / 22050.0f) + 0.4f * lp);
+        }
+        lens[i] = ComputeFingerprint(mono.data(), 22050, 22050, &fps[(size_t)i * FP_FRAMES], FP_FRAMES);
+    }
+
+    auto Batch = [&](const std::vector<int>& len, std::vector<int>& group) {
+        group.resize(n);
+        return GroupDuplicates(fps.data(), len.data(), FP_FRAMES, n, 0.2f, group.data(), 1);
+    };
+    std::vector<int> expect, got(n);
+    CHECK(Batch(lens, expect) == sounds);
+
+    DuplicateIndex index;
+    index.Build(fps.data(), lens.data(), FP_FRAMES, n / 2);
+    for (int i = n / 2; i < n; i++) index.Add(i, &fps[(size_t)i * FP_FRAMES], lens[i]);
+    CHECK(index.Groups(n, got.data()) == sounds && got == expect);
+
+    // Removed files leave their groups; survivors regroup as if never paired with them
+    std::vector<int> removedLens = lens;
+    for (int id : { 5, 17, 25, 45 }) { index.Remove(id); removedLens[id] = 0; }
+    int groups = index.Groups(n, got.data());
+    CHECK(groups == Batch(removedLens, expect) && got == expect);
+    CHECK(got[5] == -1 && got[25] == -1 && got[45] == -1);
+
+    // Re-adding restores the original grouping, and Add replaces an existing id
+    for (int id : { 5, 17, 25, 45 }) index.Add(id, &fps[(size_t)id * FP_FRAMES], lens[id]);
+    CHECK(index.Groups(n, got.data()) == sounds && got == (Batch(lens, expect), expect));
+    index.Add(45, &fps[(size_t)3 * FP_FRAMES], lens[3]);
+    index.Groups(n, got.data());
+    CHECK(got[45] == 3 && got[3] == 3 && got[23] == 3 && got[5] == 5);
+}
+
+static void MakeClusters(int n, int clusters, std::vector<float>& feats, std::vector<int>& label) {
+    feats.resize((size_t)n * FEATURE_DIM);
+    label.resize(n);
+    for (int i = 0; i < n; i++) {
+        label[i] = i % clusters;
+        for (int d = 0; d < FEATURE_DIM; d++) {
+            float center = (float)(HashU32(label[i] * 97 + d) % 1000) / 100.0f;
+            float noise = (float)(HashU32(i * 131 + d) % 1000) / 1000.0f - 0.5f;
+            feats[(size_t)i * FEATURE_DIM + d] = center + noise * 0.3f;
+        }
+    }
+}
+
+// Nearest map neighbour shares the point's cluster for (almost) every point
+static float NeighbourPurity(const std::vector<float>& xy, const std::vector<int>& label) {
+    int n = (int)label.size(), same = 0;
+    KdTree tree;
+    tree.Build(xy.data(), n, 2);
+    for (int i = 0; i < n; i++) {
+        int idx; float dist;
+        if (tree.Query(&xy[i * 2], 1, i, &idx, &dist) == 1 && label[idx] == label[i]) same++;
+    }
+    return (float)same / n;
+}
+
+static void TestLayouts() {
+    std::vector<float> feats;
+    std::vector<int> label;
+    const int n = 1200;
+    MakeClusters(n, 6, feats, label);
+    for (int m = LAYOUT_PCA; m < LAYOUT_COUNT; m++) {
+        LayoutEngine engine;
+        engine.method = m;
+        engine.tsneIterations = 300;
+        std::vector<float> xy((size_t)n * 2), again((size_t)n * 2);
+        engine.Fit(feats.data(), n - 12, xy.data());
+        engine.Place(feats.data() + (size_t)(n - 12) * FEATURE_DIM, 12, xy.data() + (size_t)(n - 12) * 2);
+        for (float v : xy) CHECK(std::isfinite(v));
+        float purity = NeighbourPurity(xy, label);
+        if (purity < 0.95f) fprintf(stderr, "  %s purity %.3f\n", LayoutName(m), purity);
+        CHECK(purity >= 0.95f);
+        CHECK(engine.FittedCount() == n);
+
+        // A saved and reloaded model places new points exactly as the original does
+        FILE* f = tmpfile();
+        CHECK(f != NULL);
+        if (f) {
+            CHECK(engine.Save(f));
+            rewind(f);
+            LayoutEngine loaded;
+            CHECK(!loaded.Load(f, n - 1) && loaded.FittedCount() == 0);
+            rewind(f);
+            CHECK(loaded.Load(f, n));
+            fclose(f);
+            CHECK(loaded.FittedCount() == n);
+            float a[6], b[6];
+            engine.Place(feats.data(), 3, a);
+            loaded.Place(feats.data(), 3, b);
+            for (int j = 0; j < 6; j++) CHECK(a[j] == b[j]);
+        }
+
+        // A corrupt count larger than the file is refused before anything is allocated
+        FILE* g = tmpfile();
+        if (g) {
+            int header[5] = { 0x594C4D41, 1, FEATURE_DIM, m, 1 << 30 };
+            fwrite(header, sizeof(header), 1, g);
+            rewind(g);
+            LayoutEngine corrupt;
+            CHECK(!corrupt.Load(g, 0x7FFFFFFF) && corrupt.FittedCount() == 0);
+            fclose(g);
+        }
+
+        // Same input, different thread count: same layout
+        LayoutEngine other;
+        other.method = m;
+        other.tsneIterations = 300;
+        other.numThreads = 1;
+        other.Fit(feats.data(), n - 12, again.data());
+        float maxDiff = 0;
+        for (int i = 0; i < (n - 12) * 2; i++) maxDiff = fmaxf(maxDiff, fabsf(xy[i] - again[i]));
+        CHECK(maxDiff < 1e-3f);
+    }
+
+    // PCA sums its covariance in fixed chunks: bit-identical at any thread count
+    const int big = 10000;
+    MakeClusters(big, 6, feats, label);
+    std::vector<float> one((size_t)big * 2), many((size_t)big * 2);
+    LayoutEngine single, threaded;
+    single.method = threaded.method = LAYOUT_PCA;
+    single.numThreads = 1;
+    threaded.numThreads = 5;
+    single.Fit(feats.data(), big, one.data());
+    threaded.Fit(feats.data(), big, many.data());
+    CHECK(one == many);
+}
+
+static void TestRelax() {
+    const int n = 3000;
+    std::vector<float> base((size_t)n * 2);
+    std::vector<unsigned int> keys(n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = HashU32(i);
+        // Plenty of exact duplicates to exercise the coincident-point split
+        base[i * 2] = (float)(HashU32(i % 2000 * 2) % 1000) / 1000.0f;
+        base[i * 2 + 1] = (float)(HashU32(i % 2000 * 2 + 1) % 1000) / 1000.0f;
+    }
+    float minDist = 0.4f * sqrtf(1.0f / n);
+    std::vector<float> a = base, b = base;
+    RelaxOverlaps(a.data(), keys.data(), n, minDist, 16, 1);
+    RelaxOverlaps(b.data(), keys.data(), n, minDist, 16, 8);
+    CHECK(memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+
+    auto CountClose = [&](const std::vector<float>& xy, float r) {
+        KdTree tree;
+        tree.Build(xy.data(), n, 2);
+        int close = 0;
+        for (int i = 0; i < n; i++) {
+            int idx; float dist;
+            if (tree.Query(&xy[i * 2], 1, i, &idx, &dist) == 1 && dist < r * r) close++;
+        }
+        return close;
+    };
+    int before = CountClose(base, minDist * 0.5f), after = CountClose(a, minDist * 0.5f);
+    CHECK(before > 0);
+    CHECK(after * 10 < before);
+}
+
+static void TestClustering() {
+    // Five tight blobs in feature space plus sparse uniform points
+    const int blobs = 5, perBlob = 400, spread = 200, n = blobs * perBlob + spread;
+    std::vector<float> feats((size_t)n * FEATURE_DIM);
+    auto Blob = [&](int b, int i, float* out) {
+        for (int d = 0; d < FEATURE_DIM; d++)
+            out[d] = (float)(HashU32(b * 31 + d) % 100) / 10.0f + ((float)(HashU32(i * 17 + d) % 1000) / 1000.0f - 0.5f) * 0.4f;
+    };
+    for (int i = 0; i < blobs * perBlob; i++) Blob(i % blobs, i, &feats[(size_t)i * FEATURE_DIM]);
+    for (int i = blobs * perBlob; i < n; i++)
+        for (int d = 0; d < FEATURE_DIM; d++) feats[(size_t)i * FEATURE_DIM + d] = (float)(HashU32(i * 7 + d) % 10000) / 1000.0f;
+
+    // Every blob lands in one cluster of its own
+    auto Pure = [&](const std::vector<int>& labels, int count) {
+        std::vector<int> of(blobs, -2);
+        bool ok = true;
+        for (int i = 0; i < blobs * perBlob; i++) {
+            int b = i % blobs;
+            if (of[b] == -2) of[b] = labels[i];
+            ok &= labels[i] == of[b] && labels[i] >= 0 && labels[i] < count;
+        }
+        for (int a = 0; a < blobs; a++)
+            for (int b = a + 1; b < blobs; b++) ok &= of[a] != of[b];
+        return ok;
+    };
+
+    ClusterEngine km;
+    km.clusters = blobs + 1;
+    km.numThreads = 1;
+    std::vector<int> labels(n), labels4(n);
+    km.Fit(feats.data(), n, labels.data());
+    CHECK(km.Count() == blobs + 1 && Pure(labels, km.Count()));
+    int total = 0;
+    for (int c = 0; c < km.Count(); c++) { total += km.Size(c); CHECK(c == 0 || km.Size(c) <= km.Size(c - 1)); }
+    CHECK(total == n);
+    km.numThreads = 4;
+    km.Fit(feats.data(), n, labels4.data());
+    CHECK(labels == labels4);                               // Same on any thread count
+
+    // New points join their blob's cluster; fitted labels are left alone
+    float extra[3 * FEATURE_DIM];
+    int extraLabels[3];
+    for (int j = 0; j < 3; j++) Blob(j, 90000 + j, &extra[j * FEATURE_DIM]);
+    km.Assign(extra, 3, extraLabels);
+    CHECK(extraLabels[0] == labels[0] && extraLabels[1] == labels[1] && extraLabels[2] == labels[2]);
+    CHECK(km.FittedCount() == n + 3);
+
+    ClusterEngine db;
+    db.method = CLUSTER_DBSCAN;
+    db.numThreads = 1;
+    db.Fit(feats.data(), n, labels.data());
+    int noise = 0;
+    for (int i = blobs * perBlob; i < n; i++) noise += labels[i] == CLUSTER_NOISE;
+    CHECK(db.Count() >= blobs && Pure(labels, db.Count()) && noise > spread / 2 && db.Radius() > 0);
+    db.numThreads = 4;
+    db.Fit(feats.data(), n, labels4.data());
+    CHECK(labels == labels4);
+    db.Assign(extra, 3, extraLabels);
+    CHECK(extraLabels[0] == labels[0] && extraLabels[2] == labels[2]);
+    float far[FEATURE_DIM];
+    for (int d = 0; d < FEATURE_DIM; d++) far[d] = 1000.0f;
+    db.Assign(far, 1, extraLabels);
+    CHECK(extraLabels[0] == CLUSTER_NOISE);
+
+    // Fitting a sample and labelling the rest keeps the blobs and the size order
+    db.fitSample = 700;
+    db.Fit(feats.data(), n, labels.data());
+    CHECK(db.Count() >= blobs && Pure(labels, db.Count()));
+    for (int c = 1; c < db.Count(); c++) CHECK(db.Size(c) <= db.Size(c - 1));
+    db.fitSample = 20000;
+
+    // Degenerate inputs
+    db.Fit(feats.data(), 3, labels.data());
+    CHECK(db.Count() == 0 && labels[0] == CLUSTER_NOISE);
+    km.Fit(feats.data(), 1, labels.data());
+    CHECK(km.Count() == 1 && labels[0] == 0);
+    km.Fit(NULL, 0, NULL);
+    CHECK(km.Count() == 0);
+}
+
+static void TestKdTree() {
+    const int n = 2000, dim = 5, k = 8;
+    std::vector<float> pts((size_t)n * dim);
+    for (size_t i = 0; i < pts.size(); i++) pts[i] = (float)(HashU32((unsigned int)i) % 10000) / 1000.0f;
+    KdTree tree;
+    tree.Build(pts.data(), n, dim);
+    int idx[k]; float dist[k];
+    for (int q = 0; q < 100; q++) {
+        int self = (int)(HashU32(q + 77) % n);
+        std::vector<std::pair<float, int>> all;
+        for (int i = 0; i < n; i++) {
+            if (i == self) continue;
+            float d2 = 0;
+            for (int d = 0; d < dim; d++) { float t = pts[i * dim + d] - pts[self * dim + d]; d2 += t * t; }
+            all.push_back({ d2, i });
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        CHECK(tree.Query(&pts[self * dim], k, self, idx, dist) == k);
+        for (int j = 0; j < k; j++) CHECK_NEAR(dist[j], all[j].first, 1e-4);
+        // A radius limit keeps only the neighbours inside it
+        int inside = 0;
+        while (inside < k && all[inside].first < all[3].first) inside++;
+        CHECK(tree.Query(&pts[self * dim], k, self, idx, dist, all[3].first) == inside);
+    }
+
+    std::vector<int> gIdx;
+    std::vector<float> gDist;
+    BuildKnnGraph(pts.data(), n, dim, k, 4, gIdx, gDist);
+    CHECK((int)gIdx.size() == n * k);
+    tree.Query(&pts[0], k, 0, idx, dist);
+    for (int j = 0; j < k; j++) CHECK(gIdx[j] == idx[j]);
+}
+
+static void TestSimilarity() {
+    std::vector<float> feats;
+    std::vector<int> label;
+    const int n = 4000;
+    MakeClusters(n, 20, feats, label);
+    SimilarityIndex index;
+    index.Build(feats.data(), n);
+    CHECK(index.Size() == n);
+
+    int ids[10]; float dists[10];
+    int sameCluster = 0, total = 0;
+    for (int q = 0; q < 200; q++) {
+        int id = (int)(HashU32(q) % n);
+        int found = index.QueryId(id, 10, ids, dists);
+        CHECK(found == 10);
+        for (int j = 0; j < found; j++) {
+            CHECK(ids[j] != id);
+            if (j > 0) CHECK(dists[j] >= dists[j - 1]);
+            sameCluster += label[ids[j]] == label[id];
+            total++;
+        }
+    }
+    CHECK(sameCluster * 100 >= total * 98);
+
+    index.Remove(5);
+    CHECK(index.Size() == n - 1);
+    for (int q = 0; q < 50; q++) {
+        int found = index.QueryId(q == 5 ? 6 : q, 10, ids, dists);
+        for (int j = 0; j < found; j++) CHECK(ids[j] != 5);
+    }
+    index.Add(5, &feats[5 * FEATURE_DIM]);
+    CHECK(index.Size() == n);
+    CHECK(index.Query(&feats[5 * FEATURE_DIM], 1, -1, ids, dists) == 1 && ids[0] == 5 && dists[0] == 0.0f);
+
+    // Save and reload against the same samples: identical answers
+    std::vector<unsigned long long> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = HashU32(i) * 2654435761ULL;
+    FILE* f = tmpfile();
+    CHECK(f != NULL);
+    if (!f) return;
+    CHECK(index.Save(f, keys.data(), feats.data(), n));
+    rewind(f);
+    SimilarityIndex loaded;
+    CHECK(loaded.Load(f, keys.data(), feats.data(), n));
+    fclose(f);
+    CHECK(loaded.Size() == n);
+    int ids2[10]; float dists2[10];
+    for (int q = 0; q < 50; q++) {
+        int a = index.QueryId(q, 10, ids, dists), b = loaded.QueryId(q, 10, ids2, dists2);
+        CHECK(a == b);
+        for (int j = 0; j < a && j < b; j++) CHECK(ids[j] == ids2[j]);
+    }
+
+    // A stream that takes no writes fails the save
+    FILE* ro = fopen((g_fixtures + "/tone_44k_mono.wav").c_str(), "rb");
+    if (ro) {
+        CHECK(!index.Save(ro, keys.data(), feats.data(), n));
+        fclose(ro);
+    }
+
+    // Corrupt list counts are refused before anything is allocated
+    FILE* g = tmpfile();
+    if (!g) return;
+    int header[4] = { 0x58495641, 1, FEATURE_DIM, 0x7FFFFFFF };
+    fwrite(header, sizeof(header), 1, g);
+    rewind(g);
+    CHECK(!loaded.Load(g, keys.data(), feats.data(), n));
+    fclose(g);
+}
+
+static void TestBoundsAndSort() {
+    float xy[] = { 0, 0, 10, 5, -2, 1, 100, 100 };
+    float rms[] = { 1.0f, 1.0f, 1.0f, 0.01f };  // Last point is quiet and ignored
+    MapBounds b = ComputeMapBounds(xy, rms, 4);
+    CHECK_NEAR(b.minX, -2 - 1.2, 1e-5);
+    CHECK_NEAR(b.maxX, 10 + 1.2, 1e-5);
+    CHECK_NEAR(b.minY, 0 - 0.5, 1e-5);
+    CHECK_NEAR(b.maxY, 5 + 0.5, 1e-5);
+
+    unsigned int keys[] = { 5, 1, 5, 0, 1 };
+    int order[5];
+    SortIndicesByKey(keys, 5, order);
+    int expected[] = { 3, 1, 4, 0, 2 };
+    CHECK(memcmp(order, expected, sizeof(order)) == 0);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) g_fixtures = argv[1];
+    TestPcmReader();
+    TestFlac();
+    TestFlacFixtures();
+    TestMp3Fixtures();
+    TestHighRes();
+    TestSine();
+    TestLoudness();
+    TestRhythm();
+    TestDegenerate();
+    TestFixtures();
+    TestDuplicates();
+    TestDuplicateIndex();
+    TestWatcher();
+    TestTrace();
+    TestFrameProfiler();
+    TestSlotReservation();
+    TestMetadataFilters();
+    TestTileRaster();
+    TestThumbnails();
+    TestProjection();
+    TestSelection();
+    TestLayouts();
+    TestRelax();
+    TestKdTree();
+    TestClustering();
+    TestSimilarity();
+    TestBoundsAndSort();
+    printf("%d checks, %d failures\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}